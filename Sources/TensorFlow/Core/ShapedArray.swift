@@ -30,6 +30,10 @@ internal class TensorBuffer<Scalar> {
 
   init(count: Int) { self.count = count }
 
+  /// Whether the storage can be written in place. Buffers aliasing memory owned by a runtime return
+  /// `false`, and get copied into an `ArrayTensorBuffer` before being mutated.
+  var isMutable: Bool { true }
+
   func withUnsafeBufferPointer<R>(
     _ body: (UnsafeBufferPointer<Scalar>) throws -> R
   ) rethrows -> R {
@@ -383,7 +387,7 @@ public struct ShapedArray<Scalar>: _ShapedArrayProtocol {
 
 extension ShapedArray {
   fileprivate mutating func ensureUniquelyReferenced() {
-    if isKnownUniquelyReferenced(&buffer) { return }
+    if buffer.isMutable && isKnownUniquelyReferenced(&buffer) { return }
     let oldBuffer = buffer
     debugLog("Unique reference check")
     buffer = oldBuffer.withUnsafeBufferPointer { oldBufferPointer in
@@ -74,7 +74,7 @@ extension Tensor {
 #if USING_X10_BACKEND
   public var rank: Int {
     @_semantics("autodiff.nonvarying")
-    get { xlaTensor.shape.count }
+    get { xlaTensor.rank }
   }
 #else
   public var rank: Int {
@@ -201,12 +201,20 @@ extension Tensor {
   public var array: ShapedArray<Scalar> {
     debugLog("Returning a host copy of array.")
 #if USING_X10_BACKEND
-    return ShapedArray<Scalar>(shape: shape.dimensions, scalars: scalars)
+    return _materializedArray
 #else
     return handle.makeHostCopy()
 #endif
   }
 
+#if USING_X10_BACKEND
+  /// A `ShapedArray` which aliases the host buffer materialized by x10, without copying it.
+  @usableFromInline
+  internal var _materializedArray: ShapedArray<Scalar> {
+    return xlaTensor.fetchShapedArray(Scalar.self)
+  }
+#endif
+
   @differentiable( where Scalar: TensorFlowFloatingPoint)
   public var scalars: [Scalar] {
 #if USING_X10_BACKEND
@@ -310,10 +318,22 @@ extension Tensor {
       The shape requires \(shape.contiguousSize) scalars but \(scalars.count) were \
       provided.
       """)
+#if USING_X10_BACKEND
+    self.init(shape: shape, borrowing: scalars, on: device)
+#else
     self = scalars.withUnsafeBufferPointer { bufferPointer in
       Tensor(shape: shape, scalars: bufferPointer, on: device)
     }
+#endif
+  }
+
+#if USING_X10_BACKEND
+  /// Creates a tensor which aliases the storage of `scalars` instead of copying it.
+  @usableFromInline
+  internal init(shape: TensorShape, borrowing scalars: [Scalar], on device: Device) {
+    self.init(_xla: XLATensor.make(scalars, shape.dimensions, on: device))
   }
+#endif
 
   /// Creates a tensor with the specified shape and contiguous scalars in row-major order.
   ///
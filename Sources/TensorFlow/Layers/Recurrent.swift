@@ -65,6 +65,14 @@ where
 
   /// Returns a zero-valued state with shape compatible with the provided input.
   func zeroState(for input: TimeStepInput) -> State
+
+  /// Returns the outputs obtained from applying the cell to the inputs of all the time steps, in
+  /// order, starting from the initial state.
+  ///
+  /// The default implementation applies the cell once per time step. Cells may run it as a single
+  /// loop instead, so that the size of the graph does not depend on the number of time steps.
+  @differentiable(wrt: (self, inputs, initialState))
+  func applied(over inputs: [TimeStepInput], initialState: State) -> [TimeStepOutput]
 }
 
 extension RNNCell {
@@ -87,6 +95,62 @@ extension RNNCell {
   public func call(input: TimeStepInput, state: State) -> RNNCellOutput<TimeStepOutput, State> {
     self(RNNCellInput(input: input, state: state))
   }
+
+  @differentiable(wrt: (self, inputs, initialState))
+  public func applied(over inputs: [TimeStepInput], initialState: State) -> [TimeStepOutput] {
+    var currentHiddenState = initialState
+    var timeStepOutputs: [TimeStepOutput] = []
+    for timeStepInput in inputs {
+      let output = self(input: timeStepInput, state: currentHiddenState)
+      currentHiddenState = output.state
+      timeStepOutputs.append(output.output)
+    }
+    return timeStepOutputs
+  }
+
+  @usableFromInline
+  @derivative(of: applied, wrt: (self, inputs, initialState))
+  internal func _vjpApplied(
+    over inputs: [TimeStepInput],
+    initialState: State
+  ) -> (
+    value: [TimeStepOutput],
+    pullback: (Array<TimeStepOutput>.TangentVector)
+      -> (TangentVector, Array<TimeStepInput>.TangentVector, State.TangentVector)
+  ) {
+    let timeStepCount = inputs.count
+    var currentHiddenState = initialState
+    var timeStepOutputs: [TimeStepOutput] = []
+    timeStepOutputs.reserveCapacity(timeStepCount)
+    var backpropagators: [Backpropagator] = []
+    backpropagators.reserveCapacity(timeStepCount)
+    for timestep in inputs {
+      let (output, backpropagator) = appliedForBackpropagation(
+        to: .init(input: timestep, state: currentHiddenState))
+      currentHiddenState = output.state
+      timeStepOutputs.append(output.output)
+      backpropagators.append(backpropagator)
+    }
+    return (
+      timeStepOutputs,
+      { 𝛁outputs in
+        precondition(
+          𝛁outputs.base.count == timeStepCount,
+          "The number of output gradients must equal the number of time steps")
+        var 𝛁cell = TangentVector.zero
+        var 𝛁state = State.TangentVector.zero
+        var reversed𝛁inputs: [TimeStepInput.TangentVector] = []
+        reversed𝛁inputs.reserveCapacity(timeStepCount)
+        for (𝛁output, backpropagator) in zip(𝛁outputs.base, backpropagators).reversed() {
+          let (new𝛁cell, 𝛁input) = backpropagator(.init(output: 𝛁output, state: 𝛁state))
+          𝛁cell += new𝛁cell
+          𝛁state = 𝛁input.state
+          reversed𝛁inputs.append(𝛁input.input)
+        }
+        return (𝛁cell, .init(Array(reversed𝛁inputs.reversed())), 𝛁state)
+      }
+    )
+  }
 }
 
 /// A simple RNN cell.
@@ -97,6 +161,7 @@ public struct SimpleRNNCell<Scalar: TensorFlowFloatingPoint>: RNNCell {
   // TODO(TF-507): Revert to `typealias State = Tensor<Scalar>` after SR-10697 is fixed.
   public struct State: Equatable, Differentiable, VectorProtocol, KeyPathIterable {
     public var value: Tensor<Scalar>
+    @differentiable
     public init(_ value: Tensor<Scalar>) {
       self.value = value
     }
@@ -343,6 +408,57 @@ public struct GRUCell<Scalar: TensorFlowFloatingPoint>: RNNCell {
   }
 }
 
+#if USING_X10_BACKEND
+// The cells run over all the time steps as a single scan, whose pullback is a reverse scan.
+
+extension SimpleRNNCell {
+  @differentiable(wrt: (self, inputs, initialState))
+  public func applied(over inputs: [Tensor<Scalar>], initialState: State) -> [State] {
+    if inputs.isEmpty { return [] }
+    let outputs = scan(
+      self, initial: [initialState.value], sequences: [Tensor(stacking: inputs)]
+    ) { cell, carried, steps in
+      let state = cell(input: steps[0], state: State(carried[0])).state
+      return [state.value, state.value]
+    }
+    return outputs[1].unstacked().differentiableMap { State($0) }
+  }
+}
+
+extension LSTMCell {
+  @differentiable(wrt: (self, inputs, initialState))
+  public func applied(over inputs: [Tensor<Scalar>], initialState: State) -> [State] {
+    if inputs.isEmpty { return [] }
+    let outputs = scan(
+      self, initial: [initialState.cell, initialState.hidden],
+      sequences: [Tensor(stacking: inputs)]
+    ) { cell, carried, steps in
+      let state = cell(input: steps[0], state: State(cell: carried[0], hidden: carried[1])).state
+      return [state.cell, state.hidden, Tensor(stacking: [state.cell, state.hidden])]
+    }
+    return outputs[2].unstacked().differentiableMap { State(cell: $0[0], hidden: $0[1]) }
+  }
+}
+
+extension GRUCell {
+  @differentiable(wrt: (self, inputs, initialState))
+  public func applied(over inputs: [Tensor<Scalar>], initialState: State) -> [State] {
+    if inputs.isEmpty { return [] }
+    // The zero state has a batch size of one, while the carried value must keep its shape.
+    let batchSize = inputs[0].shape[0]
+    let initialHidden = initialState.hidden.broadcasted(
+      to: [batchSize, initialState.hidden.shape[1]])
+    let outputs = scan(
+      self, initial: [initialHidden], sequences: [Tensor(stacking: inputs)]
+    ) { cell, carried, steps in
+      let state = cell(input: steps[0], state: State(hidden: carried[0])).state
+      return [state.hidden, state.hidden]
+    }
+    return outputs[1].unstacked().differentiableMap { State(hidden: $0) }
+  }
+}
+#endif
+
 public struct RNN<Cell: RNNCell>: Layer {
   public typealias Input = [Cell.TimeStepInput]
   public typealias Output = [Cell.TimeStepOutput]
@@ -359,14 +475,7 @@ public struct RNN<Cell: RNNCell>: Layer {
     initialState: Cell.State
   ) -> [Cell.TimeStepOutput] {
     if inputs.isEmpty { return [Cell.TimeStepOutput]() }
-    var currentHiddenState = initialState
-    var timeStepOutputs: [Cell.TimeStepOutput] = []
-    for timeStepInput in inputs {
-      let output = cell(input: timeStepInput, state: currentHiddenState)
-      currentHiddenState = output.state
-      timeStepOutputs.append(output.output)
-    }
-    return timeStepOutputs
+    return cell.applied(over: inputs, initialState: initialState)
   }
 
   @differentiable(wrt: (self,inputs,initialState))
@@ -377,50 +486,6 @@ public struct RNN<Cell: RNNCell>: Layer {
     callAsFunction(inputs, initialState: initialState)
   }
 
-  @usableFromInline
-  @derivative(of: callAsFunction, wrt: (self,inputs,initialState))
-  internal func _vjpCallAsFunction(
-    _ inputs: [Cell.TimeStepInput],
-    initialState: Cell.State
-  ) -> (
-    value: [Cell.TimeStepOutput],
-    pullback: (Array<Cell.TimeStepOutput>.TangentVector)
-      -> (TangentVector, Array<Cell.TimeStepInput>.TangentVector, Cell.State.TangentVector)
-  ) {
-    let timeStepCount = inputs.count
-    var currentHiddenState = initialState
-    var timeStepOutputs: [Cell.TimeStepOutput] = []
-    timeStepOutputs.reserveCapacity(timeStepCount)
-    var backpropagators: [Cell.Backpropagator] = []
-    backpropagators.reserveCapacity(timeStepCount)
-    for timestep in inputs {
-      let (output, backpropagator) = cell.appliedForBackpropagation(
-        to: .init(input: timestep, state: currentHiddenState))
-      currentHiddenState = output.state
-      timeStepOutputs.append(output.output)
-      backpropagators.append(backpropagator)
-    }
-    return (
-      timeStepOutputs,
-      { 𝛁outputs in
-        precondition(
-          𝛁outputs.base.count == timeStepCount,
-          "The number of output gradients must equal the number of time steps")
-        var 𝛁cell = Cell.TangentVector.zero
-        var 𝛁state = Cell.State.TangentVector.zero
-        var reversed𝛁inputs: [Cell.TimeStepInput.TangentVector] = []
-        reversed𝛁inputs.reserveCapacity(timeStepCount)
-        for (𝛁output, backpropagator) in zip(𝛁outputs.base, backpropagators).reversed() {
-          let (new𝛁cell, 𝛁input) = backpropagator(.init(output: 𝛁output, state: 𝛁state))
-          𝛁cell += new𝛁cell
-          𝛁state = 𝛁input.state
-          reversed𝛁inputs.append(𝛁input.input)
-        }
-        return (.init(cell: 𝛁cell), .init(Array(reversed𝛁inputs.reversed())), 𝛁state)
-      }
-    )
-  }
-
   @differentiable
   public func callAsFunction(_ inputs: [Cell.TimeStepInput]) -> [Cell.TimeStepOutput] {
     let initialState = withoutDerivative(at: cell.zeroState(for: inputs[0]))
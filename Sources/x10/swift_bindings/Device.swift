@@ -170,6 +170,18 @@ extension CDevice {
   }
 }
 
+/// ReplicatedTensorBarrier syncs all live tensors on `devices[0]`, by tracing and compiling their
+/// graph once and running it on all `devices` as replicas. The other replicas are fed with the
+/// values registered through `Tensor.setReplicas(_:)` or computed by previous replicated barriers,
+/// and otherwise with the value on `devices[0]`. This call blocks until the computation is
+/// complete.
+public func ReplicatedTensorBarrier(devices: [Device]) {
+  precondition(!devices.isEmpty, "A replicated barrier needs at least one device")
+  devices.withDeviceList { devices in
+    XLATensor_ReplicatedTensorBarrier(&devices)
+  }
+}
+
 /// LazyTensorBarrier ensures all live tensors (on device if provided) are scheduled and running.
 /// If wait is set to true, this call blocks until the computation is complete.
 public func LazyTensorBarrier(on device: Device? = nil, devices: [Device] = [], wait: Bool = false)
@@ -182,3 +194,14 @@ public func LazyTensorBarrier(on device: Device? = nil, devices: [Device] = [],
     }
   }
 }
+
+/// Returns the estimated peak device memory, in bytes, needed to run the computation that the next
+/// `LazyTensorBarrier` would run for the live tensors (on device if provided), parameters included.
+/// Nothing is compiled or run, so a training step can be traced at a candidate batch size and
+/// checked against the device memory before reaching its barrier.
+public func EstimatedPeakMemory(on device: Device? = nil) -> Int {
+  if var cdevice = device?.cdevice {
+    return Int(XLATensor_EstimatePeakMemory(&cdevice))
+  }
+  return Int(XLATensor_EstimatePeakMemory(nil))
+}
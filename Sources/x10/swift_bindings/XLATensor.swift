@@ -46,12 +46,36 @@ struct XLATensor {
   let handleDeleter: Handle
 }
 
+/// Keeps the storage of a Swift array alive while the x10 runtime aliases it.
+private final class BorrowedArrayStorage<Scalar> {
+  let scalars: [Scalar]
+
+  init(_ scalars: [Scalar]) {
+    self.scalars = scalars
+  }
+}
+
 extension XLATensor {
-  /// TODO(parkers): Add support for other types and aliasing.
+  /// Creates a tensor which aliases the storage of `data` instead of copying it. The array
+  /// storage is retained until the runtime releases the buffer.
   static func make<Scalar: XLAScalarType>(
     _ data: [Scalar], _ dims: [Int], on device: Device = Device.default
   ) -> XLATensor {
-    data.withUnsafeBufferPointer { data in return make(data, dims, on: device) }
+    let storage = BorrowedArrayStorage(data)
+    // The tensor keeps reading the array after it is created, until it releases `storage`. The
+    // array is never mutated through `storage`, so its buffer stays in place until then.
+    let context = Unmanaged.passRetained(storage).toOpaque()
+    return storage.scalars.withUnsafeBufferPointer { scalars in
+      dims.withUnsafeBufferPointer { dims in
+        return XLATensor(
+          _handle:
+            borrowTensor(
+              Scalar.xlaTensorScalarType, scalars.baseAddress, scalars.count, dims.baseAddress,
+              dims.count, device.cdevice,
+              { context in Unmanaged<AnyObject>.fromOpaque(context!).release() }, context
+            ))
+      }
+    }
   }
 
   static func make<Scalar: XLAScalarType>(_ data: Scalar, on device: Device = Device.default)
@@ -101,14 +125,27 @@ extension XLATensor {
     }
   }
 
+  /// Number of dimensions of `self`.
+  var rank: Int {
+    defer { _fixLifetime(self) }
+    return XLATensor_getShape(handle, nil, 0)
+  }
+
   var shape: [Int] {
     defer { _fixLifetime(self) }
-    let shape = fetchTensorShape(handle)!
-    let rank = XLAShape_getRank(shape)
-    let data = XLAShape_getDimensions(shape)
-    let result = Array(UnsafeBufferPointer(start: data!, count: rank))
-    destroyXLAShape(shape)
-    return result.map { Int($0) }
+    // Most tensors have a small rank, so try to fetch the dimensions with a single call first.
+    var capacity = 8
+    while true {
+      var rank = 0
+      let result = [Int](unsafeUninitializedCapacity: capacity) { buffer, initializedCount in
+        buffer.baseAddress!.withMemoryRebound(to: Int64.self, capacity: capacity) {
+          rank = XLATensor_getShape(handle, $0, capacity)
+        }
+        initializedCount = Swift.min(rank, capacity)
+      }
+      if rank <= capacity { return result }
+      capacity = rank
+    }
   }
 
   func fetchTensorValues<Scalar: XLAScalarType>(_ t: Scalar.Type) -> (data: [Scalar], dims: [Int]) {
@@ -128,6 +165,20 @@ extension XLATensor {
     return (data: data, dims: dims)
   }
 
+  /// Fetches the tensor contents as a `ShapedArray` whose storage aliases the host buffer
+  /// downloaded from the device, rather than copying it into a Swift array.
+  func fetchShapedArray<Scalar: XLAScalarType>(_ t: Scalar.Type) -> ShapedArray<Scalar> {
+    defer { _fixLifetime(self) }
+    let materialized = XLATensor_materialize(handle)!
+    let dims = shape
+    precondition(
+      MaterializedTensor_getType(materialized) == Scalar.xlaTensorScalarType,
+      "Types mismatch when fetching tensor values.")
+    let buffer = MaterializedTensorBuffer<Scalar>(
+      owning: materialized, count: dims.reduce(1, *))
+    return ShapedArray(buffer: buffer, shape: dims)
+  }
+
   var dtype: XLATensorScalarType {
     defer { _fixLifetime(self) }
     return XLATensor_dtype(handle)
@@ -328,6 +379,62 @@ extension XLATensor {
     return XLATensor(_handle: XLATensor_cosh(a.handle))
   }
 
+  static func setReplicaTensors(_ t: XLATensor, _ replicas: [XLATensor]) {
+    defer { _fixLifetime(t) }
+    replicas.withArrayRef { replicas in
+      XLATensor_set_replica_tensors(t.handle, replicas)
+    }
+  }
+
+  static func saveCheckpoint(_ tensors: [XLATensor], names: [String], to path: String) {
+    withCheckpointNames(names, of: tensors) { cNames, tensors in
+      XLATensor_save_checkpoint(path, cNames, tensors)
+    }
+  }
+
+  static func saveCheckpointAsync(
+    _ tensors: [XLATensor], names: [String], to path: String
+  ) -> UnsafeMutablePointer<OpaqueCheckpointSave> {
+    return withCheckpointNames(names, of: tensors) { cNames, tensors in
+      XLATensor_save_checkpoint_async(path, cNames, tensors)!
+    }
+  }
+
+  private static func withCheckpointNames<Result>(
+    _ names: [String], of tensors: [XLATensor],
+    _ body: (UnsafePointer<UnsafePointer<CChar>?>?, OpaqueXLATensorArrayRef) -> Result
+  ) -> Result {
+    precondition(tensors.count == names.count)
+    // Packs the NUL terminated names within a single buffer.
+    var nameStorage = [CChar]()
+    var nameOffsets = [Int]()
+    for name in names {
+      nameOffsets.append(nameStorage.count)
+      nameStorage += name.utf8CString
+    }
+    return tensors.withArrayRef { tensors in
+      nameStorage.withUnsafeBufferPointer { nameStorage in
+        let cNames: [UnsafePointer<CChar>?] = nameOffsets.map { nameStorage.baseAddress! + $0 }
+        return cNames.withUnsafeBufferPointer { cNames in
+          body(cNames.baseAddress, tensors)
+        }
+      }
+    }
+  }
+
+  static func loadCheckpoint(from path: String, on device: Device) -> [(
+    name: String, tensor: XLATensor
+  )] {
+    let checkpoint = XLATensor_load_checkpoint(path, device.cdevice)
+    defer { destroyCheckpoint(checkpoint) }
+    return (0..<Checkpoint_size(checkpoint)).map { i in
+      (
+        name: String(cString: Checkpoint_name(checkpoint, i)),
+        tensor: XLATensor(_handle: Checkpoint_tensor(checkpoint, i))
+      )
+    }
+  }
+
   static func crossReplicaSum(_ inputs: [XLATensor], _ scale: Double) -> [XLATensor] {
     inputs.withArrayRef { inputs in
       let tensorListHandle = XLATensor_cross_replica_sum(inputs, scale)
@@ -369,6 +476,12 @@ extension XLATensor {
     return XLATensor(_handle: XLATensor_div(a.handle, b.handle))
   }
 
+  static func einsum(_ equation: String, _ tensors: [XLATensor]) -> XLATensor {
+    tensors.withArrayRef { tensors in
+      XLATensor(_handle: XLATensor_einsum(equation, tensors))
+    }
+  }
+
   static func eq(_ a: XLATensor, _ b: XLATensor) -> XLATensor {
     defer { _fixLifetime(a) }
     defer { _fixLifetime(b) }
@@ -521,6 +634,12 @@ extension XLATensor {
     return XLATensor(_handle: XLATensor_logicalOr(a.handle, b.handle))
   }
 
+  static func masked_select(_ input: XLATensor, _ mask: XLATensor) -> XLATensor {
+    defer { _fixLifetime(input) }
+    defer { _fixLifetime(mask) }
+    return XLATensor(_handle: XLATensor_masked_select(input.handle, mask.handle))
+  }
+
   static func matmul(_ a: XLATensor, _ b: XLATensor) -> XLATensor {
     defer { _fixLifetime(a) }
     defer { _fixLifetime(b) }
@@ -646,6 +765,11 @@ extension XLATensor {
     return XLATensor(_handle: XLATensor_nll_loss(input.handle, target.handle, ignore_index))
   }
 
+  static func nonzero(_ input: XLATensor) -> XLATensor {
+    defer { _fixLifetime(input) }
+    return XLATensor(_handle: XLATensor_nonzero(input.handle))
+  }
+
   static func permute_value(_ value: XLATensor, _ dims: [Int64]) -> XLATensor {
     defer { _fixLifetime(value) }
     return dims.withArrayRef { dims in
@@ -708,6 +832,49 @@ extension XLATensor {
     return XLATensor(_handle: XLATensor_rsqrt(a.handle))
   }
 
+  /// Runs `body` over the leading dimension of the `xs` sequences as a single loop, so that the
+  /// size of the graph does not depend on `length`. `body` is traced once, on placeholders for
+  /// the carried values and for the current steps of the sequences, and returns the new carried
+  /// values followed by the steps of the output sequences. A reverse scan runs from the last step
+  /// to the first one, like the backward pass of a recurrent layer.
+  static func scan(
+    _ initial: [XLATensor], _ xs: [XLATensor], length: Int64, reverse: Bool = false,
+    _ body: (_ carried: [XLATensor], _ steps: [XLATensor]) -> [XLATensor]
+  ) -> (carried: [XLATensor], ys: [XLATensor]) {
+    let carriedParameters = initial.enumerated().map { i, t in
+      scanParameter(t, Int64(i), sequence: false)
+    }
+    let stepParameters = xs.enumerated().map { i, t in
+      scanParameter(t, Int64(initial.count + i), sequence: true)
+    }
+    let results = body(carriedParameters, stepParameters)
+    precondition(
+      results.count >= initial.count, "The scan body must return the new carried values")
+    let parameters = carriedParameters + stepParameters
+    let outputs: [XLATensor] = initial.withArrayRef { initial in
+      xs.withArrayRef { xs in
+        parameters.withArrayRef { parameters in
+          results.withArrayRef { results in
+            let tensorListHandle = XLATensor_scan(
+              initial, xs, parameters, results, length, reverse)
+            defer {
+              destroyOpaqueXLATensorArrayRef(tensorListHandle)
+            }
+            return (0..<tensorListHandle.size).map { i in
+              XLATensor(_handle: tensorListHandle.data[i]!)
+            }
+          }
+        }
+      }
+    }
+    return (Array(outputs[..<initial.count]), Array(outputs[initial.count...]))
+  }
+
+  static func scanParameter(_ input: XLATensor, _ index: Int64, sequence: Bool) -> XLATensor {
+    defer { _fixLifetime(input) }
+    return XLATensor(_handle: XLATensor_scan_parameter(input.handle, index, sequence))
+  }
+
   static func select(_ a: XLATensor, _ dim: Int64, _ index: Int64) -> XLATensor {
     defer { _fixLifetime(a) }
     return XLATensor(_handle: XLATensor_select(a.handle, dim, index))
@@ -1029,3 +1196,36 @@ extension XLATensor {
     }
   }
 }
+
+/// `TensorBuffer` backed by a materialized x10 tensor. The storage is shared with the runtime,
+/// so it is copied into an `ArrayTensorBuffer` before being mutated.
+internal class MaterializedTensorBuffer<Scalar>: TensorBuffer<Scalar> {
+  let materialized: UnsafeMutablePointer<OpaqueMaterializedTensor>
+
+  /// Creates a buffer which takes ownership of `materialized`.
+  init(owning materialized: UnsafeMutablePointer<OpaqueMaterializedTensor>, count: Int) {
+    self.materialized = materialized
+    super.init(count: count)
+  }
+
+  override var isMutable: Bool { false }
+
+  override func withUnsafeBufferPointer<R>(
+    _ body: (UnsafeBufferPointer<Scalar>) throws -> R
+  ) rethrows -> R {
+    defer { _fixLifetime(self) }
+    let startAddress = UnsafePointer<Scalar>(
+      OpaquePointer(MaterializedTensor_getData(materialized)))
+    return try body(UnsafeBufferPointer(start: startAddress, count: count))
+  }
+
+  override func withUnsafeMutableBufferPointer<R>(
+    _ body: (inout UnsafeMutableBufferPointer<Scalar>) throws -> R
+  ) rethrows -> R {
+    fatalError("MaterializedTensorBuffer is immutable")
+  }
+
+  deinit {
+    destroyMaterializedTensor(materialized)
+  }
+}
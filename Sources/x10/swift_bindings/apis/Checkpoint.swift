@@ -0,0 +1,119 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+import x10_device
+import x10_xla_tensor_wrapper
+
+/// Saves and restores tensors with the native x10 checkpoint format.
+///
+/// Unlike `TensorFlowCheckpointReader`, which creates host tensors one at a time, the tensors are
+/// saved with a single fetch of all the device data, and restored from a memory mapped file with a
+/// single upload, so restoring a model is bound by the disk bandwidth.
+public enum X10Checkpoint {
+  /// Saves `tensors` into the checkpoint file at `path`, replacing it if it exists.
+  public static func save<Scalar: TensorFlowScalar>(
+    _ tensors: [String: Tensor<Scalar>], to path: String
+  ) {
+    let names = Array(tensors.keys)
+    XLATensor.saveCheckpoint(names.map { tensors[$0]!.xlaTensor }, names: names, to: path)
+  }
+
+  /// Saves `tensors` into the checkpoint file at `path` in the background.
+  ///
+  /// The current values of the tensors are captured before returning, so the training loop can
+  /// keep updating them right away, while the device data is fetched and written by a native
+  /// thread. Call `wait()` on the result to make sure the file has been written.
+  @discardableResult
+  public static func saveAsync<Scalar: TensorFlowScalar>(
+    _ tensors: [String: Tensor<Scalar>], to path: String
+  ) -> X10CheckpointSave {
+    let names = Array(tensors.keys)
+    return X10CheckpointSave(
+      XLATensor.saveCheckpointAsync(names.map { tensors[$0]!.xlaTensor }, names: names, to: path))
+  }
+
+  /// Loads all the tensors of the checkpoint file at `path` onto `device`.
+  public static func load<Scalar: TensorFlowScalar>(
+    from path: String, on device: Device = Device.default
+  ) -> [String: Tensor<Scalar>] {
+    var tensors = [String: Tensor<Scalar>]()
+    for (name, xlaTensor) in XLATensor.loadCheckpoint(from: path, on: device) {
+      precondition(
+        xlaTensor.dtype == Scalar.xlaTensorScalarType,
+        "Tensor \(name) of checkpoint \(path) does not hold \(Scalar.self) scalars.")
+      tensors[name] = Tensor(_xla: xlaTensor)
+    }
+    return tensors
+  }
+}
+
+/// A checkpoint save running in the background, started by `X10Checkpoint.saveAsync(_:to:)`.
+public final class X10CheckpointSave {
+  private let save: UnsafeMutablePointer<OpaqueCheckpointSave>
+
+  init(_ save: UnsafeMutablePointer<OpaqueCheckpointSave>) {
+    self.save = save
+  }
+
+  deinit {
+    // The save keeps running when the handle is released before completion.
+    destroyCheckpointSave(save)
+  }
+
+  /// Whether the checkpoint file has been written.
+  public var isCompleted: Bool {
+    return CheckpointSave_isCompleted(save)
+  }
+
+  /// Blocks until the checkpoint file has been written.
+  public func wait() {
+    CheckpointSave_wait(save)
+  }
+}
+
+extension KeyPathIterable {
+  /// Saves all the `Tensor<Float>` values found through key path iteration into the checkpoint
+  /// file at `path`.
+  public func saveX10Checkpoint(to path: String) {
+    X10Checkpoint.save(x10CheckpointTensors, to: path)
+  }
+
+  /// Like `saveX10Checkpoint(to:)`, but writes the checkpoint in the background, as
+  /// `X10Checkpoint.saveAsync(_:to:)` does.
+  @discardableResult
+  public func saveX10CheckpointAsync(to path: String) -> X10CheckpointSave {
+    return X10Checkpoint.saveAsync(x10CheckpointTensors, to: path)
+  }
+
+  /// Restores all the `Tensor<Float>` values found through key path iteration from a checkpoint
+  /// written by `saveX10Checkpoint(to:)`, placing them on `device`.
+  public mutating func loadX10Checkpoint(from path: String, on device: Device = Device.default) {
+    let tensors: [String: Tensor<Float>] = X10Checkpoint.load(from: path, on: device)
+    let keyPaths = recursivelyAllWritableKeyPaths(to: Tensor<Float>.self)
+    precondition(
+      tensors.count == keyPaths.count,
+      "The checkpoint \(path) holds \(tensors.count) tensors, expected \(keyPaths.count).")
+    for (index, keyPath) in keyPaths.enumerated() {
+      self[keyPath: keyPath] = tensors[String(index)]!
+    }
+  }
+
+  private var x10CheckpointTensors: [String: Tensor<Float>] {
+    var tensors = [String: Tensor<Float>]()
+    for (index, keyPath) in recursivelyAllWritableKeyPaths(to: Tensor<Float>.self).enumerated() {
+      tensors[String(index)] = self[keyPath: keyPath]
+    }
+    return tensors
+  }
+}
@@ -40,6 +40,15 @@ extension Tensor: CrossReplicaSummable where Scalar: TensorFlowNumeric {
   }
 }
 
+extension Tensor {
+  /// Registers `replicas` as the values this tensor takes on the other replicas of a
+  /// `ReplicatedTensorBarrier`, with `replicas[i]` living on the `i + 1` replica device. This is
+  /// how each replica gets fed its own shard of an input.
+  public func setReplicas(_ replicas: [Tensor]) {
+    XLATensor.setReplicaTensors(xlaTensor, replicas.map { $0.xlaTensor })
+  }
+}
+
 extension _KeyPathIterableBase {
   /// Helper that iterates over all key paths and applies cross replica sum.
   func crossReplicaSumChild<Root>(
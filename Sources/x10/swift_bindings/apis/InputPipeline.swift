@@ -0,0 +1,114 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+import x10_device
+import x10_xla_tensor_wrapper
+
+/// Batches of (features, labels) device tensors, produced by the x10 runtime out of an in-memory
+/// dataset.
+///
+/// Native worker threads shuffle the examples, decode the raw features (like `UInt8` pixels) into
+/// `Feature` scalars, assemble the batches and upload them to `device` ahead of the training loop,
+/// so input preparation overlaps with the computation of the previous steps.
+///
+/// Each `for` loop over the pipeline iterates over one epoch:
+///
+///     for epoch in 1...epochCount {
+///       for (x, y) in pipeline { ... }
+///     }
+public final class InputPipeline<Feature: TensorFlowScalar, Label: TensorFlowScalar>: Sequence,
+  IteratorProtocol
+{
+  private var pipeline: UnsafeMutablePointer<OpaqueInputPipeline>?
+  // The feature and label arrays. The pipeline reads the examples straight out of their storage,
+  // which is shared with the arrays of the caller rather than copied. It is retained here and
+  // never mutated, so it stays in place for the lifetime of the pipeline.
+  private let dataset: Any
+
+  /// Creates a pipeline over `exampleCount` examples, stored contiguously in `features` and
+  /// `labels`.
+  ///
+  /// - Parameters:
+  ///   - features: The features of all the examples, each one of shape `featureShape`.
+  ///   - labels: The labels of all the examples, each one of shape `labelShape`.
+  ///   - featureScale: Multiplies the features when they are decoded into `Feature` scalars, like
+  ///     `1 / 255` for `UInt8` pixels. Only supported for floating point `Feature` types.
+  ///   - shuffleBufferSize: The number of examples the shuffled order is drawn from. Zero or one
+  ///     disable shuffling, while a size of at least `exampleCount` gives a uniform shuffle.
+  ///   - workerCount: The number of native threads assembling batches.
+  ///   - prefetchDepth: The number of batches prepared ahead of the training loop.
+  ///   - dropRemainder: Whether the last, partial batch of every epoch is skipped.
+  public init<RawFeature: TensorFlowScalar>(
+    features: [RawFeature], featureShape: [Int], labels: [Label], labelShape: [Int] = [],
+    featureScale: Double = 1, batchSize: Int, shuffleBufferSize: Int = 0, workerCount: Int = 1,
+    prefetchDepth: Int = 2, seed: UInt64 = 0, dropRemainder: Bool = true,
+    on device: Device = Device.default
+  ) {
+    let featureCount = featureShape.reduce(1, *)
+    let labelCount = labelShape.reduce(1, *)
+    precondition(featureCount > 0 && features.count % featureCount == 0)
+    let exampleCount = features.count / featureCount
+    precondition(
+      labels.count == exampleCount * labelCount,
+      "The features and the labels hold a different number of examples.")
+    dataset = (features, labels)
+    let options = InputPipelineOptions(
+      batch_size: batchSize, shuffle_buffer_size: shuffleBufferSize, num_workers: workerCount,
+      prefetch_depth: prefetchDepth, seed: seed, drop_remainder: dropRemainder)
+    let featureDims = featureShape.map { Int64($0) }
+    let labelDims = labelShape.map { Int64($0) }
+    pipeline = features.withUnsafeBytes { features in
+      labels.withUnsafeBytes { labels in
+        featureDims.withUnsafeBufferPointer { featureDims in
+          labelDims.withUnsafeBufferPointer { labelDims in
+            let components = [
+              InputPipelineComponent(
+                source_type: RawFeature.xlaTensorScalarType, type: Feature.xlaTensorScalarType,
+                example_dims: Int64ArrayRef(data: featureDims.baseAddress, size: featureDims.count),
+                data: features.baseAddress, scale: featureScale),
+              InputPipelineComponent(
+                source_type: Label.xlaTensorScalarType, type: Label.xlaTensorScalarType,
+                example_dims: Int64ArrayRef(data: labelDims.baseAddress, size: labelDims.count),
+                data: labels.baseAddress, scale: 1),
+            ]
+            return InputPipeline_create(
+              components, components.count, exampleCount, options, device.cdevice)
+          }
+        }
+      }
+    }
+  }
+
+  deinit {
+    // Stops the workers before the arrays they read from are released.
+    destroyInputPipeline(pipeline)
+  }
+
+  /// The number of batches in every epoch.
+  public var batchesPerEpoch: Int {
+    return InputPipeline_batchesPerEpoch(pipeline)
+  }
+
+  /// Returns the next batch of the current epoch, or `nil` once the epoch is over. The following
+  /// call starts returning the batches of the next epoch.
+  public func next() -> (x: Tensor<Feature>, y: Tensor<Label>)? {
+    let tensorListHandle = InputPipeline_next(pipeline)
+    defer { destroyOpaqueXLATensorArrayRef(tensorListHandle) }
+    if tensorListHandle.size == 0 { return nil }
+    return (
+      x: Tensor(_xla: XLATensor(_handle: tensorListHandle.data[0]!)),
+      y: Tensor(_xla: XLATensor(_handle: tensorListHandle.data[1]!))
+    )
+  }
+}
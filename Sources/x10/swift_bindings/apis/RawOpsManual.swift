@@ -1530,6 +1530,28 @@ public enum _Raw {
     return Tensor(_xla: XLATensor.div(x.xlaTensor, y.xlaTensor))
   }
 
+  /// Tensor contraction according to Einstein summation convention.
+  ///
+  /// Unlike the TensorFlow kernel, any number of operands is accepted: equations with more than
+  /// two operands are contracted pairwise in the order chosen by the einsum planner. The implicit
+  /// form (an equation without `->`) is supported as well; like `numpy.einsum`, its output
+  /// subscripts are the labels which occur exactly once, upper case before lower case.
+  ///
+  /// - Parameter inputs: The operands, one per comma separated term of `equation`.
+  ///
+  /// - Attr equation: String describing the Einstein Summation operation; in the format of
+  ///     np.einsum.
+  ///
+  /// - Output output: Output Tensor with shape depending upon `equation`.
+  public static func einsum<T: TensorFlowScalar>(
+    inputs: [Tensor<T>],
+    equation: String
+  ) -> Tensor<T> {
+    checkSameDevice(inputs)
+    checkSamePrecision(inputs)
+    return Tensor(_xla: XLATensor.einsum(equation, inputs.map { $0.xlaTensor }))
+  }
+
   /// Computes exponential linear: `exp(features) - 1` if < 0, `features` otherwise.
   ///
   /// See [Fast and Accurate Deep Network Learning by Exponential Linear Units (ELUs)
@@ -4668,7 +4690,10 @@ public enum _Raw {
   public static func where_<T: TensorFlowScalar>(
     _ input: Tensor<T>
   ) -> Tensor<Int64> {
-    fatalError("implement where_")
+    // The result is padded to the number of elements of `input`, with the count of nonzero values
+    // kept on device, so that only reading its shape synchronizes. Elementwise ops applied to the
+    // result keep the count, so their shapes resolve to it as well.
+    return Tensor(_xla: XLATensor.nonzero(input.xlaTensor))
   }
 
   /// Returns 0 if x == 0, and x / y otherwise, elementwise.
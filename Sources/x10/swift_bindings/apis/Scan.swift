@@ -0,0 +1,154 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// Runs `body` over the leading dimension of `sequences` as a single loop, so that the size of the
+/// graph does not depend on the number of steps.
+///
+/// `body` takes the parameters, the carried values and the current steps of the sequences, and
+/// returns the new carried values followed by the current steps of the output sequences. It is
+/// traced once, on placeholders for the carried values and the steps, so the tensors it reads from
+/// `parameters` are computed outside of the loop. Returns the final carried values followed by the
+/// output sequences. A reverse scan runs from the last step to the first one.
+///
+/// The pullback is a reverse scan over the carried values saved at every step, which applies the
+/// pullback of `body` at each of them, so the size of the backward graph does not depend on the
+/// number of steps either. The gradient with respect to `parameters` covers their tensors of
+/// `Scalar` type.
+@differentiable(wrt: (parameters, initial, sequences))
+public func scan<Scalar: TensorFlowFloatingPoint, Parameters: Differentiable>(
+  _ parameters: Parameters,
+  initial: [Tensor<Scalar>],
+  sequences: [Tensor<Scalar>],
+  reverse: Bool = false,
+  _ body: @escaping @differentiable (
+    Parameters, [Tensor<Scalar>], [Tensor<Scalar>]
+  ) -> [Tensor<Scalar>]
+) -> [Tensor<Scalar>] where Parameters.TangentVector: KeyPathIterable {
+  scanTensors(initial, sequences, reverse: reverse) { carried, steps in
+    body(parameters, carried, steps)
+  }
+}
+
+@usableFromInline
+@derivative(of: scan, wrt: (parameters, initial, sequences))
+internal func _vjpScan<Scalar: TensorFlowFloatingPoint, Parameters: Differentiable>(
+  _ parameters: Parameters,
+  initial: [Tensor<Scalar>],
+  sequences: [Tensor<Scalar>],
+  reverse: Bool,
+  _ body: @escaping @differentiable (
+    Parameters, [Tensor<Scalar>], [Tensor<Scalar>]
+  ) -> [Tensor<Scalar>]
+) -> (
+  value: [Tensor<Scalar>],
+  pullback: (Array<Tensor<Scalar>>.TangentVector) -> (
+    Parameters.TangentVector, Array<Tensor<Scalar>>.TangentVector,
+    Array<Tensor<Scalar>>.TangentVector
+  )
+) where Parameters.TangentVector: KeyPathIterable {
+  let carriedCount = initial.count
+  let sequenceCount = sequences.count
+  // The carried values at the start of every step are saved as extra output sequences.
+  let outputs = scanTensors(initial, sequences, reverse: reverse) { carried, steps in
+    body(parameters, carried, steps) + carried
+  }
+  let value = Array(outputs[..<(outputs.count - carriedCount)])
+  let saved = Array(outputs[(outputs.count - carriedCount)...])
+
+  // Returns the tangents of the parameters, the carried values and the steps for one step of the
+  // body, with missing or zero tangents broadcast to the shapes of the values, which the carried
+  // tangents must keep within the loop.
+  func stepPullback(
+    _ carried: [Tensor<Scalar>], _ steps: [Tensor<Scalar>], _ resultTangents: [Tensor<Scalar>]
+  ) -> (Parameters.TangentVector, [Tensor<Scalar>], [Tensor<Scalar>]) {
+    let (𝛁parameters, 𝛁carried, 𝛁steps) =
+      pullback(at: parameters, carried, steps, in: body)(.init(resultTangents))
+    return (
+      𝛁parameters, broadcastTangents(𝛁carried.base, like: carried),
+      broadcastTangents(𝛁steps.base, like: steps)
+    )
+  }
+
+  return (
+    value,
+    { 𝛁value in
+      let 𝛁outputs = broadcastTangents(𝛁value.base, like: value)
+      let 𝛁final = Array(𝛁outputs[..<carriedCount])
+      let 𝛁ys = Array(𝛁outputs[carriedCount...])
+      // The parameter tangents are accumulated in carried values, whose shapes come from tracing
+      // the pullback of the body once on placeholders for the steps. This trace is never run.
+      let placeholders = (sequences + 𝛁ys).map {
+        Tensor<Scalar>(_xla: XLATensor.scanParameter($0.xlaTensor, 0, sequence: true))
+      }
+      let (template, _, _) = stepPullback(
+        initial, Array(placeholders[..<sequenceCount]),
+        𝛁final + Array(placeholders[sequenceCount...]))
+      let keyPaths = template.recursivelyAllWritableKeyPaths(to: Tensor<Scalar>.self)
+      let 𝛁initialParameters = keyPaths.map { Tensor<Scalar>(zerosLike: template[keyPath: $0]) }
+
+      let tangents = scanTensors(
+        𝛁final + 𝛁initialParameters, saved + sequences + 𝛁ys, reverse: !reverse
+      ) { carried, steps in
+        let 𝛁carried = Array(carried[..<carriedCount])
+        let 𝛁accumulated = Array(carried[carriedCount...])
+        let (𝛁stepParameters, 𝛁previous, 𝛁steps) = stepPullback(
+          Array(steps[..<carriedCount]),
+          Array(steps[carriedCount..<(carriedCount + sequenceCount)]),
+          𝛁carried + Array(steps[(carriedCount + sequenceCount)...]))
+        let 𝛁sums = zip(𝛁accumulated, keyPaths).map { 𝛁sum, keyPath in
+          𝛁sum + 𝛁stepParameters[keyPath: keyPath]
+        }
+        return 𝛁previous + 𝛁sums + 𝛁steps
+      }
+      var 𝛁parameters = template
+      for (keyPath, 𝛁parameter) in zip(keyPaths, tangents[carriedCount...]) {
+        𝛁parameters[keyPath: keyPath] = 𝛁parameter
+      }
+      return (
+        𝛁parameters, .init(Array(tangents[..<carriedCount])),
+        .init(Array(tangents[(carriedCount + keyPaths.count)...]))
+      )
+    }
+  )
+}
+
+/// Runs `body` over the leading dimension of `sequences` through `XLATensor.scan`, and returns the
+/// final carried values followed by the output sequences.
+private func scanTensors<Scalar: TensorFlowFloatingPoint>(
+  _ initial: [Tensor<Scalar>], _ sequences: [Tensor<Scalar>], reverse: Bool,
+  _ body: ([Tensor<Scalar>], [Tensor<Scalar>]) -> [Tensor<Scalar>]
+) -> [Tensor<Scalar>] {
+  precondition(!sequences.isEmpty, "A scan needs at least one sequence")
+  let length = sequences[0].shape[0]
+  for sequence in sequences {
+    precondition(sequence.shape[0] == length, "The sequences of a scan must have the same length")
+  }
+  let (carried, ys) = XLATensor.scan(
+    initial.map { $0.xlaTensor }, sequences.map { $0.xlaTensor }, length: Int64(length),
+    reverse: reverse
+  ) { carried, steps in
+    body(carried.map { Tensor(_xla: $0) }, steps.map { Tensor(_xla: $0) }).map { $0.xlaTensor }
+  }
+  return (carried + ys).map { Tensor(_xla: $0) }
+}
+
+/// Returns the tangents broadcast to the shapes of the values, with zeros for the missing ones.
+private func broadcastTangents<Scalar: TensorFlowFloatingPoint>(
+  _ tangents: [Tensor<Scalar>], like values: [Tensor<Scalar>]
+) -> [Tensor<Scalar>] {
+  values.indices.map { i in
+    i < tangents.count
+      ? tangents[i].broadcasted(like: values[i]) : Tensor(zerosLike: values[i])
+  }
+}
@@ -0,0 +1,69 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+import x10_xla_tensor_wrapper
+
+/// The host value of a tensor, which is fetched from the device in the background.
+///
+/// Creating a `TensorFuture` schedules the pending computation of the tensor without waiting for
+/// it, so the host can keep tracing while the device runs. Reading `value` only blocks if the
+/// device has not produced the tensor yet.
+public final class TensorFuture<Scalar: TensorFlowScalar> {
+  private var future: UnsafeMutablePointer<OpaqueMaterializedTensorFuture>?
+  private var cachedValue: ShapedArray<Scalar>?
+  private let shape: [Int]
+
+  fileprivate init(_ xlaTensor: XLATensor) {
+    shape = xlaTensor.shape
+    future = XLATensor_materialize_async(xlaTensor.handle)
+    _fixLifetime(xlaTensor)
+  }
+
+  /// Whether `value` can be read without blocking.
+  public var isReady: Bool {
+    guard let future = future else { return true }
+    return MaterializedTensorFuture_isReady(future)
+  }
+
+  /// The host value of the tensor, waiting for the device to produce it if needed.
+  public var value: ShapedArray<Scalar> {
+    if let cachedValue = cachedValue { return cachedValue }
+    let materialized = MaterializedTensorFuture_wait(future!)!
+    destroyMaterializedTensorFuture(future!)
+    future = nil
+    precondition(
+      MaterializedTensor_getType(materialized) == Scalar.xlaTensorScalarType,
+      "Types mismatch when fetching tensor values.")
+    let buffer = MaterializedTensorBuffer<Scalar>(
+      owning: materialized, count: shape.reduce(1, *))
+    let result = ShapedArray(buffer: buffer, shape: shape)
+    cachedValue = result
+    return result
+  }
+
+  deinit {
+    if let future = future {
+      destroyMaterializedTensorFuture(future)
+    }
+  }
+}
+
+extension Tensor {
+  /// Starts fetching the value of this tensor to the host, without waiting for the device to
+  /// compute it. This lets scalar statistics be read one step later instead of syncing every
+  /// step.
+  public func fetchWhenReady() -> TensorFuture<Scalar> {
+    return TensorFuture(xlaTensor)
+  }
+}
@@ -144,3 +144,17 @@ void XLATensor_LazyTensorBarrier(const struct CDevice* device,
                                              /*wait=*/wait);
   swift_xla::XLATensor::MarkStep(converted_device);
 }
+
+void XLATensor_ReplicatedTensorBarrier(struct DeviceList* device_list) {
+  const auto device_strings = DeviceListToStrings(device_list);
+  swift_xla::XLATensor::SyncLiveTensorsGraphReplicated(device_strings);
+  swift_xla::Device device(device_strings.front());
+  swift_xla::XLATensor::MarkStep(&device);
+}
+
+int64_t XLATensor_EstimatePeakMemory(const struct CDevice* device) {
+  swift_xla::Device tmp_device;
+  if (device) tmp_device = ConvertDevice(*device);
+  return swift_xla::XLATensor::EstimateLiveTensorsPeakMemory(
+      device ? &tmp_device : nullptr);
+}
@@ -19,6 +19,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 #include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
@@ -64,6 +65,16 @@ void syncLiveTensorsForDevices(struct DeviceList* device_list);
 void XLATensor_LazyTensorBarrier(const struct CDevice* device,
                                  struct DeviceList* device_list, bool wait);
 
+// Marks step and synchronizes the live tensors of the first device of the list,
+// by tracing their graph once and running it on all the devices of the list as
+// replicas. Blocks until the computation is complete.
+void XLATensor_ReplicatedTensorBarrier(struct DeviceList* device_list);
+
+// Estimates the peak device memory, in bytes, needed by the graph which the
+// next barrier would run for the live tensors of the device (or of all devices
+// if null), without compiling nor running it.
+int64_t XLATensor_EstimatePeakMemory(const struct CDevice* device);
+
 #ifdef __cplusplus
 }  // extern "C"
 
@@ -36,54 +36,6 @@ public struct HostStatistics {
   }
 }
 
-fileprivate func makeNibbleTensor(_ input: [Int], on device: Device) -> Tensor<Float> {
-  var scalars = [Float]()
-  for i in input {
-    var iCopy = i
-    for _ in 0..<16 {
-      scalars.append(Float(iCopy & 15))
-      iCopy = iCopy >> 4
-    }
-  }
-  return Tensor<Float>(shape: [input.count, 16], scalars: scalars, on: device)
-}
-
-// Cross replica sum doesn't work on integers, so break up a single tensor integer
-// into multiple floats that can be added separately and cover different ranges
-// of the integer.  These `Float`s can be reassembled into the original integer
-// using `unpackNibbles`.
-fileprivate func makeNibbleTensor(_ input: Tensor<Int32>, on device: Device) -> Tensor<Float> {
-  precondition(input.rank == 1)
-  var nibbles = [Tensor<Int32>]()
-  var inputCopy = input
-  let divisor = Tensor<Int32>(16, on: device)
-  for _ in 0..<16 {
-    let nextICopy = inputCopy / divisor
-    nibbles.append(inputCopy - nextICopy * divisor)
-    inputCopy = nextICopy
-  }
-  return Tensor<Float>(Tensor<Int32>(stacking: nibbles, alongAxis: 1))
-}
-
-fileprivate func unpackNibbles(_ scalars: [Float]) -> Int {
-  var out: Int = 0
-  for i in 0..<scalars.count {
-    out += Int(scalars[i]) << (i * 4)
-  }
-  return out
-}
-
-fileprivate func unpackNibbles(_ input: Tensor<Float>) -> [Int] {
-  let shape = input.shape.dimensions
-  precondition(shape.count == 2 && shape[1] == 16)
-  var out = [Int]()
-  let scalars = input.scalars
-  for i in 0..<shape[0] {
-    out.append(unpackNibbles((0..<16).map { scalars[i * 16 + $0] }))
-  }
-  return out
-}
-
 public class EpochPipelineQueue {
   var doNextEpoch: [() -> Void] = []
   public init() {}
@@ -139,17 +91,20 @@ struct Statistics {
   }
 
   public func crsHostStats(on device: Device, devices: [Device]) -> () -> HostStatistics {
-    var ints = makeNibbleTensor(
-      Tensor<Int32>(stacking: [
-        correctGuessCountTensor, Tensor<Int32>(Int32(totalSamples), on: device),
-      ]), on: device)
+    var ints = Tensor<Int32>(stacking: [
+      correctGuessCountTensor, Tensor<Int32>(Int32(totalSamples), on: device),
+    ])
     var floats = totalLossTensor.reshaped(to: [1])
     ints.crossReplicaSum(1)
     floats.crossReplicaSum(1)
-    LazyTensorBarrier(on: device, devices: devices, wait: true)
+    // Schedules the reduction without waiting for it, so the host is not blocked on the device
+    // until the statistics are actually read.
+    LazyTensorBarrier(on: device, devices: devices)
+    let intsFuture = ints.fetchWhenReady()
+    let floatsFuture = floats.fetchWhenReady()
     return {
-      let intsScalars = unpackNibbles(ints)
-      let floatsScalars = floats.scalars
+      let intsScalars = intsFuture.value.scalars
+      let floatsScalars = floatsFuture.value.scalars
 
       return HostStatistics(
         correctGuessCount: Int(intsScalars[0]),
@@ -159,6 +114,22 @@ struct Statistics {
   }
 }
 
+extension Statistics {
+  /// Sums the statistics accumulated by each replica of a `ReplicatedState` training loop.
+  /// `totalSamples` is expected to already count the samples of all the replicas.
+  func replicatedHostStats(devices: [Device]) -> HostStatistics {
+    var ints = correctGuessCountTensor.reshaped(to: [1])
+    var floats = totalLossTensor.reshaped(to: [1])
+    ints.crossReplicaSum(1)
+    floats.crossReplicaSum(1)
+    ReplicatedTensorBarrier(devices: devices)
+    return HostStatistics(
+      correctGuessCount: Int(ints.scalars[0]),
+      totalSamples: totalSamples,
+      totalLoss: floats.scalars[0])
+  }
+}
+
 @differentiable
 public func _defaultLossFunction(_ ŷ: Tensor<Float>, _ y: Tensor<Int32>) -> Tensor<Float> {
   softmaxCrossEntropy(logits: ŷ, labels: y)
@@ -264,6 +235,100 @@ where
   }
 }
 
+/// The state of a data-parallel training loop which runs on all the devices from a single thread.
+///
+/// Unlike `ThreadState`, which keeps a copy of the model per device and traces the same training
+/// step once per device, the step is traced, hashed and compiled once on `devices[0]`, and then
+/// executed on all the devices as replicas, so the host cost of a step does not grow with the
+/// number of devices. Each replica is fed its own shard of every batch. As with `ThreadState`, the
+/// gradients are reduced across the replicas by the optimizer (like a `GeneralOptimizer` with
+/// `crossReplicaSumCount` set to the number of devices).
+public class ReplicatedState<Model: Layer, Opt: Optimizer>
+where
+  Opt.Model == Model, Opt.Scalar == Float, Model.Input == Tensor<Float>,
+  Model.Output == Tensor<Float>,
+  Model.TangentVector.VectorSpaceScalar == Float
+{
+  public var classifier: Model
+  public var optimizer: Opt
+  let devices: [Device]
+
+  public init(model: Model, optimizer: Opt, devices: [Device]) {
+    precondition(!devices.isEmpty, "Replicated training needs at least one device")
+    self.devices = devices
+    self.classifier = Model(copying: model, to: devices[0])
+    self.optimizer = Opt(copying: optimizer, to: devices[0])
+  }
+
+  /// Feeds the other replicas with their shards of a batch, and returns the `devices[0]` one.
+  func shard(
+    _ batch: [(x: Tensor<Float>, y: Tensor<Int32>)]
+  ) -> (x: Tensor<Float>, y: Tensor<Int32>, sampleCount: Int) {
+    precondition(batch.count == devices.count, "Expected one batch shard per device")
+    for (i, shard) in batch.enumerated() {
+      precondition(
+        shard.x.device == devices[i] && shard.y.device == devices[i],
+        "Batch shard \(i) is not on \(devices[i])")
+    }
+    let replicas = batch.dropFirst()
+    batch[0].x.setReplicas(replicas.map { $0.x })
+    batch[0].y.setReplicas(replicas.map { $0.y })
+    return (batch[0].x, batch[0].y, batch.reduce(0) { $0 + $1.y.shape[0] })
+  }
+
+  /// Runs an epoch, where each element of the datasets holds one batch shard per device, with the
+  /// i-th shard living on `devices[i]`.
+  public func run<Dataset: Sequence>(
+    train: Dataset, test: Dataset,
+    scheduleLearningRate: (Opt) -> Void = { _ in },
+    lossFunction: @differentiable (Tensor<Float>, @noDerivative Tensor<Int32>) -> Tensor<Float> =
+      _defaultLossFunction
+  ) -> (train: HostStatistics, test: HostStatistics)
+  where Dataset.Iterator.Element == [(x: Tensor<Float>, y: Tensor<Int32>)] {
+    let device = devices[0]
+
+    LazyTensorBarrier(on: device, wait: true)
+
+    var trainStats = Statistics(on: device)
+    var testStats = Statistics(on: device)
+    Context.local.learningPhase = .training
+    for batch in train {
+      let scope = MakeAnnotationScope("training")
+      let (x, y, sampleCount) = shard(batch)
+      let 𝛁model = gradient(at: classifier) { classifier -> Tensor<Float> in
+        let ŷ = classifier(x)
+        let correctPredictions = ŷ.argmax(squeezingAxis: 1) .== y
+        trainStats.correctGuessCountTensor += Tensor<Int32>(correctPredictions).sum()
+        let loss = lossFunction(ŷ, y)
+        trainStats.totalLossTensor += Float(y.shape[0]) * loss
+        return loss
+      }
+      trainStats.totalSamples += sampleCount
+      scheduleLearningRate(optimizer)
+      optimizer.update(&classifier, along: 𝛁model)
+      ReplicatedTensorBarrier(devices: devices)
+      DestroyAnnotationScope(scope)
+    }
+
+    Context.local.learningPhase = .inference
+    for batch in test {
+      let scope = MakeAnnotationScope("test")
+      let (x, y, sampleCount) = shard(batch)
+      let ŷ = classifier(x)
+      let correctPredictions = ŷ.argmax(squeezingAxis: 1) .== y
+      testStats.correctGuessCountTensor += Tensor<Int32>(correctPredictions).sum()
+      testStats.totalSamples += sampleCount
+      testStats.totalLossTensor += Float(y.shape[0]) * lossFunction(ŷ, y)
+      ReplicatedTensorBarrier(devices: devices)
+      DestroyAnnotationScope(scope)
+    }
+    return (
+      train: trainStats.replicatedHostStats(devices: devices),
+      test: testStats.replicatedHostStats(devices: devices)
+    )
+  }
+}
+
 class ThreadResultBox<T> {
   init() {}
   var data: T? = nil
@@ -17,6 +17,7 @@
 #include <random>
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/cost_analysis.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_dump_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
@@ -25,6 +26,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/strided_slice_helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/core/util/mirror_pad_mode.h"
 
 using swift_xla::XlaHelpers;
@@ -105,7 +107,6 @@ swift_xla::XLATensor* XLATensor_makeScalar(XLAScalar value,
       atScalar(value), ToScalarType(type), ConvertDevice(cdevice)));
 }
 
-// TODO(parkers): reduce copying here...
 swift_xla::XLATensor* copyTensor(XLATensorScalarType type,
                                  const void* raw_value, size_t num_entries,
                                  const size_t* shape, size_t rank,
@@ -116,6 +117,7 @@ swift_xla::XLATensor* copyTensor(XLATensorScalarType type,
     auto* value = reinterpret_cast<const DType*>(raw_value);     \
     std::unique_ptr<DType[]> data(new DType[num_entries]);       \
     memcpy(data.get(), value, num_entries * sizeof(DType));      \
+    XLA_COUNTER("HostCopiedBytes", num_entries * sizeof(DType)); \
     std::vector<int64_t> dims(shape, shape + rank);              \
     at::Tensor t(std::move(data), std::move(dims));              \
     return new swift_xla::XLATensor(                             \
@@ -127,6 +129,28 @@ swift_xla::XLATensor* copyTensor(XLATensorScalarType type,
       LOG(FATAL) << "Invalid type: " << type;
   }
 }
+OpaqueXLATensor* borrowTensor(enum XLATensorScalarType type, const void* value,
+                              size_t num_entries, const size_t* shape,
+                              size_t rank, const struct CDevice device,
+                              void (*release)(void*), void* release_context) {
+  switch (type) {
+#define DEFINE_BORROW_CASE(name, aten_name, DType)                      \
+  case XLATensorScalarType_##name: {                                    \
+    auto buffer = std::make_unique<at::BorrowedAnyScalarBuffer<DType>>( \
+        reinterpret_cast<const DType*>(value), num_entries, release,    \
+        release_context);                                               \
+    std::vector<int64_t> dims(shape, shape + rank);                     \
+    at::Tensor t(std::move(buffer), std::move(dims));                   \
+    return new swift_xla::XLATensor(                                    \
+        swift_xla::XLATensor::Create(t, ConvertDevice(device)));        \
+  }
+    LIST_SCALAR_TYPES(DEFINE_BORROW_CASE)
+#undef DEFINE_BORROW_CASE
+    default:
+      LOG(FATAL) << "Invalid type: " << type;
+  }
+}
+
 OpaqueXLATensor* copyTensorAndMakeResident(enum XLATensorScalarType type,
                                            const void* value,
                                            size_t num_entries,
@@ -137,7 +161,7 @@ OpaqueXLATensor* copyTensorAndMakeResident(enum XLATensorScalarType type,
     const float* float_buffer = reinterpret_cast<const float*>(value);
     auto non_owned_buffer =
         std::make_unique<at::NonOwnedAnyScalarBuffer<float>>(
-            float_buffer, num_entries * sizeof(float));
+            float_buffer, num_entries);
     std::vector<int64_t> dims(shape, shape + rank);
     auto device = ConvertDevice(cdevice);
     auto dest_shape = swift_xla::MakeArrayShapeFromDimensions(
@@ -174,7 +198,8 @@ OpaqueMaterializedTensor* XLATensor_materialize(OpaqueXLATensor* t) {
   // Avoid barriers for fetching trivial local tensors.
   auto current_tensor = t->CurrentTensorData();
   if (current_tensor) return new at::Tensor(std::move(*current_tensor));
-  t->ApplyPendingGraph();
+  // ToTensor() evaluates tiny graphs on the host, without a device barrier,
+  // and applies the pending graph of the other ones.
   return new at::Tensor(t->ToTensor());
 }
 
@@ -182,6 +207,20 @@ enum XLATensorScalarType MaterializedTensor_getType(
     OpaqueMaterializedTensor* t) {
   return FromScalarType(t->scalar_type());
 }
+
+OpaqueMaterializedTensorFuture* XLATensor_materialize_async(
+    OpaqueXLATensor* t) {
+  return new xla::util::AsyncTask<at::Tensor>(t->ToTensorAsync());
+}
+
+bool MaterializedTensorFuture_isReady(OpaqueMaterializedTensorFuture* f) {
+  return f->IsCompleted();
+}
+
+OpaqueMaterializedTensor* MaterializedTensorFuture_wait(
+    OpaqueMaterializedTensorFuture* f) {
+  return new at::Tensor(f->Wait().ConsumeValue());
+}
 enum XLATensorScalarType XLATensor_dtype(OpaqueXLATensor* a) {
   return FromScalarType(a->dtype());
 }
@@ -215,11 +254,23 @@ XLATensorScalarType FromScalarType(at::ScalarType type) {
 
 void destroyTensor(swift_xla::XLATensor* t) { delete t; }
 void destroyMaterializedTensor(OpaqueMaterializedTensor* t) { delete t; }
+void destroyMaterializedTensorFuture(OpaqueMaterializedTensorFuture* f) {
+  delete f;
+}
 void destroyXLAShape(xla::util::MaybeRef<xla::Shape>* s) { delete s; }
 
 xla::util::MaybeRef<xla::Shape>* fetchTensorShape(
     swift_xla::XLATensor* tensor) {
-  return new xla::util::MaybeRef<xla::Shape>(tensor->shape());
+  xla::Shape shape = tensor->shape();
+  if (!shape.is_static()) {
+    // Resolves the actual size of the dynamic dimension.
+    std::vector<xla::int64> sizes = tensor->GetSizes();
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      shape.set_dimensions(i, sizes[i]);
+      shape.set_dynamic_dimension(i, false);
+    }
+  }
+  return new xla::util::MaybeRef<xla::Shape>(std::move(shape));
 }
 
 size_t XLAShape_getRank(xla::util::MaybeRef<xla::Shape>* shape) {
@@ -231,6 +282,25 @@ const int64_t* XLAShape_getDimensions(OpaqueXLAShape* shape) {
   return reinterpret_cast<const int64_t*>(shape->get().dimensions().data());
 }
 
+size_t XLATensor_getShape(OpaqueXLATensor* tensor, int64_t* dimensions,
+                          size_t capacity) {
+  static_assert(sizeof(int64_t) == sizeof(xla::int64), "Sanity");
+  xla::util::MaybeRef<xla::Shape> shape = tensor->shape();
+  absl::Span<const xla::int64> shape_dimensions = shape.get().dimensions();
+  std::vector<xla::int64> sizes;
+  if (!shape.get().is_static()) {
+    // The rank alone is known without resolving the dynamic dimension.
+    if (capacity == 0) {
+      return shape_dimensions.size();
+    }
+    sizes = tensor->GetSizes();
+    shape_dimensions = sizes;
+  }
+  std::copy_n(shape_dimensions.begin(),
+              std::min(shape_dimensions.size(), capacity), dimensions);
+  return shape_dimensions.size();
+}
+
 static c10::optional<swift_xla::Device> AsOptional(const CDevice* device) {
   if (!device) return absl::nullopt;
   return ConvertDevice(*device);
@@ -394,6 +464,10 @@ OpaqueXLATensor* XLATensor_diagonal_value(OpaqueXLATensor* a, int64_t offset,
 OpaqueXLATensor* XLATensor_div(OpaqueXLATensor* a, OpaqueXLATensor* b) {
   return new XLATensor(XLATensor::div(*a, *b));
 }
+OpaqueXLATensor* XLATensor_einsum(const char* equation,
+                                  OpaqueXLATensorArrayRef tensors) {
+  return new XLATensor(XLATensor::einsum(equation, tensors.array()));
+}
 OpaqueXLATensor* XLATensor_eq(OpaqueXLATensor* a, OpaqueXLATensor* b) {
   return new XLATensor(XLATensor::eq(*a, *b));
 }
@@ -480,6 +554,10 @@ OpaqueXLATensor* XLATensor_logicalNot(OpaqueXLATensor* a) {
 OpaqueXLATensor* XLATensor_logicalOr(OpaqueXLATensor* a, OpaqueXLATensor* b) {
   return new XLATensor(XLATensor::logicalOr(*a, *b));
 }
+OpaqueXLATensor* XLATensor_masked_select(OpaqueXLATensor* input,
+                                         OpaqueXLATensor* mask) {
+  return new XLATensor(XLATensor::masked_select(*input, *mask));
+}
 OpaqueXLATensor* XLATensor_matmul(OpaqueXLATensor* a, OpaqueXLATensor* b) {
   return new XLATensor(XLATensor::matmul(*a, *b));
 }
@@ -521,6 +599,9 @@ OpaqueXLATensor* XLATensor_nll_loss(OpaqueXLATensor* input,
   return new XLATensor(XLATensor::nll_loss(*input, *target, weight,
                                            at::Reduction::Mean, ignore_index));
 }
+OpaqueXLATensor* XLATensor_nonzero(OpaqueXLATensor* input) {
+  return new XLATensor(XLATensor::nonzero(*input));
+}
 OpaqueXLATensor* XLATensor_permute_value(OpaqueXLATensor* a,
                                          Int64ArrayRef arr) {
   return new XLATensor(XLATensor::permute_value(*a, arr.slice()));
@@ -568,6 +649,19 @@ OpaqueXLATensor* XLATensor_round_to_even(OpaqueXLATensor* a) {
 OpaqueXLATensor* XLATensor_rsqrt(OpaqueXLATensor* a) {
   return new XLATensor(XLATensor::rsqrt(*a));
 }
+OpaqueXLATensorArrayRef XLATensor_scan(OpaqueXLATensorArrayRef init,
+                                       OpaqueXLATensorArrayRef xs,
+                                       OpaqueXLATensorArrayRef parameters,
+                                       OpaqueXLATensorArrayRef results,
+                                       int64_t length, bool reverse) {
+  return ConvertTensorList(XLATensor::scan(init.array(), xs.array(),
+                                           parameters.array(), results.array(),
+                                           length, reverse));
+}
+OpaqueXLATensor* XLATensor_scan_parameter(OpaqueXLATensor* input,
+                                          int64_t index, bool sequence) {
+  return new XLATensor(XLATensor::scan_parameter(*input, index, sequence));
+}
 OpaqueXLATensor* XLATensor_select(OpaqueXLATensor* a, int64_t dim,
                                   int64_t index) {
   return new XLATensor(XLATensor::select(*a, dim, index));
@@ -742,6 +836,10 @@ OpaqueXLATensor* XLATensor_xla_pad(OpaqueXLATensor* input,
 struct CDevice XLATensor_device(OpaqueXLATensor* t) {
   return ConvertDevice(t->GetDevice());
 }
+void XLATensor_set_replica_tensors(OpaqueXLATensor* t,
+                                   OpaqueXLATensorArrayRef replicas) {
+  XLATensor::SetReplicaTensors(*t, replicas.array());
+}
 OpaqueXLATensor* XLATensor_rand(Int64ArrayRef size, int64_t seed) {
   std::vector<int64_t> size_vec(size.slice().begin(), size.slice().end());
   uint64_t numel = std::accumulate(size_vec.begin(), size_vec.end(),
@@ -782,6 +880,104 @@ StridedSliceSpec* ComputeIndexingBoundsAndStrides(
 }
 void PrintMetrics() {
   LOG(INFO) << "Metrics:\n" << xla::metrics::CreateMetricReport();
+  PrintScopeCosts(/*max_scopes=*/20);
+  PrintMemoryUsage(/*max_holders=*/20);
+}
+void PrintMemoryUsage(int64_t max_holders) {
+  std::string report = xla::memory::CreateMemoryReport(max_holders);
+  if (!report.empty()) {
+    LOG(INFO) << "Memory Usage:\n" << report;
+  }
+}
+void PrintMemoryTimeline() {
+  std::string timeline = xla::memory::CreateMemoryTimeline();
+  if (!timeline.empty()) {
+    LOG(INFO) << "Memory Timeline:\n" << timeline;
+  }
+}
+void PrintScopeCosts(int64_t max_scopes) {
+  std::string report = swift_xla::ir::CreateScopeCostReport(max_scopes);
+  if (!report.empty()) {
+    LOG(INFO) << "Scope Costs:\n" << report;
+  }
 }
+int64_t GetCounterValue(const char* name) {
+  xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+  return counter != nullptr ? counter->Value() : 0;
+}
+MetricSummary GetMetricSummary(const char* name) {
+  xla::metrics::MetricData* metric = xla::metrics::GetMetric(name);
+  if (metric == nullptr) return {0, 0};
+  return {metric->Accumulator(),
+          static_cast<int64_t>(metric->TotalSamples())};
+}
+OpaqueInputPipeline* InputPipeline_create(
+    const InputPipelineComponent* components, size_t num_components,
+    size_t num_examples, InputPipelineOptions options,
+    const struct CDevice device) {
+  std::vector<swift_xla::InputPipeline::Component> pipeline_components;
+  pipeline_components.reserve(num_components);
+  for (size_t i = 0; i < num_components; ++i) {
+    swift_xla::InputPipeline::Component component;
+    component.source_type = ToScalarType(components[i].source_type);
+    component.type = ToScalarType(components[i].type);
+    component.example_dims.assign(
+        components[i].example_dims.data,
+        components[i].example_dims.data + components[i].example_dims.size);
+    component.data = components[i].data;
+    component.scale = components[i].scale;
+    pipeline_components.push_back(std::move(component));
+  }
+  swift_xla::InputPipeline::Options pipeline_options;
+  pipeline_options.batch_size = options.batch_size;
+  pipeline_options.shuffle_buffer_size = options.shuffle_buffer_size;
+  pipeline_options.num_workers = options.num_workers;
+  pipeline_options.prefetch_depth = options.prefetch_depth;
+  pipeline_options.seed = options.seed;
+  pipeline_options.drop_remainder = options.drop_remainder;
+  return new swift_xla::InputPipeline(std::move(pipeline_components),
+                                      num_examples, pipeline_options,
+                                      ConvertDevice(device));
+}
+size_t InputPipeline_batchesPerEpoch(OpaqueInputPipeline* pipeline) {
+  return pipeline->batches_per_epoch();
+}
+OpaqueXLATensorArrayRef InputPipeline_next(OpaqueInputPipeline* pipeline) {
+  return ConvertTensorList(pipeline->Next());
+}
+void destroyInputPipeline(OpaqueInputPipeline* pipeline) { delete pipeline; }
+void XLATensor_save_checkpoint(const char* path, const char* const* names,
+                               OpaqueXLATensorArrayRef tensors) {
+  std::vector<std::string> tensor_names(names, names + tensors.size);
+  swift_xla::SaveCheckpoint(path, tensor_names, tensors.array());
+}
+OpaqueCheckpointSave* XLATensor_save_checkpoint_async(
+    const char* path, const char* const* names,
+    OpaqueXLATensorArrayRef tensors) {
+  std::vector<std::string> tensor_names(names, names + tensors.size);
+  return new xla::util::AsyncTask<bool>(swift_xla::SaveCheckpointAsync(
+      path, std::move(tensor_names), tensors.array()));
+}
+bool CheckpointSave_isCompleted(OpaqueCheckpointSave* save) {
+  return save->IsCompleted();
+}
+void CheckpointSave_wait(OpaqueCheckpointSave* save) { save->Wait(); }
+void destroyCheckpointSave(OpaqueCheckpointSave* save) { delete save; }
+OpaqueCheckpoint* XLATensor_load_checkpoint(const char* path,
+                                            const struct CDevice device) {
+  return new swift_xla::Checkpoint(
+      swift_xla::LoadCheckpoint(path, ConvertDevice(device)));
+}
+size_t Checkpoint_size(OpaqueCheckpoint* checkpoint) {
+  return checkpoint->tensors.size();
+}
+const char* Checkpoint_name(OpaqueCheckpoint* checkpoint, size_t index) {
+  return checkpoint->names.at(index).c_str();
+}
+OpaqueXLATensor* Checkpoint_tensor(OpaqueCheckpoint* checkpoint,
+                                   size_t index) {
+  return new XLATensor(checkpoint->tensors.at(index));
+}
+void destroyCheckpoint(OpaqueCheckpoint* checkpoint) { delete checkpoint; }
 void DeleteString(OpaqueString* str) { delete str; }
 const char* GetStringCStr(OpaqueString* str) { return str->c_str(); }
@@ -23,9 +23,15 @@
 #include "swift_bindings/device_wrapper.h"
 
 #ifdef __cplusplus
+#include "tensorflow/compiler/tf2xla/xla_tensor/checkpoint.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/input_pipeline.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
+using OpaqueInputPipeline = swift_xla::InputPipeline;
+using OpaqueCheckpoint = swift_xla::Checkpoint;
+using OpaqueCheckpointSave = xla::util::AsyncTask<bool>;
 using OpaqueMaterializedTensor = at::Tensor;
+using OpaqueMaterializedTensorFuture = xla::util::AsyncTask<at::Tensor>;
 using OpaqueXLATensor = swift_xla::XLATensor;
 using OpaqueXLAShape = xla::util::MaybeRef<xla::Shape>;
 using XLAAnnotationScope = tensorflow::profiler::TraceMe;
@@ -38,10 +44,18 @@ typedef struct OpaqueXLAShape {
 } OpaqueXLAShape;
 typedef struct OpaqueMaterializedTensor {
 } OpaqueMaterializedTensor;
+typedef struct OpaqueMaterializedTensorFuture {
+} OpaqueMaterializedTensorFuture;
 typedef struct XLAAnnotationScope {
 } XLAAnnotationScope;
 typedef struct OpaqueString {
 } OpaqueString;
+typedef struct OpaqueInputPipeline {
+} OpaqueInputPipeline;
+typedef struct OpaqueCheckpoint {
+} OpaqueCheckpoint;
+typedef struct OpaqueCheckpointSave {
+} OpaqueCheckpointSave;
 #endif
 
 XLAAnnotationScope* MakeAnnotationScope(const char* scope);
@@ -85,7 +99,6 @@ OpaqueXLATensor* XLATensor_makeScalar(XLAScalar value,
                                       enum XLATensorScalarType type,
                                       const struct CDevice cdevice);
 
-// TODO(parkers): Make aliasing constructor.
 OpaqueXLATensor* copyTensor(enum XLATensorScalarType type, const void* value,
                             size_t num_entries, const size_t* shape,
                             size_t rank, const struct CDevice device);
@@ -99,12 +112,29 @@ OpaqueXLATensor* copyTensorAndMakeResident(enum XLATensorScalarType type,
                                            const size_t* shape, size_t rank,
                                            const struct CDevice device,
                                            bool to_reduced_precision);
+// Creates a tensor which aliases the caller provided buffer rather than copying
+// it. The buffer must stay valid and unmodified until release(release_context)
+// is invoked, which happens once the runtime drops its last reference to it.
+OpaqueXLATensor* borrowTensor(enum XLATensorScalarType type, const void* value,
+                              size_t num_entries, const size_t* shape,
+                              size_t rank, const struct CDevice device,
+                              void (*release)(void*), void* release_context);
 void destroyTensor(OpaqueXLATensor* t);
 OpaqueMaterializedTensor* XLATensor_materialize(OpaqueXLATensor* t);
 void destroyMaterializedTensor(OpaqueMaterializedTensor* t);
 const void* MaterializedTensor_getData(OpaqueMaterializedTensor* t);
 enum XLATensorScalarType MaterializedTensor_getType(
     OpaqueMaterializedTensor* t);
+// Schedules the pending computation of the tensor (if any) and starts fetching
+// its value, without waiting for the device to produce it.
+OpaqueMaterializedTensorFuture* XLATensor_materialize_async(
+    OpaqueXLATensor* t);
+bool MaterializedTensorFuture_isReady(OpaqueMaterializedTensorFuture* f);
+// Blocks until the value is available. The returned tensor is owned by the
+// caller, and the future must not be waited on again.
+OpaqueMaterializedTensor* MaterializedTensorFuture_wait(
+    OpaqueMaterializedTensorFuture* f);
+void destroyMaterializedTensorFuture(OpaqueMaterializedTensorFuture* f);
 enum XLATensorScalarType XLATensor_dtype(OpaqueXLATensor* a);
 enum XLATensorScalarType XLATensor_physical_scalar_type(OpaqueXLATensor* a);
 
@@ -114,6 +144,10 @@ OpaqueXLAShape* fetchTensorShape(OpaqueXLATensor* tensor);
 void destroyXLAShape(OpaqueXLAShape* shape);
 size_t XLAShape_getRank(OpaqueXLAShape* shape);
 const int64_t* XLAShape_getDimensions(OpaqueXLAShape* shape);
+// Returns the rank of the tensor, and stores up to `capacity` of its dimensions
+// into `dimensions`. Unlike fetchTensorShape(), this does not allocate.
+size_t XLATensor_getShape(OpaqueXLATensor* tensor, int64_t* dimensions,
+                          size_t capacity);
 
 enum TFPadding {
   TFPadding_VALID = 1,     // No padding.
@@ -251,6 +285,8 @@ OpaqueXLATensor* XLATensor_cumsum(OpaqueXLATensor* a, int64_t dim,
 OpaqueXLATensor* XLATensor_diagonal_value(OpaqueXLATensor* a, int64_t offset,
                                           int64_t dim1, int64_t dim2);
 OpaqueXLATensor* XLATensor_div(OpaqueXLATensor* a, OpaqueXLATensor* b);
+OpaqueXLATensor* XLATensor_einsum(const char* equation,
+                                  OpaqueXLATensorArrayRef tensors);
 OpaqueXLATensor* XLATensor_eq(OpaqueXLATensor* a, OpaqueXLATensor* b);
 OpaqueXLATensor* XLATensor_exp(OpaqueXLATensor* a);
 OpaqueXLATensor* XLATensor_expand(OpaqueXLATensor* a, Int64ArrayRef dims);
@@ -281,6 +317,8 @@ OpaqueXLATensor* XLATensor_logical_cast(OpaqueXLATensor* input,
 OpaqueXLATensor* XLATensor_logicalAnd(OpaqueXLATensor* a, OpaqueXLATensor* b);
 OpaqueXLATensor* XLATensor_logicalNot(OpaqueXLATensor* a);
 OpaqueXLATensor* XLATensor_logicalOr(OpaqueXLATensor* a, OpaqueXLATensor* b);
+OpaqueXLATensor* XLATensor_masked_select(OpaqueXLATensor* input,
+                                         OpaqueXLATensor* mask);
 OpaqueXLATensor* XLATensor_matmul(OpaqueXLATensor* a, OpaqueXLATensor* b);
 OpaqueXLATensor* XLATensor_max(OpaqueXLATensor* input, int64_t dim,
                                bool keepdim);
@@ -297,6 +335,7 @@ OpaqueXLATensor* XLATensor_ne(OpaqueXLATensor* a, OpaqueXLATensor* b);
 OpaqueXLATensor* XLATensor_neg(OpaqueXLATensor* a);
 OpaqueXLATensor* XLATensor_nll_loss(OpaqueXLATensor* input,
                                     OpaqueXLATensor* target, int ignore_index);
+OpaqueXLATensor* XLATensor_nonzero(OpaqueXLATensor* input);
 OpaqueXLATensor* XLATensor_permute_value(OpaqueXLATensor* a, Int64ArrayRef arr);
 OpaqueXLATensor* XLATensor_physical_cast(OpaqueXLATensor* input,
                                          enum XLATensorScalarType dest_type);
@@ -315,6 +354,15 @@ OpaqueXLATensor* XLATensor_repeat(OpaqueXLATensor* input,
 OpaqueXLATensor* XLATensor_resize_value(OpaqueXLATensor* a, Int64ArrayRef arr);
 OpaqueXLATensor* XLATensor_round_to_even(OpaqueXLATensor* a);
 OpaqueXLATensor* XLATensor_rsqrt(OpaqueXLATensor* a);
+// Runs the body traced on the parameters over the leading dimension of xs, as
+// a single loop. Returns the final carried values and the output sequences.
+OpaqueXLATensorArrayRef XLATensor_scan(OpaqueXLATensorArrayRef init,
+                                       OpaqueXLATensorArrayRef xs,
+                                       OpaqueXLATensorArrayRef parameters,
+                                       OpaqueXLATensorArrayRef results,
+                                       int64_t length, bool reverse);
+OpaqueXLATensor* XLATensor_scan_parameter(OpaqueXLATensor* input,
+                                          int64_t index, bool sequence);
 OpaqueXLATensor* XLATensor_select(OpaqueXLATensor* a, int64_t dim,
                                   int64_t index);
 OpaqueXLATensor* XLATensor_sigmoid(OpaqueXLATensor* a);
@@ -395,6 +443,10 @@ OpaqueXLATensor* XLATensor_xla_slice(OpaqueXLATensor* input,
                                      Int64ArrayRef strides);
 // Retrieves the device for a given tensor.
 struct CDevice XLATensor_device(OpaqueXLATensor* t);
+// Registers the copies of t used by the other replicas of a replicated tensor
+// barrier, with replicas.data[i] living on the (i+1)-th replica device.
+void XLATensor_set_replica_tensors(OpaqueXLATensor* t,
+                                   OpaqueXLATensorArrayRef replicas);
 // Creates a float tensor on the current device filled with random numbers in
 // the [0, 1) interval.
 OpaqueXLATensor* XLATensor_rand(Int64ArrayRef size, int64_t seed);
@@ -407,8 +459,93 @@ StridedSliceSpec* ComputeIndexingBoundsAndStrides(
     Int64ArrayRef strides, int32_t begin_mask, int32_t end_mask,
     int32_t ellipsis_mask, int32_t new_axis_mask, int32_t shrink_axis_mask);
 
+// Logs the metrics, followed by the top scopes by cost when XLA_SCOPE_COSTS is
+// set and by the device memory usage when XLA_MEMORY_TRACKING is set.
 void PrintMetrics();
 
+// Logs the current and peak device memory usage, along with the max_holders
+// largest live device data handles and the max_holders scopes holding the most
+// device memory. Only available when XLA_MEMORY_TRACKING is set.
+void PrintMemoryUsage(int64_t max_holders);
+
+// Logs the device memory usage at the end of each of the last steps. Only
+// available when XLA_MEMORY_TRACKING is set.
+void PrintMemoryTimeline();
+
+// Logs the max_scopes IR scopes with the highest cost over the executed graphs,
+// as estimated from their nodes and, on CPU, sampled from their execution time.
+// Only available when XLA_SCOPE_COSTS is set.
+void PrintScopeCosts(int64_t max_scopes);
+
+// Returns the current value of the named counter, or zero if the counter has
+// not been created yet.
+int64_t GetCounterValue(const char* name);
+
+// The sum and the count of all the samples posted to a metric.
+typedef struct MetricSummary {
+  double accumulator;
+  int64_t total_samples;
+} MetricSummary;
+
+// Returns the summary of the named metric, or zeros if the metric has not been
+// created yet.
+MetricSummary GetMetricSummary(const char* name);
+
+// Input pipeline:
+
+// One component (like the features or the labels) of the examples of an input
+// pipeline. The data points to the contiguous examples of the dataset, and must
+// stay valid until the pipeline is destroyed.
+typedef struct InputPipelineComponent {
+  enum XLATensorScalarType source_type;
+  enum XLATensorScalarType type;
+  Int64ArrayRef example_dims;
+  const void* data;
+  double scale;
+} InputPipelineComponent;
+
+typedef struct InputPipelineOptions {
+  size_t batch_size;
+  size_t shuffle_buffer_size;
+  size_t num_workers;
+  size_t prefetch_depth;
+  uint64_t seed;
+  bool drop_remainder;
+} InputPipelineOptions;
+
+OpaqueInputPipeline* InputPipeline_create(
+    const InputPipelineComponent* components, size_t num_components,
+    size_t num_examples, InputPipelineOptions options,
+    const struct CDevice device);
+size_t InputPipeline_batchesPerEpoch(OpaqueInputPipeline* pipeline);
+// Returns the tensors of the next batch, one per component, or an empty list
+// once at the end of every epoch.
+OpaqueXLATensorArrayRef InputPipeline_next(OpaqueInputPipeline* pipeline);
+void destroyInputPipeline(OpaqueInputPipeline* pipeline);
+
+// Checkpoints:
+
+// Saves the tensors into an x10 checkpoint file, with names[i] being the name
+// of the i-th tensor.
+void XLATensor_save_checkpoint(const char* path, const char* const* names,
+                               OpaqueXLATensorArrayRef tensors);
+// Snapshots the current data of the tensors and saves them in the background.
+// The returned save must be destroyed with destroyCheckpointSave().
+OpaqueCheckpointSave* XLATensor_save_checkpoint_async(
+    const char* path, const char* const* names,
+    OpaqueXLATensorArrayRef tensors);
+bool CheckpointSave_isCompleted(OpaqueCheckpointSave* save);
+// Blocks until the checkpoint file has been written.
+void CheckpointSave_wait(OpaqueCheckpointSave* save);
+void destroyCheckpointSave(OpaqueCheckpointSave* save);
+// Loads all the tensors of an x10 checkpoint file onto device.
+OpaqueCheckpoint* XLATensor_load_checkpoint(const char* path,
+                                            const struct CDevice device);
+size_t Checkpoint_size(OpaqueCheckpoint* checkpoint);
+const char* Checkpoint_name(OpaqueCheckpoint* checkpoint, size_t index);
+OpaqueXLATensor* Checkpoint_tensor(OpaqueCheckpoint* checkpoint, size_t index);
+void destroyCheckpoint(OpaqueCheckpoint* checkpoint);
+
 // Randomly shuffles the array defined by (data, size) by seed and then
 // returns the result.
 void SeededRandomShuffle(size_t* data, size_t size, int64_t seed);
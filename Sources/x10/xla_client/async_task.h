@@ -87,6 +87,11 @@ class AsyncTask {
     return *this;
   }
 
+  bool IsCompleted() const {
+    std::lock_guard<std::mutex> lock(data_->mutex);
+    return data_->completed;
+  }
+
   const T& GetValue() const {
     std::lock_guard<std::mutex> lock(data_->mutex);
     return *data_->result;
@@ -15,6 +15,7 @@
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <fstream>
 #include <map>
@@ -25,13 +26,26 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/status_macros.h"
 #include "tensorflow/core/util/device_name_utils.h"
 
 namespace xla {
 
+ComputationClient::Data::Data(std::string device, Shape shape,
+                              bool placeholder)
+    : device_(std::move(device)), shape_(std::move(shape)) {
+  int64 bytes = !placeholder && (shape_.IsArray() || shape_.IsTuple())
+                    ? ShapeUtil::ByteSizeOf(shape_, sizeof(void*))
+                    : 0;
+  memory::TrackAllocation(this, device_, bytes);
+}
+
+ComputationClient::Data::~Data() { memory::UntrackAllocation(this); }
+
 std::shared_ptr<ComputationClient::Computation> ComputationClient::Compile(
     XlaComputation computation, std::string compilation_device,
     std::vector<std::string> devices, const Shape* output_shape) {
@@ -66,12 +80,30 @@ int64 ComputationClient::GetDeviceOrdinal(const std::string& device) {
   return std::stoi(device.substr(pos + 1));
 }
 
+namespace {
+
+std::atomic<bool> g_client_created(false);
+ComputationClient* g_installed_client = nullptr;
+
+}  // namespace
+
 ComputationClient* ComputationClient::Get() {
-  static ComputationClient* computation_client =
-      ComputationClient::Create().release();
+  static ComputationClient* computation_client = []() {
+    g_client_created = true;
+    return g_installed_client != nullptr
+               ? g_installed_client
+               : ComputationClient::Create().release();
+  }();
   return computation_client;
 }
 
+void ComputationClient::Set(std::unique_ptr<ComputationClient> client) {
+  XLA_CHECK(!g_client_created)
+      << "The ComputationClient singleton has already been created";
+  XLA_CHECK(g_installed_client == nullptr);
+  g_installed_client = client.release();
+}
+
 metrics::Metric* ComputationClient::TransferToServerMetric() {
   static metrics::Metric* metric =
       new metrics::Metric("TransferToServerTime", metrics::MetricFnTime);
@@ -44,10 +44,12 @@ class ComputationClient {
 
     using OpaqueHandle = int64;
 
-    Data(std::string device, Shape shape)
-        : device_(std::move(device)), shape_(std::move(shape)) {}
+    // Data handles are accounted by the memory tracker (see memory_tracker.h)
+    // for their whole lifetime. Placeholders have no buffer until one is
+    // assigned to them, so they start at zero bytes.
+    Data(std::string device, Shape shape, bool placeholder = false);
 
-    virtual ~Data() {}
+    virtual ~Data();
 
     const std::string& device() const { return device_; }
 
@@ -115,6 +117,11 @@ class ComputationClient {
     Shape shape;
     std::string device;
     PopulateFn populate_fn;
+    // If not null, points to a host buffer which already has the exact layout
+    // and element type of shape. Clients can transfer it directly, without
+    // staging a copy through populate_fn. The buffer must remain valid until
+    // the TransferToServer() call returns.
+    const void* data = nullptr;
   };
 
   struct CompileInstance {
@@ -289,6 +296,11 @@ class ComputationClient {
   // Returns the ComputationClient singleton.
   static ComputationClient* Get();
 
+  // Installs the ComputationClient singleton returned by Get(), in place of the
+  // one built by Create(). Must be called before the first Get() call. Tools
+  // and benchmarks use it to run against a specific client implementation.
+  static void Set(std::unique_ptr<ComputationClient> client);
+
  protected:
   // Metrics common to all client intrfaces.
   static metrics::Metric* TransferToServerMetric();
@@ -16,13 +16,11 @@
 
 #include <tuple>
 
-#include "platforms/deepsea/executor/deepsea_platform.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
-#include "tensorflow/compiler/xla/service/platform_util.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 
 namespace xla {
@@ -180,12 +178,16 @@ FakeComputationClient::FakeComputationClient() {
   }
 }
 
+FakeComputationClient::~FakeComputationClient() {}
+
+// When built as a library next to another client implementation, the fake
+// client is installed explicitly via ComputationClient::Set().
+#ifndef XLA_FAKE_COMPUTATION_CLIENT_NO_FACTORY
 std::unique_ptr<ComputationClient> ComputationClient::Create() {
   return std::make_unique<FakeComputationClient>();
 }
 
-FakeComputationClient::~FakeComputationClient() {}
-
 bool ComputationClient::IsLocal() { return true; }
+#endif  // XLA_FAKE_COMPUTATION_CLIENT_NO_FACTORY
 
 }  // namespace xla
@@ -19,6 +19,7 @@
 #include "platforms/deepsea/executor/deepsea_platform.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
@@ -190,7 +191,7 @@ class LocalComputationClient::Device {
 class LocalComputationClient::LocalData : public Data {
  public:
   LocalData(std::string device, Shape shape)
-      : Data(std::move(device), std::move(shape)) {}
+      : Data(std::move(device), std::move(shape), /*placeholder=*/true) {}
   LocalData(std::string device, ScopedShapedBuffer buffer, int64 computation_id)
       : Data(std::move(device), buffer.on_host_shape()),
         buffer_(std::make_shared<ScopedShapedBuffer>(std::move(buffer))),
@@ -201,6 +202,7 @@ class LocalComputationClient::LocalData : public Data {
     if (&xrt_data != this) {
       buffer_ = xrt_data.buffer_;
       computation_id_ = xrt_data.computation_id_;
+      memory::AssignAllocation(this, &xrt_data);
     }
   }
 
@@ -273,16 +275,22 @@ DataPtr LocalComputationClient::TransferToServer(
 
 std::vector<DataPtr> LocalComputationClient::TransferToServer(
     absl::Span<const TensorSource> tensors) {
+  metrics::TimedSection timed(TransferToServerMetric());
   tensorflow::profiler::TraceMe trace("TransferToServer");
   std::vector<std::unique_ptr<char[]>> buffers;
   buffers.resize(tensors.size());
   size_t total_size = 0;
-  // TODO(parkers): This copy may not be strictly necessary when the layouts
-  // are known to be properly sized from the start.
   util::MultiWait mwait(tensors.size());
   for (size_t i = 0; i < tensors.size(); ++i) {
     size_t size = xla::ShapeUtil::ByteSizeOf(tensors[i].shape);
     total_size += size;
+    if (tensors[i].data != nullptr) {
+      // The source buffer already has the device layout, so it can be read
+      // directly by the transfer manager.
+      XLA_COUNTER("DirectTransferToServer", 1);
+      mwait.Done();
+      continue;
+    }
     auto converter = [&, i, size]() {
       buffers[i] = std::make_unique<char[]>(size + 1);
       tensors[i].populate_fn(tensors[i], buffers[i].get(), size);
@@ -332,7 +340,10 @@ std::vector<DataPtr> LocalComputationClient::TransferToServer(
     }();
 
     // TODO(parkers): Check if buffer is aliased and add dep on compute_stream.
-    xla::BorrowingLiteral literal(buffers[i].get(), tensor.shape);
+    xla::BorrowingLiteral literal(
+        tensor.data != nullptr ? static_cast<const char*>(tensor.data)
+                               : buffers[i].get(),
+        tensor.shape);
 
     TF_CHECK_OK(transfer_manager->TransferLiteralToDeviceAsync(
         stream.get(), literal, buffer));
@@ -464,6 +475,13 @@ std::vector<ComputationPtr> LocalComputationClient::Compile(
 std::vector<DataPtr> LocalComputationClient::ExecuteComputation(
     const Computation& computation, absl::Span<const DataPtr> arguments,
     const std::string& device, const ExecuteComputationOptions& options) {
+  metrics::TimedSection timed(ExecuteMetric());
+  return RunComputation(computation, arguments, device);
+}
+
+std::vector<DataPtr> LocalComputationClient::RunComputation(
+    const Computation& computation, absl::Span<const DataPtr> arguments,
+    const std::string& device) {
   auto& local_computation = dynamic_cast<const LocalComputation&>(computation);
   Device* device_ptr = GetDevice(device);
   std::vector<const xla::ShapedBuffer*> args;
@@ -515,7 +533,20 @@ std::vector<std::vector<DataPtr>> LocalComputationClient::ExecuteReplicated(
     const std::vector<std::vector<DataPtr>>& arguments,
     absl::Span<const std::string> devices,
     const ExecuteReplicatedOptions& options) {
-  TF_LOG(FATAL) << "Implement";
+  metrics::TimedSection timed(ExecuteReplicatedMetric());
+  XLA_CHECK_EQ(arguments.size(), devices.size());
+  std::vector<std::vector<DataPtr>> results(devices.size());
+  // The replicas rendezvous within the cross replica operations of the
+  // computation, so they need to be running concurrently.
+  util::MultiWait mwait(devices.size());
+  for (size_t i = 0; i < devices.size(); ++i) {
+    auto executor = [&, i]() {
+      results[i] = RunComputation(computation, arguments[i], devices[i]);
+    };
+    env::ScheduleIoClosure(mwait.Completer(std::move(executor)));
+  }
+  mwait.Wait();
+  return results;
 }
 
 std::vector<std::vector<DataPtr>> LocalComputationClient::ExecuteParallel(
@@ -528,7 +559,53 @@ std::vector<std::vector<DataPtr>> LocalComputationClient::ExecuteParallel(
 
 std::vector<DataPtr> LocalComputationClient::ExecuteChained(
     absl::Span<const ExecuteChainedOp> ops, const std::string& device) {
-  TF_LOG(FATAL) << "Implement";
+  metrics::TimedSection timed(ExecuteChainedMetric());
+
+  std::vector<int64> uses(ops.size(), 0);
+  for (auto& op : ops) {
+    for (auto& input : op.inputs) {
+      uses[input.op_index] += 1;
+    }
+  }
+  // On non CPU devices ExecuteComputation() only enqueues the computation on
+  // the device stream, so every op is dispatched while the previous ones are
+  // still running.
+  std::vector<std::vector<DataPtr>> ops_outputs(ops.size());
+  std::vector<DataPtr> results;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    const ExecuteChainedOp& op = ops[i];
+    if (op.device_data != nullptr) {
+      ops_outputs[i].push_back(op.device_data);
+    } else {
+      std::vector<DataPtr> arguments;
+      arguments.reserve(op.inputs.size());
+      for (auto& input : op.inputs) {
+        XLA_CHECK_LT(input.op_index, i);
+        XLA_CHECK_LT(input.output_index.value_or(0),
+                     ops_outputs[input.op_index].size());
+        arguments.push_back(
+            ops_outputs[input.op_index][input.output_index.value_or(0)]);
+      }
+      ops_outputs[i] = RunComputation(*op.computation, arguments, device);
+    }
+
+    for (auto& output : op.outputs) {
+      if (output.result_index >= results.size()) {
+        results.resize(output.result_index + 1);
+      }
+      XLA_CHECK_LT(output.output_index.value_or(0), ops_outputs[i].size());
+      results[output.result_index] =
+          ops_outputs[i][output.output_index.value_or(0)];
+    }
+    // Drop references to any intermediate result which is not used anymore.
+    for (auto& input : op.inputs) {
+      uses[input.op_index] -= 1;
+      if (uses[input.op_index] == 0) {
+        ops_outputs[input.op_index].clear();
+      }
+    }
+  }
+  return results;
 }
 
 std::vector<std::vector<DataPtr>> LocalComputationClient::DeconstructTuple(
@@ -95,6 +95,13 @@ class LocalComputationClient : public ComputationClient {
   Device* GetDevice(std::string device) const;
 
  private:
+  // Runs the computation on the device. Unlike ExecuteComputation(), it does
+  // not record ExecuteTime, so that the replicated and chained executions are
+  // only timed once, by their own metric.
+  std::vector<DataPtr> RunComputation(const Computation& computation,
+                                      absl::Span<const DataPtr> arguments,
+                                      const std::string& device);
+
   std::string default_device_ = "CPU:0";
   std::unordered_map<std::string, std::unique_ptr<Device>> devices_;
   std::unordered_map<std::string, int32_t> remote_devices_;
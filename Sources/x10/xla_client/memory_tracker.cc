@@ -0,0 +1,336 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace xla {
+namespace memory {
+namespace {
+
+constexpr size_t kNumKinds = static_cast<size_t>(Kind::kOther) + 1;
+
+using KindBytes = std::array<int64, kNumKinds>;
+
+struct Allocation {
+  std::string device;
+  int64 bytes = 0;
+  Tag tag;
+  // The step the handle has been created within.
+  int64 step = 0;
+};
+
+struct DeviceState {
+  DeviceUsage usage;
+  int64 step_peak_bytes = 0;
+  KindBytes kind_bytes = {};
+};
+
+struct TimelineEntry {
+  int64 step = 0;
+  std::string device;
+  int64 current_bytes = 0;
+  int64 step_peak_bytes = 0;
+  KindBytes kind_bytes = {};
+};
+
+std::string TimelineEntryToString(const TimelineEntry& entry) {
+  std::string line =
+      absl::StrCat("step=", entry.step, " device=", entry.device,
+                   " current=", entry.current_bytes,
+                   " peak=", entry.step_peak_bytes);
+  for (size_t i = 0; i < kNumKinds; ++i) {
+    absl::StrAppend(&line, " ", KindName(static_cast<Kind>(i)), "=",
+                    entry.kind_bytes[i]);
+  }
+  return line;
+}
+
+class MemoryTracker {
+ public:
+  static MemoryTracker* Get() {
+    static MemoryTracker* tracker = new MemoryTracker();
+    return tracker;
+  }
+
+  void Track(const void* handle, const std::string& device, int64 bytes) {
+    std::lock_guard<std::mutex> lock(lock_);
+    Allocation& allocation = allocations_[handle];
+    allocation.device = device;
+    allocation.bytes = bytes;
+    allocation.step = step_;
+    DeviceState& state = devices_[device];
+    state.usage.current_bytes += bytes;
+    state.usage.peak_bytes =
+        std::max(state.usage.peak_bytes, state.usage.current_bytes);
+    state.step_peak_bytes =
+        std::max(state.step_peak_bytes, state.usage.current_bytes);
+    state.kind_bytes[static_cast<size_t>(Kind::kOther)] += bytes;
+  }
+
+  void Untrack(const void* handle) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end()) {
+      return;
+    }
+    DeviceState& state = devices_[it->second.device];
+    state.usage.current_bytes -= it->second.bytes;
+    state.kind_bytes[static_cast<size_t>(it->second.tag.kind)] -=
+        it->second.bytes;
+    allocations_.erase(it);
+  }
+
+  void Assign(const void* handle, const void* source) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = allocations_.find(handle);
+    auto source_it = allocations_.find(source);
+    if (it == allocations_.end() || source_it == allocations_.end() ||
+        it == source_it) {
+      return;
+    }
+    Allocation& allocation = it->second;
+    Allocation& source_allocation = source_it->second;
+    DeviceState& state = devices_[allocation.device];
+    DeviceState& source_state = devices_[source_allocation.device];
+    state.usage.current_bytes += source_allocation.bytes - allocation.bytes;
+    state.kind_bytes[static_cast<size_t>(allocation.tag.kind)] +=
+        source_allocation.bytes - allocation.bytes;
+    source_state.usage.current_bytes -= source_allocation.bytes;
+    source_state.kind_bytes[static_cast<size_t>(source_allocation.tag.kind)] -=
+        source_allocation.bytes;
+    allocation.bytes = source_allocation.bytes;
+    source_allocation.bytes = 0;
+  }
+
+  void SetTag(const void* handle, Tag tag) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end()) {
+      return;
+    }
+    Allocation& allocation = it->second;
+    KindBytes& kind_bytes = devices_[allocation.device].kind_bytes;
+    kind_bytes[static_cast<size_t>(allocation.tag.kind)] -= allocation.bytes;
+    kind_bytes[static_cast<size_t>(tag.kind)] += allocation.bytes;
+    allocation.tag = std::move(tag);
+  }
+
+  std::map<std::string, DeviceUsage> GetDeviceUsages() {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::map<std::string, DeviceUsage> usages;
+    for (auto& device_state : devices_) {
+      usages.emplace(device_state.first, device_state.second.usage);
+    }
+    return usages;
+  }
+
+  void MarkStep() {
+    static const size_t kMaxTimelineSize =
+        sys_util::GetEnvInt("XLA_MEMORY_TIMELINE_SIZE", 1024);
+    static const std::string timeline_file =
+        sys_util::GetEnvString("XLA_MEMORY_TIMELINE_FILE", "");
+    static metrics::Metric* usage_metric =
+        new metrics::Metric("DeviceMemoryUsage", metrics::MetricFnBytes);
+    static metrics::Metric* peak_metric = new metrics::Metric(
+        "StepPeakDeviceMemoryUsage", metrics::MetricFnBytes);
+    std::lock_guard<std::mutex> lock(lock_);
+    std::unique_ptr<std::ofstream> timeline_stream;
+    if (!timeline_file.empty()) {
+      timeline_stream.reset(
+          new std::ofstream(timeline_file, std::ios::out | std::ios::app));
+    }
+    for (auto& device_state : devices_) {
+      DeviceState& state = device_state.second;
+      TimelineEntry entry;
+      entry.step = step_;
+      entry.device = device_state.first;
+      entry.current_bytes = state.usage.current_bytes;
+      entry.step_peak_bytes = state.step_peak_bytes;
+      entry.kind_bytes = state.kind_bytes;
+      usage_metric->AddSample(entry.current_bytes);
+      peak_metric->AddSample(entry.step_peak_bytes);
+      if (timeline_stream != nullptr) {
+        (*timeline_stream) << TimelineEntryToString(entry) << "\n";
+      }
+      timeline_.push_back(std::move(entry));
+      state.step_peak_bytes = state.usage.current_bytes;
+    }
+    while (timeline_.size() > kMaxTimelineSize) {
+      timeline_.pop_front();
+    }
+    ++step_;
+  }
+
+  std::string CreateReport(size_t max_holders) {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::stringstream ss;
+    for (auto& device_state : devices_) {
+      const DeviceState& state = device_state.second;
+      ss << device_state.first << ": Current="
+         << metrics::MetricFnBytes(state.usage.current_bytes)
+         << ", Peak=" << metrics::MetricFnBytes(state.usage.peak_bytes);
+      for (size_t i = 0; i < kNumKinds; ++i) {
+        ss << ", " << KindName(static_cast<Kind>(i)) << "="
+           << metrics::MetricFnBytes(state.kind_bytes[i]);
+      }
+      ss << "\n";
+    }
+
+    std::vector<const Allocation*> holders;
+    std::map<std::string, int64> scope_bytes;
+    holders.reserve(allocations_.size());
+    for (auto& handle_allocation : allocations_) {
+      const Allocation& allocation = handle_allocation.second;
+      holders.push_back(&allocation);
+      scope_bytes[allocation.tag.scope] += allocation.bytes;
+    }
+    size_t num_holders = std::min(max_holders, holders.size());
+    std::partial_sort(holders.begin(), holders.begin() + num_holders,
+                      holders.end(),
+                      [](const Allocation* a, const Allocation* b) {
+                        return a->bytes > b->bytes;
+                      });
+    ss << "Top Holders:\n";
+    for (size_t i = 0; i < num_holders; ++i) {
+      const Allocation& allocation = *holders[i];
+      ss << "  " << metrics::MetricFnBytes(allocation.bytes) << " on "
+         << allocation.device << ": " << KindName(allocation.tag.kind);
+      if (!allocation.tag.op.empty()) {
+        ss << ", Op=" << allocation.tag.op;
+      }
+      if (!allocation.tag.scope.empty()) {
+        ss << ", Scope=" << allocation.tag.scope;
+      }
+      ss << ", Step=" << allocation.step << "\n";
+    }
+
+    std::vector<std::pair<std::string, int64>> scopes(scope_bytes.begin(),
+                                                      scope_bytes.end());
+    size_t num_scopes = std::min(max_holders, scopes.size());
+    std::partial_sort(scopes.begin(), scopes.begin() + num_scopes,
+                      scopes.end(),
+                      [](const std::pair<std::string, int64>& a,
+                         const std::pair<std::string, int64>& b) {
+                        return a.second > b.second;
+                      });
+    ss << "Top Scopes:\n";
+    for (size_t i = 0; i < num_scopes; ++i) {
+      ss << "  " << (scopes[i].first.empty() ? "<unscoped>" : scopes[i].first)
+         << ": " << metrics::MetricFnBytes(scopes[i].second) << "\n";
+    }
+    return ss.str();
+  }
+
+  std::string CreateTimeline() {
+    std::lock_guard<std::mutex> lock(lock_);
+    std::stringstream ss;
+    for (auto& entry : timeline_) {
+      ss << TimelineEntryToString(entry) << "\n";
+    }
+    return ss.str();
+  }
+
+ private:
+  std::mutex lock_;
+  std::unordered_map<const void*, Allocation> allocations_;
+  std::map<std::string, DeviceState> devices_;
+  std::deque<TimelineEntry> timeline_;
+  int64 step_ = 0;
+};
+
+}  // namespace
+
+const char* KindName(Kind kind) {
+  switch (kind) {
+    case Kind::kParameter:
+      return "Parameter";
+    case Kind::kActivation:
+      return "Activation";
+    case Kind::kCache:
+      return "Cache";
+    case Kind::kOther:
+      return "Other";
+  }
+  XLA_ERROR() << "Invalid memory kind " << static_cast<int>(kind);
+}
+
+bool IsTrackingEnabled() {
+  static const bool tracking_enabled =
+      sys_util::GetEnvBool("XLA_MEMORY_TRACKING", false);
+  return tracking_enabled;
+}
+
+void TrackAllocation(const void* handle, const std::string& device,
+                     int64 bytes) {
+  if (IsTrackingEnabled()) {
+    MemoryTracker::Get()->Track(handle, device, bytes);
+  }
+}
+
+void UntrackAllocation(const void* handle) {
+  if (IsTrackingEnabled()) {
+    MemoryTracker::Get()->Untrack(handle);
+  }
+}
+
+void AssignAllocation(const void* handle, const void* source) {
+  if (IsTrackingEnabled()) {
+    MemoryTracker::Get()->Assign(handle, source);
+  }
+}
+
+void SetTag(const void* handle, Tag tag) {
+  if (IsTrackingEnabled()) {
+    MemoryTracker::Get()->SetTag(handle, std::move(tag));
+  }
+}
+
+std::map<std::string, DeviceUsage> GetDeviceUsages() {
+  return IsTrackingEnabled() ? MemoryTracker::Get()->GetDeviceUsages()
+                             : std::map<std::string, DeviceUsage>();
+}
+
+void MarkStep() {
+  if (IsTrackingEnabled()) {
+    MemoryTracker::Get()->MarkStep();
+  }
+}
+
+std::string CreateMemoryReport(size_t max_holders) {
+  return IsTrackingEnabled() ? MemoryTracker::Get()->CreateReport(max_holders)
+                             : std::string();
+}
+
+std::string CreateMemoryTimeline() {
+  return IsTrackingEnabled() ? MemoryTracker::Get()->CreateTimeline()
+                             : std::string();
+}
+
+}  // namespace memory
+}  // namespace xla
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef X10_XLA_CLIENT_MEMORY_TRACKER_H_
+#define X10_XLA_CLIENT_MEMORY_TRACKER_H_
+
+#include <map>
+#include <string>
+
+#include "tensorflow/compiler/xla/types.h"
+
+namespace xla {
+namespace memory {
+
+// Accounting of the device memory held by the live ComputationClient::Data
+// handles, enabled by XLA_MEMORY_TRACKING. Every handle is accounted the byte
+// size of its shape from its creation to its destruction. Placeholders for
+// pending outputs hold no buffer, so they are accounted zero bytes until the
+// result of their computation is assigned to them.
+
+// What the memory of a handle holds.
+enum class Kind {
+  // Data transferred from the host, like inputs and model weights.
+  kParameter,
+  // Results of the executed graphs.
+  kActivation,
+  // Data kept alive by the device data cache.
+  kCache,
+  kOther,
+};
+
+struct Tag {
+  Kind kind = Kind::kOther;
+  // The kind of the IR node producing the data, if any.
+  std::string op;
+  // The IR scope the data has been created within.
+  std::string scope;
+};
+
+struct DeviceUsage {
+  int64 current_bytes = 0;
+  // The highest current_bytes since the process started.
+  int64 peak_bytes = 0;
+};
+
+const char* KindName(Kind kind);
+
+bool IsTrackingEnabled();
+
+// Called by the ComputationClient::Data constructor and destructor.
+void TrackAllocation(const void* handle, const std::string& device,
+                     int64 bytes);
+void UntrackAllocation(const void* handle);
+
+// Called by Data::Assign: handle now holds the buffer of source, so the bytes
+// accounted to source move to handle, whose previous bytes are released.
+void AssignAllocation(const void* handle, const void* source);
+
+// Tags the allocation of a handle, which is accounted as Kind::kOther until
+// then.
+void SetTag(const void* handle, Tag tag);
+
+std::map<std::string, DeviceUsage> GetDeviceUsages();
+
+// Ends the current step: appends the usage of every device, along with its
+// peak within the step, to the timeline (and to XLA_MEMORY_TIMELINE_FILE if
+// set), and starts a new one.
+void MarkStep();
+
+// Creates a report of the current and peak usage of every device, broken down
+// by kind, followed by the max_holders largest handles and the max_holders
+// scopes holding the most memory. Returns an empty string if tracking is not
+// enabled.
+std::string CreateMemoryReport(size_t max_holders);
+
+// Dumps the last XLA_MEMORY_TIMELINE_SIZE entries of the timeline, one per
+// device and step.
+std::string CreateMemoryTimeline();
+
+}  // namespace memory
+}  // namespace xla
+
+#endif  // X10_XLA_CLIENT_MEMORY_TRACKER_H_
@@ -14,6 +14,8 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
 
+#include <unordered_map>
+
 namespace c10 {
 
 const char* Symbol::toQualString() const {
@@ -35,4 +37,19 @@ const char* Symbol::toQualString() const {
   }
 }
 
+Symbol Symbol::fromQualString(const std::string& s) {
+  static const std::unordered_map<std::string, Symbol>* symbols = []() {
+    auto symbols = new std::unordered_map<std::string, Symbol>();
+    for (unique_t value = 0; value < swift_xla::xla_symbols::END_Symbol;
+         ++value) {
+      Symbol symbol;
+      symbol.value = value;
+      symbols->emplace(symbol.toQualString(), symbol);
+    }
+    return symbols;
+  }();
+  auto it = symbols->find(s);
+  return it != symbols->end() ? it->second : Symbol();
+}
+
 }  // namespace c10
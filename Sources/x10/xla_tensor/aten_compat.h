@@ -771,6 +771,8 @@
   _(xla, get_dimensions_size)     \
   _(xla, moving_average)          \
   _(xla, not_supported)           \
+  _(xla, scan)                    \
+  _(xla, scan_parameter)          \
   _(xla, select)                  \
   _(xla, tensor_data)             \
   _(xla, token)                   \
@@ -1046,6 +1048,31 @@ class NonOwnedAnyScalarBuffer : public AnyScalarBuffer {
   }
 };
 
+// Implementation of Scalar buffer backed by a data buffer which is pinned by
+// a foreign owner (ie, a Swift array). The release callback is invoked once the
+// last reference to the buffer goes away, so the owner can unpin the storage.
+template <typename T>
+class BorrowedAnyScalarBuffer : public NonOwnedAnyScalarBuffer<T> {
+ public:
+  using ReleaseFn = void (*)(void*);
+
+  BorrowedAnyScalarBuffer(const T* data, size_t len, ReleaseFn release,
+                          void* release_context)
+      : NonOwnedAnyScalarBuffer<T>(data, len),
+        release_(release),
+        release_context_(release_context) {}
+
+  ~BorrowedAnyScalarBuffer() override {
+    if (release_ != nullptr) {
+      release_(release_context_);
+    }
+  }
+
+ private:
+  ReleaseFn release_;
+  void* release_context_;
+};
+
 template <typename T>
 std::unique_ptr<AnyScalarBuffer> AnyScalarBuffer::make(
     std::unique_ptr<T[]> data, size_t len) {
@@ -1148,7 +1175,9 @@ struct Symbol {
 
   const char* toQualString() const;
 
-  static Symbol fromQualString(const std::string& s) { return Symbol(); }
+  // Returns the symbol whose qualified name is s, or the default symbol if
+  // there is none.
+  static Symbol fromQualString(const std::string& s);
 
  private:
   unique_t value;
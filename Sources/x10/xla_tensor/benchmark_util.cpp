@@ -0,0 +1,121 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/benchmark_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+
+namespace swift_xla {
+namespace {
+
+// Parses a single --name=value argument into the matching flag, and returns
+// false if there is none, or if the value is not valid for it.
+bool ParseFlag(absl::string_view arg, absl::Span<const BenchmarkFlag> flags) {
+  for (auto& flag : flags) {
+    absl::string_view value = arg;
+    if (!absl::ConsumePrefix(&value, absl::StrCat("--", flag.name, "="))) {
+      continue;
+    }
+    if (flag.string_value != nullptr) {
+      *flag.string_value = std::string(value);
+      return true;
+    }
+    return absl::SimpleAtoi(value, flag.int_value) &&
+           *flag.int_value >= flag.min_value;
+  }
+  return false;
+}
+
+double ElapsedMicros(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+bool ParseBenchmarkFlags(int argc, char** argv,
+                         absl::Span<const BenchmarkFlag> flags,
+                         absl::string_view usage) {
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseFlag(argv[i], flags)) {
+      absl::FPrintF(stderr, "Invalid argument: %s\n", argv[i]);
+      PrintBenchmarkUsage(argv[0], usage);
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrintBenchmarkUsage(const char* program, absl::string_view usage) {
+  absl::FPrintF(stderr, "Usage: %s %s\n", program, usage);
+}
+
+std::shared_ptr<xla::ComputationClient::Computation> CompileForDevice(
+    xla::XlaComputation computation, const Device& device) {
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape result_shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device.hw_type);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({std::move(computation), device.ToString(),
+                       xla::ComputationClient::Get()->GetCompilationDevices(
+                           device.ToString(), {}),
+                       &result_shape});
+  return xla::ComputationClient::Get()->Compile(std::move(instances)).front();
+}
+
+std::vector<xla::Literal> ExecuteAndFetch(
+    const xla::ComputationClient::Computation& computation,
+    absl::Span<const xla::ComputationClient::DataPtr> arguments,
+    const Device& device) {
+  std::vector<xla::ComputationClient::DataPtr> results =
+      xla::ComputationClient::Get()->ExecuteComputation(
+          computation, arguments, device.ToString(), {});
+  return xla::ComputationClient::Get()->TransferFromServer(results);
+}
+
+BenchmarkTimes TimeRepeated(const std::function<void()>& fn, int repetitions) {
+  XLA_CHECK_GT(repetitions, 0);
+  BenchmarkTimes times;
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  times.first_us = ElapsedMicros(start);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repetitions; ++i) {
+    fn();
+  }
+  times.average_us = ElapsedMicros(start) / repetitions;
+  return times;
+}
+
+bool ChecksumsMatch(absl::string_view name, double lhs, double rhs,
+                    double relative_tolerance) {
+  double scale = std::max(std::abs(lhs), std::abs(rhs));
+  if (std::abs(lhs - rhs) <= relative_tolerance * std::max(scale, 1.0)) {
+    return true;
+  }
+  absl::FPrintF(stderr, "%s: checksum mismatch: %g vs %g\n", name, lhs, rhs);
+  return false;
+}
+
+}  // namespace swift_xla
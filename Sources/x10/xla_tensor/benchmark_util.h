@@ -0,0 +1,86 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/client/xla_computation.h"
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+
+namespace swift_xla {
+
+// A --name=value command line flag of a benchmark, holding either an integer
+// which must be at least min_value, or a string.
+struct BenchmarkFlag {
+  BenchmarkFlag(std::string name, int* value, int min_value = 1)
+      : name(std::move(name)), int_value(value), min_value(min_value) {}
+
+  BenchmarkFlag(std::string name, std::string* value)
+      : name(std::move(name)), string_value(value) {}
+
+  std::string name;
+  int* int_value = nullptr;
+  int min_value = 0;
+  std::string* string_value = nullptr;
+};
+
+// Parses the command line into the flags. On an invalid or unknown argument,
+// prints the error and the usage, which lists the accepted arguments, and
+// returns false.
+bool ParseBenchmarkFlags(int argc, char** argv,
+                         absl::Span<const BenchmarkFlag> flags,
+                         absl::string_view usage);
+
+// Prints the usage line of the benchmark to stderr.
+void PrintBenchmarkUsage(const char* program, absl::string_view usage);
+
+// Compiles the computation for the device.
+std::shared_ptr<xla::ComputationClient::Computation> CompileForDevice(
+    xla::XlaComputation computation, const Device& device);
+
+// Executes the computation over the arguments, and fetches its results, which
+// waits for the execution to complete.
+std::vector<xla::Literal> ExecuteAndFetch(
+    const xla::ComputationClient::Computation& computation,
+    absl::Span<const xla::ComputationClient::DataPtr> arguments,
+    const Device& device);
+
+struct BenchmarkTimes {
+  // The time of the first run, which includes the warm up of the device and
+  // possibly some compilations.
+  double first_us = 0;
+  // The average time of the following runs.
+  double average_us = 0;
+};
+
+// Runs fn once, and then the given number of times.
+BenchmarkTimes TimeRepeated(const std::function<void()>& fn, int repetitions);
+
+// Returns whether the checksums which two computations of the same values
+// produce are within the relative tolerance of each other. Otherwise prints
+// both of them, along with the name of the check.
+bool ChecksumsMatch(absl::string_view name, double lhs, double rhs,
+                    double relative_tolerance);
+
+}  // namespace swift_xla
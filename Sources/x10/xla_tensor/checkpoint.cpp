@@ -0,0 +1,476 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <set>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace swift_xla {
+namespace {
+
+constexpr char kMagic[8] = {'X', '1', '0', 'C', 'K', 'P', 'T', '\0'};
+constexpr uint64_t kVersion = 1;
+// Tensor data is page aligned, so that mapped tensors can be handed to DMA
+// capable transfers as they are.
+constexpr uint64_t kDataAlignment = 4096;
+// The size of the chunks of the data section which are read in parallel.
+constexpr uint64_t kReadChunkSize = 16 << 20;
+
+struct Header {
+  char magic[8];
+  uint64_t version;
+  uint64_t num_tensors;
+  uint64_t index_offset;
+  uint64_t index_size;
+};
+
+struct IndexEntry {
+  std::string name;
+  at::ScalarType type;
+  std::vector<int64_t> dims;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+};
+
+uint64_t AlignOffset(uint64_t offset) {
+  return (offset + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+}
+
+template <typename T>
+void AppendValue(const T& value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+std::string SerializeIndex(const std::vector<IndexEntry>& entries) {
+  std::string index;
+  for (auto& entry : entries) {
+    AppendValue<uint64_t>(entry.name.size(), &index);
+    index.append(entry.name);
+    AppendValue<int32_t>(static_cast<int32_t>(entry.type), &index);
+    AppendValue<uint32_t>(entry.dims.size(), &index);
+    for (int64_t dim : entry.dims) {
+      AppendValue(dim, &index);
+    }
+    AppendValue(entry.offset, &index);
+    AppendValue(entry.size, &index);
+  }
+  return index;
+}
+
+class IndexReader {
+ public:
+  IndexReader(const char* data, uint64_t size, const std::string& path)
+      : data_(data), size_(size), path_(path) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Consume(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string ReadString(uint64_t size) {
+    return std::string(Consume(size), size);
+  }
+
+  uint64_t remaining() const { return size_ - offset_; }
+
+ private:
+  const char* Consume(uint64_t size) {
+    XLA_CHECK_LE(size, size_ - offset_)
+        << "Truncated index in checkpoint " << path_;
+    const char* data = data_ + offset_;
+    offset_ += size;
+    return data;
+  }
+
+  const char* data_;
+  uint64_t size_;
+  uint64_t offset_ = 0;
+  const std::string& path_;
+};
+
+// The size of an index entry with an empty name and no dimensions.
+constexpr uint64_t kMinIndexEntrySize = sizeof(uint64_t) + sizeof(int32_t) +
+                                        sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+bool IsValidScalarType(int32_t type) {
+  switch (static_cast<at::ScalarType>(type)) {
+#define VALID_TYPE_CASE(name, aten_name, type) case at::ScalarType::aten_name:
+    LIST_SCALAR_TYPES(VALID_TYPE_CASE)
+#undef VALID_TYPE_CASE
+    return true;
+  }
+  return false;
+}
+
+// Parses the index of a checkpoint whose tensor data lies within the
+// [data_begin, data_end) range of the file.
+std::vector<IndexEntry> ParseIndex(const char* data, uint64_t size,
+                                   uint64_t num_tensors, uint64_t data_begin,
+                                   uint64_t data_end, const std::string& path) {
+  XLA_CHECK_LE(num_tensors, size / kMinIndexEntrySize)
+      << "Invalid number of tensors in checkpoint " << path;
+  IndexReader reader(data, size, path);
+  std::vector<IndexEntry> entries(num_tensors);
+  for (auto& entry : entries) {
+    entry.name = reader.ReadString(reader.Read<uint64_t>());
+    int32_t type = reader.Read<int32_t>();
+    XLA_CHECK(type >= 0 && type <= std::numeric_limits<int8_t>::max() &&
+              IsValidScalarType(type))
+        << "Invalid type " << type << " of entry " << entry.name
+        << " in checkpoint " << path;
+    entry.type = static_cast<at::ScalarType>(type);
+    uint32_t rank = reader.Read<uint32_t>();
+    XLA_CHECK_LE(rank, reader.remaining() / sizeof(int64_t))
+        << "Truncated index in checkpoint " << path;
+    // The byte size is bounded by the data section at every step, so it
+    // cannot overflow.
+    uint64_t byte_size = at::internal::GetSizeof(entry.type);
+    entry.dims.resize(rank);
+    for (auto& dim : entry.dims) {
+      dim = reader.Read<int64_t>();
+      XLA_CHECK_GE(dim, 0) << "Corrupted entry " << entry.name
+                           << " in checkpoint " << path;
+      uint64_t size_dim = static_cast<uint64_t>(dim);
+      XLA_CHECK(size_dim == 0 ||
+                byte_size <= (data_end - data_begin) / size_dim)
+          << "Out of bounds entry " << entry.name << " in checkpoint " << path;
+      byte_size *= size_dim;
+    }
+    entry.offset = reader.Read<uint64_t>();
+    entry.size = reader.Read<uint64_t>();
+    XLA_CHECK_EQ(entry.size, byte_size)
+        << "Corrupted entry " << entry.name << " in checkpoint " << path;
+    XLA_CHECK(entry.offset >= data_begin && entry.offset <= data_end &&
+              entry.size <= data_end - entry.offset)
+        << "Out of bounds entry " << entry.name << " in checkpoint " << path;
+  }
+  return entries;
+}
+
+// Flushes the content of the file to the storage device, so that a crash after
+// the following rename cannot leave a checkpoint with missing data behind.
+void SyncFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  XLA_CHECK_GE(fd, 0) << "Unable to open " << path << ": "
+                      << std::strerror(errno);
+  int status = fsync(fd);
+  int fsync_errno = errno;
+  close(fd);
+  XLA_CHECK_EQ(status, 0) << "Unable to sync " << path << ": "
+                          << std::strerror(fsync_errno);
+}
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    XLA_CHECK_GE(fd, 0) << "Unable to open checkpoint " << path << ": "
+                        << std::strerror(errno);
+    struct stat file_stat;
+    XLA_CHECK_EQ(fstat(fd, &file_stat), 0)
+        << "Unable to stat checkpoint " << path << ": " << std::strerror(errno);
+    size_ = file_stat.st_size;
+    if (size_ > 0) {
+      void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      XLA_CHECK(data != MAP_FAILED) << "Unable to map checkpoint " << path
+                                    << ": " << std::strerror(errno);
+      data_ = static_cast<const char*>(data);
+      madvise(data, size_, MADV_WILLNEED);
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  const char* data() const { return data_; }
+
+  uint64_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+// Faults in the pages of the [begin, end) range of the mapping from multiple
+// threads, so that the following transfers read from memory rather than
+// waiting on serial disk reads.
+void ReadPages(const MappedFile& file, uint64_t begin, uint64_t end) {
+  tensorflow::profiler::TraceMe trace("ReadCheckpointPages");
+  size_t num_chunks = (end - begin + kReadChunkSize - 1) / kReadChunkSize;
+  xla::util::MultiWait mwait(num_chunks);
+  for (size_t i = 0; i < num_chunks; ++i) {
+    uint64_t chunk_begin = begin + i * kReadChunkSize;
+    uint64_t chunk_end = std::min(chunk_begin + kReadChunkSize, end);
+    auto reader = [&file, chunk_begin, chunk_end]() {
+      volatile char sink = 0;
+      for (uint64_t offset = chunk_begin; offset < chunk_end;
+           offset += kDataAlignment) {
+        sink = file.data()[offset];
+      }
+      (void)sink;
+    };
+    xla::env::ScheduleIoClosure(mwait.Completer(std::move(reader)));
+  }
+  mwait.Wait();
+  XLA_COUNTER("CheckpointReadBytes", end - begin);
+}
+
+// The number of snapshots which hold references to device data they have not
+// fetched yet.
+std::atomic<size_t> g_pending_snapshots(0);
+
+// The tensors of a checkpoint, as captured at save time. Tensors which have
+// host data keep it, while the others keep references to their device data.
+struct CapturedTensors {
+  std::vector<c10::optional<at::Tensor>> host_tensors;
+  std::vector<at::ScalarType> types;
+  std::vector<xla::ComputationClient::DataPtr> handles;
+  std::vector<size_t> handle_indices;
+  std::vector<std::string> devices;
+};
+
+// Captures the current data of the tensors. The pending IR graphs of all the
+// tensors are materialized at once, waiting for their execution only if wait
+// is true.
+CapturedTensors CaptureTensors(std::vector<XLATensor> tensors, bool wait) {
+  std::vector<XLATensor> pending_tensors;
+  for (auto& tensor : tensors) {
+    if (!tensor.CurrentTensorData() && tensor.CurrentXlaData() == nullptr) {
+      pending_tensors.push_back(tensor);
+    }
+  }
+  if (!pending_tensors.empty()) {
+    XLATensor::SyncTensorsGraph(&pending_tensors, {}, wait,
+                                /*sync_xla_data=*/false);
+  }
+  CapturedTensors captured;
+  captured.host_tensors.resize(tensors.size());
+  std::set<std::string> devices;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    captured.types.push_back(tensors[i].dtype());
+    c10::optional<at::Tensor> tensor_data = tensors[i].CurrentTensorData();
+    if (tensor_data) {
+      captured.host_tensors[i] = std::move(tensor_data);
+    } else {
+      xla::ComputationClient::DataPtr xla_data = tensors[i].CurrentXlaData();
+      XLA_CHECK(xla_data != nullptr);
+      devices.insert(xla_data->device());
+      captured.handles.push_back(std::move(xla_data));
+      captured.handle_indices.push_back(i);
+    }
+  }
+  captured.devices.assign(devices.begin(), devices.end());
+  return captured;
+}
+
+// Fetches the captured device data with a single transfer, and releases the
+// references to it.
+std::vector<at::Tensor> FetchTensors(CapturedTensors* captured) {
+  if (!captured->handles.empty()) {
+    std::vector<xla::Literal> literals =
+        xla::ComputationClient::Get()->TransferFromServer(captured->handles);
+    for (size_t i = 0; i < literals.size(); ++i) {
+      size_t index = captured->handle_indices[i];
+      captured->host_tensors[index] = MakeTensorFromXlaLiteral(
+          std::move(literals[i]), captured->types[index]);
+    }
+    captured->handles.clear();
+  }
+  std::vector<at::Tensor> host_tensors;
+  host_tensors.reserve(captured->host_tensors.size());
+  for (auto& tensor : captured->host_tensors) {
+    host_tensors.push_back(std::move(*tensor));
+  }
+  return host_tensors;
+}
+
+void WriteCheckpoint(const std::string& path,
+                     absl::Span<const std::string> names,
+                     const std::vector<at::Tensor>& host_tensors) {
+  tensorflow::profiler::TraceMe trace("WriteCheckpoint");
+  std::vector<IndexEntry> entries(host_tensors.size());
+  uint64_t offset = AlignOffset(sizeof(Header));
+  for (size_t i = 0; i < host_tensors.size(); ++i) {
+    entries[i].name = names[i];
+    entries[i].type = host_tensors[i].scalar_type();
+    entries[i].dims = host_tensors[i].shape();
+    entries[i].offset = offset;
+    entries[i].size = host_tensors[i].buffer().raw_size();
+    offset = AlignOffset(offset + entries[i].size);
+  }
+  std::string index = SerializeIndex(entries);
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_tensors = entries.size();
+  header.index_offset = offset;
+  header.index_size = index.size();
+
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    XLA_CHECK(file) << "Unable to create checkpoint " << temp_path;
+    std::string padding(kDataAlignment, '\0');
+    uint64_t position = 0;
+    auto write = [&](const void* data, uint64_t size) {
+      file.write(static_cast<const char*>(data), size);
+      position += size;
+    };
+    auto pad_to = [&](uint64_t target) {
+      XLA_CHECK_LE(position, target);
+      write(padding.data(), target - position);
+    };
+    write(&header, sizeof(header));
+    for (size_t i = 0; i < entries.size(); ++i) {
+      pad_to(entries[i].offset);
+      write(host_tensors[i].buffer().raw_data(), entries[i].size);
+    }
+    pad_to(header.index_offset);
+    write(index.data(), index.size());
+    file.flush();
+    XLA_CHECK(file) << "Unable to write checkpoint " << temp_path;
+  }
+  SyncFile(temp_path);
+  XLA_CHECK_EQ(std::rename(temp_path.c_str(), path.c_str()), 0)
+      << "Unable to rename " << temp_path << " to " << path << ": "
+      << std::strerror(errno);
+  XLA_COUNTER("CheckpointWrittenBytes", offset + index.size());
+}
+
+}  // namespace
+
+void SaveCheckpoint(const std::string& path,
+                    absl::Span<const std::string> names,
+                    std::vector<XLATensor> tensors) {
+  tensorflow::profiler::TraceMe trace("SaveCheckpoint");
+  XLA_CHECK_EQ(names.size(), tensors.size());
+  CapturedTensors captured = CaptureTensors(std::move(tensors), /*wait=*/true);
+  WriteCheckpoint(path, names, FetchTensors(&captured));
+}
+
+xla::util::AsyncTask<bool> SaveCheckpointAsync(const std::string& path,
+                                               std::vector<std::string> names,
+                                               std::vector<XLATensor> tensors) {
+  tensorflow::profiler::TraceMe trace("SaveCheckpointAsync");
+  XLA_CHECK_EQ(names.size(), tensors.size());
+  auto captured = std::make_shared<CapturedTensors>(
+      CaptureTensors(std::move(tensors), /*wait=*/false));
+  XLA_COUNTER("CheckpointSnapshots", 1);
+  ++g_pending_snapshots;
+  auto snapshot_fn = [path, names = std::move(names), captured]() {
+    std::vector<at::Tensor> host_tensors;
+    {
+      // The snapshot stops being pending once its device data has been
+      // fetched, even if the fetch fails.
+      xla::util::ExceptionCleanup pending_release(
+          [](xla::util::ExceptionCleanup::StatusType) {
+            --g_pending_snapshots;
+          });
+      // The captured device data might still be produced by the asynchronous
+      // execution of the step which preceded the snapshot.
+      if (!captured->handles.empty()) {
+        XLATensor::WaitDeviceOps(captured->devices);
+      }
+      host_tensors = FetchTensors(captured.get());
+    }
+    WriteCheckpoint(path, names, host_tensors);
+    return true;
+  };
+  xla::util::AsyncTask<bool> async(std::move(snapshot_fn));
+  async.Schedule();
+  return async;
+}
+
+bool HasPendingCheckpointSnapshots() { return g_pending_snapshots > 0; }
+
+Checkpoint LoadCheckpoint(const std::string& path, const Device& device) {
+  tensorflow::profiler::TraceMe trace("LoadCheckpoint");
+  MappedFile file(path);
+  XLA_CHECK_GE(file.size(), sizeof(Header))
+      << "Truncated checkpoint header in " << path;
+  Header header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  XLA_CHECK_EQ(std::memcmp(header.magic, kMagic, sizeof(kMagic)), 0)
+      << path << " is not an x10 checkpoint";
+  XLA_CHECK_EQ(header.version, kVersion)
+      << "Unsupported version of checkpoint " << path;
+  // The data section spans from the first aligned offset after the header to
+  // the index.
+  uint64_t data_begin = AlignOffset(sizeof(Header));
+  XLA_CHECK(header.index_offset >= data_begin &&
+            header.index_offset <= file.size() &&
+            header.index_size <= file.size() - header.index_offset)
+      << "Truncated index in checkpoint " << path;
+  std::vector<IndexEntry> entries =
+      ParseIndex(file.data() + header.index_offset, header.index_size,
+                 header.num_tensors, data_begin, header.index_offset, path);
+
+  ReadPages(file, data_begin, header.index_offset);
+
+  // The tensors alias the mapped pages, which stay valid until the transfer
+  // returns.
+  std::vector<at::Tensor> host_tensors;
+  host_tensors.reserve(entries.size());
+  for (auto& entry : entries) {
+    host_tensors.push_back(MakeTensorFromHostBuffer(
+        entry.type, file.data() + entry.offset, entry.dims));
+  }
+  std::vector<xla::ComputationClient::TensorSource> source_tensors;
+  source_tensors.reserve(host_tensors.size());
+  for (auto& tensor : host_tensors) {
+    source_tensors.push_back(TensorToTensorSource(tensor, device));
+  }
+  std::vector<xla::ComputationClient::DataPtr> handles =
+      xla::ComputationClient::Get()->TransferToServer(source_tensors);
+
+  Checkpoint checkpoint;
+  checkpoint.names.reserve(entries.size());
+  checkpoint.tensors.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    checkpoint.names.push_back(std::move(entries[i].name));
+    checkpoint.tensors.push_back(
+        XLATensor::Create(std::move(handles[i]), entries[i].type));
+  }
+  return checkpoint;
+}
+
+}  // namespace swift_xla
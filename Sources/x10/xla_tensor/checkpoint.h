@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/xla_client/async_task.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+
+// The x10 checkpoint file format is made of:
+//
+//   - A fixed size header, holding the offset and size of the tensor index.
+//   - The data of the tensors, each one starting at a page aligned offset, in
+//     host layout and byte order.
+//   - The tensor index, with name, element type, dimensions, offset and size
+//     of every tensor.
+//
+// The data section can be memory mapped and handed to the device transfers
+// without any intermediate copy.
+struct Checkpoint {
+  std::vector<std::string> names;
+  std::vector<XLATensor> tensors;
+};
+
+// Saves the tensors under the given names. The device data of all the tensors
+// is fetched with a single TransferFromServer() call. The file is written to a
+// temporary path first and renamed, so a preempted save never leaves a
+// truncated checkpoint behind.
+void SaveCheckpoint(const std::string& path,
+                    absl::Span<const std::string> names,
+                    std::vector<XLATensor> tensors);
+
+// Like SaveCheckpoint(), but returns right after capturing references to the
+// current data of the tensors, usually at a step boundary. The pending graphs
+// are scheduled without waiting, and a background thread fetches the device
+// data and writes the file while the following steps run. The captured device
+// buffers are not donated to the following steps while the snapshot holds
+// them, so the steps write their results into new buffers instead.
+xla::util::AsyncTask<bool> SaveCheckpointAsync(const std::string& path,
+                                               std::vector<std::string> names,
+                                               std::vector<XLATensor> tensors);
+
+// Returns whether any checkpoint snapshot holds device data it has not fetched
+// yet, in which case parameter buffers must not be aliased with outputs.
+bool HasPendingCheckpointSnapshots();
+
+// Loads all the tensors of a checkpoint onto device. The file is memory
+// mapped, its pages are read in parallel chunks, and the tensors are uploaded
+// with a single TransferToServer() call reading straight from the mapping.
+Checkpoint LoadCheckpoint(const std::string& path, const Device& device);
+
+}  // namespace swift_xla
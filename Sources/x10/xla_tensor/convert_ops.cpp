@@ -89,4 +89,15 @@ xla::XlaOp CastToScalarType(xla::XlaOp input,
   }
 }
 
+xla::PrimitiveType GetCastToScalarType(xla::PrimitiveType type,
+                                       c10::optional<at::ScalarType> dtype) {
+  if (dtype) {
+    return MakeXlaPrimitiveType(*dtype, /*device=*/nullptr);
+  }
+  return type != xla::PrimitiveType::PRED
+             ? type
+             : GetDevicePrimitiveType(xla::PrimitiveType::U8,
+                                      /*device=*/nullptr);
+}
+
 }  // namespace swift_xla
@@ -35,4 +35,9 @@ xla::XlaOp ConvertToNumeric(xla::XlaOp op);
 xla::XlaOp CastToScalarType(xla::XlaOp input,
                             c10::optional<at::ScalarType> dtype);
 
+// Returns the element type which CastToScalarType() converts values of the
+// given type to.
+xla::PrimitiveType GetCastToScalarType(xla::PrimitiveType type,
+                                       c10::optional<at::ScalarType> dtype);
+
 }  // namespace swift_xla
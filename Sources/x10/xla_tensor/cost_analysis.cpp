@@ -0,0 +1,393 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/cost_analysis.h"
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/einsum_planner.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/einsum.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scan.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+// When apportioning the time of an execution to its scopes, a byte accessed
+// weighs as much as kFlopsPerByte floating point operations, which is about
+// the ratio of compute to memory bandwidth of a CPU.
+constexpr double kFlopsPerByte = 4.0;
+
+struct ScopeTally {
+  NodeCost cost;
+  double nanos = 0;
+};
+
+struct ScopeTallies {
+  std::mutex lock;
+  std::map<std::string, ScopeTally> tallies;
+  size_t executions = 0;
+  size_t timed_executions = 0;
+};
+
+ScopeTallies* GetScopeTallies() {
+  static ScopeTallies* tallies = new ScopeTallies();
+  return tallies;
+}
+
+double ElementCount(const xla::Shape& shape) {
+  if (shape.IsTuple()) {
+    double count = 0;
+    for (auto& element_shape : shape.tuple_shapes()) {
+      count += ElementCount(element_shape);
+    }
+    return count;
+  }
+  return shape.IsArray() ? xla::ShapeUtil::ElementsIn(shape) : 0;
+}
+
+double ByteCount(const xla::Shape& shape) {
+  if (shape.IsTuple()) {
+    double count = 0;
+    for (auto& element_shape : shape.tuple_shapes()) {
+      count += ByteCount(element_shape);
+    }
+    return count;
+  }
+  return shape.IsArray() ? xla::ShapeUtil::ByteSizeOf(shape) : 0;
+}
+
+bool IsLeafData(const OpKind& kind) {
+  return kind == *ops::xla_device_data || kind == OpKind(at::prim::Constant) ||
+         kind == *ops::xla_scan_parameter;
+}
+
+bool IsDataMovement(const OpKind& kind) {
+  static const std::set<OpKind>* kinds = new std::set<OpKind>({
+      OpKind(at::aten::as_strided),
+      OpKind(at::aten::cat),
+      OpKind(at::aten::constant_pad_nd),
+      OpKind(at::aten::diagonal),
+      OpKind(at::aten::expand),
+      OpKind(at::aten::flip),
+      OpKind(at::aten::gather),
+      OpKind(at::aten::index_select),
+      OpKind(at::aten::permute),
+      OpKind(at::aten::repeat),
+      OpKind(at::aten::split),
+      OpKind(at::aten::squeeze),
+      OpKind(at::aten::stack),
+      OpKind(at::aten::take),
+      OpKind(at::aten::tf_mirror_pad),
+      OpKind(at::aten::unsqueeze),
+      OpKind(at::aten::view),
+      OpKind(at::aten::xla_pad),
+      OpKind(at::aten::xla_slice),
+      *ops::xla_as_strided_view_update,
+      *ops::xla_diagonal_view_update,
+      *ops::xla_generic_slice,
+      *ops::xla_select,
+      *ops::xla_unselect,
+      *ops::xla_update_slice,
+  });
+  return kinds->count(kind) > 0;
+}
+
+bool IsReduction(const OpKind& kind) {
+  static const std::set<OpKind>* kinds = new std::set<OpKind>({
+      OpKind(at::aten::all),
+      OpKind(at::aten::any),
+      OpKind(at::aten::argmax),
+      OpKind(at::aten::argmin),
+      OpKind(at::aten::cumprod),
+      OpKind(at::aten::cumsum),
+      OpKind(at::aten::kthvalue),
+      OpKind(at::aten::logsumexp),
+      OpKind(at::aten::max),
+      OpKind(at::aten::mean),
+      OpKind(at::aten::min),
+      OpKind(at::aten::prod),
+      OpKind(at::aten::std),
+      OpKind(at::aten::sum),
+      OpKind(at::aten::topk),
+  });
+  return kinds->count(kind) > 0;
+}
+
+// Returns the number of multiply-adds of a convolution producing output_shape
+// (or consuming it, for the backward passes) with a filter of filter_shape.
+// Every output element is the dot product of the filter slice of its feature,
+// which makes the count independent of the filter layout, and also right for
+// grouped and depthwise convolutions.
+double ConvolutionMacs(const xla::Shape& output_shape,
+                       const xla::Shape& filter_shape,
+                       xla::int64 feature_dim) {
+  xla::int64 features = output_shape.dimensions(feature_dim);
+  if (features == 0) {
+    return 0;
+  }
+  return ElementCount(output_shape) * ElementCount(filter_shape) / features;
+}
+
+// Returns the number of multiply-adds of an einsum. Equations with more than
+// two operands are contracted pairwise, and cost what the steps of their plan
+// do. Otherwise this is the product of the sizes of all the labels. Equations
+// with ellipsis are accounted as a multiply-add per output element.
+double EinsumMacs(const ops::Einsum* einsum) {
+  const std::string& equation = einsum->equation();
+  if (einsum->operands().size() > 2) {
+    std::vector<xla::Shape> shapes;
+    for (auto& operand : einsum->operands()) {
+      shapes.push_back(operand.shape());
+    }
+    return GetEinsumPlan(equation, shapes)->flops;
+  }
+  std::vector<std::string> inputs = absl::StrSplit(
+      equation.substr(0, equation.find("->")), ',', absl::SkipEmpty());
+  if (equation.find('.') != std::string::npos ||
+      inputs.size() != einsum->operands().size()) {
+    return ElementCount(einsum->shape());
+  }
+  std::unordered_map<char, xla::int64> label_sizes;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const xla::Shape& shape = einsum->operand(i).shape();
+    xla::int64 rank = std::min<xla::int64>(inputs[i].size(), shape.rank());
+    for (xla::int64 j = 0; j < rank; ++j) {
+      xla::int64& size = label_sizes[inputs[i][j]];
+      size = std::max(size, shape.dimensions(j));
+    }
+  }
+  double macs = 1;
+  for (auto& label_size : label_sizes) {
+    macs *= label_size.second;
+  }
+  return macs;
+}
+
+double EstimateFlops(const Node* node) {
+  const OpKind& kind = node->op();
+  if (IsDataMovement(kind)) {
+    return 0;
+  }
+  if (kind == OpKind(at::aten::tf_convolution)) {
+    // NHWC input and output, HWIO filter.
+    const xla::Shape& shape = node->shape();
+    return 2 * ConvolutionMacs(shape, node->operand(1).shape(),
+                               shape.rank() - 1);
+  }
+  if (kind == OpKind(at::aten::tf_conv_backprop_input)) {
+    // Operands are the filter and the NHWC gradient of the output.
+    const xla::Shape& grad_shape = node->operand(1).shape();
+    return 2 * ConvolutionMacs(grad_shape, node->operand(0).shape(),
+                               grad_shape.rank() - 1);
+  }
+  if (kind == OpKind(at::aten::tf_conv_backprop_filter)) {
+    // Operands are the input and the NHWC gradient of the output.
+    const xla::Shape& grad_shape = node->operand(1).shape();
+    return 2 * ConvolutionMacs(grad_shape, node->shape(),
+                               grad_shape.rank() - 1);
+  }
+  if (kind == OpKind(at::aten::convolution_overrideable)) {
+    // NCHW input and output, OIHW weight.
+    return 2 * ConvolutionMacs(node->shape(0), node->operand(1).shape(),
+                               /*feature_dim=*/1);
+  }
+  if (kind == OpKind(at::aten::convolution_backward_overrideable)) {
+    // Computes the gradients of both the input and the weight.
+    return 4 * ConvolutionMacs(node->operand(0).shape(),
+                               node->operand(2).shape(), /*feature_dim=*/1);
+  }
+  if (kind == OpKind(at::aten::mm) || kind == OpKind(at::aten::addmm) ||
+      kind == OpKind(at::aten::matmul)) {
+    const xla::Shape& lhs_shape = node->operand(0).shape();
+    xla::int64 contracted =
+        lhs_shape.rank() > 0 ? lhs_shape.dimensions(lhs_shape.rank() - 1) : 1;
+    return 2 * ElementCount(node->shape()) * contracted;
+  }
+  const ops::Einsum* einsum = dynamic_cast<const ops::Einsum*>(node);
+  if (einsum != nullptr) {
+    return 2 * EinsumMacs(einsum);
+  }
+  if (IsReduction(kind)) {
+    return ElementCount(node->operand(0).shape());
+  }
+  return ElementCount(node->shape());
+}
+
+// Returns the cost of the length steps of a scan. A step runs the nodes of the
+// body lowered within the loop, which excludes the parameters, the captured
+// values and the nodes they depend on. The sequences are read and written a
+// step at a time by the body, so the operands and outputs of the node are not
+// accounted again.
+NodeCost ScanCost(const ops::Scan* scan) {
+  Util::EmissionMap emap;
+  for (auto& parameter : scan->parameters()) {
+    emap[parameter.get()] = Util::kEmitted;
+  }
+  for (auto& captured : scan->captured()) {
+    emap[captured.node.get()] = Util::kEmitted;
+  }
+  NodeCost cost;
+  for (auto& result : scan->results()) {
+    for (const Node* node : Util::ComputePostOrder(result.node.get(), &emap)) {
+      NodeCost node_cost = EstimateNodeCost(node);
+      cost.flops += node_cost.flops;
+      cost.bytes_accessed += node_cost.bytes_accessed;
+    }
+  }
+  cost.flops *= scan->length();
+  cost.bytes_accessed *= scan->length();
+  return cost;
+}
+
+std::string MetricFnFlops(double value) {
+  const int kNumSuffixes = 6;
+  static const char* const kFlopsSuffixes[kNumSuffixes] = {
+      "", "K", "M", "G", "T", "P"};
+  int sfix = 0;
+  for (; (sfix + 1) < kNumSuffixes && value >= 1000.0; ++sfix) {
+    value /= 1000.0;
+  }
+  std::stringstream ss;
+  ss.precision(2);
+  ss << std::fixed << value << kFlopsSuffixes[sfix] << "FLOP";
+  return ss.str();
+}
+
+}  // namespace
+
+const char* const kUnscopedName = "<unscoped>";
+
+NodeCost EstimateNodeCost(const Node* node) {
+  NodeCost cost;
+  if (IsLeafData(node->op())) {
+    return cost;
+  }
+  const ops::Scan* scan = dynamic_cast<const ops::Scan*>(node);
+  if (scan != nullptr) {
+    return ScanCost(scan);
+  }
+  cost.flops = EstimateFlops(node);
+  for (auto& operand : node->operands()) {
+    cost.bytes_accessed += ByteCount(operand.shape());
+  }
+  cost.bytes_accessed += ByteCount(node->shape());
+  return cost;
+}
+
+ScopeCosts ComputeScopeCosts(absl::Span<const Node* const> post_order) {
+  ScopeCosts scope_costs;
+  for (auto node : post_order) {
+    if (IsLeafData(node->op())) {
+      continue;
+    }
+    NodeCost cost = EstimateNodeCost(node);
+    const std::string& scope = node->metadata().scope;
+    if (scope.empty()) {
+      ScopeCost& scope_cost = scope_costs[kUnscopedName];
+      scope_cost.cost.flops += cost.flops;
+      scope_cost.cost.bytes_accessed += cost.bytes_accessed;
+      scope_cost.num_nodes += 1;
+      continue;
+    }
+    // Accounts the node to its scope and to all the enclosing ones.
+    for (size_t end = 0; end != std::string::npos;) {
+      end = scope.find('/', end + 1);
+      ScopeCost& scope_cost = scope_costs[scope.substr(0, end)];
+      scope_cost.cost.flops += cost.flops;
+      scope_cost.cost.bytes_accessed += cost.bytes_accessed;
+      scope_cost.num_nodes += 1;
+    }
+  }
+  return scope_costs;
+}
+
+void RecordScopeCosts(const ScopeCosts& scope_costs, double execution_nanos) {
+  // The outermost scopes partition the nodes of the graph.
+  double total_weight = 0;
+  for (auto& name_cost : scope_costs) {
+    if (name_cost.first.find('/') == std::string::npos) {
+      const NodeCost& cost = name_cost.second.cost;
+      total_weight += cost.flops + kFlopsPerByte * cost.bytes_accessed;
+    }
+  }
+  ScopeTallies* tallies = GetScopeTallies();
+  std::lock_guard<std::mutex> lock(tallies->lock);
+  tallies->executions += 1;
+  if (execution_nanos >= 0) {
+    tallies->timed_executions += 1;
+  }
+  for (auto& name_cost : scope_costs) {
+    const NodeCost& cost = name_cost.second.cost;
+    ScopeTally& tally = tallies->tallies[name_cost.first];
+    tally.cost.flops += cost.flops;
+    tally.cost.bytes_accessed += cost.bytes_accessed;
+    if (execution_nanos >= 0 && total_weight > 0) {
+      tally.nanos += execution_nanos *
+                     (cost.flops + kFlopsPerByte * cost.bytes_accessed) /
+                     total_weight;
+    }
+  }
+}
+
+std::string CreateScopeCostReport(size_t max_scopes) {
+  ScopeTallies* tallies = GetScopeTallies();
+  std::lock_guard<std::mutex> lock(tallies->lock);
+  if (tallies->executions == 0) {
+    return std::string();
+  }
+  bool by_time = tallies->timed_executions > 0;
+  using RankedScope = std::pair<std::string, const ScopeTally*>;
+  std::vector<RankedScope> ranked;
+  ranked.reserve(tallies->tallies.size());
+  for (auto& name_tally : tallies->tallies) {
+    ranked.emplace_back(name_tally.first, &name_tally.second);
+  }
+  std::stable_sort(ranked.begin(), ranked.end(),
+                   [by_time](const RankedScope& a, const RankedScope& b) {
+                     return by_time ? a.second->nanos > b.second->nanos
+                                    : a.second->cost.flops >
+                                          b.second->cost.flops;
+                   });
+  if (ranked.size() > max_scopes) {
+    ranked.resize(max_scopes);
+  }
+  std::stringstream ss;
+  ss << "Executions: " << tallies->executions
+     << ", Timed: " << tallies->timed_executions << "\n";
+  for (auto& name_tally : ranked) {
+    const ScopeTally& tally = *name_tally.second;
+    ss << name_tally.first << ": Flops=" << MetricFnFlops(tally.cost.flops)
+       << ", BytesAccessed=" << xla::metrics::MetricFnBytes(
+                                    tally.cost.bytes_accessed);
+    if (by_time) {
+      ss << ", ApportionedTime=" << xla::metrics::MetricFnTime(tally.nanos);
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+}  // namespace ir
+}  // namespace swift_xla
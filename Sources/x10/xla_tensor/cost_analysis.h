@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+
+// The estimated cost of running a node: the floating point operations it
+// performs (a multiply-add counting as two), and the bytes it reads from its
+// operands and writes to its outputs.
+struct NodeCost {
+  double flops = 0;
+  double bytes_accessed = 0;
+};
+
+// The cost of the nodes of a graph created within a scope (see ScopePusher),
+// including the nodes of all its nested scopes.
+struct ScopeCost {
+  NodeCost cost;
+  size_t num_nodes = 0;
+};
+
+// Maps every scope of a graph, and all the enclosing scopes, to its cost. The
+// nodes created out of any scope are accounted to kUnscopedName.
+using ScopeCosts = std::map<std::string, ScopeCost>;
+
+extern const char* const kUnscopedName;
+
+// Estimates the cost of a node from its kind and its operand and output shapes.
+// Convolutions and dot products count a multiply-add per output element and
+// contracted element, reductions an operation per input element, other
+// computations an operation per output element, and data movement ops (views,
+// slices, concatenations, ...) none. A scan costs its body times its length.
+// Device data and constants cost nothing, they are accounted as reads of the
+// nodes using them.
+NodeCost EstimateNodeCost(const Node* node);
+
+ScopeCosts ComputeScopeCosts(absl::Span<const Node* const> post_order);
+
+// Accounts one execution of a graph with the given scope costs. When
+// execution_nanos is not negative, the execution has been timed as a whole, and
+// its time is apportioned to the scopes according to their estimated cost: the
+// time of a scope is an estimate, not a measurement.
+void RecordScopeCosts(const ScopeCosts& scope_costs, double execution_nanos);
+
+// Creates a report of the max_scopes scopes with the highest accumulated cost
+// over all the recorded executions, ranked by apportioned time when some time
+// has been recorded, and by estimated flops otherwise. Returns an empty string
+// if no execution has been recorded.
+std::string CreateScopeCostReport(size_t max_scopes);
+
+}  // namespace ir
+}  // namespace swift_xla
@@ -14,6 +14,7 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/cross_replica_reduces.h"
 
+#include <cmath>
 #include <map>
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
@@ -21,6 +22,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 
 namespace swift_xla {
@@ -36,14 +38,14 @@ struct ReduceContext {
   std::map<xla::PrimitiveType, PerTypeContext> contexts;
 };
 
-xla::Shape MakeReduceShape(absl::Span<const xla::Shape> operand_shapes) {
-  Device xla_device = GetCurrentDevice();
+xla::Shape MakeReduceShape(absl::Span<const xla::Shape> operand_shapes,
+                           DeviceType hw_type) {
   std::vector<xla::Shape> shapes_and_layouts;
   shapes_and_layouts.reserve(operand_shapes.size());
   for (auto& shape : operand_shapes) {
     shapes_and_layouts.push_back(MakeArrayShapeFromDimensions(
         shape.dimensions(), shape.dynamic_dimensions(), shape.element_type(),
-        xla_device.hw_type));
+        hw_type));
   }
   return xla::ShapeUtil::MakeTupleShape(shapes_and_layouts);
 }
@@ -80,12 +82,122 @@ xla::XlaComputation GetReduceComutation(AllReduceType reduce_type,
               << xla::util::GetEnumValue(reduce_type);
 }
 
+// 64 bit integers are summed as four 16 bit limbs held within 32 bit integers,
+// which do not overflow for up to 2^15 replicas. Carries are propagated when
+// joining the limbs back.
+constexpr xla::int64 kLimbBits = 16;
+constexpr xla::int64 kNumLimbs = 4;
+
+// Describes how an all-reduce operand is mapped to the values which are
+// actually reduced across replicas.
+struct OperandEncoding {
+  enum Kind {
+    kNative,
+    kWidened,
+    kLimbs,
+  };
+
+  Kind kind = kNative;
+  xla::PrimitiveType type = xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+  // The index of the first encoded value within the reduced values.
+  size_t index = 0;
+};
+
+bool IsNarrowInteger(xla::PrimitiveType type) {
+  switch (type) {
+    case xla::PrimitiveType::S8:
+    case xla::PrimitiveType::S16:
+    case xla::PrimitiveType::U8:
+    case xla::PrimitiveType::U16:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Is64BitInteger(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::S64 || type == xla::PrimitiveType::U64;
+}
+
+// Encodes operand into values which the device can reduce natively, appending
+// them to reduce_operands.
+OperandEncoding EncodeOperand(xla::XlaOp operand, AllReduceType reduce_type,
+                              DeviceType hw_type,
+                              std::vector<xla::XlaOp>* reduce_operands) {
+  OperandEncoding encoding;
+  encoding.type = XlaHelpers::TypeOfXlaOp(operand);
+  encoding.index = reduce_operands->size();
+  if (IsNarrowInteger(encoding.type) && reduce_type != AllReduceType::kAnd &&
+      reduce_type != AllReduceType::kOr) {
+    encoding.kind = OperandEncoding::kWidened;
+    reduce_operands->push_back(
+        xla::ConvertElementType(operand, xla::PrimitiveType::S32));
+  } else if (Is64BitInteger(encoding.type) &&
+             reduce_type == AllReduceType::kSum &&
+             hw_type == DeviceType::TPU) {
+    encoding.kind = OperandEncoding::kLimbs;
+    xla::XlaOp bits =
+        xla::BitcastConvertType(operand, xla::PrimitiveType::U64);
+    xla::XlaOp mask = XlaHelpers::ScalarValue<xla::uint64>(
+        (1 << kLimbBits) - 1, xla::PrimitiveType::U64, operand.builder());
+    for (xla::int64 i = 0; i < kNumLimbs; ++i) {
+      xla::XlaOp shift = XlaHelpers::ScalarValue<xla::uint64>(
+          i * kLimbBits, xla::PrimitiveType::U64, operand.builder());
+      reduce_operands->push_back(xla::ConvertElementType(
+          xla::And(xla::ShiftRightLogical(bits, shift), mask),
+          xla::PrimitiveType::S32));
+    }
+  } else {
+    reduce_operands->push_back(operand);
+  }
+  return encoding;
+}
+
+xla::XlaOp DecodeOperand(const OperandEncoding& encoding,
+                         absl::Span<const xla::XlaOp> reduced) {
+  switch (encoding.kind) {
+    case OperandEncoding::kNative:
+      return reduced[encoding.index];
+    case OperandEncoding::kWidened:
+      return xla::ConvertElementType(reduced[encoding.index], encoding.type);
+    case OperandEncoding::kLimbs: {
+      xla::XlaOp result;
+      for (xla::int64 i = 0; i < kNumLimbs; ++i) {
+        xla::XlaOp limb = xla::ConvertElementType(reduced[encoding.index + i],
+                                                  xla::PrimitiveType::U64);
+        xla::XlaOp shift = XlaHelpers::ScalarValue<xla::uint64>(
+            i * kLimbBits, xla::PrimitiveType::U64, limb.builder());
+        limb = xla::ShiftLeft(limb, shift);
+        result = i == 0 ? limb : result + limb;
+      }
+      return xla::BitcastConvertType(result, encoding.type);
+    }
+  }
+  XLA_ERROR() << "Invalid operand encoding: " << encoding.kind;
+}
+
+xla::XlaOp ScaleValue(xla::XlaOp value, double scale) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(value);
+  if (xla::primitive_util::IsIntegralType(type) &&
+      scale != std::trunc(scale)) {
+    // Integers scaled by fractional values (like 1 / num_replicas) go through
+    // floating point, rather than scaling by the truncated value.
+    xla::XlaOp scaling_value = XlaHelpers::ScalarValue<float>(
+        scale, xla::PrimitiveType::F32, value.builder());
+    return xla::ConvertElementType(
+        xla::ConvertElementType(value, xla::PrimitiveType::F32) *
+            scaling_value,
+        type);
+  }
+  return value * XlaHelpers::ScalarValue<float>(scale, type, value.builder());
+}
+
 }  // namespace
 
 std::vector<xla::XlaOp> BuildAllReduce(
     AllReduceType reduce_type, absl::Span<const xla::XlaOp> operands,
     xla::XlaOp token, double scale,
-    const std::vector<std::vector<xla::int64>>& groups) {
+    const std::vector<std::vector<xla::int64>>& groups, DeviceType hw_type) {
   std::vector<xla::ReplicaGroup> reduce_groups;
   for (auto& group : groups) {
     xla::ReplicaGroup rgroup;
@@ -94,12 +206,21 @@ std::vector<xla::XlaOp> BuildAllReduce(
     }
     reduce_groups.push_back(std::move(rgroup));
   }
+  // Integer types which the device cannot reduce natively are encoded into
+  // ones it can, rather than being reduced as floating point values.
+  std::vector<xla::XlaOp> reduce_operands;
+  std::vector<OperandEncoding> encodings;
+  encodings.reserve(operands.size());
+  for (auto& operand : operands) {
+    encodings.push_back(
+        EncodeOperand(operand, reduce_type, hw_type, &reduce_operands));
+  }
   // TODO: We use pseudo-tokens ATM, which are real values. This need to be
   // switched to use the real XLA Token once support has been added to XLA
   // AllReduce().
   xla::XlaOp chained_token = token;
-  ReduceContext redux = GetReduceContext(operands);
-  std::vector<xla::XlaOp> result(operands.size());
+  ReduceContext redux = GetReduceContext(reduce_operands);
+  std::vector<xla::XlaOp> reduced(reduce_operands.size());
   for (auto& type_ctx : redux.contexts) {
     xla::XlaOp token_op =
         xla::ConvertElementType(chained_token, type_ctx.first);
@@ -111,21 +232,19 @@ std::vector<xla::XlaOp> BuildAllReduce(
         xla::Tuple(operands[0].builder(), type_ctx.second.ops),
         GetReduceComutation(reduce_type, type_ctx.first), reduce_groups,
         /*channel_id=*/absl::nullopt,
-        MakeReduceShape(type_ctx.second.operand_shapes));
+        MakeReduceShape(type_ctx.second.operand_shapes, hw_type));
     for (size_t i = 0; i < type_ctx.second.indices.size(); ++i) {
-      size_t op_idx = type_ctx.second.indices[i];
-      xla::XlaOp gte = xla::GetTupleElement(reduce, i);
-      if (scale != 1.0) {
-        xla::XlaOp scaling_value = XlaHelpers::ScalarValue<float>(
-            scale, type_ctx.second.operand_shapes[i].element_type(),
-            gte.builder());
-        gte = gte * scaling_value;
-      }
-      result[op_idx] = gte;
+      reduced[type_ctx.second.indices[i]] = xla::GetTupleElement(reduce, i);
     }
     chained_token =
         xla::GetTupleElement(reduce, type_ctx.second.indices.size());
   }
+  std::vector<xla::XlaOp> result;
+  result.reserve(operands.size() + 1);
+  for (auto& encoding : encodings) {
+    xla::XlaOp value = DecodeOperand(encoding, reduced);
+    result.push_back(scale != 1.0 ? ScaleValue(value, scale) : value);
+  }
   result.push_back(
       xla::ConvertElementType(chained_token, XlaHelpers::TypeOfXlaOp(token)));
   return result;
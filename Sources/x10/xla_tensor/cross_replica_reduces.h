@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
 namespace swift_xla {
@@ -32,9 +33,12 @@ enum class AllReduceType {
   kAnd,
 };
 
+// Reduces the operands across the replicas of the groups, on devices of type
+// hw_type, which decides how the integer types the device cannot reduce
+// natively are encoded.
 std::vector<xla::XlaOp> BuildAllReduce(
     AllReduceType reduce_type, absl::Span<const xla::XlaOp> operands,
     xla::XlaOp token, double scale,
-    const std::vector<std::vector<xla::int64>>& groups);
+    const std::vector<std::vector<xla::int64>>& groups, DeviceType hw_type);
 
 }  // namespace swift_xla
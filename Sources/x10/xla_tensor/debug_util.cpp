@@ -19,11 +19,13 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_dump_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_serialization.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 
 namespace swift_xla {
@@ -113,6 +115,37 @@ void DebugUtil::SaveTensorsGraphInfo(const char* name,
   }
 }
 
+void DebugUtil::SaveTensorsGraphBinary(absl::Span<const XLATensor> tensors,
+                                       const std::vector<size_t>* indices,
+                                       size_t hash) {
+  static const std::string save_dir =
+      xla::sys_util::GetEnvString("XLA_SAVE_GRAPHS_DIR", "");
+  if (save_dir.empty()) {
+    return;
+  }
+  std::vector<ir::Value> root_values;
+  auto add_root = [&](const XLATensor& tensor) {
+    ir::Value ir_value = tensor.CurrentIrValue();
+    if (ir_value) {
+      root_values.push_back(std::move(ir_value));
+    }
+  };
+  if (indices != nullptr) {
+    for (auto index : *indices) {
+      add_root(tensors[index]);
+    }
+  } else {
+    for (auto& tensor : tensors) {
+      add_root(tensor);
+    }
+  }
+  std::vector<ir::Output> roots(root_values.begin(), root_values.end());
+  std::string path = absl::StrFormat("%s/graph-%016x.x10ir", save_dir, hash);
+  std::ofstream graph_file(path, std::ios_base::binary);
+  graph_file << ir::SerializeGraph(roots);
+  XLA_CHECK(graph_file) << "Failed to save the IR graph to " << path;
+}
+
 bool DebugUtil::ExperimentEnabled(const std::string& name) {
   static const std::unordered_set<std::string>* xset = LoadExperiments();
   return xset->find(name) != xset->end();
@@ -50,6 +50,15 @@ class DebugUtil {
       const std::vector<size_t>* indices,
       GraphFormat format = GetDefaultGraphFormat());
 
+  // If the environment variable XLA_SAVE_GRAPHS_DIR is set to a directory, the
+  // IR graph whose roots are the IR values held at the tensors is saved there
+  // in the binary form of ir::SerializeGraph(), as graph-<hash>.x10ir, for
+  // ir_replay_benchmark to replay. If indices is not nullptr, it selects the
+  // indices of the tensors whose graph will be saved.
+  static void SaveTensorsGraphBinary(absl::Span<const XLATensor> tensors,
+                                     const std::vector<size_t>* indices,
+                                     size_t hash);
+
   static bool ExperimentEnabled(const std::string& name);
 };
 
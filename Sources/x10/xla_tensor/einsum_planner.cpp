@@ -0,0 +1,442 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/einsum_planner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+
+namespace swift_xla {
+namespace {
+
+// Equations with up to this many operands are planned by dynamic programming
+// over the subsets of operands, which takes O(3^N) steps. Larger ones contract
+// at every step the pair whose result is the smallest relative to its operands.
+constexpr size_t kMaxOptimalOperands = 8;
+
+// The labels are the letters, uppercase ones first so that iterating over the
+// label indices follows the character order.
+constexpr int kNumLabels = 52;
+
+using LabelSet = std::uint64_t;
+using EinsumPlanCache = xla::util::Cache<std::string, EinsumPlan>;
+
+struct ParsedEquation {
+  std::vector<std::vector<int>> inputs;
+  std::vector<int> output;
+};
+
+LabelSet LabelBit(int label) { return LabelSet(1) << label; }
+
+LabelSet ToLabelSet(absl::Span<const int> labels) {
+  LabelSet set = 0;
+  for (int label : labels) {
+    set |= LabelBit(label);
+  }
+  return set;
+}
+
+int LabelIndex(char c, const std::string& equation) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+  if (c >= 'a' && c <= 'z') {
+    return 26 + c - 'a';
+  }
+  XLA_ERROR() << "Invalid label '" << c << "' in einsum equation: "
+              << equation;
+}
+
+std::vector<int> ParseLabels(absl::string_view spec,
+                             const std::string& equation) {
+  std::vector<int> labels;
+  LabelSet seen = 0;
+  for (char c : spec) {
+    if (c == ' ') {
+      continue;
+    }
+    int label = LabelIndex(c, equation);
+    XLA_CHECK_EQ(seen & LabelBit(label), 0)
+        << "Repeated labels within an operand are not supported: "
+        << equation;
+    seen |= LabelBit(label);
+    labels.push_back(label);
+  }
+  return labels;
+}
+
+ParsedEquation ParseEquation(const std::string& equation) {
+  XLA_CHECK_EQ(equation.find("..."), std::string::npos)
+      << "Ellipsis is not supported in einsum equation: " << equation;
+  std::vector<std::string> sides = absl::StrSplit(equation, "->");
+  XLA_CHECK_LE(sides.size(), 2) << "Invalid einsum equation: " << equation;
+  ParsedEquation parsed;
+  std::vector<int> label_counts(kNumLabels, 0);
+  for (absl::string_view input : absl::StrSplit(sides[0], ',')) {
+    parsed.inputs.push_back(ParseLabels(input, equation));
+    for (int label : parsed.inputs.back()) {
+      ++label_counts[label];
+    }
+  }
+  if (sides.size() == 2) {
+    parsed.output = ParseLabels(sides[1], equation);
+    for (int label : parsed.output) {
+      XLA_CHECK_GT(label_counts[label], 0)
+          << "Output label not found in the inputs of einsum equation: "
+          << equation;
+    }
+  } else {
+    for (int label = 0; label < kNumLabels; ++label) {
+      if (label_counts[label] == 1) {
+        parsed.output.push_back(label);
+      }
+    }
+  }
+  return parsed;
+}
+
+std::vector<xla::int64> GetLabelSizes(const ParsedEquation& parsed,
+                                      absl::Span<const xla::Shape> shapes,
+                                      const std::string& equation) {
+  XLA_CHECK_EQ(parsed.inputs.size(), shapes.size())
+      << "Wrong number of operands for einsum equation: " << equation;
+  std::vector<xla::int64> sizes(kNumLabels, -1);
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    XLA_CHECK_EQ(parsed.inputs[i].size(), shapes[i].rank())
+        << "Wrong rank for operand " << i << " of einsum equation " << equation
+        << ": " << shapes[i];
+    for (size_t dim = 0; dim < parsed.inputs[i].size(); ++dim) {
+      xla::int64& size = sizes[parsed.inputs[i][dim]];
+      XLA_CHECK(size < 0 || size == shapes[i].dimensions(dim))
+          << "Einsum " << equation << " has mismatching sizes for "
+          << shapes[i];
+      size = shapes[i].dimensions(dim);
+    }
+  }
+  return sizes;
+}
+
+double LabelSetSize(LabelSet set, absl::Span<const xla::int64> sizes) {
+  double size = 1;
+  for (int label = 0; label < kNumLabels; ++label) {
+    if (set & LabelBit(label)) {
+      size *= sizes[label];
+    }
+  }
+  return size;
+}
+
+size_t EmitSubsetSteps(size_t subset, size_t num_inputs,
+                       absl::Span<const size_t> splits,
+                       std::vector<std::pair<size_t, size_t>>* pairs) {
+  size_t split = splits[subset];
+  if (split == 0) {
+    // Single operand subset.
+    size_t input = 0;
+    while ((subset >> input) != 1) {
+      ++input;
+    }
+    return input;
+  }
+  size_t lhs = EmitSubsetSteps(split, num_inputs, splits, pairs);
+  size_t rhs = EmitSubsetSteps(subset ^ split, num_inputs, splits, pairs);
+  pairs->emplace_back(lhs, rhs);
+  return num_inputs + pairs->size() - 1;
+}
+
+// Returns the pairs of value ids contracted by the steps, with the minimum
+// number of multiply-adds. The labels of the result of contracting a subset of
+// the inputs are the ones of the subset which also appear outside of it.
+std::vector<std::pair<size_t, size_t>> PlanOptimal(
+    absl::Span<const LabelSet> inputs, LabelSet output,
+    absl::Span<const xla::int64> sizes) {
+  size_t num_inputs = inputs.size();
+  size_t num_subsets = size_t(1) << num_inputs;
+  size_t all_inputs = num_subsets - 1;
+  std::vector<LabelSet> subset_labels(num_subsets, 0);
+  for (size_t subset = 1; subset < num_subsets; ++subset) {
+    size_t input = 0;
+    while (((subset >> input) & 1) == 0) {
+      ++input;
+    }
+    subset_labels[subset] =
+        subset_labels[subset & (subset - 1)] | inputs[input];
+  }
+  std::vector<LabelSet> result_labels(num_subsets, 0);
+  for (size_t subset = 1; subset < num_subsets; ++subset) {
+    result_labels[subset] =
+        subset_labels[subset] & (subset_labels[all_inputs ^ subset] | output);
+  }
+  std::vector<double> costs(num_subsets, 0);
+  std::vector<size_t> splits(num_subsets, 0);
+  for (size_t subset = 1; subset < num_subsets; ++subset) {
+    if ((subset & (subset - 1)) == 0) {
+      continue;
+    }
+    // Each split is only visited once, with the lowest input on the lhs.
+    size_t lowest = subset & (~subset + 1);
+    costs[subset] = std::numeric_limits<double>::infinity();
+    for (size_t lhs = (subset - 1) & subset; lhs > 0;
+         lhs = (lhs - 1) & subset) {
+      if ((lhs & lowest) == 0) {
+        continue;
+      }
+      size_t rhs = subset ^ lhs;
+      double cost =
+          costs[lhs] + costs[rhs] +
+          LabelSetSize(result_labels[lhs] | result_labels[rhs], sizes);
+      if (cost < costs[subset]) {
+        costs[subset] = cost;
+        splits[subset] = lhs;
+      }
+    }
+  }
+  std::vector<std::pair<size_t, size_t>> pairs;
+  EmitSubsetSteps(all_inputs, num_inputs, splits, &pairs);
+  return pairs;
+}
+
+std::vector<std::pair<size_t, size_t>> PlanGreedy(
+    absl::Span<const LabelSet> inputs, LabelSet output,
+    absl::Span<const xla::int64> sizes) {
+  std::vector<std::pair<size_t, LabelSet>> pending;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    pending.emplace_back(i, inputs[i]);
+  }
+  std::vector<std::pair<size_t, size_t>> pairs;
+  while (pending.size() > 1) {
+    size_t best_i = 0;
+    size_t best_j = 0;
+    LabelSet best_labels = 0;
+    double best_growth = std::numeric_limits<double>::infinity();
+    double best_flops = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < pending.size(); ++i) {
+      for (size_t j = i + 1; j < pending.size(); ++j) {
+        LabelSet needed = output;
+        for (size_t k = 0; k < pending.size(); ++k) {
+          if (k != i && k != j) {
+            needed |= pending[k].second;
+          }
+        }
+        LabelSet labels = (pending[i].second | pending[j].second) & needed;
+        double growth = LabelSetSize(labels, sizes) -
+                        LabelSetSize(pending[i].second, sizes) -
+                        LabelSetSize(pending[j].second, sizes);
+        double flops =
+            LabelSetSize(pending[i].second | pending[j].second, sizes);
+        if (growth < best_growth ||
+            (growth == best_growth && flops < best_flops)) {
+          best_i = i;
+          best_j = j;
+          best_labels = labels;
+          best_growth = growth;
+          best_flops = flops;
+        }
+      }
+    }
+    pairs.emplace_back(pending[best_i].first, pending[best_j].first);
+    pending.erase(pending.begin() + best_j);
+    pending.erase(pending.begin() + best_i);
+    pending.emplace_back(inputs.size() + pairs.size() - 1, best_labels);
+  }
+  return pairs;
+}
+
+std::shared_ptr<EinsumPlan> BuildPlan(
+    const ParsedEquation& parsed, absl::Span<const xla::int64> sizes,
+    absl::Span<const std::pair<size_t, size_t>> pairs) {
+  size_t num_inputs = parsed.inputs.size();
+  LabelSet output = ToLabelSet(parsed.output);
+  std::vector<std::vector<int>> value_labels;
+  auto plan = std::make_shared<EinsumPlan>();
+  for (size_t i = 0; i < num_inputs; ++i) {
+    LabelSet needed = output;
+    for (size_t j = 0; j < num_inputs; ++j) {
+      if (j != i) {
+        needed |= ToLabelSet(parsed.inputs[j]);
+      }
+    }
+    std::vector<xla::int64> reduce_dims;
+    std::vector<int> labels;
+    for (size_t dim = 0; dim < parsed.inputs[i].size(); ++dim) {
+      int label = parsed.inputs[i][dim];
+      if (needed & LabelBit(label)) {
+        labels.push_back(label);
+      } else {
+        reduce_dims.push_back(dim);
+      }
+    }
+    plan->input_reduce_dims.push_back(std::move(reduce_dims));
+    value_labels.push_back(std::move(labels));
+  }
+  std::vector<bool> live(num_inputs, true);
+  for (auto& pair : pairs) {
+    EinsumStep step;
+    step.lhs = pair.first;
+    step.rhs = pair.second;
+    live[step.lhs] = false;
+    live[step.rhs] = false;
+    LabelSet needed = output;
+    for (size_t id = 0; id < live.size(); ++id) {
+      if (live[id]) {
+        needed |= ToLabelSet(value_labels[id]);
+      }
+    }
+    const std::vector<int>& lhs_labels = value_labels[step.lhs];
+    const std::vector<int>& rhs_labels = value_labels[step.rhs];
+    LabelSet lhs_set = ToLabelSet(lhs_labels);
+    LabelSet rhs_set = ToLabelSet(rhs_labels);
+    std::vector<int> batch_labels;
+    for (size_t dim = 0; dim < lhs_labels.size(); ++dim) {
+      int label = lhs_labels[dim];
+      if ((rhs_set & LabelBit(label)) == 0) {
+        continue;
+      }
+      xla::int64 rhs_dim =
+          std::find(rhs_labels.begin(), rhs_labels.end(), label) -
+          rhs_labels.begin();
+      if (needed & LabelBit(label)) {
+        step.lhs_batch_dims.push_back(dim);
+        step.rhs_batch_dims.push_back(rhs_dim);
+        batch_labels.push_back(label);
+      } else {
+        step.lhs_contracting_dims.push_back(dim);
+        step.rhs_contracting_dims.push_back(rhs_dim);
+      }
+    }
+    std::vector<int> labels = batch_labels;
+    for (int label : lhs_labels) {
+      if ((rhs_set & LabelBit(label)) == 0) {
+        labels.push_back(label);
+      }
+    }
+    for (int label : rhs_labels) {
+      if ((lhs_set & LabelBit(label)) == 0) {
+        labels.push_back(label);
+      }
+    }
+    plan->flops += LabelSetSize(lhs_set | rhs_set, sizes);
+    plan->steps.push_back(std::move(step));
+    value_labels.push_back(std::move(labels));
+    live.push_back(true);
+  }
+  const std::vector<int>& last_labels = value_labels.back();
+  XLA_CHECK_EQ(last_labels.size(), parsed.output.size());
+  for (int label : parsed.output) {
+    auto it = std::find(last_labels.begin(), last_labels.end(), label);
+    XLA_CHECK(it != last_labels.end());
+    plan->output_permutation.push_back(it - last_labels.begin());
+    plan->output_sizes.push_back(sizes[label]);
+  }
+  return plan;
+}
+
+EinsumPlanCache* GetEinsumPlanCache() {
+  static xla::int64 plan_cache_size =
+      xla::sys_util::GetEnvInt("XLA_EINSUM_PLAN_CACHE_SIZE", 1024);
+  static EinsumPlanCache* cache = new EinsumPlanCache(plan_cache_size);
+  return cache;
+}
+
+std::string MakePlanKey(const std::string& equation,
+                        absl::Span<const xla::Shape> shapes) {
+  std::string key = equation;
+  for (auto& shape : shapes) {
+    absl::StrAppend(&key, ";", absl::StrJoin(shape.dimensions(), ","));
+  }
+  return key;
+}
+
+}  // namespace
+
+std::shared_ptr<const EinsumPlan> GetEinsumPlan(
+    const std::string& equation, absl::Span<const xla::Shape> shapes) {
+  std::string key = MakePlanKey(equation, shapes);
+  std::shared_ptr<EinsumPlan> plan = GetEinsumPlanCache()->Get(key);
+  if (plan != nullptr) {
+    return plan;
+  }
+  XLA_COUNTER("EinsumPlanCacheMiss", 1);
+  ParsedEquation parsed = ParseEquation(equation);
+  std::vector<xla::int64> sizes = GetLabelSizes(parsed, shapes, equation);
+  LabelSet output = ToLabelSet(parsed.output);
+  // The planners see the labels of the inputs once the ones unique to an input
+  // have been reduced away.
+  std::vector<LabelSet> inputs;
+  for (size_t i = 0; i < parsed.inputs.size(); ++i) {
+    LabelSet others = output;
+    for (size_t j = 0; j < parsed.inputs.size(); ++j) {
+      if (j != i) {
+        others |= ToLabelSet(parsed.inputs[j]);
+      }
+    }
+    inputs.push_back(ToLabelSet(parsed.inputs[i]) & others);
+  }
+  std::vector<std::pair<size_t, size_t>> pairs =
+      inputs.size() <= kMaxOptimalOperands
+          ? PlanOptimal(inputs, output, sizes)
+          : PlanGreedy(inputs, output, sizes);
+  plan = BuildPlan(parsed, sizes, pairs);
+  return GetEinsumPlanCache()->Add(std::move(key), std::move(plan));
+}
+
+xla::XlaOp BuildEinsum(absl::Span<const xla::XlaOp> operands,
+                       const EinsumPlan& plan) {
+  XLA_CHECK_EQ(operands.size(), plan.input_reduce_dims.size());
+  std::vector<xla::XlaOp> values;
+  for (size_t i = 0; i < operands.size(); ++i) {
+    xla::XlaOp value = operands[i];
+    if (!plan.input_reduce_dims[i].empty()) {
+      xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(value);
+      value = xla::Reduce(value, xla::Zero(value.builder(), type),
+                          XlaHelpers::CreateAddComputation(type),
+                          plan.input_reduce_dims[i]);
+    }
+    values.push_back(value);
+  }
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
+  for (auto& step : plan.steps) {
+    xla::DotDimensionNumbers dimension_numbers;
+    for (xla::int64 dim : step.lhs_batch_dims) {
+      dimension_numbers.add_lhs_batch_dimensions(dim);
+    }
+    for (xla::int64 dim : step.rhs_batch_dims) {
+      dimension_numbers.add_rhs_batch_dimensions(dim);
+    }
+    for (xla::int64 dim : step.lhs_contracting_dims) {
+      dimension_numbers.add_lhs_contracting_dimensions(dim);
+    }
+    for (xla::int64 dim : step.rhs_contracting_dims) {
+      dimension_numbers.add_rhs_contracting_dimensions(dim);
+    }
+    values.push_back(xla::DotGeneral(values[step.lhs], values[step.rhs],
+                                     dimension_numbers, &precision_config));
+  }
+  return xla::Transpose(values.back(), plan.output_permutation);
+}
+
+}  // namespace swift_xla
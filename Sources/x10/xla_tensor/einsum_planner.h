@@ -0,0 +1,67 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace swift_xla {
+
+// A contraction of two values of an einsum plan, lowered to a dot-general. The
+// inputs of the einsum are the values 0 to N-1, and the result of the i-th step
+// is the value N+i. The dimensions of the result are the batch ones, followed
+// by the free ones of the lhs and then the free ones of the rhs, so that no
+// transpose is needed between the steps.
+struct EinsumStep {
+  size_t lhs = 0;
+  size_t rhs = 0;
+  std::vector<xla::int64> lhs_batch_dims;
+  std::vector<xla::int64> rhs_batch_dims;
+  std::vector<xla::int64> lhs_contracting_dims;
+  std::vector<xla::int64> rhs_contracting_dims;
+};
+
+struct EinsumPlan {
+  // The dimensions of each input which are summed away before any step, since
+  // their label appears neither in another input nor in the output.
+  std::vector<std::vector<xla::int64>> input_reduce_dims;
+  std::vector<EinsumStep> steps;
+  // The transpose from the dimensions of the last value to the output ones.
+  std::vector<xla::int64> output_permutation;
+  std::vector<xla::int64> output_sizes;
+  // The number of multiply-adds performed by the steps.
+  double flops = 0;
+};
+
+// Returns the plan of an einsum with any number of operands, in numpy syntax
+// ("ab,bc,cd->ad", or "ab,bc,cd" for the implicit output). The contraction
+// order minimizing the number of multiply-adds is searched for exhaustively for
+// a few operands, and greedily for more, as opt_einsum does. Plans are cached
+// by equation and operand dimensions.
+std::shared_ptr<const EinsumPlan> GetEinsumPlan(
+    const std::string& equation, absl::Span<const xla::Shape> shapes);
+
+xla::XlaOp BuildEinsum(absl::Span<const xla::XlaOp> operands,
+                       const EinsumPlan& plan);
+
+}  // namespace swift_xla
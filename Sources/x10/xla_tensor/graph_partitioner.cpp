@@ -0,0 +1,110 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/graph_partitioner.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+// A cut which does not fall on a scope boundary is only chosen if it has less
+// than 1/kScopeBoundaryBias of the live bytes of the best one which does.
+constexpr double kScopeBoundaryBias = 2.0;
+
+// Returns, for every position k, the number of bytes produced by the nodes
+// before k and used by a node at k or after it (or by a root). Device data is
+// not counted, as it is a parameter of the partitions using it anyway.
+std::vector<double> ComputeLiveBytes(absl::Span<const Node* const> post_order,
+                                     absl::Span<const Output> roots) {
+  size_t size = post_order.size();
+  std::unordered_map<const Node*, size_t> node_positions;
+  node_positions.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    node_positions[post_order[i]] = i;
+  }
+  OutputMap<size_t> last_uses;
+  for (size_t i = 0; i < size; ++i) {
+    for (auto& operand : post_order[i]->operands()) {
+      last_uses[operand] = i;
+    }
+  }
+  for (auto& root : roots) {
+    last_uses[root] = size;
+  }
+  std::vector<double> live_bytes(size + 1, 0);
+  for (auto& output_last_use : last_uses) {
+    const Output& output = output_last_use.first;
+    if (ops::DeviceData::Cast(output.node) != nullptr) {
+      continue;
+    }
+    double bytes = xla::ShapeUtil::ByteSizeOf(output.shape(), sizeof(void*));
+    live_bytes[node_positions.at(output.node) + 1] += bytes;
+    if (output_last_use.second < size) {
+      live_bytes[output_last_use.second + 1] -= bytes;
+    }
+  }
+  for (size_t i = 1; i <= size; ++i) {
+    live_bytes[i] += live_bytes[i - 1];
+  }
+  return live_bytes;
+}
+
+bool IsScopeBoundary(absl::Span<const Node* const> post_order, size_t pos) {
+  return post_order[pos - 1]->metadata().scope !=
+         post_order[pos]->metadata().scope;
+}
+
+}  // namespace
+
+std::vector<std::vector<const Node*>> PartitionGraph(
+    absl::Span<const Node* const> post_order, absl::Span<const Output> roots,
+    size_t max_partition_size) {
+  XLA_CHECK_GT(max_partition_size, 1);
+  std::vector<double> live_bytes = ComputeLiveBytes(post_order, roots);
+  std::vector<std::vector<const Node*>> partitions;
+  size_t start = 0;
+  while (post_order.size() - start > max_partition_size) {
+    // Partitions are kept at least half full, so that a cheap cut right after
+    // the previous one does not lead to a multitude of tiny partitions.
+    size_t best_cut = 0;
+    double best_cost = 0;
+    for (size_t cut = start + max_partition_size / 2;
+         cut <= start + max_partition_size; ++cut) {
+      double cost = live_bytes[cut];
+      if (!IsScopeBoundary(post_order, cut)) {
+        cost *= kScopeBoundaryBias;
+      }
+      // On ties the later cut wins, which leads to fewer partitions.
+      if (best_cut == 0 || cost <= best_cost) {
+        best_cut = cut;
+        best_cost = cost;
+      }
+    }
+    partitions.emplace_back(post_order.begin() + start,
+                            post_order.begin() + best_cut);
+    start = best_cut;
+  }
+  partitions.emplace_back(post_order.begin() + start, post_order.end());
+  return partitions;
+}
+
+}  // namespace ir
+}  // namespace swift_xla
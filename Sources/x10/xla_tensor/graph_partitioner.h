@@ -0,0 +1,40 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+
+// Splits the post-order of an IR graph into consecutive ranges of at most
+// max_partition_size nodes, each of which can be lowered into a computation of
+// its own. The values crossing a cut become results of the partition producing
+// them and parameters of the partitions using them, so the cuts are placed
+// where the fewest bytes are live, preferably at the boundaries between scopes
+// (see ScopePusher). The cuts only depend on the graph and not on the order in
+// which its nodes have been created, so a graph is split the same way at every
+// step.
+std::vector<std::vector<const Node*>> PartitionGraph(
+    absl::Span<const Node* const> post_order, absl::Span<const Output> roots,
+    size_t max_partition_size);
+
+}  // namespace ir
+}  // namespace swift_xla
@@ -412,46 +412,33 @@ xla::XlaOp XlaHelpers::LinearInterpolation(xla::XlaOp value0, xla::XlaOp value1,
   return value0 * alpha_value + value1 * (one - alpha_value);
 }
 
-std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteValues(xla::XlaOp op1,
-                                                            xla::XlaOp op2) {
-  xla::PrimitiveType type1 = TypeOfXlaOp(op1);
-  xla::PrimitiveType type2 = TypeOfXlaOp(op2);
+xla::PrimitiveType XlaHelpers::PromoteType(xla::PrimitiveType type1,
+                                           xla::PrimitiveType type2) {
   if (type1 == type2) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(op1, op2);
+    return type1;
   }
   xla::int64 size1 = xla::ShapeUtil::ByteSizeOfPrimitiveType(type1);
   xla::int64 size2 = xla::ShapeUtil::ByteSizeOfPrimitiveType(type2);
   if (xla::primitive_util::IsFloatingPointType(type1)) {
-    if (!xla::primitive_util::IsFloatingPointType(type2) || size1 >= size2) {
-      return std::pair<xla::XlaOp, xla::XlaOp>(
-          op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
-    }
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
+    return !xla::primitive_util::IsFloatingPointType(type2) || size1 >= size2
+               ? type1
+               : type2;
   }
   if (xla::primitive_util::IsFloatingPointType(type2) || size2 >= size1) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
-  }
-  if (xla::primitive_util::IsIntegralType(type1) &&
-      xla::primitive_util::IsIntegralType(type2)) {
-    if (size1 >= size2) {
-      return std::pair<xla::XlaOp, xla::XlaOp>(
-          op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
-    }
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
-  }
-  if (type1 == xla::PrimitiveType::PRED) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        ConvertTo(op1, type1, type2, /*device=*/nullptr), op2);
-  }
-  if (type2 == xla::PrimitiveType::PRED) {
-    return std::pair<xla::XlaOp, xla::XlaOp>(
-        op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
+    return type2;
   }
+  // Neither type is a floating point one, and the first one is wider.
+  return type1;
+}
+
+std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteValues(xla::XlaOp op1,
+                                                            xla::XlaOp op2) {
+  xla::PrimitiveType type1 = TypeOfXlaOp(op1);
+  xla::PrimitiveType type2 = TypeOfXlaOp(op2);
+  xla::PrimitiveType type = PromoteType(type1, type2);
   return std::pair<xla::XlaOp, xla::XlaOp>(
-      op1, ConvertTo(op2, type2, type1, /*device=*/nullptr));
+      ConvertTo(op1, type1, type, /*device=*/nullptr),
+      ConvertTo(op2, type2, type, /*device=*/nullptr));
 }
 
 std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteSecondValue(
@@ -507,6 +494,13 @@ xla::Shape XlaHelpers::GetPromotedShape(const xla::Shape& shape1,
       GetPromotedShape(shape1.dimensions(), shape2.dimensions()));
 }
 
+xla::Shape XlaHelpers::GetPromotedBinaryOpShape(const xla::Shape& shape1,
+                                                const xla::Shape& shape2) {
+  return xla::ShapeUtil::MakeShape(
+      PromoteType(shape1.element_type(), shape2.element_type()),
+      GetPromotedShape(shape1.dimensions(), shape2.dimensions()));
+}
+
 std::pair<xla::XlaOp, xla::XlaOp> XlaHelpers::PromoteShapes(xla::XlaOp op1,
                                                             xla::XlaOp op2) {
   const xla::Shape& shape1 = ShapeOfXlaOp(op1);
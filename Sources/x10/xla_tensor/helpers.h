@@ -253,6 +253,11 @@ class XlaHelpers {
                                                           xla::int64 dim1,
                                                           xla::int64 rank);
 
+  // Returns the type which values of type1 and type2 are promoted to, when
+  // used together within an elementwise operation.
+  static xla::PrimitiveType PromoteType(xla::PrimitiveType type1,
+                                        xla::PrimitiveType type2);
+
   // Performs type promotion to make sure both operations return the same type.
   static std::pair<xla::XlaOp, xla::XlaOp> PromoteValues(xla::XlaOp op1,
                                                          xla::XlaOp op2);
@@ -294,6 +299,11 @@ class XlaHelpers {
   static xla::Shape GetPromotedShape(const xla::Shape& shape1,
                                      const xla::Shape& shape2);
 
+  // Returns the shape of an elementwise binary operation over operands of the
+  // given shapes, after both type and shape promotion (see Promote()).
+  static xla::Shape GetPromotedBinaryOpShape(const xla::Shape& shape1,
+                                             const xla::Shape& shape2);
+
   // Returns a new operations which broadcast the input operation into the
   // shape. The op_shape is the shape of the op operation, while shape should be
   // one that op is broadcast-able to (usually the result of a
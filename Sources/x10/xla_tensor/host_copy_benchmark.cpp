@@ -0,0 +1,96 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the number of host bytes copied in order to create a device tensor
+// out of a host buffer, comparing the copying path (what copyTensor() does)
+// with the borrowing one (what borrowTensor() does).
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+using swift_xla::Device;
+using swift_xla::GetDefaultDevice;
+using swift_xla::XLATensor;
+
+namespace {
+
+xla::int64 HostCopiedBytes() {
+  xla::metrics::CounterData* counter =
+      xla::metrics::GetCounter("HostCopiedBytes");
+  return counter != nullptr ? counter->Value() : 0;
+}
+
+at::Tensor MakeCopiedTensor(const std::vector<float>& host,
+                            std::vector<int64_t> dims) {
+  std::unique_ptr<float[]> data(new float[host.size()]);
+  std::memcpy(data.get(), host.data(), host.size() * sizeof(float));
+  XLA_COUNTER("HostCopiedBytes", host.size() * sizeof(float));
+  return at::Tensor(std::move(data), std::move(dims));
+}
+
+at::Tensor MakeBorrowedTensor(const std::vector<float>& host,
+                              std::vector<int64_t> dims, int* releases) {
+  auto buffer = std::make_unique<at::BorrowedAnyScalarBuffer<float>>(
+      host.data(), host.size(),
+      [](void* context) { ++*static_cast<int*>(context); }, releases);
+  return at::Tensor(std::move(buffer), std::move(dims));
+}
+
+void RunBenchmark(const std::vector<int64_t>& dims, const Device& device) {
+  size_t num_elements = at::GetLenFromShape(dims);
+  std::vector<float> host(num_elements, 1.0f);
+  size_t tensor_bytes = num_elements * sizeof(float);
+
+  xla::int64 start = HostCopiedBytes();
+  {
+    XLATensor tensor = XLATensor::Create(MakeCopiedTensor(host, dims), device);
+    tensor.GetXlaData();
+  }
+  xla::int64 copied_bytes = HostCopiedBytes() - start;
+
+  int releases = 0;
+  start = HostCopiedBytes();
+  {
+    XLATensor tensor =
+        XLATensor::Create(MakeBorrowedTensor(host, dims, &releases), device);
+    tensor.GetXlaData();
+  }
+  xla::int64 borrowed_bytes = HostCopiedBytes() - start;
+
+  absl::PrintF(
+      "tensor_bytes=%d copy_path=%d (%.2fx) borrow_path=%d (%.2fx)%s\n",
+      tensor_bytes, copied_bytes,
+      static_cast<double>(copied_bytes) / tensor_bytes, borrowed_bytes,
+      static_cast<double>(borrowed_bytes) / tensor_bytes,
+      releases == 1 ? "" : " (buffer not released!)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Device& device = *GetDefaultDevice();
+  absl::PrintF("Host bytes copied per created tensor on %s\n",
+               device.ToString());
+  for (auto& dims : std::vector<std::vector<int64_t>>{
+           {16}, {256, 256}, {64, 3, 224, 224}, {1024, 1024, 25}}) {
+    RunBenchmark(dims, device);
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/host_evaluator.h"
+
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/compiler/xla/service/hlo_evaluator.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+
+namespace swift_xla {
+namespace {
+
+bool IsHostEvaluableOp(const ir::OpKind& op) {
+  static const std::set<ir::OpKind>* host_evaluable_ops =
+      new std::set<ir::OpKind>({
+          // Elementwise operations.
+          ir::OpKind(at::aten::abs), ir::OpKind(at::aten::add),
+          ir::OpKind(at::aten::ceil), ir::OpKind(at::aten::clamp),
+          ir::OpKind(at::aten::cos), ir::OpKind(at::aten::div),
+          ir::OpKind(at::aten::eq), ir::OpKind(at::aten::exp),
+          ir::OpKind(at::aten::floor), ir::OpKind(at::aten::fmod),
+          ir::OpKind(at::aten::ge), ir::OpKind(at::aten::gt),
+          ir::OpKind(at::aten::le), ir::OpKind(at::aten::log),
+          ir::OpKind(at::aten::log1p), ir::OpKind(at::aten::logical_and),
+          ir::OpKind(at::aten::logical_or), ir::OpKind(at::aten::lt),
+          ir::OpKind(at::aten::max), ir::OpKind(at::aten::min),
+          ir::OpKind(at::aten::mul), ir::OpKind(at::aten::ne),
+          ir::OpKind(at::aten::neg), ir::OpKind(at::aten::pow),
+          ir::OpKind(at::aten::reciprocal), ir::OpKind(at::aten::relu),
+          ir::OpKind(at::aten::round_to_even), ir::OpKind(at::aten::rsqrt),
+          ir::OpKind(at::aten::sigmoid), ir::OpKind(at::aten::sign),
+          ir::OpKind(at::aten::sin), ir::OpKind(at::aten::sqrt),
+          ir::OpKind(at::aten::sub), ir::OpKind(at::aten::tanh),
+          ir::OpKind(at::aten::where), ir::OpKind(at::aten::xla_is_finite),
+          ir::OpKind(at::aten::xla_is_inf), ir::OpKind(at::aten::xla_is_nan),
+          ir::OpKind(at::aten::xla_rem), ir::OpKind(at::aten::__and__),
+          ir::OpKind(at::aten::__or__), ir::OpKind(at::aten::__xor__),
+          ir::OpKind(at::prim::Constant), *ir::ops::xla_cast,
+          *ir::ops::xla_device_data,
+          // Reductions.
+          ir::OpKind(at::aten::all), ir::OpKind(at::aten::any),
+          ir::OpKind(at::aten::argmax), ir::OpKind(at::aten::argmin),
+          ir::OpKind(at::aten::mean), ir::OpKind(at::aten::prod),
+          ir::OpKind(at::aten::sum),
+          // Shape operations.
+          ir::OpKind(at::aten::cat), ir::OpKind(at::aten::expand),
+          ir::OpKind(at::aten::permute), ir::OpKind(at::aten::squeeze),
+          ir::OpKind(at::aten::stack), ir::OpKind(at::aten::unsqueeze),
+          ir::OpKind(at::aten::view), ir::OpKind(at::aten::xla_slice),
+          *ir::ops::xla_generic_slice, *ir::ops::xla_select,
+      });
+  return host_evaluable_ops->count(op) > 0;
+}
+
+bool IsHostEvaluableShape(const xla::Shape& shape, xla::int64 max_elements) {
+  return shape.is_static() &&
+         xla::ShapeUtil::ElementsInRecursive(shape) <= max_elements;
+}
+
+bool IsHostEvaluableNode(const ir::Node* node, xla::int64 max_elements) {
+  if (!IsHostEvaluableOp(node->op()) ||
+      !IsHostEvaluableShape(node->shape(), max_elements)) {
+    return false;
+  }
+  // Data still being computed by an asynchronous execution would have to be
+  // waited for, at which point running on device is just as good.
+  const ir::ops::DeviceData* device_data = ir::ops::DeviceData::Cast(node);
+  return device_data == nullptr || device_data->data()->HasValue();
+}
+
+}  // namespace
+
+bool CanEvaluateOnHost(const ir::Value& root, size_t max_graph_size,
+                       xla::int64 max_elements) {
+  // The visit stops as soon as it finds more than max_graph_size nodes, so that
+  // the graphs which are too large are rejected in constant time.
+  std::unordered_set<const ir::Node*> visited;
+  std::vector<const ir::Node*> pending = {root.node.get()};
+  while (!pending.empty()) {
+    const ir::Node* node = pending.back();
+    pending.pop_back();
+    if (!visited.insert(node).second) {
+      continue;
+    }
+    if (visited.size() > max_graph_size ||
+        !IsHostEvaluableNode(node, max_elements)) {
+      return false;
+    }
+    for (auto& operand : node->operands()) {
+      pending.push_back(operand.node);
+    }
+  }
+  return true;
+}
+
+xla::Literal EvaluateOnHost(const ir::Value& root) {
+  XLA_TIMED("HostEvaluation");
+  ir::LoweringContext lowering_ctx("HostEvaluation");
+  xla::XlaComputation computation =
+      ConsumeValue(lowering_ctx.Build(lowering_ctx.GetOutputOp(root)));
+  std::unique_ptr<xla::HloModule> module =
+      ConsumeValue(xla::util::CreateModuleFromProto(computation.proto()));
+
+  const std::vector<xla::ComputationClient::DataPtr>& parameters_data =
+      lowering_ctx.GetParametersData();
+  std::vector<xla::Literal> arguments;
+  if (!parameters_data.empty()) {
+    arguments =
+        xla::ComputationClient::Get()->TransferFromServer(parameters_data);
+  }
+  std::vector<const xla::Literal*> argument_ptrs;
+  argument_ptrs.reserve(arguments.size());
+  for (auto& argument : arguments) {
+    argument_ptrs.push_back(&argument);
+  }
+  xla::HloEvaluator evaluator;
+  xla::Literal result =
+      ConsumeValue(evaluator.Evaluate(*module, argument_ptrs));
+  XLA_COUNTER("HostEvaluatedGraphs", 1);
+  return result;
+}
+
+}  // namespace swift_xla
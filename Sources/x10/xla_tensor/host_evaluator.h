@@ -0,0 +1,35 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/xla/literal.h"
+
+namespace swift_xla {
+
+// Returns whether the graph of root has at most max_graph_size nodes, each of
+// them an elementwise, reduction or shape operation with static outputs of at
+// most max_elements elements, and whether its device data is available.
+bool CanEvaluateOnHost(const ir::Value& root, size_t max_graph_size,
+                       xla::int64 max_elements);
+
+// Evaluates the graph of root on the host with the HLO evaluator, which does
+// not need to compile it, nor to pollute the computation caches with it. The
+// device data used by the graph is fetched from the device.
+xla::Literal EvaluateOnHost(const ir::Value& root);
+
+}  // namespace swift_xla
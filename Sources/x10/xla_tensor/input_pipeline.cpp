@@ -0,0 +1,301 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/input_pipeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace swift_xla {
+namespace {
+
+bool CanDecode(at::ScalarType source_type, at::ScalarType type) {
+  if (source_type == type) {
+    return true;
+  }
+  if (type != at::ScalarType::Float && type != at::ScalarType::Double) {
+    return false;
+  }
+  switch (source_type) {
+    case at::ScalarType::Float:
+    case at::ScalarType::Double:
+    case at::ScalarType::Byte:
+    case at::ScalarType::Char:
+    case at::ScalarType::Short:
+    case at::ScalarType::Int:
+    case at::ScalarType::Long:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <typename S, typename T>
+void DecodeValues(const S* source, size_t count, double scale, T* dest) {
+  for (size_t i = 0; i < count; ++i) {
+    dest[i] = static_cast<T>(source[i] * scale);
+  }
+}
+
+template <typename T>
+void DecodeValues(const void* source, at::ScalarType source_type, size_t count,
+                  double scale, T* dest) {
+  switch (source_type) {
+#define DEFINE_DECODE_CASE(name, aten_name, DType)                             \
+  case at::ScalarType::aten_name:                                              \
+    DecodeValues(reinterpret_cast<const DType*>(source), count, scale, dest); \
+    break;
+    LIST_SCALAR_TYPES(DEFINE_DECODE_CASE)
+#undef DEFINE_DECODE_CASE
+    default:
+      XLA_ERROR() << "Unsupported source type: " << source_type;
+  }
+}
+
+// Decodes count values of the source example into the batch buffer.
+void DecodeExample(const InputPipeline::Component& component,
+                   const void* source, size_t count, void* dest) {
+  if (component.source_type == component.type && component.scale == 1.0) {
+    std::memcpy(dest, source,
+                count * at::internal::GetSizeof(component.type));
+  } else if (component.type == at::ScalarType::Float) {
+    DecodeValues(source, component.source_type, count, component.scale,
+                 reinterpret_cast<float*>(dest));
+  } else {
+    DecodeValues(source, component.source_type, count, component.scale,
+                 reinterpret_cast<double*>(dest));
+  }
+}
+
+}  // namespace
+
+InputPipeline::InputPipeline(std::vector<Component> components,
+                             size_t num_examples, const Options& options,
+                             const Device& device)
+    : components_(std::move(components)),
+      num_examples_(num_examples),
+      options_(options),
+      device_(device) {
+  XLA_CHECK(!components_.empty());
+  XLA_CHECK_GT(options_.batch_size, 0);
+  XLA_CHECK_GT(options_.num_workers, 0);
+  XLA_CHECK_GT(options_.prefetch_depth, 0);
+  for (auto& component : components_) {
+    XLA_CHECK(CanDecode(component.source_type, component.type))
+        << "Cannot decode input pipeline examples of type "
+        << static_cast<int>(component.source_type) << " into type "
+        << static_cast<int>(component.type);
+    XLA_CHECK(component.data != nullptr || num_examples_ == 0);
+  }
+  batches_per_epoch_ =
+      options_.drop_remainder
+          ? num_examples_ / options_.batch_size
+          : (num_examples_ + options_.batch_size - 1) / options_.batch_size;
+  XLA_CHECK_GT(batches_per_epoch_, 0)
+      << "The dataset has fewer examples (" << num_examples_
+      << ") than a batch (" << options_.batch_size << ")";
+
+  // The host batch buffers are allocated once and recycled across the batches
+  // going through the same slot.
+  slots_.resize(options_.prefetch_depth);
+  for (auto& slot : slots_) {
+    for (auto& component : components_) {
+      size_t example_size = at::GetLenFromShape(component.example_dims) *
+                            at::internal::GetSizeof(component.type);
+      slot.host_buffers.push_back(
+          std::make_unique<char[]>(options_.batch_size * example_size));
+    }
+  }
+  for (size_t i = 0; i < options_.num_workers; ++i) {
+    workers_.emplace_back([this]() { RunWorker(); });
+  }
+}
+
+InputPipeline::~InputPipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::vector<XLATensor> InputPipeline::Next() {
+  if (epoch_end_pending_) {
+    epoch_end_pending_ = false;
+    return {};
+  }
+  tensorflow::profiler::TraceMe trace("InputPipeline::Next");
+  std::vector<xla::ComputationClient::DataPtr> data;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Slot& slot = slots_[consumed_batches_ % slots_.size()];
+    if (slot.ready_batch != consumed_batches_) {
+      // The consumer is faster than the workers, so the input pipeline is
+      // currently the bottleneck of the training loop.
+      XLA_COUNTER("InputPipelineStalls", 1);
+      cv_.wait(lock, [&] { return slot.ready_batch == consumed_batches_; });
+    }
+    if (slot.exptr != nullptr) {
+      std::rethrow_exception(slot.exptr);
+    }
+    data = std::move(slot.data);
+    slot.data.clear();
+    ++consumed_batches_;
+    // The orders of the completed epochs are no longer needed by any worker.
+    int64_t epoch = consumed_batches_ / batches_per_epoch_;
+    epoch_orders_.erase(epoch_orders_.begin(),
+                        epoch_orders_.lower_bound(epoch));
+  }
+  cv_.notify_all();
+  XLA_COUNTER("InputPipelineBatches", 1);
+  epoch_end_pending_ = consumed_batches_ % batches_per_epoch_ == 0;
+
+  std::vector<XLATensor> tensors;
+  tensors.reserve(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    tensors.push_back(XLATensor::Create(std::move(data[i]),
+                                        components_[i].type));
+  }
+  return tensors;
+}
+
+void InputPipeline::RunWorker() {
+  for (;;) {
+    int64_t batch;
+    Slot* slot;
+    std::shared_ptr<const std::vector<size_t>> order;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      batch = next_batch_to_assemble_++;
+      slot = &slots_[batch % slots_.size()];
+      // Wait for the consumer to take the batch which previously went through
+      // the same slot.
+      int64_t ring_size = slots_.size();
+      cv_.wait(lock, [&] {
+        return shutdown_ || batch < consumed_batches_ + ring_size;
+      });
+      if (shutdown_) {
+        return;
+      }
+      order = GetEpochOrder(batch / batches_per_epoch_);
+    }
+    try {
+      AssembleBatch(batch, *order, slot);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot->exptr = std::current_exception();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slot->ready_batch = batch;
+    }
+    cv_.notify_all();
+  }
+}
+
+void InputPipeline::AssembleBatch(int64_t batch,
+                                  const std::vector<size_t>& order,
+                                  Slot* slot) {
+  tensorflow::profiler::TraceMe trace("InputPipeline::AssembleBatch");
+  size_t start = (batch % batches_per_epoch_) * options_.batch_size;
+  size_t batch_size = std::min(options_.batch_size, num_examples_ - start);
+  std::vector<at::Tensor> tensors;
+  tensors.reserve(components_.size());
+  for (size_t i = 0; i < components_.size(); ++i) {
+    const Component& component = components_[i];
+    size_t example_count = at::GetLenFromShape(component.example_dims);
+    size_t source_size =
+        example_count * at::internal::GetSizeof(component.source_type);
+    size_t dest_size = example_count * at::internal::GetSizeof(component.type);
+    const char* source = reinterpret_cast<const char*>(component.data);
+    char* dest = slot->host_buffers[i].get();
+    for (size_t j = 0; j < batch_size; ++j) {
+      DecodeExample(component, source + order[start + j] * source_size,
+                    example_count, dest + j * dest_size);
+    }
+    std::vector<int64_t> dims({static_cast<int64_t>(batch_size)});
+    dims.insert(dims.end(), component.example_dims.begin(),
+                component.example_dims.end());
+    tensors.push_back(
+        MakeTensorFromHostBuffer(component.type, dest, std::move(dims)));
+  }
+
+  // All the components of the batch are uploaded with a single transfer. The
+  // host buffers can be reused as soon as TransferToServer() returns.
+  std::vector<xla::ComputationClient::TensorSource> source_tensors;
+  source_tensors.reserve(tensors.size());
+  for (auto& tensor : tensors) {
+    source_tensors.push_back(TensorToTensorSource(tensor, device_));
+  }
+  slot->data = xla::ComputationClient::Get()->TransferToServer(source_tensors);
+}
+
+std::shared_ptr<const std::vector<size_t>> InputPipeline::GetEpochOrder(
+    int64_t epoch) {
+  auto it = epoch_orders_.find(epoch);
+  if (it == epoch_orders_.end()) {
+    it = epoch_orders_
+             .emplace(epoch, std::make_shared<const std::vector<size_t>>(
+                                 ShuffleExamples(epoch)))
+             .first;
+  }
+  return it->second;
+}
+
+std::vector<size_t> InputPipeline::ShuffleExamples(int64_t epoch) const {
+  std::vector<size_t> order;
+  order.reserve(num_examples_);
+  if (options_.shuffle_buffer_size <= 1) {
+    order.resize(num_examples_);
+    std::iota(order.begin(), order.end(), 0);
+    return order;
+  }
+  // The order of an epoch only depends on the seed and the epoch number, and
+  // not on the timing of the workers.
+  std::seed_seq seed{static_cast<uint32_t>(options_.seed),
+                     static_cast<uint32_t>(options_.seed >> 32),
+                     static_cast<uint32_t>(epoch)};
+  std::mt19937_64 engine(seed);
+  std::vector<size_t> buffer;
+  buffer.reserve(std::min(options_.shuffle_buffer_size, num_examples_));
+  size_t next_example = 0;
+  while (next_example < num_examples_ &&
+         buffer.size() < options_.shuffle_buffer_size) {
+    buffer.push_back(next_example++);
+  }
+  while (!buffer.empty()) {
+    std::uniform_int_distribution<size_t> distribution(0, buffer.size() - 1);
+    size_t index = distribution(engine);
+    order.push_back(buffer[index]);
+    if (next_example < num_examples_) {
+      buffer[index] = next_example++;
+    } else {
+      buffer[index] = buffer.back();
+      buffer.pop_back();
+    }
+  }
+  return order;
+}
+
+}  // namespace swift_xla
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+
+// Produces batches of device tensors out of an in-memory dataset. Worker
+// threads shuffle the examples, decode and assemble them into host batch
+// buffers, and upload the batches to the device ahead of the consumer, so that
+// batch preparation overlaps with the computation of the previous steps.
+class InputPipeline {
+ public:
+  // One component (like the features or the labels) of the dataset examples.
+  struct Component {
+    // The element type of the source data and the one of the batch tensors.
+    // Numeric sources can be decoded into floating point batches, in which
+    // case the values are multiplied by scale.
+    at::ScalarType source_type = at::ScalarType::Float;
+    at::ScalarType type = at::ScalarType::Float;
+    // The dimensions of a single example, without the batch dimension.
+    std::vector<int64_t> example_dims;
+    // Points to the contiguous examples of the dataset. The buffer must stay
+    // valid for the lifetime of the pipeline.
+    const void* data = nullptr;
+    double scale = 1.0;
+  };
+
+  struct Options {
+    size_t batch_size = 1;
+    // The number of examples the shuffled order is drawn from. Zero or one
+    // disable shuffling, while a size at least as large as the dataset gives a
+    // uniform shuffle of every epoch.
+    size_t shuffle_buffer_size = 0;
+    size_t num_workers = 1;
+    // The number of batches which are assembled and uploaded to the device
+    // ahead of the consumer. This bounds the host batch buffers as well.
+    size_t prefetch_depth = 2;
+    uint64_t seed = 0;
+    // Whether the last, partial batch of each epoch is skipped.
+    bool drop_remainder = true;
+  };
+
+  InputPipeline(std::vector<Component> components, size_t num_examples,
+                const Options& options, const Device& device);
+
+  ~InputPipeline();
+
+  size_t batches_per_epoch() const { return batches_per_epoch_; }
+
+  // Returns the tensors of the next batch, one per component. An empty vector
+  // is returned after the last batch of every epoch, and the following call
+  // starts returning the batches of the next epoch.
+  std::vector<XLATensor> Next();
+
+ private:
+  // An entry of the ring of batches being prepared for the consumer. The batch
+  // number b is assembled within the slot b % slots_.size().
+  struct Slot {
+    std::vector<std::unique_ptr<char[]>> host_buffers;
+    std::vector<xla::ComputationClient::DataPtr> data;
+    std::exception_ptr exptr;
+    // The number of the batch held by the slot, once it is ready.
+    int64_t ready_batch = -1;
+  };
+
+  void RunWorker();
+
+  void AssembleBatch(int64_t batch, const std::vector<size_t>& order,
+                     Slot* slot);
+
+  // Returns the order of the examples in the given epoch. Must be called with
+  // mutex_ held.
+  std::shared_ptr<const std::vector<size_t>> GetEpochOrder(int64_t epoch);
+
+  std::vector<size_t> ShuffleExamples(int64_t epoch) const;
+
+  std::vector<Component> components_;
+  size_t num_examples_ = 0;
+  Options options_;
+  Device device_;
+  size_t batches_per_epoch_ = 0;
+  std::vector<Slot> slots_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<int64_t, std::shared_ptr<const std::vector<size_t>>> epoch_orders_;
+  int64_t next_batch_to_assemble_ = 0;
+  int64_t consumed_batches_ = 0;
+  bool epoch_end_pending_ = false;
+  bool shutdown_ = false;
+};
+
+}  // namespace swift_xla
@@ -14,14 +14,20 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 
+#include <algorithm>
 #include <functional>
+#include <memory>
 #include <sstream>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 
 namespace swift_xla {
@@ -72,13 +78,54 @@ std::string GetCurrentScope() {
   return scope;
 }
 
-ShapeCache* GetShapeCache() {
+// The shape cache is shared by all the tracing threads, so that a shape is
+// only inferred once per process. It is split into shards, each one with its
+// own lock, to keep the contention low.
+class SharedShapeCache {
+ public:
+  explicit SharedShapeCache(size_t max_size) {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      shards_.push_back(std::make_unique<ShapeCache>(
+          std::max<size_t>(max_size / kNumShards, 1)));
+    }
+  }
+
+  ShapeCache* GetShard(size_t key) { return shards_[key % kNumShards].get(); }
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  std::vector<std::unique_ptr<ShapeCache>> shards_;
+};
+
+SharedShapeCache* GetShapeCache() {
   static xla::int64 shape_cache_size =
       xla::sys_util::GetEnvInt("XLA_IR_SHAPE_CACHE_SIZE", 131072);
-  thread_local ShapeCache* cache = new ShapeCache(shape_cache_size);
+  static SharedShapeCache* cache = new SharedShapeCache(shape_cache_size);
   return cache;
 }
 
+// The output shape of a node only depends on its operation, its attributes
+// (both within the node hash) and the shapes of its operands, so the cache is
+// keyed by those rather than by the hash of the whole graph rooted at the node.
+// This lets the same operation applied to equally shaped operands hit the
+// cache across different graphs. Some element types depend on the kind of the
+// current device, which is part of the key as well.
+size_t GetShapeKey(size_t node_hash, absl::Span<const Output> operands) {
+  size_t key = xla::util::HashCombine(
+      node_hash, xla::util::GetEnumValue(GetCurrentDevice().hw_type));
+  for (auto& operand : operands) {
+    const xla::Shape& shape = operand.shape();
+    key = xla::util::HashCombine(key, xla::util::ShapeHash(shape));
+    if (shape.IsArray() && !shape.is_static()) {
+      for (xla::int64 i = 0; i < shape.rank(); ++i) {
+        key = xla::util::HashCombine(key, shape.is_dynamic_dimension(i));
+      }
+    }
+  }
+  return key;
+}
+
 }  // namespace
 
 size_t Output::Hasher::operator()(const Output& output) const {
@@ -204,10 +251,12 @@ size_t Node::GetOpHash(OpKind op, const xla::Shape& shape, size_t hash_seed) {
 }
 
 xla::Shape Node::GetOpShape(const std::function<xla::Shape()>& shape_fn) const {
-  ShapeCache* shape_cache = GetShapeCache();
-  auto shape = shape_cache->Get(hash());
+  size_t key = GetShapeKey(node_hash_, operands_as_outputs_);
+  ShapeCache* shape_cache = GetShapeCache()->GetShard(key);
+  auto shape = shape_cache->Get(key);
   if (shape == nullptr) {
-    shape = shape_cache->Add(hash(), std::make_shared<xla::Shape>(shape_fn()));
+    XLA_COUNTER("IrShapeCacheMiss", 1);
+    shape = shape_cache->Add(key, std::make_shared<xla::Shape>(shape_fn()));
   }
   return *shape;
 }
@@ -218,5 +267,7 @@ ScopePusher::~ScopePusher() { PopScope(); }
 
 void ScopePusher::ResetScopes() { ResetScopeContext(); }
 
+std::string ScopePusher::CurrentScope() { return GetCurrentScope(); }
+
 }  // namespace ir
 }  // namespace swift_xla
@@ -191,6 +191,11 @@ class Node {
 
   const Output& operand(size_t i) const { return operands_as_outputs_.at(i); }
 
+  // Same as operand(), but holding a reference on the operand node.
+  Value operand_value(size_t i) const {
+    return Value(operands_.at(i), operands_as_outputs_.at(i).index);
+  }
+
   size_t node_hash() const { return node_hash_; }
 
   size_t hash() const { return hash_; }
@@ -201,6 +206,11 @@ class Node {
 
   virtual NodePtr Clone(OpList operands) const;
 
+  // Emits the XLA operations of the node into loctx. Graphs larger than
+  // XLA_PARALLEL_LOWERING_SIZE nodes are lowered concurrently, with a lowering
+  // context per thread (see XLATensor::LowerGraph()), so implementations must
+  // be thread-safe: they may only mutate loctx, and any state shared across
+  // nodes needs its own synchronization.
   virtual XlaOpVector Lower(LoweringContext* loctx) const;
 
   XlaOpVector ReturnOp(xla::XlaOp op, LoweringContext* loctx) const;
@@ -241,6 +251,9 @@ struct ScopePusher {
   ~ScopePusher();
 
   static void ResetScopes();
+
+  // Returns the scope the IR nodes created by this thread are attached to.
+  static std::string CurrentScope();
 };
 
 inline std::ostream& operator<<(std::ostream& stream, const Node& node) {
@@ -0,0 +1,135 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Replays an IR graph saved by ir::SerializeGraph(), for example with the
+// XLA_SAVE_GRAPHS_DIR environment variable set while running the program which
+// traced it. The device data placeholders of the graph are filled with random
+// values, and the graph is compiled and executed by SyncTensorsGraph(), on the
+// default device, which is the CPU unless configured otherwise. The first run
+// includes the compilation, and the later ones hit the compilation cache, like
+// the steps of a training loop.
+//
+// Usage: ir_replay_benchmark --graph=FILE [--repetitions=N] [--seed=N]
+
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/benchmark_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_serialization.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+
+namespace swift_xla {
+namespace {
+
+// Returns device data of the given shape, holding uniform values in [-1, 1)
+// for floating point types, and in [0, 10) for the other ones, so that the
+// values are valid indices of most gathers and slices.
+xla::ComputationClient::DataPtr MakeRandomData(const xla::Shape& shape,
+                                               const Device& device,
+                                               std::mt19937* engine) {
+  XLA_CHECK(shape.IsArray()) << "Unsupported placeholder shape: " << shape;
+  std::vector<float> values(xla::ShapeUtil::ElementsIn(shape));
+  if (xla::primitive_util::IsFloatingPointType(shape.element_type())) {
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (auto& value : values) {
+      value = distribution(*engine);
+    }
+  } else {
+    int max_value = shape.element_type() == xla::PrimitiveType::PRED ? 1 : 9;
+    std::uniform_int_distribution<int> distribution(0, max_value);
+    for (auto& value : values) {
+      value = static_cast<float>(distribution(*engine));
+    }
+  }
+  std::vector<int64_t> dimensions(shape.dimensions().begin(),
+                                  shape.dimensions().end());
+  return TensorToXlaData(at::Tensor(std::move(values), std::move(dimensions)),
+                         shape, device);
+}
+
+// Syncs the graph rooted at the given values, on new tensors holding them.
+void RunGraph(absl::Span<const ir::Value> roots, const Device& device) {
+  std::vector<XLATensor> tensors;
+  for (auto& root : roots) {
+    tensors.push_back(XLATensor::Create(root, device));
+  }
+  XLATensor::SyncTensorsGraph(&tensors, {}, /*wait=*/true,
+                              /*sync_xla_data=*/false);
+}
+
+void RunBenchmark(const std::string& path, int repetitions, int seed) {
+  std::ifstream graph_file(path, std::ios_base::binary);
+  XLA_CHECK(graph_file) << "Failed to open " << path;
+  std::stringstream data;
+  data << graph_file.rdbuf();
+
+  const Device& device = *GetDefaultDevice();
+  std::mt19937 engine(seed);
+  size_t num_placeholders = 0;
+  std::vector<ir::Value> roots = ir::DeserializeGraph(
+      data.str(), [&](const xla::Shape& shape) {
+        ++num_placeholders;
+        return ir::MakeNode<ir::ops::DeviceData>(
+            MakeRandomData(shape, device, &engine));
+      });
+  std::vector<const ir::Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node.get());
+  }
+  absl::PrintF("Replaying %s on %s: %d nodes, %d placeholders, %d roots\n",
+               path, device.ToString(), ir::Util::GetGraphSize(root_nodes),
+               num_placeholders, roots.size());
+
+  BenchmarkTimes times =
+      TimeRepeated([&]() { RunGraph(roots, device); }, repetitions);
+  absl::PrintF("compile+execute=%12.1fus execute=%12.1fus\n", times.first_us,
+               times.average_us);
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  const char* usage = "--graph=FILE [--repetitions=N] [--seed=N]";
+  std::string graph;
+  int repetitions = 10;
+  int seed = 0;
+  if (!swift_xla::ParseBenchmarkFlags(argc, argv,
+                                      {{"graph", &graph},
+                                       {"repetitions", &repetitions},
+                                       {"seed", &seed, /*min_value=*/0}},
+                                      usage)) {
+    return 1;
+  }
+  if (graph.empty()) {
+    swift_xla::PrintBenchmarkUsage(argv[0], usage);
+    return 1;
+  }
+  swift_xla::RunBenchmark(graph, repetitions, seed);
+  return 0;
+}
@@ -0,0 +1,298 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_serialization.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/replayed.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+// A serialized graph starts with the magic, followed by the format version and
+// the number of nodes. Then come the nodes in post order, and the roots. All
+// the integers are varints, and the strings are prefixed by their size.
+constexpr absl::string_view kMagic = "X10IR";
+constexpr xla::uint64 kVersion = 1;
+
+enum NodeKind : xla::uint64 {
+  kPlaceholder = 0,
+  kComputed = 1,
+};
+
+class Writer {
+ public:
+  void WriteVarint(xla::uint64 value) {
+    while (value >= 0x80) {
+      data_.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    data_.push_back(static_cast<char>(value));
+  }
+
+  void WriteString(absl::string_view value) {
+    WriteVarint(value.size());
+    data_.append(value.data(), value.size());
+  }
+
+  void WriteShape(const xla::Shape& shape) {
+    WriteString(shape.ToProto().SerializeAsString());
+  }
+
+  void WriteBytes(absl::string_view value) {
+    data_.append(value.data(), value.size());
+  }
+
+  std::string Consume() { return std::move(data_); }
+
+ private:
+  std::string data_;
+};
+
+class Reader {
+ public:
+  explicit Reader(absl::string_view data) : data_(data) {}
+
+  xla::uint64 ReadVarint() {
+    xla::uint64 value = 0;
+    for (int shift = 0;; shift += 7) {
+      XLA_CHECK(!data_.empty()) << "Truncated IR graph";
+      XLA_CHECK_LT(shift, 64) << "Invalid varint in IR graph";
+      xla::uint8 byte = static_cast<xla::uint8>(data_.front());
+      data_.remove_prefix(1);
+      value |= static_cast<xla::uint64>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+  }
+
+  // Reads the number of the items which follow. Every item takes at least one
+  // byte, so larger counts come from a corrupted graph.
+  size_t ReadCount() {
+    xla::uint64 count = ReadVarint();
+    XLA_CHECK_LE(count, data_.size()) << "Invalid count in IR graph";
+    return count;
+  }
+
+  absl::string_view ReadString() { return ReadBytes(ReadVarint()); }
+
+  xla::Shape ReadShape() {
+    absl::string_view data = ReadString();
+    xla::ShapeProto proto;
+    XLA_CHECK(proto.ParseFromArray(data.data(), data.size()))
+        << "Invalid shape in IR graph";
+    return xla::Shape(proto);
+  }
+
+  absl::string_view ReadBytes(size_t size) {
+    XLA_CHECK_LE(size, data_.size()) << "Truncated IR graph";
+    absl::string_view value = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return value;
+  }
+
+  bool empty() const { return data_.empty(); }
+
+ private:
+  absl::string_view data_;
+};
+
+// Lowers the node alone, with a parameter standing for each of its operands.
+// Multi-output nodes return the tuple of their outputs.
+xla::XlaComputation LowerStandalone(const Node* node) {
+  LoweringContext loctx("ReplayedNode");
+  for (auto& operand : node->operands()) {
+    loctx.AssignOutputOp(operand, loctx.AddParameter(operand.shape()));
+  }
+  XlaOpVector ops = loctx.LowerNode(node);
+  xla::XlaOp root =
+      ops.size() == 1 ? ops.front() : xla::Tuple(loctx.builder(), ops);
+  return ConsumeValue(loctx.Build(root));
+}
+
+// The computation a node lowers to only depends on its own hash, which covers
+// its op kind and attributes, and on its shape and the shapes of its operands.
+// Keys are compared in full, so colliding hashes cannot share a computation.
+struct ComputationKey {
+  struct Hash {
+    size_t operator()(const ComputationKey& key) const {
+      size_t hash = key.node_hash;
+      for (auto& shape : key.shapes) {
+        hash = xla::util::HashCombine(hash, xla::ShapeHash(shape));
+      }
+      return hash;
+    }
+  };
+
+  explicit ComputationKey(const Node* node) : node_hash(node->node_hash()) {
+    shapes.push_back(node->shape());
+    for (auto& operand : node->operands()) {
+      shapes.push_back(operand.shape());
+    }
+  }
+
+  bool operator==(const ComputationKey& rhs) const {
+    return node_hash == rhs.node_hash && shapes == rhs.shapes;
+  }
+
+  size_t node_hash;
+  // The node shape, followed by the shapes of its operands.
+  std::vector<xla::Shape> shapes;
+};
+
+}  // namespace
+
+std::string SerializeGraph(absl::Span<const Output> roots) {
+  std::vector<const Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node);
+  }
+  std::vector<const Node*> post_order = Util::ComputePostOrder(root_nodes);
+  // Device data nodes sharing the same data become a single placeholder, which
+  // keeps the parameters of the replayed computation the same. The data is
+  // keyed by its handle object, as pending data has no opaque handle yet.
+  std::unordered_map<const Node*, size_t> node_indices;
+  std::unordered_map<const xla::ComputationClient::Data*, size_t>
+      placeholder_indices;
+  std::vector<const Node*> nodes;
+  for (auto node : post_order) {
+    const ops::DeviceData* device_data = ops::DeviceData::Cast(node);
+    if (device_data != nullptr) {
+      auto it = placeholder_indices
+                    .emplace(device_data->data().get(), nodes.size())
+                    .first;
+      if (it->second != nodes.size()) {
+        node_indices.emplace(node, it->second);
+        continue;
+      }
+    }
+    node_indices.emplace(node, nodes.size());
+    nodes.push_back(node);
+  }
+  auto write_output = [&](Writer* writer, const Output& output) {
+    writer->WriteVarint(node_indices.at(output.node));
+    writer->WriteVarint(output.index);
+  };
+
+  Writer writer;
+  writer.WriteBytes(kMagic);
+  writer.WriteVarint(kVersion);
+  writer.WriteVarint(nodes.size());
+  std::unordered_map<ComputationKey, size_t, ComputationKey::Hash>
+      computation_indices;
+  for (auto node : nodes) {
+    bool placeholder = ops::DeviceData::Cast(node) != nullptr;
+    writer.WriteVarint(placeholder ? kPlaceholder : kComputed);
+    writer.WriteString(node->op().ToString());
+    writer.WriteShape(node->shape());
+    writer.WriteVarint(node->num_outputs());
+    writer.WriteVarint(node->node_hash());
+    writer.WriteString(node->ToString());
+    if (placeholder) {
+      continue;
+    }
+    writer.WriteVarint(node->operands().size());
+    for (auto& operand : node->operands()) {
+      write_output(&writer, operand);
+    }
+    // A computation is written along with the first node using it, and the
+    // later ones only refer to its index.
+    auto it = computation_indices
+                  .emplace(ComputationKey(node), computation_indices.size())
+                  .first;
+    writer.WriteVarint(it->second);
+    if (it->second + 1 == computation_indices.size()) {
+      writer.WriteString(LowerStandalone(node).proto().SerializeAsString());
+    }
+  }
+  writer.WriteVarint(roots.size());
+  for (auto& root : roots) {
+    write_output(&writer, root);
+  }
+  return writer.Consume();
+}
+
+std::vector<Value> DeserializeGraph(absl::string_view data,
+                                    const PlaceholderFn& placeholder_fn) {
+  Reader reader(data);
+  XLA_CHECK_EQ(reader.ReadBytes(kMagic.size()), kMagic)
+      << "Not a serialized IR graph";
+  xla::uint64 version = reader.ReadVarint();
+  XLA_CHECK_EQ(version, kVersion) << "Unsupported IR graph version";
+  std::vector<NodePtr> nodes(reader.ReadCount());
+  auto read_value = [&](size_t num_nodes) {
+    xla::uint64 node_index = reader.ReadVarint();
+    XLA_CHECK_LT(node_index, num_nodes) << "Invalid operand in IR graph";
+    xla::uint64 output_index = reader.ReadVarint();
+    XLA_CHECK_LT(output_index, nodes[node_index]->num_outputs())
+        << "Invalid operand in IR graph";
+    return Value(nodes[node_index], output_index);
+  };
+
+  std::vector<std::shared_ptr<const xla::XlaComputation>> computations;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    xla::uint64 kind = reader.ReadVarint();
+    std::string op_name(reader.ReadString());
+    OpKind op = OpKind::Get(op_name);
+    XLA_CHECK_EQ(op.ToString(), op_name) << "Unknown IR op kind";
+    xla::Shape shape = reader.ReadShape();
+    size_t num_outputs = reader.ReadVarint();
+    size_t node_hash = reader.ReadVarint();
+    std::string description(reader.ReadString());
+    if (kind == kPlaceholder) {
+      nodes[i] = placeholder_fn(shape);
+      continue;
+    }
+    XLA_CHECK_EQ(kind, kComputed) << "Invalid node kind in IR graph";
+    std::vector<Value> operands(reader.ReadCount());
+    for (auto& operand : operands) {
+      operand = read_value(i);
+    }
+    xla::uint64 computation_index = reader.ReadVarint();
+    if (computation_index == computations.size()) {
+      absl::string_view proto_data = reader.ReadString();
+      xla::HloModuleProto proto;
+      XLA_CHECK(proto.ParseFromArray(proto_data.data(), proto_data.size()))
+          << "Invalid computation in IR graph";
+      computations.push_back(
+          std::make_shared<const xla::XlaComputation>(std::move(proto)));
+    }
+    XLA_CHECK_LT(computation_index, computations.size())
+        << "Invalid computation in IR graph";
+    nodes[i] = MakeNode<ops::Replayed>(
+        std::move(op), operands, std::move(shape), num_outputs, node_hash,
+        computations[computation_index], std::move(description));
+  }
+  std::vector<Value> roots(reader.ReadCount());
+  for (auto& root : roots) {
+    root = read_value(nodes.size());
+  }
+  XLA_CHECK(reader.empty()) << "Trailing data in IR graph";
+  return roots;
+}
+
+}  // namespace ir
+}  // namespace swift_xla
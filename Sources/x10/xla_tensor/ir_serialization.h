@@ -0,0 +1,49 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+
+// Serializes the graph rooted at the given outputs in a compact binary form,
+// which can be replayed offline without the program which traced it. The nodes
+// are recorded in post order, with their op kind, shape, operands, hash and
+// description. Node classes carry their attributes in members with no generic
+// accessor, so the attributes of a node are captured by the computation it
+// lowers to, with a parameter standing for each of its operands. Device data
+// nodes are recorded as placeholders of their shape, without their content.
+std::string SerializeGraph(absl::Span<const Output> roots);
+
+// Returns the node standing for a device data placeholder of the given shape.
+using PlaceholderFn = std::function<NodePtr(const xla::Shape& shape)>;
+
+// Rebuilds a graph serialized by SerializeGraph(), and returns its roots. The
+// nodes other than placeholders are ops::Replayed ones, calling the computation
+// of the original node. The placeholder function is called in post order.
+std::vector<Value> DeserializeGraph(absl::string_view data,
+                                    const PlaceholderFn& placeholder_fn);
+
+}  // namespace ir
+}  // namespace swift_xla
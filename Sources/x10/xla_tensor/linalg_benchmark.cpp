@@ -0,0 +1,188 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the execution time of the small matrix lowerings (see
+// UseSmallMatrixLowering()) with the generic XLA client library routines, on
+// batches of small symmetric positive definite matrices. Both computations of
+// a decomposition reduce the squares of its outputs to a scalar checksum, whose
+// transfer waits for the execution to complete. Squares do not depend on the
+// signs, nor on the choice of basis within an eigenspace, which the two
+// lowerings are free to differ in, so the checksums of the two computations
+// must match. The benchmark fails otherwise.
+//
+// Usage: linalg_benchmark [--batch=N] [--repetitions=N]
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/benchmark_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/matrix.h"
+#include "tensorflow/compiler/xla/client/lib/qr.h"
+#include "tensorflow/compiler/xla/client/lib/self_adjoint_eig.h"
+#include "tensorflow/compiler/xla/client/lib/svd.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+namespace {
+
+using DecompositionFn =
+    std::function<std::vector<xla::XlaOp>(xla::XlaOp input, bool small)>;
+
+struct Decomposition {
+  std::string name;
+  DecompositionFn fn;
+};
+
+std::vector<Decomposition> GetDecompositions() {
+  return {
+      {"cholesky",
+       [](xla::XlaOp input, bool small) -> std::vector<xla::XlaOp> {
+         return {small ? BuildSmallCholesky(input, /*lower=*/true)
+                       : xla::Cholesky(input, /*lower=*/true)};
+       }},
+      {"qr",
+       [](xla::XlaOp input, bool small) -> std::vector<xla::XlaOp> {
+         if (small) {
+           return BuildSmallQR(input, /*full_matrices=*/false);
+         }
+         xla::QRDecompositionResult result =
+             xla::QRDecomposition(input, /*full_matrices=*/false,
+                                  /*block_size=*/128,
+                                  XlaHelpers::mat_mul_precision())
+                 .ValueOrDie();
+         return {result.q, result.r};
+       }},
+      {"symeig",
+       [](xla::XlaOp input, bool small) -> std::vector<xla::XlaOp> {
+         if (small) {
+           return BuildSmallSymEig(input, /*lower=*/true);
+         }
+         xla::SelfAdjointEigResult result =
+             xla::SelfAdjointEig(input, /*lower=*/true, /*max_iter=*/100,
+                                 /*epsilon=*/1e-6);
+         return {result.w, result.v};
+       }},
+      {"svd",
+       [](xla::XlaOp input, bool small) -> std::vector<xla::XlaOp> {
+         if (small) {
+           return BuildSmallSVD(input, /*some=*/true, /*compute_uv=*/true);
+         }
+         xla::SVDResult result =
+             xla::SVD(input, /*max_iter=*/100, /*epsilon=*/1e-6,
+                      XlaHelpers::mat_mul_precision());
+         return {result.u, result.d, result.v};
+       }},
+      {"triangular_solve",
+       [](xla::XlaOp input, bool small) -> std::vector<xla::XlaOp> {
+         xla::XlaOp lower = xla::Triangle(input, /*lower=*/true);
+         return {small ? BuildSmallTriangularSolve(
+                             lower, input, /*left_side=*/true,
+                             /*lower=*/true, /*transpose=*/false,
+                             /*unit_diagonal=*/false)
+                       : xla::TriangularSolve(
+                             lower, input, /*left_side=*/true,
+                             /*lower=*/true, /*unit_diagonal=*/false,
+                             xla::TriangularSolveOptions::NO_TRANSPOSE)};
+       }},
+  };
+}
+
+// The input matrices are made positive definite within the computation, as
+// x * x^T + n * I.
+std::shared_ptr<xla::ComputationClient::Computation> CompileDecomposition(
+    const DecompositionFn& fn, bool small, const xla::Shape& shape,
+    const Device& device) {
+  xla::XlaBuilder builder("LinalgBenchmark");
+  xla::XlaOp x = xla::Parameter(&builder, 0, shape, "x");
+  xla::int64 n = shape.dimensions(shape.rank() - 1);
+  xla::XlaOp input = xla::Add(
+      xla::BatchDot(x, false, x, true, XlaHelpers::mat_mul_precision()),
+      xla::IdentityMatrix(&builder, shape.element_type(), n, n) *
+          xla::ScalarLike(x, n),
+      /*broadcast_dimensions=*/{shape.rank() - 2, shape.rank() - 1});
+  xla::XlaOp checksum = xla::Zero(&builder, shape.element_type());
+  for (xla::XlaOp output : fn(input, small)) {
+    checksum =
+        checksum +
+        xla::ReduceAll(output * output,
+                       xla::Zero(&builder, shape.element_type()),
+                       XlaHelpers::CreateAddComputation(shape.element_type()));
+  }
+  return CompileForDevice(ConsumeValue(builder.Build(checksum)), device);
+}
+
+// Returns whether the checksums of the two lowerings match.
+bool RunBenchmark(const Decomposition& decomposition, xla::int64 batch,
+                  xla::int64 n, const Device& device, int repetitions) {
+  std::vector<float> values(batch * n * n);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<float>((i * 7919) % 101) / 101.0f - 0.5f;
+  }
+  at::Tensor tensor(std::move(values), {batch, n, n});
+  xla::ComputationClient::DataPtr data = TensorToXlaData(tensor, device);
+  double times[2];
+  double checksums[2];
+  for (bool small : {false, true}) {
+    auto computation =
+        CompileDecomposition(decomposition.fn, small, data->shape(), device);
+    checksums[small] =
+        ExecuteAndFetch(*computation, {data}, device).front().Get<float>({});
+    times[small] =
+        TimeRepeated([&]() { ExecuteAndFetch(*computation, {data}, device); },
+                     repetitions)
+            .average_us;
+  }
+  absl::PrintF(
+      "%-16s batch=%d n=%-3d generic=%10.1fus small=%10.1fus (%.2fx)\n",
+      decomposition.name, batch, n, times[false], times[true],
+      times[false] / times[true]);
+  return ChecksumsMatch(absl::StrFormat("%s n=%d", decomposition.name, n),
+                        checksums[false], checksums[true],
+                        /*relative_tolerance=*/1e-3);
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  int batch = 1024;
+  int repetitions = 20;
+  if (!swift_xla::ParseBenchmarkFlags(
+          argc, argv, {{"batch", &batch}, {"repetitions", &repetitions}},
+          "[--batch=N] [--repetitions=N]")) {
+    return 1;
+  }
+  const swift_xla::Device& device = *swift_xla::GetDefaultDevice();
+  absl::PrintF("Batched decompositions on %s\n", device.ToString());
+  bool checksums_match = true;
+  for (auto& decomposition : swift_xla::GetDecompositions()) {
+    for (xla::int64 n : {4, 8, 16, 32, 64}) {
+      checksums_match &= swift_xla::RunBenchmark(decomposition, batch, n,
+                                                 device, repetitions);
+    }
+  }
+  return checksums_match ? 0 : 1;
+}
@@ -75,6 +75,13 @@ xla::XlaOp LoweringContext::GetParameter(
   return it->second;
 }
 
+xla::XlaOp LoweringContext::AddParameter(const xla::Shape& shape) {
+  xla::XlaOp param = xla::Parameter(builder(), parameters_.size(), shape,
+                                    absl::StrCat("p", parameters_.size()));
+  parameters_.push_back(nullptr);
+  return param;
+}
+
 xla::int64 LoweringContext::AddResult(xla::XlaOp op) {
   root_tuple_.push_back(std::move(op));
   return root_tuple_.size() - 1;
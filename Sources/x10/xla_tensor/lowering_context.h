@@ -45,6 +45,12 @@ class LoweringContext {
   xla::XlaOp GetParameter(
       const std::shared_ptr<xla::ComputationClient::Data>& data);
 
+  // Declares a parameter which is not associated with any data, like a value
+  // produced by another computation. Such parameters are numbered along with
+  // the ones created by GetParameter(), and hold a null entry within the vector
+  // returned by GetParametersData().
+  xla::XlaOp AddParameter(const xla::Shape& shape);
+
   // Retrieves the vector holding all the tensors associated with the parameter
   // instructions which have been created.
   const std::vector<xla::ComputationClient::DataPtr>& GetParametersData()
@@ -14,11 +14,25 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/convert_ops.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/xla_lower_util.h"
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/comparators.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/loops.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/qr.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 
@@ -93,6 +107,175 @@ std::vector<xla::int64> GetDiagonalPermutation(xla::int64 rank, xla::int64 dim1,
   return permutation;
 }
 
+// The Jacobi sweeps stop once the off-diagonal part is this many epsilons of
+// the norm of the matrix, or after the same number of iterations the generic
+// lowerings allow.
+constexpr double kJacobiToleranceEpsilons = 4;
+constexpr xla::int32 kMaxJacobiSweeps = 100;
+
+xla::int64 GetSmallMatrixSize() {
+  static const xla::int64 small_matrix_size =
+      xla::sys_util::GetEnvInt("XLA_SMALL_MATRIX_SIZE", 64);
+  return small_matrix_size;
+}
+
+std::vector<xla::int64> BatchDimensions(const xla::Shape& shape) {
+  return xla::util::ToVector<xla::int64>(
+      shape.dimensions().subspan(0, shape.rank() - 2));
+}
+
+xla::XlaOp BatchDot(xla::XlaOp lhs, bool transpose_lhs, xla::XlaOp rhs,
+                    bool transpose_rhs) {
+  return xla::BatchDot(lhs, transpose_lhs, rhs, transpose_rhs,
+                       XlaHelpers::mat_mul_precision());
+}
+
+xla::XlaOp BatchIdentity(xla::XlaBuilder* builder, xla::PrimitiveType type,
+                         absl::Span<const xla::int64> batch_dimensions,
+                         xla::int64 n) {
+  return xla::Broadcast(xla::IdentityMatrix(builder, type, n, n),
+                        batch_dimensions);
+}
+
+// Sums the squares of the input along the given dimension.
+xla::XlaOp SumOfSquares(xla::XlaOp input, xla::int64 dim) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  return xla::Reduce(
+      input * input, xla::Zero(input.builder(), shape.element_type()),
+      XlaHelpers::CreateAddComputation(shape.element_type()), {dim});
+}
+
+// Broadcasts the per pair values, of shape [..., P], into the shape of a
+// matrix whose dimension dim has size P, and its other trailing one any size.
+xla::XlaOp BroadcastPairValues(xla::XlaOp values, const xla::Shape& shape,
+                               xla::int64 dim) {
+  std::vector<xla::int64> broadcast_dimensions;
+  for (xla::int64 i = 0; i < shape.rank() - 2; ++i) {
+    broadcast_dimensions.push_back(i);
+  }
+  broadcast_dimensions.push_back(dim);
+  return xla::BroadcastInDim(values, shape.dimensions(), broadcast_dimensions);
+}
+
+struct JacobiRotation {
+  xla::XlaOp c;
+  xla::XlaOp s;
+};
+
+// Computes, for each pair, the rotation which annihilates apq in the symmetric
+// 2x2 matrix [[app, apq], [apq, aqq]] (Golub & Van Loan, Algorithm 8.4.1).
+JacobiRotation ComputeJacobiRotation(xla::XlaOp app, xla::XlaOp apq,
+                                     xla::XlaOp aqq) {
+  xla::XlaOp zeros = xla::ZerosLike(apq);
+  xla::XlaOp ones = xla::FullLike(apq, 1);
+  xla::XlaOp is_diagonal = xla::Eq(apq, zeros);
+  xla::XlaOp safe_apq = xla::Select(is_diagonal, ones, apq);
+  xla::XlaOp tau = (aqq - app) / (xla::FullLike(apq, 2) * safe_apq);
+  xla::XlaOp t = xla::Select(xla::Ge(tau, zeros), ones, -ones) /
+                 (xla::Abs(tau) + xla::Sqrt(ones + tau * tau));
+  xla::XlaOp c = xla::Rsqrt(ones + t * t);
+  return {xla::Select(is_diagonal, ones, c),
+          xla::Select(is_diagonal, zeros, t * c)};
+}
+
+// Applies the rotations to the pairs of rows (dim is rank - 2) or columns (dim
+// is rank - 1) i and i + N / 2 of the input.
+xla::XlaOp RotatePairs(xla::XlaOp input, const JacobiRotation& rotation,
+                       xla::int64 dim) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 half = shape.dimensions(dim) / 2;
+  xla::XlaOp top = xla::SliceInDim(input, 0, half, 1, dim);
+  xla::XlaOp bottom = xla::SliceInDim(input, half, 2 * half, 1, dim);
+  const xla::Shape& half_shape = XlaHelpers::ShapeOfXlaOp(top);
+  xla::XlaOp c = BroadcastPairValues(rotation.c, half_shape, dim);
+  xla::XlaOp s = BroadcastPairValues(rotation.s, half_shape, dim);
+  return xla::ConcatInDim(input.builder(),
+                          {c * top - s * bottom, s * top + c * bottom}, dim);
+}
+
+// Moves the rows or columns to the pairing of the next round of a round robin
+// tournament, where i plays i + N / 2: the first one stays in place, while the
+// others rotate through the two halves. After N - 1 rounds every index has
+// been paired with every other one, and the original order is restored.
+xla::XlaOp NextRoundOrder(xla::XlaOp input, xla::int64 dim) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 size = shape.dimensions(dim);
+  xla::int64 half = size / 2;
+  if (half < 2) {
+    return input;
+  }
+  return xla::ConcatInDim(input.builder(),
+                          {xla::SliceInDim(input, 0, 1, 1, dim),
+                           xla::SliceInDim(input, half, half + 1, 1, dim),
+                           xla::SliceInDim(input, 1, half - 1, 1, dim),
+                           xla::SliceInDim(input, half + 1, size, 1, dim),
+                           xla::SliceInDim(input, half - 1, half, 1, dim)},
+                          dim);
+}
+
+// Runs Jacobi sweeps, each of them unrolled over the N - 1 rounds of pairings,
+// until the convergence measure returned by sweep_fn falls below tolerance.
+// The state holds the matrices updated by a sweep.
+std::vector<xla::XlaOp> RunJacobiSweeps(
+    const std::function<std::vector<xla::XlaOp>(
+        absl::Span<const xla::XlaOp>, xla::XlaOp*)>& sweep_fn,
+    xla::XlaOp tolerance, std::vector<xla::XlaOp> state) {
+  xla::XlaBuilder* builder = tolerance.builder();
+  // The loop values are the sweep count, the convergence measure of the last
+  // sweep, its tolerance and the state.
+  std::vector<xla::XlaOp> initial_values = {
+      xla::ConstantR0<xla::int32>(builder, 0),
+      xla::ScalarLike(tolerance, std::numeric_limits<float>::infinity()),
+      tolerance};
+  initial_values.insert(initial_values.end(), state.begin(), state.end());
+  auto condition_fn =
+      [](absl::Span<const xla::XlaOp> values,
+         xla::XlaBuilder* builder) -> xla::StatusOr<xla::XlaOp> {
+    return xla::And(
+        xla::Lt(values[0],
+                xla::ConstantR0<xla::int32>(builder, kMaxJacobiSweeps)),
+        xla::Gt(values[1], values[2]));
+  };
+  auto body_fn = [&](absl::Span<const xla::XlaOp> values,
+                     xla::XlaBuilder* /*builder*/)
+      -> xla::StatusOr<std::vector<xla::XlaOp>> {
+    xla::XlaOp measure;
+    std::vector<xla::XlaOp> result = sweep_fn(values.subspan(3), &measure);
+    result.insert(result.begin(),
+                  {values[0] + xla::ScalarLike(values[0], 1), measure,
+                   values[2]});
+    return result;
+  };
+  std::vector<xla::XlaOp> values = xla::WhileLoopHelper(
+      condition_fn, body_fn, initial_values, "JacobiSweeps", builder)
+      .ValueOrDie();
+  return std::vector<xla::XlaOp>(values.begin() + 3, values.end());
+}
+
+// Sorts the vectors along the trailing dimension of vectors, by their values.
+xla::XlaOp SortVectors(xla::XlaOp vectors, xla::XlaOp values,
+                       bool descending) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(vectors);
+  xla::XlaOp keys = BroadcastPairValues(values, shape, shape.rank() - 1);
+  std::vector<xla::PrimitiveType> types(2, shape.element_type());
+  xla::XlaComputation comparator =
+      descending ? xla::CreateScalarGtComputation(types, vectors.builder())
+                 : xla::CreateScalarLtComputation(types, vectors.builder());
+  return xla::GetTupleElement(
+      xla::Sort({keys, vectors}, comparator, shape.rank() - 1,
+                /*is_stable=*/true),
+      1);
+}
+
+xla::XlaOp SortValues(xla::XlaOp values, bool descending) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(values);
+  std::vector<xla::PrimitiveType> types(1, shape.element_type());
+  xla::XlaComputation comparator =
+      descending ? xla::CreateScalarGtComputation(types, values.builder())
+                 : xla::CreateScalarLtComputation(types, values.builder());
+  return xla::Sort({values}, comparator, shape.rank() - 1, /*is_stable=*/true);
+}
+
 }  // namespace
 
 xla::XlaOp BuildTriu(xla::XlaOp input, xla::int64 diagonal) {
@@ -142,6 +325,13 @@ xla::XlaOp BuildDiagonalViewUpdate(xla::XlaOp target, xla::XlaOp input,
 }
 
 xla::XlaOp BuildInverse(xla::XlaOp input) {
+  if (UseSmallMatrixLowering(XlaHelpers::ShapeOfXlaOp(input))) {
+    std::vector<xla::XlaOp> qr = BuildSmallQR(input, /*full_matrices=*/false);
+    return BuildSmallTriangularSolve(qr[1], xla::TransposeInMinorDims(qr[0]),
+                                     /*left_side=*/true, /*lower=*/false,
+                                     /*transpose=*/false,
+                                     /*unit_diagonal=*/false);
+  }
   xla::QRDecompositionResult qr_result =
       xla::QRDecomposition(input, /*full_matrices=*/false,
                            XlaHelpers::mat_mul_precision())
@@ -154,4 +344,291 @@ xla::XlaOp BuildInverse(xla::XlaOp input) {
                               xla::TriangularSolveOptions::NO_TRANSPOSE);
 }
 
+bool UseSmallMatrixLowering(const xla::Shape& shape) {
+  if (shape.rank() < 2 || (shape.element_type() != xla::PrimitiveType::F32 &&
+                           shape.element_type() != xla::PrimitiveType::F64)) {
+    return false;
+  }
+  xla::int64 size = GetSmallMatrixSize();
+  return shape.dimensions(shape.rank() - 2) <= size &&
+         shape.dimensions(shape.rank() - 1) <= size;
+}
+
+xla::XlaOp BuildSmallCholesky(xla::XlaOp input, bool lower) {
+  // The upper factor is the transposed lower factor of the transposed input,
+  // which has the upper triangle in place of the lower one.
+  xla::XlaOp a = lower ? input : xla::TransposeInMinorDims(input);
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(a);
+  xla::int64 n = shape.dimensions(shape.rank() - 1);
+  xla::XlaOp l = xla::ZerosLike(a);
+  for (xla::int64 j = 0; j < n; ++j) {
+    // Column j of the factor only depends on the columns before it, which are
+    // the only non zero ones of l at this point.
+    xla::XlaOp l_row = xla::SliceInMinorDims(l, {j, 0}, {j + 1, n});
+    xla::XlaOp column =
+        xla::SliceInMinorDims(a, {j, j}, {n, j + 1}) -
+        BatchDot(xla::SliceInMinorDims(l, {j, 0}, {n, n}), false, l_row, true);
+    xla::XlaOp diagonal = xla::SliceInMinorDims(column, {0, 0}, {1, 1});
+    l = xla::UpdateSliceInMinorDims(l, column * xla::Rsqrt(diagonal), {j, j});
+  }
+  return lower ? l : xla::TransposeInMinorDims(l);
+}
+
+std::vector<xla::XlaOp> BuildSmallQR(xla::XlaOp input, bool full_matrices) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 m = shape.dimensions(shape.rank() - 2);
+  xla::int64 n = shape.dimensions(shape.rank() - 1);
+  xla::int64 k = std::min(m, n);
+  xla::XlaOp r = input;
+  xla::XlaOp q = BatchIdentity(input.builder(), shape.element_type(),
+                               BatchDimensions(shape), m);
+  for (xla::int64 j = 0; j < std::min(m - 1, n); ++j) {
+    // The Householder reflection I - tau * v * v^T, with v[0] = 1, zeroes the
+    // column j of r below the diagonal (with the conventions of LAPACK's
+    // xLARFG, so that the result matches xla::QRDecomposition()).
+    xla::XlaOp x = xla::SliceInMinorDims(r, {j, j}, {m, j + 1});
+    xla::XlaOp alpha = xla::SliceInMinorDims(x, {0, 0}, {1, 1});
+    xla::XlaOp x_tail = xla::SliceInMinorDims(x, {1, 0}, {m - j, 1});
+    xla::XlaOp sigma = BatchDot(x_tail, true, x_tail, false);
+    xla::XlaOp zeros = xla::ZerosLike(alpha);
+    xla::XlaOp ones = xla::FullLike(alpha, 1);
+    xla::XlaOp mu = xla::Sqrt(alpha * alpha + sigma);
+    xla::XlaOp beta = xla::Select(xla::Lt(alpha, zeros), mu, -mu);
+    xla::XlaOp is_zero = xla::Eq(sigma, zeros);
+    xla::XlaOp tau = xla::Select(is_zero, zeros, (beta - alpha) / beta);
+    xla::XlaOp scale = xla::Select(is_zero, ones, alpha - beta);
+    xla::XlaOp v = xla::ConcatInDim(
+        input.builder(), {xla::FullLike(alpha, 1), x_tail / scale},
+        shape.rank() - 2);
+
+    xla::XlaOp r_tail = xla::SliceInMinorDims(r, {j, 0}, {m, n});
+    r_tail = r_tail - tau * BatchDot(v, false, BatchDot(v, true, r_tail, false),
+                                     false);
+    r = xla::UpdateSliceInMinorDims(r, r_tail, {j, 0});
+    xla::XlaOp q_tail = xla::SliceInMinorDims(q, {0, j}, {m, m});
+    q_tail = q_tail - tau * BatchDot(BatchDot(q_tail, false, v, false), false,
+                                     v, true);
+    q = xla::UpdateSliceInMinorDims(q, q_tail, {0, j});
+  }
+  r = xla::UpperTriangle(r);
+  if (!full_matrices) {
+    q = xla::SliceInMinorDims(q, {0, 0}, {m, k});
+    r = xla::SliceInMinorDims(r, {0, 0}, {k, n});
+  }
+  return {q, r};
+}
+
+std::vector<xla::XlaOp> BuildSmallSymEig(xla::XlaOp input, bool lower) {
+  // Builds the full symmetric matrix out of the lower triangle.
+  xla::XlaOp lower_input = lower ? input : xla::TransposeInMinorDims(input);
+  xla::XlaOp a =
+      xla::Triangle(lower_input, /*lower=*/true) +
+      xla::TransposeInMinorDims(xla::Select(xla::TriangleMask(lower_input, -1),
+                                            lower_input,
+                                            xla::ZerosLike(lower_input)));
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(a);
+  xla::int64 rank = shape.rank();
+  xla::int64 n = shape.dimensions(rank - 1);
+  // An odd size is padded with a zero row and column, which no rotation ever
+  // touches, as all its pairings are already diagonal.
+  xla::int64 padded_n = n + n % 2;
+  if (padded_n != n) {
+    std::vector<xla::int64> padded_dims =
+        xla::util::ToVector<xla::int64>(shape.dimensions());
+    padded_dims[rank - 2] = padded_dims[rank - 1] = padded_n;
+    a = PadToSize(a, padded_dims);
+  }
+  xla::int64 half = padded_n / 2;
+  xla::XlaOp v = BatchIdentity(a.builder(), shape.element_type(),
+                               BatchDimensions(shape), padded_n);
+  auto sweep_fn = [&](absl::Span<const xla::XlaOp> state,
+                      xla::XlaOp* measure) {
+    xla::XlaOp matrix = state[0];
+    xla::XlaOp vectors = state[1];
+    for (xla::int64 round = 0; round + 1 < padded_n; ++round) {
+      JacobiRotation rotation = ComputeJacobiRotation(
+          xla::GetMatrixDiagonal(
+              xla::SliceInMinorDims(matrix, {0, 0}, {half, half})),
+          xla::GetMatrixDiagonal(
+              xla::SliceInMinorDims(matrix, {0, half}, {half, padded_n})),
+          xla::GetMatrixDiagonal(xla::SliceInMinorDims(
+              matrix, {half, half}, {padded_n, padded_n})));
+      matrix = RotatePairs(RotatePairs(matrix, rotation, rank - 2), rotation,
+                           rank - 1);
+      vectors = RotatePairs(vectors, rotation, rank - 1);
+      matrix = NextRoundOrder(NextRoundOrder(matrix, rank - 2), rank - 1);
+      vectors = NextRoundOrder(vectors, rank - 1);
+    }
+    // The largest ratio, within the batch, between the off-diagonal norm and
+    // the norm of a matrix.
+    xla::XlaOp norm = SumOfSquares(SumOfSquares(matrix, rank - 1), rank - 2);
+    xla::XlaOp off_diagonal =
+        norm - SumOfSquares(xla::GetMatrixDiagonal(matrix), rank - 2);
+    xla::XlaOp ratio = xla::Select(xla::Eq(norm, xla::ZerosLike(norm)),
+                                   xla::ZerosLike(norm), off_diagonal / norm);
+    *measure = xla::ReduceAll(
+        xla::Sqrt(ratio), xla::Zero(matrix.builder(), shape.element_type()),
+        xla::CreateScalarMaxComputation(shape.element_type(),
+                                        matrix.builder()));
+    return std::vector<xla::XlaOp>({matrix, vectors});
+  };
+  xla::XlaOp tolerance =
+      xla::Epsilon(a.builder(), shape.element_type()) *
+      xla::ScalarLike(a, kJacobiToleranceEpsilons * padded_n);
+  std::vector<xla::XlaOp> state = RunJacobiSweeps(sweep_fn, tolerance, {a, v});
+  xla::XlaOp w = xla::GetMatrixDiagonal(state[0]);
+  v = state[1];
+  if (padded_n != n) {
+    w = xla::SliceInMinorDims(w, {0}, {n});
+    v = xla::SliceInMinorDims(v, {0, 0}, {n, n});
+  }
+  return {SortValues(w, /*descending=*/false),
+          SortVectors(v, w, /*descending=*/false)};
+}
+
+std::vector<xla::XlaOp> BuildSmallSVD(xla::XlaOp input, bool some,
+                                      bool compute_uv) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 rank = input_shape.rank();
+  xla::int64 m = input_shape.dimensions(rank - 2);
+  xla::int64 n = input_shape.dimensions(rank - 1);
+  XLA_CHECK(some || !compute_uv || m == n)
+      << "Full SVD matrices require a square input: " << input_shape;
+  // The columns are orthogonalized, so a wide input is decomposed through its
+  // transpose, swapping u and v.
+  bool transposed = m < n;
+  xla::XlaOp a = transposed ? xla::TransposeInMinorDims(input) : input;
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(a);
+  xla::int64 rows = shape.dimensions(rank - 2);
+  xla::int64 k = shape.dimensions(rank - 1);
+  xla::int64 padded_k = k + k % 2;
+  if (padded_k != k) {
+    std::vector<xla::int64> padded_dims =
+        xla::util::ToVector<xla::int64>(shape.dimensions());
+    padded_dims[rank - 1] = padded_k;
+    a = PadToSize(a, padded_dims);
+  }
+  xla::int64 half = padded_k / 2;
+  xla::XlaOp v = BatchIdentity(a.builder(), shape.element_type(),
+                               BatchDimensions(shape), padded_k);
+  auto sweep_fn = [&](absl::Span<const xla::XlaOp> state,
+                      xla::XlaOp* measure) {
+    xla::XlaOp matrix = state[0];
+    xla::XlaOp vectors = state[1];
+    std::vector<xla::XlaOp> cosines;
+    for (xla::int64 round = 0; round + 1 < padded_k; ++round) {
+      xla::XlaOp top = xla::SliceInMinorDims(matrix, {0, 0}, {rows, half});
+      xla::XlaOp bottom =
+          xla::SliceInMinorDims(matrix, {0, half}, {rows, padded_k});
+      xla::XlaOp alpha = SumOfSquares(top, rank - 2);
+      xla::XlaOp beta = SumOfSquares(bottom, rank - 2);
+      xla::XlaOp gamma = xla::Reduce(
+          top * bottom, xla::Zero(matrix.builder(), shape.element_type()),
+          XlaHelpers::CreateAddComputation(shape.element_type()), {rank - 2});
+      JacobiRotation rotation = ComputeJacobiRotation(alpha, gamma, beta);
+      matrix =
+          NextRoundOrder(RotatePairs(matrix, rotation, rank - 1), rank - 1);
+      vectors =
+          NextRoundOrder(RotatePairs(vectors, rotation, rank - 1), rank - 1);
+      // The cosine of the angle between the columns of each pair.
+      xla::XlaOp norms = xla::Sqrt(alpha * beta);
+      cosines.push_back(xla::ReduceAll(
+          xla::Select(xla::Eq(norms, xla::ZerosLike(norms)),
+                      xla::ZerosLike(norms), xla::Abs(gamma) / norms),
+          xla::Zero(matrix.builder(), shape.element_type()),
+          xla::CreateScalarMaxComputation(shape.element_type(),
+                                          matrix.builder())));
+    }
+    *measure = cosines.front();
+    for (size_t i = 1; i < cosines.size(); ++i) {
+      *measure = xla::Max(*measure, cosines[i]);
+    }
+    return std::vector<xla::XlaOp>({matrix, vectors});
+  };
+  xla::XlaOp tolerance =
+      xla::Epsilon(a.builder(), shape.element_type()) *
+      xla::ScalarLike(a, kJacobiToleranceEpsilons * padded_k);
+  std::vector<xla::XlaOp> state = RunJacobiSweeps(sweep_fn, tolerance, {a, v});
+  a = xla::SliceInMinorDims(state[0], {0, 0}, {rows, k});
+  v = xla::SliceInMinorDims(state[1], {0, 0}, {k, k});
+  // The singular values are the norms of the orthogonalized columns, and the
+  // left singular vectors the normalized columns.
+  xla::XlaOp d = xla::Sqrt(SumOfSquares(a, rank - 2));
+  xla::XlaOp safe_d =
+      xla::Select(xla::Eq(d, xla::ZerosLike(d)), xla::FullLike(d, 1), d);
+  xla::XlaOp u = a / BroadcastPairValues(safe_d, shape, rank - 1);
+  u = SortVectors(u, d, /*descending=*/true);
+  v = SortVectors(v, d, /*descending=*/true);
+  d = SortValues(d, /*descending=*/true);
+  if (compute_uv) {
+    // The columns of u for null or negligible singular values hold zeros or
+    // noise, so they are replaced with an orthonormal completion of the other
+    // ones. The Q factor of u is such a completion, which keeps the columns of
+    // the non negligible singular values up to the sign of the diagonal of R.
+    std::vector<xla::int64> batch_dimensions(rank - 2);
+    std::iota(batch_dimensions.begin(), batch_dimensions.end(), 0);
+    xla::XlaOp threshold =
+        xla::SliceInMinorDims(d, {0}, {1}) *
+        (xla::Epsilon(a.builder(), shape.element_type()) *
+         xla::ScalarLike(d, kJacobiToleranceEpsilons * rows));
+    xla::XlaOp negligible = xla::Le(
+        d, xla::Reshape(threshold, BatchDimensions(shape)), batch_dimensions);
+    u = xla::Select(BroadcastPairValues(negligible, shape, rank - 1),
+                    xla::ZerosLike(u), u);
+    std::vector<xla::XlaOp> qr = BuildSmallQR(u, /*full_matrices=*/false);
+    xla::XlaOp r_diagonal = xla::GetMatrixDiagonal(qr[1]);
+    xla::XlaOp signs = xla::Select(
+        xla::Lt(r_diagonal, xla::ZerosLike(r_diagonal)),
+        xla::FullLike(r_diagonal, -1), xla::FullLike(r_diagonal, 1));
+    u = qr[0] * BroadcastPairValues(signs, shape, rank - 1);
+  }
+  if (transposed) {
+    std::swap(u, v);
+  }
+  if (!compute_uv) {
+    // Matches the shapes the generic lowering produces in this case.
+    xla::Shape u_shape(input_shape);
+    u_shape.set_dimensions(rank - 1, m);
+    xla::Shape v_shape(input_shape);
+    v_shape.set_dimensions(rank - 2, n);
+    v_shape.set_dimensions(rank - 1, some ? std::min(m, n) : n);
+    u = xla::Zeros(input.builder(), u_shape);
+    v = xla::Zeros(input.builder(), v_shape);
+  }
+  return {u, d, v};
+}
+
+xla::XlaOp BuildSmallTriangularSolve(xla::XlaOp a, xla::XlaOp b,
+                                     bool left_side, bool lower,
+                                     bool transpose, bool unit_diagonal) {
+  // x * op(a) = b is solved as op(a)^T * x^T = b^T, and a^T * x = b as a
+  // system of the opposite triangle.
+  if (!left_side) {
+    b = xla::TransposeInMinorDims(b);
+    transpose = !transpose;
+  }
+  if (transpose) {
+    a = xla::TransposeInMinorDims(a);
+    lower = !lower;
+  }
+  const xla::Shape& a_shape = XlaHelpers::ShapeOfXlaOp(a);
+  const xla::Shape& b_shape = XlaHelpers::ShapeOfXlaOp(b);
+  xla::int64 n = a_shape.dimensions(a_shape.rank() - 1);
+  xla::int64 k = b_shape.dimensions(b_shape.rank() - 1);
+  xla::XlaOp x = xla::ZerosLike(b);
+  for (xla::int64 step = 0; step < n; ++step) {
+    // The rows of x not solved yet are zero, so the product only accounts for
+    // the ones which are.
+    xla::int64 i = lower ? step : n - 1 - step;
+    xla::XlaOp row = xla::SliceInMinorDims(b, {i, 0}, {i + 1, k}) -
+                     BatchDot(xla::SliceInMinorDims(a, {i, 0}, {i + 1, n}),
+                              false, x, false);
+    if (!unit_diagonal) {
+      row = row / xla::SliceInMinorDims(a, {i, i}, {i + 1, i + 1});
+    }
+    x = xla::UpdateSliceInMinorDims(x, row, {i, 0});
+  }
+  return left_side ? x : xla::TransposeInMinorDims(x);
+}
+
 }  // namespace swift_xla
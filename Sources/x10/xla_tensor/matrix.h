@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
 namespace swift_xla {
@@ -33,4 +35,35 @@ xla::XlaOp BuildDiagonalViewUpdate(xla::XlaOp target, xla::XlaOp input,
 
 xla::XlaOp BuildInverse(xla::XlaOp input);
 
+// The generic XLA client library decompositions are blocked and iterative
+// algorithms, whose loop overhead dominates for small matrices. Returns whether
+// the trailing two dimensions of the shape are small enough (see
+// XLA_SMALL_MATRIX_SIZE) for the routines below to be used instead, which are
+// unrolled and operate on the whole batch at each step.
+bool UseSmallMatrixLowering(const xla::Shape& shape);
+
+// Unrolled Cholesky-Crout factorization, one column per step.
+xla::XlaOp BuildSmallCholesky(xla::XlaOp input, bool lower);
+
+// Unrolled Householder QR decomposition. Returns {q, r}, like
+// xla::QRDecomposition().
+std::vector<xla::XlaOp> BuildSmallQR(xla::XlaOp input, bool full_matrices);
+
+// Cyclic Jacobi eigendecomposition of a symmetric matrix, which uses the lower
+// or upper triangle of the input. Returns {w, v}, with the eigenvalues in
+// ascending order.
+std::vector<xla::XlaOp> BuildSmallSymEig(xla::XlaOp input, bool lower);
+
+// One-sided Jacobi SVD. Returns {u, d, v}, with the singular values in
+// descending order, and u and v holding min(M, N) vectors each (or zeros, if
+// compute_uv is false). Full matrices are only supported for square inputs.
+std::vector<xla::XlaOp> BuildSmallSVD(xla::XlaOp input, bool some,
+                                      bool compute_uv);
+
+// Unrolled substitution solving op(a) * x = b, or x * op(a) = b if left_side
+// is false, for a triangular a with the same batch dimensions as b.
+xla::XlaOp BuildSmallTriangularSolve(xla::XlaOp a, xla::XlaOp b,
+                                     bool left_side, bool lower,
+                                     bool transpose, bool unit_diagonal);
+
 }  // namespace swift_xla
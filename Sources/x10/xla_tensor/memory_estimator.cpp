@@ -0,0 +1,199 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_estimator.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+
+namespace swift_xla {
+namespace {
+
+xla::int64 BufferBytes(const xla::Shape& shape) {
+  if (shape.IsTuple()) {
+    xla::int64 bytes = 0;
+    for (auto& element_shape : shape.tuple_shapes()) {
+      bytes += BufferBytes(element_shape);
+    }
+    return bytes;
+  }
+  return shape.IsArray() ? xla::ShapeUtil::ByteSizeOf(shape) : 0;
+}
+
+// Whether the instruction forwards the buffers of its operands instead of
+// creating one of its own.
+bool ForwardsBuffers(const std::string& opcode) {
+  return opcode == "bitcast" || opcode == "get-tuple-element" ||
+         opcode == "tuple";
+}
+
+bool CallsComputations(const std::string& opcode) {
+  return opcode == "call" || opcode == "conditional" || opcode == "while";
+}
+
+struct ComputationEstimate {
+  // The highest number of bytes live at once within the computation, not
+  // counting its parameters, which belong to the caller.
+  xla::int64 peak_bytes = 0;
+  xla::int64 output_bytes = 0;
+};
+
+class MemoryEstimator {
+ public:
+  explicit MemoryEstimator(const xla::HloModuleProto& module) {
+    for (auto& computation : module.computations()) {
+      computations_[computation.id()] = &computation;
+    }
+  }
+
+  // Estimates a computation, whose results at the given indices of its root
+  // tuple are written within parameter buffers.
+  ComputationEstimate Estimate(xla::int64 computation_id,
+                               absl::Span<const xla::int64> aliased_outputs) {
+    const xla::HloComputationProto* computation =
+        computations_.at(computation_id);
+    size_t size = computation->instructions_size();
+    std::unordered_map<xla::int64, size_t> positions;
+    for (size_t i = 0; i < size; ++i) {
+      positions[computation->instructions(i).id()] = i;
+    }
+    // The positions of the instructions whose buffers hold the value of each
+    // instruction.
+    std::vector<std::vector<size_t>> owners(size);
+    std::vector<xla::int64> bytes(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+      const xla::HloInstructionProto& instruction =
+          computation->instructions(i);
+      if (ForwardsBuffers(instruction.opcode())) {
+        for (auto operand_id : instruction.operand_ids()) {
+          const std::vector<size_t>& operand_owners =
+              owners[positions.at(operand_id)];
+          owners[i].insert(owners[i].end(), operand_owners.begin(),
+                           operand_owners.end());
+        }
+      } else if (instruction.opcode() != "parameter") {
+        owners[i].push_back(i);
+        bytes[i] = BufferBytes(xla::Shape(instruction.shape()));
+      }
+    }
+    size_t root = positions.at(computation->root_id());
+    const xla::HloInstructionProto& root_instruction =
+        computation->instructions(root);
+    for (auto output_index : aliased_outputs) {
+      XLA_CHECK_EQ(root_instruction.opcode(), "tuple");
+      for (auto owner :
+           owners[positions.at(root_instruction.operand_ids(output_index))]) {
+        bytes[owner] = 0;
+      }
+    }
+
+    // Every buffer is released after its last use, but the results, which are
+    // live until the end.
+    std::vector<size_t> last_uses(size);
+    for (size_t i = 0; i < size; ++i) {
+      last_uses[i] = i;
+      for (auto operand_id : computation->instructions(i).operand_ids()) {
+        for (auto owner : owners[positions.at(operand_id)]) {
+          last_uses[owner] = std::max(last_uses[owner], i);
+        }
+      }
+    }
+    ComputationEstimate estimate;
+    for (auto owner : owners[root]) {
+      last_uses[owner] = size;
+      estimate.output_bytes += bytes[owner];
+    }
+    std::vector<std::vector<size_t>> releases(size);
+    for (size_t i = 0; i < size; ++i) {
+      if (last_uses[i] < size) {
+        releases[last_uses[i]].push_back(i);
+      }
+    }
+
+    xla::int64 live_bytes = 0;
+    for (size_t i = 0; i < size; ++i) {
+      const xla::HloInstructionProto& instruction =
+          computation->instructions(i);
+      xla::int64 temporary_bytes = 0;
+      if (CallsComputations(instruction.opcode())) {
+        for (auto called_id : instruction.called_computation_ids()) {
+          const ComputationEstimate& called = GetCalledEstimate(called_id);
+          temporary_bytes = std::max(temporary_bytes,
+                                     called.peak_bytes - called.output_bytes);
+        }
+      }
+      live_bytes += bytes[i];
+      estimate.peak_bytes =
+          std::max(estimate.peak_bytes, live_bytes + temporary_bytes);
+      for (auto released : releases[i]) {
+        live_bytes -= bytes[released];
+      }
+    }
+    return estimate;
+  }
+
+ private:
+  const ComputationEstimate& GetCalledEstimate(xla::int64 computation_id) {
+    auto it = called_estimates_.find(computation_id);
+    if (it == called_estimates_.end()) {
+      it = called_estimates_
+               .emplace(computation_id,
+                        Estimate(computation_id, /*aliased_outputs=*/{}))
+               .first;
+    }
+    return it->second;
+  }
+
+  std::unordered_map<xla::int64, const xla::HloComputationProto*>
+      computations_;
+  std::unordered_map<xla::int64, ComputationEstimate> called_estimates_;
+};
+
+}  // namespace
+
+MemoryEstimate EstimateMemory(const xla::HloModuleProto& module) {
+  std::vector<xla::int64> aliased_outputs;
+  for (auto& entry : module.input_output_alias().entries()) {
+    // Only the results of a root tuple can be aliased.
+    if (entry.output_shape_index_size() == 1) {
+      aliased_outputs.push_back(entry.output_shape_index(0));
+    }
+  }
+  MemoryEstimator estimator(module);
+  ComputationEstimate entry_estimate =
+      estimator.Estimate(module.entry_computation_id(), aliased_outputs);
+
+  MemoryEstimate estimate;
+  for (auto& computation : module.computations()) {
+    if (computation.id() != module.entry_computation_id()) {
+      continue;
+    }
+    for (auto& instruction : computation.instructions()) {
+      if (instruction.opcode() == "parameter") {
+        estimate.parameter_bytes +=
+            BufferBytes(xla::Shape(instruction.shape()));
+      }
+    }
+  }
+  estimate.output_bytes = entry_estimate.output_bytes;
+  estimate.peak_bytes = estimate.parameter_bytes + entry_estimate.peak_bytes;
+  return estimate;
+}
+
+}  // namespace swift_xla
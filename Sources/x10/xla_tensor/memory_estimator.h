@@ -0,0 +1,43 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/xla/service/hlo.pb.h"
+#include "tensorflow/compiler/xla/types.h"
+
+namespace swift_xla {
+
+// The device memory needed to run a computation.
+struct MemoryEstimate {
+  xla::int64 parameter_bytes = 0;
+  // The bytes of the results which are not aliased with a parameter.
+  xla::int64 output_bytes = 0;
+  // The highest number of bytes live at once, parameters and results included.
+  xla::int64 peak_bytes = 0;
+};
+
+// Estimates the memory needed to run a computation from the lifetimes of the
+// buffers of its HLO instructions, in the order they have been emitted. The
+// parameters are live for the whole execution, and the results aliased with a
+// parameter (see XlaBuilder::SetUpAlias()) are written in place. Tuples, tuple
+// element accesses and bitcasts share the buffers of their operands, and the
+// temporaries of called computations (calls, while loops and conditionals) are
+// accounted while the calling instruction runs. As the backend can reorder and
+// fuse the instructions, this is an estimate and not a bound.
+MemoryEstimate EstimateMemory(const xla::HloModuleProto& module);
+
+}  // namespace swift_xla
@@ -0,0 +1,136 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_scheduler.h"
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+double NodeBytes(const Node* node) {
+  if (node->operands().empty()) {
+    return 0;
+  }
+  double bytes = 0;
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    const xla::Shape& shape = node->shape(i);
+    if (shape.IsArray()) {
+      bytes += xla::ShapeUtil::ByteSizeOf(shape);
+    }
+  }
+  return bytes;
+}
+
+}  // namespace
+
+std::vector<const Node*> ScheduleForMemory(
+    absl::Span<const Node* const> post_order, absl::Span<const Output> roots) {
+  size_t size = post_order.size();
+  std::unordered_map<const Node*, size_t> node_positions;
+  node_positions.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    node_positions[post_order[i]] = i;
+  }
+  // Both lists are deduplicated, as a node can use several outputs of the same
+  // operand. The users are visited in post-order, so a repeated user can only
+  // be the last one appended.
+  std::vector<std::vector<size_t>> operands(size);
+  std::vector<std::vector<size_t>> users(size);
+  for (size_t i = 0; i < size; ++i) {
+    for (auto& operand : post_order[i]->operands()) {
+      size_t position = node_positions.at(operand.node);
+      if (users[position].empty() || users[position].back() != i) {
+        users[position].push_back(i);
+        operands[i].push_back(position);
+      }
+    }
+  }
+  std::vector<bool> is_root(size, false);
+  for (auto& root : roots) {
+    is_root[node_positions.at(root.node)] = true;
+  }
+  std::vector<double> bytes(size);
+  std::vector<size_t> pending_operands(size);
+  std::vector<size_t> pending_users(size);
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = NodeBytes(post_order[i]);
+    pending_operands[i] = operands[i].size();
+    pending_users[i] = users[i].size();
+  }
+
+  // The ready nodes, keyed by the bytes they allocate net of the bytes they
+  // free, and then by their post-order position.
+  std::set<std::pair<double, size_t>> ready;
+  std::vector<double> ready_keys(size, 0);
+  auto compute_key = [&](size_t i) {
+    double freed_bytes = 0;
+    for (auto operand : operands[i]) {
+      if (pending_users[operand] == 1 && !is_root[operand]) {
+        freed_bytes += bytes[operand];
+      }
+    }
+    return bytes[i] - freed_bytes;
+  };
+  auto add_ready = [&](size_t i) {
+    ready_keys[i] = compute_key(i);
+    ready.emplace(ready_keys[i], i);
+  };
+  for (size_t i = 0; i < size; ++i) {
+    if (pending_operands[i] == 0) {
+      add_ready(i);
+    }
+  }
+
+  std::vector<bool> scheduled(size, false);
+  std::vector<const Node*> schedule;
+  schedule.reserve(size);
+  while (!ready.empty()) {
+    size_t current = ready.begin()->second;
+    ready.erase(ready.begin());
+    scheduled[current] = true;
+    schedule.push_back(post_order[current]);
+    for (auto operand : operands[current]) {
+      pending_users[operand] -= 1;
+      if (pending_users[operand] != 1 || is_root[operand]) {
+        continue;
+      }
+      // The remaining user of the operand now frees it, which makes it more
+      // attractive if it is ready.
+      for (auto user : users[operand]) {
+        if (!scheduled[user] && pending_operands[user] == 0) {
+          ready.erase({ready_keys[user], user});
+          add_ready(user);
+        }
+      }
+    }
+    for (auto user : users[current]) {
+      pending_operands[user] -= 1;
+      if (pending_operands[user] == 0) {
+        add_ready(user);
+      }
+    }
+  }
+  XLA_CHECK_EQ(schedule.size(), size);
+  return schedule;
+}
+
+}  // namespace ir
+}  // namespace swift_xla
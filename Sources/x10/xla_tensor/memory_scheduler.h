@@ -0,0 +1,38 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+
+// Reorders the post-order of an IR graph to lower its peak of live bytes, by
+// list scheduling: among the nodes whose operands have all been scheduled, the
+// one freeing the most bytes of operands net of the bytes of its outputs comes
+// first, and ties are broken by the original post-order, so the schedule is
+// deterministic. The result is still a valid post-order of the graph. Nodes
+// without operands (device data, constants) are accounted no bytes, as they do
+// not hold activations.
+std::vector<const Node*> ScheduleForMemory(
+    absl::Span<const Node* const> post_order, absl::Span<const Output> roots);
+
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,117 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Compares the throughput of the op-by-op executor, for a few maximum cluster
+// sizes, with the one of the fused execution of the same graph, as a sync of
+// the tensors runs it. The graph is a chain of layers of elementwise ops over
+// [size, size] values, h = tanh(h * w + b), followed by a full sum. Both paths
+// fetch the results, which waits for the execution to complete, and the graph
+// is traced only once, so that only its execution is measured.
+//
+// Usage: op_by_op_benchmark [--size=N] [--layers=N] [--repetitions=N]
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/benchmark_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/op_by_op_executor.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+namespace {
+
+XLATensor MakeTensor(xla::int64 size, int seed, const Device& device) {
+  std::vector<float> values(size * size);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] =
+        static_cast<float>((i * 7919 + seed * 104729) % 1009) / 1009.0f - 0.5f;
+  }
+  return XLATensor::Create(at::Tensor(std::move(values), {size, size}),
+                           device);
+}
+
+std::vector<ir::Value> BuildGraph(xla::int64 size, int layers,
+                                  const Device& device) {
+  XLATensor h = MakeTensor(size, 0, device);
+  for (int i = 0; i < layers; ++i) {
+    XLATensor w = MakeTensor(size, 2 * i + 1, device);
+    XLATensor b = MakeTensor(size, 2 * i + 2, device);
+    h = XLATensor::tanh(
+        XLATensor::add(XLATensor::mul(h, w), b, at::Scalar(1.0)));
+  }
+  XLATensor total = XLATensor::sum(h, {0, 1},
+                                   /*keep_reduced_dimensions=*/false,
+                                   c10::nullopt);
+  return {h.GetIrValue(), total.GetIrValue()};
+}
+
+void RunFused(absl::Span<const ir::Value> roots, const Device& device) {
+  std::vector<XLATensor> tensors;
+  for (auto& root : roots) {
+    tensors.push_back(XLATensor::Create(root, device));
+  }
+  XLATensor::SyncTensorsGraph(&tensors, {}, /*wait=*/true,
+                              /*sync_xla_data=*/false);
+  for (auto& tensor : tensors) {
+    tensor.ToTensor();
+  }
+}
+
+void RunBenchmark(xla::int64 size, int layers, int repetitions,
+                  const Device& device) {
+  std::vector<ir::Value> roots = BuildGraph(size, layers, device);
+  double fused_time =
+      TimeRepeated([&]() { RunFused(roots, device); }, repetitions).average_us;
+  absl::PrintF("size=%-5d layers=%-3d fused=%12.1fus\n", size, layers,
+               fused_time);
+  for (size_t cluster_size : {1, 4, 16, 64}) {
+    OpByOpExecutor executor(/*compile_cache_size=*/1024, cluster_size,
+                            /*shape_bucketing=*/false);
+    double time = TimeRepeated(
+                      [&]() {
+                        xla::ComputationClient::Get()->TransferFromServer(
+                            executor.Execute(roots, device.ToString(), {}));
+                      },
+                      repetitions)
+                      .average_us;
+    absl::PrintF("  cluster_size=%-3d op-by-op=%12.1fus (%.2fx fused)\n",
+                 cluster_size, time, time / fused_time);
+  }
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  int size = 256;
+  int layers = 16;
+  int repetitions = 10;
+  if (!swift_xla::ParseBenchmarkFlags(argc, argv,
+                                      {{"size", &size},
+                                       {"layers", &layers},
+                                       {"repetitions", &repetitions}},
+                                      "[--size=N] [--layers=N] "
+                                      "[--repetitions=N]")) {
+    return 1;
+  }
+  const swift_xla::Device& device = *swift_xla::GetDefaultDevice();
+  absl::PrintF("Op-by-op execution on %s\n", device.ToString());
+  swift_xla::RunBenchmark(size, layers, repetitions, device);
+  return 0;
+}
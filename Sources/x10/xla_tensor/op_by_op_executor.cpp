@@ -14,9 +14,14 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/op_by_op_executor.h"
 
+#include <algorithm>
 #include <list>
+#include <map>
+#include <mutex>
+#include <set>
 #include <unordered_map>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
@@ -24,64 +29,413 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/cast.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/mean.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scalar.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/sum.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
 namespace swift_xla {
 namespace {
 
-absl::optional<size_t> GetOutputIndex(bool is_device_data, size_t index) {
-  // The output of every result of an op-by-op computation is wrapped into a
-  // tuple, so we need to use the index to extract it. Device data instead is
-  // already unwrapped, so we need to pass an empty index so that TF/XRT code
-  // uses the result buffer directly.
-  if (is_device_data) {
+using ChainedInput = xla::ComputationClient::ExecuteChainedOp::Input;
+
+// Bucketed values are padded to at least this many elements, so that all the
+// tiny tensors share the same kernels.
+constexpr xla::int64 kMinBucketSize = 16;
+
+// The number of element counts of bucketed values which are kept on device.
+constexpr size_t kNumElementsCacheSize = 1024;
+
+// A cluster is a range of consecutive nodes of the post-order, which gets
+// lowered into a single computation. The parameters of the computation are the
+// outputs of the nodes of other clusters used by the cluster nodes, and its
+// results the outputs of the cluster nodes which are used outside of it.
+//
+// A bucketed cluster is made of elementwise operations over values of the same
+// number of elements, possibly followed by reductions of all of them, and its
+// computation operates on values flattened and padded to bucket_size elements.
+// Such a computation does not depend on the actual shape of the values, so one
+// kernel serves all the shapes falling into the same bucket.
+struct Cluster {
+  std::vector<const ir::Node*> nodes;
+  std::vector<ir::Output> parameters;
+  std::vector<ir::Output> results;
+  xla::int64 num_elements = 0;
+  xla::int64 bucket_size = 0;
+};
+
+bool IsClusterableOp(const ir::OpKind& op) {
+  static const std::set<ir::OpKind>* clusterable_ops =
+      new std::set<ir::OpKind>({
+          // Elementwise operations.
+          ir::OpKind(at::aten::abs), ir::OpKind(at::aten::acos),
+          ir::OpKind(at::aten::acosh), ir::OpKind(at::aten::add),
+          ir::OpKind(at::aten::asin), ir::OpKind(at::aten::asinh),
+          ir::OpKind(at::aten::atan), ir::OpKind(at::aten::atan2),
+          ir::OpKind(at::aten::atanh), ir::OpKind(at::aten::bitwise_not),
+          ir::OpKind(at::aten::ceil), ir::OpKind(at::aten::clamp),
+          ir::OpKind(at::aten::cos), ir::OpKind(at::aten::cosh),
+          ir::OpKind(at::aten::div), ir::OpKind(at::aten::erf),
+          ir::OpKind(at::aten::erfc), ir::OpKind(at::aten::erfinv),
+          ir::OpKind(at::aten::exp), ir::OpKind(at::aten::expm1),
+          ir::OpKind(at::aten::floor), ir::OpKind(at::aten::fmod),
+          ir::OpKind(at::aten::hardshrink), ir::OpKind(at::aten::leaky_relu),
+          ir::OpKind(at::aten::log), ir::OpKind(at::aten::log1p),
+          ir::OpKind(at::aten::logical_and), ir::OpKind(at::aten::logical_or),
+          ir::OpKind(at::aten::max), ir::OpKind(at::aten::min),
+          ir::OpKind(at::aten::mul), ir::OpKind(at::aten::neg),
+          ir::OpKind(at::aten::pow), ir::OpKind(at::aten::reciprocal),
+          ir::OpKind(at::aten::relu), ir::OpKind(at::aten::round_to_even),
+          ir::OpKind(at::aten::rsqrt), ir::OpKind(at::aten::sigmoid),
+          ir::OpKind(at::aten::sign), ir::OpKind(at::aten::sin),
+          ir::OpKind(at::aten::sinh), ir::OpKind(at::aten::softshrink),
+          ir::OpKind(at::aten::sqrt), ir::OpKind(at::aten::sub),
+          ir::OpKind(at::aten::tan), ir::OpKind(at::aten::tanh),
+          ir::OpKind(at::aten::threshold), ir::OpKind(at::aten::where),
+          ir::OpKind(at::aten::xla_is_finite), ir::OpKind(at::aten::xla_is_inf),
+          ir::OpKind(at::aten::xla_is_nan), ir::OpKind(at::aten::xla_rem),
+          ir::OpKind(at::aten::__and__), ir::OpKind(at::aten::__or__),
+          ir::OpKind(at::aten::__xor__), ir::OpKind(at::prim::Constant),
+          *ir::ops::xla_cast,
+          // Reductions.
+          ir::OpKind(at::aten::all), ir::OpKind(at::aten::any),
+          ir::OpKind(at::aten::argmax), ir::OpKind(at::aten::argmin),
+          ir::OpKind(at::aten::log_softmax), ir::OpKind(at::aten::logsumexp),
+          ir::OpKind(at::aten::mean), ir::OpKind(at::aten::prod),
+          ir::OpKind(at::aten::softmax), ir::OpKind(at::aten::std),
+          ir::OpKind(at::aten::sum),
+          // Data movement which XLA fuses with its producers and consumers.
+          ir::OpKind(at::aten::expand), ir::OpKind(at::aten::permute),
+          ir::OpKind(at::aten::squeeze), ir::OpKind(at::aten::unsqueeze),
+          ir::OpKind(at::aten::view),
+      });
+  return clusterable_ops->count(op) > 0;
+}
+
+bool IsClusterableNode(const ir::Node* node) {
+  if (!IsClusterableOp(node->op()) || !node->shape().is_static()) {
+    return false;
+  }
+  for (auto& operand : node->operands()) {
+    if (!operand.shape().is_static()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsBucketableOp(const ir::OpKind& op) {
+  // Operations whose lowering only depends on the element types of their
+  // operands, and not on their shapes or other attributes.
+  static const std::set<ir::OpKind>* bucketable_ops =
+      new std::set<ir::OpKind>({
+          ir::OpKind(at::aten::abs), ir::OpKind(at::aten::acos),
+          ir::OpKind(at::aten::acosh), ir::OpKind(at::aten::add),
+          ir::OpKind(at::aten::asin), ir::OpKind(at::aten::asinh),
+          ir::OpKind(at::aten::atan), ir::OpKind(at::aten::atan2),
+          ir::OpKind(at::aten::atanh), ir::OpKind(at::aten::bitwise_not),
+          ir::OpKind(at::aten::ceil), ir::OpKind(at::aten::cos),
+          ir::OpKind(at::aten::cosh), ir::OpKind(at::aten::div),
+          ir::OpKind(at::aten::eq), ir::OpKind(at::aten::erf),
+          ir::OpKind(at::aten::erfc), ir::OpKind(at::aten::erfinv),
+          ir::OpKind(at::aten::exp), ir::OpKind(at::aten::expm1),
+          ir::OpKind(at::aten::floor), ir::OpKind(at::aten::fmod),
+          ir::OpKind(at::aten::ge), ir::OpKind(at::aten::gt),
+          ir::OpKind(at::aten::le), ir::OpKind(at::aten::log),
+          ir::OpKind(at::aten::log1p), ir::OpKind(at::aten::logical_and),
+          ir::OpKind(at::aten::logical_or), ir::OpKind(at::aten::lt),
+          ir::OpKind(at::aten::max), ir::OpKind(at::aten::min),
+          ir::OpKind(at::aten::mul), ir::OpKind(at::aten::ne),
+          ir::OpKind(at::aten::neg), ir::OpKind(at::aten::pow),
+          ir::OpKind(at::aten::reciprocal), ir::OpKind(at::aten::relu),
+          ir::OpKind(at::aten::round_to_even), ir::OpKind(at::aten::rsqrt),
+          ir::OpKind(at::aten::sigmoid), ir::OpKind(at::aten::sign),
+          ir::OpKind(at::aten::sin), ir::OpKind(at::aten::sinh),
+          ir::OpKind(at::aten::sqrt), ir::OpKind(at::aten::sub),
+          ir::OpKind(at::aten::tan), ir::OpKind(at::aten::tanh),
+          ir::OpKind(at::aten::where), ir::OpKind(at::aten::xla_is_finite),
+          ir::OpKind(at::aten::xla_is_inf), ir::OpKind(at::aten::xla_is_nan),
+          ir::OpKind(at::aten::xla_rem), *ir::ops::xla_cast,
+      });
+  return bucketable_ops->count(op) > 0;
+}
+
+// Whether the node is a sum or a mean of all the elements of its operand.
+bool IsFullReduction(const ir::Node* node) {
+  if (dynamic_cast<const ir::ops::Sum*>(node) == nullptr &&
+      dynamic_cast<const ir::ops::Mean*>(node) == nullptr) {
+    return false;
+  }
+  return node->shape().rank() == 0 && node->operand(0).shape().rank() > 0;
+}
+
+// Returns the number of elements of the values a node operates on, if the node
+// can be lowered on flattened and padded values, or absl::nullopt otherwise.
+absl::optional<xla::int64> GetBucketableElements(const ir::Node* node) {
+  const xla::Shape& shape = node->shape();
+  if (!IsClusterableNode(node) || node->num_outputs() != 1) {
+    return absl::nullopt;
+  }
+  if (dynamic_cast<const ir::ops::Scalar*>(node) != nullptr) {
+    return shape.rank() > 0
+               ? absl::optional<xla::int64>(xla::ShapeUtil::ElementsIn(shape))
+               : absl::nullopt;
+  }
+  if (IsFullReduction(node)) {
+    return xla::ShapeUtil::ElementsIn(node->operand(0).shape());
+  }
+  if (!IsBucketableOp(node->op()) || shape.rank() == 0) {
     return absl::nullopt;
   }
-  return index;
+  // Elementwise operations are only bucketable without broadcasting, besides
+  // the one of scalars, which works the same way on the flattened values.
+  for (auto& operand : node->operands()) {
+    const xla::Shape& operand_shape = operand.shape();
+    if (operand_shape.rank() > 0 &&
+        operand_shape.dimensions() != shape.dimensions()) {
+      return absl::nullopt;
+    }
+  }
+  return xla::ShapeUtil::ElementsIn(shape);
+}
+
+xla::int64 GetBucketSize(xla::int64 num_elements) {
+  xla::int64 bucket_size = kMinBucketSize;
+  while (bucket_size < num_elements) {
+    bucket_size *= 2;
+  }
+  return bucket_size;
+}
+
+void AssignClusterBuckets(std::vector<Cluster>* clusters) {
+  for (auto& cluster : *clusters) {
+    absl::optional<xla::int64> num_elements;
+    for (auto node : cluster.nodes) {
+      absl::optional<xla::int64> node_elements = GetBucketableElements(node);
+      if (!node_elements ||
+          (num_elements && *num_elements != *node_elements)) {
+        num_elements = absl::nullopt;
+        break;
+      }
+      num_elements = node_elements;
+    }
+    if (num_elements && *num_elements > 0) {
+      cluster.num_elements = *num_elements;
+      cluster.bucket_size = GetBucketSize(*num_elements);
+    }
+  }
+}
+
+bool HasFullReduction(const Cluster& cluster) {
+  return std::any_of(cluster.nodes.begin(), cluster.nodes.end(),
+                     IsFullReduction);
+}
+
+// Splits the post-order into clusters. A cluster grows with the following
+// clusterable nodes, up to max_cluster_size nodes, while any other node is a
+// cluster of its own. Since the clusters are ranges of the post-order, the
+// parameters of a cluster are always produced by former clusters.
+std::vector<Cluster> BuildClusters(
+    absl::Span<const ir::Node* const> post_order, size_t max_cluster_size,
+    std::unordered_map<const ir::Node*, size_t>* node_to_cluster) {
+  std::vector<Cluster> clusters;
+  bool open_cluster = false;
+  for (auto node : post_order) {
+    bool clusterable = IsClusterableNode(node);
+    if (!open_cluster || !clusterable ||
+        clusters.back().nodes.size() >= max_cluster_size) {
+      clusters.emplace_back();
+    }
+    open_cluster = clusterable;
+    clusters.back().nodes.push_back(node);
+    (*node_to_cluster)[node] = clusters.size() - 1;
+  }
+  return clusters;
 }
 
-const xla::Shape& GetParameterShape(const ir::Output& operand,
-                                    const xla::Shape& input_shape) {
-  // See comment in GetOutputIndex() about device data WRT computation outpout
-  // shape handling.
-  const ir::ops::DeviceData* device_data =
-      dynamic_cast<const ir::ops::DeviceData*>(operand.node);
-  return device_data != nullptr
-             ? input_shape
-             : xla::ShapeUtil::GetTupleElementShape(input_shape, operand.index);
+void ComputeClusterInterfaces(
+    absl::Span<const ir::Value> roots,
+    const std::unordered_map<const ir::Node*, size_t>& node_to_cluster,
+    std::vector<Cluster>* clusters) {
+  ir::OutputSet external_outputs;
+  for (auto& root : roots) {
+    external_outputs.insert(root);
+  }
+  for (size_t i = 0; i < clusters->size(); ++i) {
+    Cluster& cluster = (*clusters)[i];
+    ir::OutputSet parameters;
+    for (auto node : cluster.nodes) {
+      for (auto& operand : node->operands()) {
+        if (node_to_cluster.at(operand.node) != i) {
+          external_outputs.insert(operand);
+          if (parameters.insert(operand).second) {
+            cluster.parameters.push_back(operand);
+          }
+        }
+      }
+    }
+  }
+  for (auto& cluster : *clusters) {
+    for (auto node : cluster.nodes) {
+      for (size_t i = 0; i < node->num_outputs(); ++i) {
+        ir::Output output(node, i);
+        if (external_outputs.count(output) > 0) {
+          cluster.results.push_back(output);
+        }
+      }
+    }
+  }
+}
+
+// Bucketed clusters are keyed by what their lowering depends on, which is not
+// the shape of the nodes. Other nodes are keyed by their hash and shape, as the
+// hash of a node with operands does not cover its shape.
+size_t GetNodeKey(const ir::Node* node, bool bucketed) {
+  if (!bucketed) {
+    return xla::util::HashCombine(node->node_hash(),
+                                  xla::util::ShapeHash(node->shape()));
+  }
+  size_t key = xla::util::MHash(node->op().hash(),
+                                static_cast<int>(node->shape().element_type()));
+  const ir::ops::Scalar* scalar = dynamic_cast<const ir::ops::Scalar*>(node);
+  if (scalar != nullptr) {
+    return xla::util::HashCombine(key, ir::ops::ScalarHash(scalar->value()));
+  }
+  const ir::ops::Cast* cast = dynamic_cast<const ir::ops::Cast*>(node);
+  if (cast != nullptr) {
+    return xla::util::HashCombine(key, static_cast<int>(cast->dtype()));
+  }
+  return key;
+}
+
+size_t ComputeClusterKey(const Cluster& cluster,
+                         absl::Span<const xla::Shape* const> parameter_shapes,
+                         size_t seed) {
+  size_t key = xla::util::HashCombine(seed, cluster.bucket_size);
+  for (auto parameter_shape : parameter_shapes) {
+    key = xla::util::HashCombine(key, xla::util::ShapeHash(*parameter_shape));
+  }
+  // Besides the operations, the key captures how the nodes are wired together
+  // within the cluster, by the positions of their operands in the cluster or
+  // within the parameters.
+  std::unordered_map<const ir::Node*, size_t> node_positions;
+  for (size_t i = 0; i < cluster.nodes.size(); ++i) {
+    const ir::Node* node = cluster.nodes[i];
+    node_positions[node] = i;
+    key = xla::util::HashCombine(key,
+                                 GetNodeKey(node, cluster.bucket_size > 0));
+    for (auto& operand : node->operands()) {
+      auto it = node_positions.find(operand.node);
+      if (it != node_positions.end()) {
+        key = xla::util::HashCombine(key, xla::util::MHash(it->second,
+                                                           operand.index));
+      } else {
+        auto param_it = std::find(cluster.parameters.begin(),
+                                  cluster.parameters.end(), operand);
+        key = xla::util::HashCombine(
+            key, xla::util::MHash(cluster.nodes.size(),
+                                  param_it - cluster.parameters.begin()));
+      }
+    }
+  }
+  for (auto& result : cluster.results) {
+    key = xla::util::HashCombine(
+        key, xla::util::MHash(node_positions.at(result.node), result.index));
+  }
+  return key;
 }
 
-size_t ComputeNodeKey(const ir::Node* node,
-                      absl::Span<const xla::Shape* const> input_shapes,
-                      size_t seed) {
-  size_t key = seed;
-  const auto& operands = node->operands();
-  for (size_t i = 0; i < operands.size(); ++i) {
-    key = xla::util::HashCombine(key, xla::util::ShapeHash(GetParameterShape(
-                                          operands[i], *input_shapes[i])));
+// Lowers a full reduction of a bucketed value, whose padding elements are
+// masked out by comparing their indices with the number of elements.
+xla::XlaOp LowerBucketedReduction(const ir::Node* node, xla::XlaOp input,
+                                  xla::XlaOp num_elements) {
+  xla::PrimitiveType type = node->shape().element_type();
+  bool is_mean = dynamic_cast<const ir::ops::Mean*>(node) != nullptr;
+  xla::PrimitiveType sum_type =
+      is_mean ? XlaHelpers::TypeOfXlaOp(input) : type;
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp mask = xla::Lt(
+      xla::Iota(builder, xla::S32, input_shape.dimensions(0)), num_elements);
+  xla::XlaOp zero = xla::Zero(builder, sum_type);
+  xla::XlaOp masked_input =
+      xla::Select(mask, xla::ConvertElementType(input, sum_type),
+                  xla::Broadcast(zero, input_shape.dimensions()));
+  xla::XlaOp result =
+      xla::Reduce(masked_input, zero,
+                  XlaHelpers::CreateAddComputation(sum_type), {0});
+  if (is_mean) {
+    result = xla::Div(result, xla::ConvertElementType(num_elements, sum_type));
   }
-  key = xla::util::HashCombine(key, xla::util::ShapeHash(node->shape()));
-  return xla::util::HashCombine(key, node->node_hash());
+  return xla::ConvertElementType(result, type);
 }
 
-xla::XlaComputation BuildNodeComputation(
-    const ir::Node* node, absl::Span<const xla::Shape* const> input_shapes,
-    const Device& device) {
-  ir::LoweringContext loctx("BuildNodeComputation");
-  const auto& operands = node->operands();
-  for (size_t i = 0; i < operands.size(); ++i) {
-    xla::XlaOp param = xla::Parameter(
-        loctx.builder(), i, GetParameterShape(operands[i], *input_shapes[i]),
-        absl::StrCat("p", i));
-    loctx.AssignOutputOp(operands[i], param);
+xla::XlaComputation BuildClusterComputation(
+    const Cluster& cluster,
+    absl::Span<const xla::Shape* const> parameter_shapes) {
+  ir::LoweringContext loctx("BuildClusterComputation");
+  for (size_t i = 0; i < cluster.parameters.size(); ++i) {
+    xla::XlaOp param = xla::Parameter(loctx.builder(), i, *parameter_shapes[i],
+                                      absl::StrCat("p", i));
+    loctx.AssignOutputOp(cluster.parameters[i], param);
   }
-  for (auto& xla_op : loctx.LowerNode(node)) {
-    loctx.AddResult(xla_op);
+  // Bucketed clusters with reductions take the actual number of elements of
+  // their values as last parameter.
+  xla::XlaOp num_elements;
+  if (parameter_shapes.size() > cluster.parameters.size()) {
+    num_elements = xla::Parameter(loctx.builder(), cluster.parameters.size(),
+                                  *parameter_shapes.back(), "num_elements");
   }
+  for (auto node : cluster.nodes) {
+    const ir::ops::Scalar* scalar = dynamic_cast<const ir::ops::Scalar*>(node);
+    if (cluster.bucket_size > 0 && scalar != nullptr) {
+      xla::XlaOp value = XlaHelpers::ScalarValue(
+          scalar->value(), node->shape().element_type(), loctx.builder());
+      loctx.AssignOutputOp(ir::Output(node, 0),
+                           xla::Broadcast(value, {cluster.bucket_size}));
+    } else if (cluster.bucket_size > 0 && IsFullReduction(node)) {
+      loctx.AssignOutputOp(
+          ir::Output(node, 0),
+          LowerBucketedReduction(node, loctx.GetOutputOp(node->operand(0)),
+                                 num_elements));
+    } else {
+      loctx.LowerNode(node);
+    }
+  }
+  for (auto& result : cluster.results) {
+    loctx.AddResult(loctx.GetOutputOp(result));
+  }
+  return ConsumeValue(loctx.Build());
+}
+
+// Flattens a value and pads it to the bucket size.
+xla::XlaComputation BuildBucketComputation(const xla::Shape& shape,
+                                           xla::int64 bucket_size) {
+  ir::LoweringContext loctx("BuildBucketComputation");
+  xla::XlaOp param = xla::Parameter(loctx.builder(), 0, shape, "p0");
+  xla::int64 num_elements = xla::ShapeUtil::ElementsIn(shape);
+  xla::XlaOp flat = xla::Reshape(param, {num_elements});
+  loctx.AddResult(xla::PadInDim(
+      flat, xla::Zero(loctx.builder(), shape.element_type()), 0,
+      /*pad_lo=*/0, /*pad_hi=*/bucket_size - num_elements));
+  return ConsumeValue(loctx.Build());
+}
+
+// Drops the padding of a bucketed value, and restores its shape.
+xla::XlaComputation BuildUnbucketComputation(const xla::Shape& bucket_shape,
+                                             const xla::Shape& shape) {
+  ir::LoweringContext loctx("BuildUnbucketComputation");
+  xla::XlaOp param = xla::Parameter(loctx.builder(), 0, bucket_shape, "p0");
+  xla::XlaOp flat = xla::SliceInDim(param, 0, xla::ShapeUtil::ElementsIn(shape),
+                                    1, 0);
+  loctx.AddResult(xla::Reshape(flat, shape.dimensions()));
   return ConsumeValue(loctx.Build());
 }
 
@@ -90,10 +444,167 @@ size_t GetNodesKeySeed(const std::string& device,
   return xla::util::MHash(device, devices);
 }
 
+std::string GetClusterKind(const Cluster& cluster) {
+  std::string kind = cluster.nodes.size() == 1
+                         ? cluster.nodes.front()->op().ToString()
+                         : "cluster";
+  return cluster.bucket_size > 0 ? absl::StrCat(kind, ".bucketed") : kind;
+}
+
+// The compile cache hits and misses of the ops of a given kind, which show up
+// in the metrics report as OpByOpCacheHit.<kind> and OpByOpCacheMiss.<kind>.
+struct KindCounters {
+  explicit KindCounters(const std::string& kind)
+      : hits(absl::StrCat("OpByOpCacheHit.", kind)),
+        misses(absl::StrCat("OpByOpCacheMiss.", kind)) {}
+
+  xla::metrics::Counter hits;
+  xla::metrics::Counter misses;
+};
+
+KindCounters* GetKindCounters(const std::string& kind) {
+  static std::mutex* lock = new std::mutex();
+  static auto* counters =
+      new std::map<std::string, std::unique_ptr<KindCounters>>();
+  std::lock_guard<std::mutex> guard(*lock);
+  auto it = counters->find(kind);
+  if (it == counters->end()) {
+    it = counters->emplace(kind, absl::make_unique<KindCounters>(kind)).first;
+  }
+  return it->second.get();
+}
+
+// Accumulates the chained ops of an execution, looking up their computations
+// within the compile cache, and batching the compilation of the missing ones.
+class ChainedOpsBuilder {
+ public:
+  using CompileCache =
+      xla::util::Cache<size_t, xla::ComputationClient::Computation>;
+
+  ChainedOpsBuilder(CompileCache* compile_cache, const std::string& device,
+                    std::vector<std::string> compilation_devices)
+      : compile_cache_(compile_cache),
+        device_(device),
+        compilation_devices_(std::move(compilation_devices)) {}
+
+  size_t AddDeviceData(xla::ComputationClient::DataPtr device_data) {
+    ops_shapes_.push_back(&device_data->shape());
+    ops_.emplace_back();
+    ops_.back().device_data = std::move(device_data);
+    return ops_.size() - 1;
+  }
+
+  // Adds an op running the computation built by build_fn, whose results are
+  // wrapped in a tuple.
+  size_t AddComputation(size_t cache_key, const std::string& kind,
+                        std::vector<ChainedInput> inputs,
+                        const std::function<xla::XlaComputation()>& build_fn) {
+    size_t index = ops_.size();
+    xla::ComputationClient::ExecuteChainedOp op;
+    op.inputs = std::move(inputs);
+    op.computation = compile_cache_->Get(cache_key);
+    if (op.computation != nullptr) {
+      GetKindCounters(kind)->hits.AddValue(1);
+      ops_shapes_.push_back(&op.computation->program_shape().result());
+    } else {
+      XLA_COUNTER("OpByOpCompileCacheMiss", 1);
+      GetKindCounters(kind)->misses.AddValue(1);
+
+      // Within a single IR graph, there can be many duplicated IR nodes, so
+      // make sure we do not issue an XLA compilation for each one of those.
+      auto& cache_key_indices = compile_indices_[cache_key];
+      cache_key_indices.push_back(index);
+      if (cache_key_indices.size() == 1) {
+        cache_keys_.push_back(cache_key);
+        cache_keys_instance_[cache_key] = compile_instances_.size();
+
+        xla::XlaComputation computation = build_fn();
+        xla::ProgramShape program_shape =
+            ConsumeValue(computation.GetProgramShape());
+        compile_shapes_.push_back(MakeShapeWithDeviceLayout(
+            program_shape.result(), Device(device_).hw_type));
+        compile_instances_.push_back({std::move(computation), device_,
+                                      compilation_devices_,
+                                      &compile_shapes_.back()});
+        ops_shapes_.push_back(&compile_shapes_.back());
+      } else {
+        ops_shapes_.push_back(
+            compile_instances_[cache_keys_instance_.at(cache_key)]
+                .output_shape);
+      }
+    }
+    ops_.push_back(std::move(op));
+    return index;
+  }
+
+  const xla::Shape& GetShape(const ChainedInput& input) const {
+    const xla::Shape* shape = ops_shapes_[input.op_index];
+    return input.output_index
+               ? xla::ShapeUtil::GetTupleElementShape(*shape,
+                                                      *input.output_index)
+               : *shape;
+  }
+
+  void AddOutput(const ChainedInput& input, size_t result_index) {
+    ops_[input.op_index].outputs.push_back(
+        {result_index, input.output_index});
+  }
+
+  // Compiles the computations which missed the cache, and returns the ops.
+  std::vector<xla::ComputationClient::ExecuteChainedOp> Build() {
+    if (!compile_instances_.empty()) {
+      TF_VLOG(3) << "Compiling " << compile_instances_.size()
+                 << " computations on device " << device_;
+      auto computation_ptrs = xla::ComputationClient::Get()->Compile(
+          std::move(compile_instances_));
+      TF_VLOG(3) << "Compiling " << computation_ptrs.size()
+                 << " computations on device " << device_ << " done!";
+      for (size_t i = 0; i < computation_ptrs.size(); ++i) {
+        compile_cache_->Add(cache_keys_[i], computation_ptrs[i]);
+        for (auto index : compile_indices_[cache_keys_[i]]) {
+          ops_[index].computation = computation_ptrs[i];
+        }
+      }
+    }
+    return std::move(ops_);
+  }
+
+ private:
+  CompileCache* compile_cache_;
+  std::string device_;
+  std::vector<std::string> compilation_devices_;
+  std::vector<xla::ComputationClient::ExecuteChainedOp> ops_;
+  std::vector<const xla::Shape*> ops_shapes_;
+  std::vector<size_t> cache_keys_;
+  std::unordered_map<size_t, std::vector<size_t>> compile_indices_;
+  std::unordered_map<size_t, size_t> cache_keys_instance_;
+  std::list<xla::Shape> compile_shapes_;
+  std::vector<xla::ComputationClient::CompileInstance> compile_instances_;
+};
+
 }  // namespace
 
-OpByOpExecutor::OpByOpExecutor(size_t compile_cache_size)
-    : compile_cache_(compile_cache_size) {}
+OpByOpExecutor::OpByOpExecutor(size_t compile_cache_size,
+                               size_t max_cluster_size, bool shape_bucketing)
+    : compile_cache_(compile_cache_size),
+      max_cluster_size_(std::max<size_t>(max_cluster_size, 1)),
+      shape_bucketing_(shape_bucketing),
+      num_elements_data_(kNumElementsCacheSize) {}
+
+xla::ComputationClient::DataPtr OpByOpExecutor::GetNumElementsData(
+    const std::string& device, xla::int64 num_elements) {
+  NumElementsKey key(device, num_elements);
+  xla::ComputationClient::DataPtr data = num_elements_data_.Get(key);
+  if (data == nullptr) {
+    xla::int32 value = num_elements;
+    data = num_elements_data_.Add(
+        std::move(key),
+        TensorToXlaData(
+            MakeTensorFromHostBuffer(at::ScalarType::Int, &value, {}),
+            Device(device)));
+  }
+  return data;
+}
 
 std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
     absl::Span<const ir::Value> roots, const std::string& device,
@@ -108,100 +619,109 @@ std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
   XLA_VALUE_METRIC("OpByOpGraphSize", post_order.size());
   TF_VLOG(5) << "TensorsGraphSize=" << post_order.size();
 
-  std::unordered_map<const ir::Node*, size_t> node_to_index;
-  node_to_index.reserve(post_order.size());
-  for (size_t i = 0; i < post_order.size(); ++i) {
-    node_to_index[post_order[i]] = i;
+  std::unordered_map<const ir::Node*, size_t> node_to_cluster;
+  node_to_cluster.reserve(post_order.size());
+  std::vector<Cluster> clusters =
+      BuildClusters(post_order, max_cluster_size_, &node_to_cluster);
+  ComputeClusterInterfaces(roots, node_to_cluster, &clusters);
+  if (shape_bucketing_) {
+    AssignClusterBuckets(&clusters);
   }
+  XLA_VALUE_METRIC("OpByOpClusters", clusters.size());
+  TF_VLOG(5) << "OpByOpClusters=" << clusters.size();
 
   auto compilation_devices =
       xla::ComputationClient::Get()->GetCompilationDevices(device, devices);
   size_t nodes_key_seed = GetNodesKeySeed(device, compilation_devices);
-  Device exec_device(device);
-  std::vector<size_t> cache_keys;
-  std::unordered_map<size_t, std::vector<size_t>> compile_indices;
-  std::unordered_map<size_t, size_t> cache_keys_instance;
-  std::list<xla::Shape> compile_shapes;
-  std::vector<bool> device_data_ops(post_order.size());
-  std::vector<const xla::Shape*> ops_shapes(post_order.size());
-  std::vector<xla::ComputationClient::CompileInstance> compile_instances;
-  std::vector<xla::ComputationClient::ExecuteChainedOp> chained_exec_ops(
-      post_order.size());
-  for (size_t i = 0; i < post_order.size(); ++i) {
-    const ir::Node* node = post_order[i];
-    xla::ComputationClient::ExecuteChainedOp& cxop = chained_exec_ops[i];
+  ChainedOpsBuilder builder(&compile_cache_, device, compilation_devices);
+
+  // Where every output used across clusters is found within the chained ops,
+  // in the exact and in the bucketed form. The outputs of a cluster computation
+  // are wrapped into a tuple, so we need to use the index of the output within
+  // the cluster results to extract it. Device data instead is already
+  // unwrapped, so we need to pass an empty index so that TF/XRT code uses the
+  // result buffer directly.
+  ir::OutputMap<ChainedInput> exact_values;
+  ir::OutputMap<ChainedInput> bucketed_values;
+  auto get_exact_value = [&](const ir::Output& output) {
+    auto it = exact_values.find(output);
+    if (it != exact_values.end()) {
+      return it->second;
+    }
+    const ChainedInput& bucketed_value = bucketed_values.at(output);
+    const xla::Shape& bucket_shape = builder.GetShape(bucketed_value);
+    const xla::Shape& shape = output.shape();
+    size_t cache_key = xla::util::MHash(nodes_key_seed, "unbucket",
+                                        xla::util::ShapeHash(bucket_shape),
+                                        xla::util::ShapeHash(shape));
+    size_t op_index = builder.AddComputation(
+        cache_key, "unbucket", {bucketed_value},
+        [&]() { return BuildUnbucketComputation(bucket_shape, shape); });
+    return exact_values.emplace(output, ChainedInput{op_index, 0})
+        .first->second;
+  };
+  auto get_bucketed_value = [&](const ir::Output& output,
+                                xla::int64 bucket_size) {
+    auto it = bucketed_values.find(output);
+    if (it != bucketed_values.end()) {
+      return it->second;
+    }
+    ChainedInput exact_value = get_exact_value(output);
+    const xla::Shape& shape = builder.GetShape(exact_value);
+    size_t cache_key = xla::util::MHash(
+        nodes_key_seed, "bucket", xla::util::ShapeHash(shape), bucket_size);
+    size_t op_index = builder.AddComputation(
+        cache_key, "bucket", {exact_value},
+        [&]() { return BuildBucketComputation(shape, bucket_size); });
+    return bucketed_values.emplace(output, ChainedInput{op_index, 0})
+        .first->second;
+  };
+
+  for (auto& cluster : clusters) {
     const ir::ops::DeviceData* device_data =
-        dynamic_cast<const ir::ops::DeviceData*>(node);
+        dynamic_cast<const ir::ops::DeviceData*>(cluster.nodes.front());
     if (device_data != nullptr) {
-      cxop.device_data = device_data->data();
-      ops_shapes[i] = &cxop.device_data->shape();
-      device_data_ops[i] = true;
-    } else {
-      std::vector<const xla::Shape*> op_input_shapes;
-      for (auto& operand : node->operands()) {
-        size_t op_index = node_to_index.at(operand.node);
-        cxop.inputs.push_back(
-            {op_index,
-             GetOutputIndex(device_data_ops[op_index], operand.index)});
-        op_input_shapes.push_back(ops_shapes[op_index]);
-      }
+      size_t op_index = builder.AddDeviceData(device_data->data());
+      exact_values.emplace(ir::Output(device_data, 0),
+                           ChainedInput{op_index, absl::nullopt});
+      continue;
+    }
+    bool bucketed = cluster.bucket_size > 0;
+    std::vector<ChainedInput> inputs;
+    std::vector<const xla::Shape*> parameter_shapes;
+    for (auto& parameter : cluster.parameters) {
+      inputs.push_back(bucketed && parameter.shape().rank() > 0
+                           ? get_bucketed_value(parameter, cluster.bucket_size)
+                           : get_exact_value(parameter));
+      parameter_shapes.push_back(&builder.GetShape(inputs.back()));
+    }
+    if (bucketed && HasFullReduction(cluster)) {
+      inputs.push_back({builder.AddDeviceData(
+                            GetNumElementsData(device, cluster.num_elements)),
+                        absl::nullopt});
+      parameter_shapes.push_back(&builder.GetShape(inputs.back()));
+    }
 
-      size_t cache_key = ComputeNodeKey(node, op_input_shapes, nodes_key_seed);
-      cxop.computation = compile_cache_.Get(cache_key);
-      if (cxop.computation == nullptr) {
-        XLA_COUNTER("OpByOpCompileCacheMiss", 1);
-
-        // Within a single IR graph, there can be many duplicated IR nodes, so
-        // make sure we do not issue an XLA compilation for each one of those.
-        auto& cache_key_indices = compile_indices[cache_key];
-        cache_key_indices.push_back(i);
-        if (cache_key_indices.size() == 1) {
-          cache_keys.push_back(cache_key);
-          cache_keys_instance[cache_key] = compile_instances.size();
-
-          xla::XlaComputation computation =
-              BuildNodeComputation(node, op_input_shapes, exec_device);
-          xla::ProgramShape program_shape =
-              ConsumeValue(computation.GetProgramShape());
-          compile_shapes.push_back(MakeShapeWithDeviceLayout(
-              program_shape.result(), exec_device.hw_type));
-          compile_instances.push_back({std::move(computation), device,
-                                       compilation_devices,
-                                       &compile_shapes.back()});
-          ops_shapes[i] = &compile_shapes.back();
-        } else {
-          ops_shapes[i] =
-              compile_instances[cache_keys_instance.at(cache_key)].output_shape;
-        }
-      } else {
-        ops_shapes[i] = &cxop.computation->program_shape().result();
-      }
+    size_t cache_key =
+        ComputeClusterKey(cluster, parameter_shapes, nodes_key_seed);
+    size_t op_index = builder.AddComputation(
+        cache_key, GetClusterKind(cluster), std::move(inputs), [&]() {
+          return BuildClusterComputation(cluster, parameter_shapes);
+        });
+    for (size_t i = 0; i < cluster.results.size(); ++i) {
+      const ir::Output& result = cluster.results[i];
+      auto& values = bucketed && result.shape().rank() > 0 ? bucketed_values
+                                                             : exact_values;
+      values.emplace(result, ChainedInput{op_index, i});
     }
   }
   // Fixup the requested outputs (roots) within the chained ops vector.
   for (size_t i = 0; i < roots.size(); ++i) {
-    size_t op_index = node_to_index.at(roots[i].node.get());
-    chained_exec_ops[op_index].outputs.push_back(
-        {i, GetOutputIndex(device_data_ops[op_index], roots[i].index)});
+    builder.AddOutput(get_exact_value(roots[i]), i);
   }
-
   // If we missed the cache for certain ops, compile them now and fixup the
   // chained ops vector.
-  if (!compile_instances.empty()) {
-    TF_VLOG(3) << "Compiling " << compile_instances.size()
-               << " computations on device " << device;
-    auto computation_ptrs =
-        xla::ComputationClient::Get()->Compile(std::move(compile_instances));
-    TF_VLOG(3) << "Compiling " << computation_ptrs.size()
-               << " computations on device " << device << " done!";
-    for (size_t i = 0; i < computation_ptrs.size(); ++i) {
-      compile_cache_.Add(cache_keys[i], computation_ptrs[i]);
-      for (auto index : compile_indices[cache_keys[i]]) {
-        chained_exec_ops[index].computation = computation_ptrs[i];
-      }
-    }
-  }
-  return chained_exec_ops;
+  return builder.Build();
 }
 
 std::vector<xla::ComputationClient::DataPtr> OpByOpExecutor::Execute(
@@ -229,8 +749,12 @@ OpByOpExecutor::AsyncTask OpByOpExecutor::ExecuteAsync(
 OpByOpExecutor* OpByOpExecutor::Get() {
   static const xla::int64 compile_cache_size =
       xla::sys_util::GetEnvInt("SPLIT_EXECUTOR_CACHE_SIZE", 2048);
-  static OpByOpExecutor* split_executor =
-      new OpByOpExecutor(compile_cache_size);
+  static const xla::int64 max_cluster_size =
+      xla::sys_util::GetEnvInt("SPLIT_EXECUTOR_CLUSTER_SIZE", 1);
+  static const bool shape_bucketing =
+      xla::sys_util::GetEnvBool("SPLIT_EXECUTOR_SHAPE_BUCKETING", false);
+  static OpByOpExecutor* split_executor = new OpByOpExecutor(
+      compile_cache_size, max_cluster_size, shape_bucketing);
   return split_executor;
 }
 
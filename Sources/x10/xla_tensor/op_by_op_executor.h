@@ -17,12 +17,14 @@
 #pragma once
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/types/span.h"
 #include "tensorflow/compiler/xla/xla_client/async_task.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 #include "tensorflow/compiler/xla/types.h"
 
@@ -32,6 +34,19 @@ namespace swift_xla {
 // allows to run an IR graph is per-IR-node isolation mode. Instead of lowering
 // the whole IR graph in a single XLA computation, the single IR nodes are
 // lowered and executed independently.
+//
+// When the maximum cluster size is greater than one, runs of consecutive
+// elementwise and reduction nodes within the post-order are instead grouped in
+// clusters, which are lowered, compiled and cached as a single computation, so
+// that XLA can fuse them. This keeps the small compilations of the op-by-op
+// mode, while avoiding a device memory round trip for every node of the
+// cluster.
+//
+// With shape bucketing, the elementwise operations and the full reductions are
+// run on their values flattened, and padded to the next power of two number of
+// elements, so that the same kernel serves many shapes instead of one. Values
+// are converted from and to such form only when flowing into and out of the
+// bucketed kernels.
 class OpByOpExecutor {
  public:
   using AsyncResult = std::vector<xla::ComputationClient::DataPtr>;
@@ -39,6 +54,12 @@ class OpByOpExecutor {
 
   static OpByOpExecutor* Get();
 
+  // Creates an executor with its own compile cache. Besides the one returned
+  // by Get(), which is configured by the environment, executors are only meant
+  // to be created by tests and benchmarks.
+  OpByOpExecutor(size_t compile_cache_size, size_t max_cluster_size,
+                 bool shape_bucketing);
+
   std::vector<xla::ComputationClient::ExecuteChainedOp> BuildOps(
       absl::Span<const ir::Value> roots, const std::string& device,
       absl::Span<const std::string> devices);
@@ -55,9 +76,28 @@ class OpByOpExecutor {
   using CompileCache =
       xla::util::Cache<size_t, xla::ComputationClient::Computation>;
 
-  explicit OpByOpExecutor(size_t compile_cache_size);
+  // The device and the number of elements of a bucketed value.
+  using NumElementsKey = std::pair<std::string, xla::int64>;
+
+  struct NumElementsKeyHash {
+    size_t operator()(const NumElementsKey& key) const {
+      return xla::util::MHash(key.first, key.second);
+    }
+  };
+
+  using NumElementsCache =
+      xla::util::Cache<NumElementsKey, xla::ComputationClient::Data,
+                       NumElementsKeyHash>;
+
+  // Returns the device data holding the actual number of elements of bucketed
+  // values, which the bucketed reductions need to skip the padding.
+  xla::ComputationClient::DataPtr GetNumElementsData(const std::string& device,
+                                                     xla::int64 num_elements);
 
   CompileCache compile_cache_;
+  size_t max_cluster_size_;
+  bool shape_bucketing_;
+  NumElementsCache num_elements_data_;
 };
 
 }  // namespace swift_xla
@@ -19,6 +19,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/reduction.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
 
@@ -34,7 +35,11 @@ xla::Shape NodeOutputShape(const Value& input,
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return BuildAll(operands[0], dimensions, keep_reduced_dimensions);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return ReduceShape(input.shape(), dimensions, keep_reduced_dimensions,
+                       input.shape().element_type());
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
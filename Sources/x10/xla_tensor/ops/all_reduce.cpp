@@ -47,20 +47,22 @@ std::vector<Value> GetOperandList(absl::Span<const Value> operands,
 
 AllReduce::AllReduce(AllReduceType reduce_type,
                      absl::Span<const Value> operands, const Value& token,
-                     double scale, std::vector<std::vector<xla::int64>> groups)
+                     double scale, std::vector<std::vector<xla::int64>> groups,
+                     DeviceType hw_type)
     : Node(xla_cross_replica_sum, GetOperandList(operands, token),
            [&]() { return NodeOutputShape(operands, token); },
            /*num_outputs=*/operands.size() + 1,
            xla::util::MHash(xla::util::GetEnumValue(reduce_type), scale,
-                            groups)),
+                            groups, xla::util::GetEnumValue(hw_type))),
       reduce_type_(reduce_type),
       scale_(scale),
-      groups_(std::move(groups)) {}
+      groups_(std::move(groups)),
+      hw_type_(hw_type) {}
 
 NodePtr AllReduce::Clone(OpList operands) const {
   std::vector<Value> operand_list(operands.begin(), operands.end() - 1);
   return MakeNode<AllReduce>(reduce_type_, operand_list, operands.back(),
-                             scale_, groups_);
+                             scale_, groups_, hw_type_);
 }
 
 XlaOpVector AllReduce::Lower(LoweringContext* loctx) const {
@@ -71,8 +73,9 @@ XlaOpVector AllReduce::Lower(LoweringContext* loctx) const {
     inputs.push_back(loctx->GetOutputOp(operand_list[i]));
   }
   xla::XlaOp token = loctx->GetOutputOp(operand_list.back());
-  return ReturnOps(BuildAllReduce(reduce_type_, inputs, token, scale_, groups_),
-                   loctx);
+  return ReturnOps(
+      BuildAllReduce(reduce_type_, inputs, token, scale_, groups_, hw_type_),
+      loctx);
 }
 
 std::string AllReduce::ToString() const {
@@ -84,7 +87,7 @@ std::string AllReduce::ToString() const {
     ss << (i == 0 ? "(" : ",(");
     ss << absl::StrJoin(groups_[i], ", ") << ")";
   }
-  ss << ")";
+  ss << "), hw_type=" << xla::util::GetEnumValue(hw_type_);
   return ss.str();
 }
 
@@ -27,7 +27,7 @@ class AllReduce : public Node {
  public:
   AllReduce(AllReduceType reduce_type, absl::Span<const Value> operands,
             const Value& token, double scale,
-            std::vector<std::vector<xla::int64>> groups);
+            std::vector<std::vector<xla::int64>> groups, DeviceType hw_type);
 
   std::string ToString() const override;
 
@@ -41,10 +41,15 @@ class AllReduce : public Node {
 
   const std::vector<std::vector<xla::int64>>& groups() const { return groups_; }
 
+  // The type of the devices the reduction runs on, which its lowering depends
+  // on.
+  DeviceType hw_type() const { return hw_type_; }
+
  private:
   AllReduceType reduce_type_;
   double scale_;
   std::vector<std::vector<xla::int64>> groups_;
+  DeviceType hw_type_;
 };
 
 }  // namespace ops
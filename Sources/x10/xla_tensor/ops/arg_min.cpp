@@ -17,6 +17,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/reduction.h"
 
 namespace swift_xla {
@@ -29,7 +30,10 @@ xla::Shape NodeOutputShape(const Value& input, xla::int64 dim, bool keepdim) {
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return BuildArgMin(operands[0], dim, keepdim);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return ArgReduceShape(input.shape(), dim, keepdim);
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
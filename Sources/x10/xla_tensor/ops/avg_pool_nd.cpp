@@ -19,6 +19,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/pooling.h"
 
 namespace swift_xla {
@@ -39,7 +40,11 @@ xla::Shape NodeOutputShape(const Value& input, xla::int64 spatial_dim_count,
     return BuildAvgPoolNd(operands[0], spatial_dim_count, kernel_size, stride,
                           padding, ceil_mode, count_include_pad);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return PoolNdShape(input.shape(), spatial_dim_count, kernel_size, stride,
+                       padding, ceil_mode);
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 c10::Symbol AvgPoolNdSymbol(xla::int64 spatial_dim_count) {
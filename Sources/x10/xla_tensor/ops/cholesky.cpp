@@ -15,7 +15,9 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/cholesky.h"
 
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
@@ -34,8 +36,11 @@ NodePtr Cholesky::Clone(OpList operands) const {
 
 XlaOpVector Cholesky::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  xla::XlaOp output =
-      xla::Triangle(xla::Cholesky(input, /*lower=*/lower_), /*lower=*/lower_);
+  xla::XlaOp factor =
+      UseSmallMatrixLowering(XlaHelpers::ShapeOfXlaOp(input))
+          ? BuildSmallCholesky(input, /*lower=*/lower_)
+          : xla::Cholesky(input, /*lower=*/lower_);
+  xla::XlaOp output = xla::Triangle(factor, /*lower=*/lower_);
   return ReturnOp(output, loctx);
 }
 
@@ -16,20 +16,38 @@
 
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/data_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/einsum_planner.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 
 namespace swift_xla {
 namespace ir {
 namespace ops {
 namespace {
 
+// xla::Einsum only handles two operands in the explicit form; everything else
+// goes through the einsum planner.
+bool UsesEinsumPlan(size_t num_operands, const std::string& equation) {
+  return num_operands != 2 || equation.find("->") == std::string::npos;
+}
+
 xla::Shape NodeOutputShape(absl::Span<const ir::Value> values,
                            const std::string& equation) {
-  XLA_CHECK_EQ(values.size(), 2)
-      << "Only two inputs supported for einsum for now";
+  if (UsesEinsumPlan(values.size(), equation)) {
+    std::vector<xla::Shape> shapes;
+    for (auto& value : values) {
+      shapes.push_back(value.shape());
+      XLA_CHECK(xla::ShapeUtil::SameElementType(shapes[0], shapes.back()))
+          << shapes[0] << " and " << shapes.back();
+    }
+    std::shared_ptr<const EinsumPlan> plan = GetEinsumPlan(equation, shapes);
+    return xla::ShapeUtil::MakeShape(shapes[0].element_type(),
+                                     plan->output_sizes);
+  }
   auto lower_for_shape_fn =
       [equation](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return xla::Einsum(operands[0], operands[1], equation,
@@ -40,7 +58,10 @@ xla::Shape NodeOutputShape(absl::Span<const ir::Value> values,
   for (auto& value : values) {
     shapes.push_back(value.shape());
   }
-  return InferOutputShape(shapes, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return EinsumShape(shapes[0], shapes[1], equation);
+  };
+  return InferOutputShape(shapes, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
@@ -56,6 +77,18 @@ NodePtr Einsum::Clone(OpList operands) const {
 }
 
 XlaOpVector Einsum::Lower(LoweringContext* loctx) const {
+  if (UsesEinsumPlan(operands().size(), equation_)) {
+    // Equations with more operands are contracted pairwise, in the order
+    // computed from the operand shapes, which also determined the node shape.
+    std::vector<xla::XlaOp> inputs;
+    std::vector<xla::Shape> shapes;
+    for (auto& input : operands()) {
+      inputs.push_back(loctx->GetOutputOp(input));
+      shapes.push_back(input.shape());
+    }
+    return ReturnOp(BuildEinsum(inputs, *GetEinsumPlan(equation_, shapes)),
+                    loctx);
+  }
   xla::XlaOp output = xla::Einsum(loctx->GetOutputOp(operand(0)),
                                   loctx->GetOutputOp(operand(1)), equation_,
                                   XlaHelpers::mat_mul_precision());
@@ -19,6 +19,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/xla/client/lib/slicing.h"
 
 namespace swift_xla {
@@ -33,7 +34,11 @@ xla::Shape NodeOutputShape(const Value& input, const Value& index,
     return xla::TorchGather(operands[0], operands[1], dim,
                             IsSparseGather(operands[0], operands[1], dim));
   };
-  return InferOutputShape({input.shape(), index.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return GatherShape(input.shape(), index.shape(), dim);
+  };
+  return InferOutputShape({input.shape(), index.shape()}, lower_for_shape_fn,
+                          shape_fn);
 }
 
 }  // namespace
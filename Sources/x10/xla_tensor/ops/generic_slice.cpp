@@ -19,6 +19,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/data_ops.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
 
 namespace swift_xla {
@@ -33,7 +34,16 @@ xla::Shape NodeOutputShape(const Value& input,
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return BuildSlice(operands[0], base_indices, sizes);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    std::vector<xla::int64> limit_indices(base_indices.begin(),
+                                          base_indices.end());
+    for (size_t i = 0; i < limit_indices.size(); ++i) {
+      limit_indices[i] += sizes.at(i);
+    }
+    return SliceShape(input.shape(), base_indices, limit_indices,
+                      std::vector<xla::int64>(base_indices.size(), 1));
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
@@ -18,6 +18,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/xla/client/lib/slicing.h"
 
 namespace swift_xla {
@@ -31,7 +32,11 @@ xla::Shape NodeOutputShape(const Value& input, const Value& index,
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return xla::TorchIndexSelect(operands[0], operands[1], dim);
   };
-  return InferOutputShape({input.shape(), index.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return IndexSelectShape(input.shape(), index.shape(), dim);
+  };
+  return InferOutputShape({input.shape(), index.shape()}, lower_for_shape_fn,
+                          shape_fn);
 }
 
 }  // namespace
@@ -14,11 +14,34 @@
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
 
+#include <atomic>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 
 namespace swift_xla {
 namespace ir {
 namespace ops {
+namespace {
+
+std::atomic<bool>& GetShapeFunctionsEnabled() {
+  static std::atomic<bool>* enabled = new std::atomic<bool>(
+      xla::sys_util::GetEnvBool("XLA_IR_SHAPE_FUNCTIONS", true));
+  return *enabled;
+}
+
+bool AllStatic(absl::Span<const xla::Shape> shapes) {
+  for (auto& shape : shapes) {
+    if (!shape.is_static()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
 
 xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
                             const LowerForShapeFn& core_lowering_fn) {
@@ -34,6 +57,31 @@ xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
   return XlaHelpers::ShapeOfXlaOp(result);
 }
 
+xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
+                            const LowerForShapeFn& core_lowering_fn,
+                            const ShapeFn& shape_fn) {
+  if (!ShapeFunctionsEnabled() || !AllStatic(input_shapes)) {
+    return InferOutputShape(input_shapes, core_lowering_fn);
+  }
+  xla::Shape shape = shape_fn();
+  // Debug mode which validates the closed form shapes against the traced ones.
+  static const bool check_shapes =
+      xla::sys_util::GetEnvBool("XLA_CHECK_SHAPE_FUNCTIONS", false);
+  if (check_shapes) {
+    xla::Shape traced_shape = InferOutputShape(input_shapes, core_lowering_fn);
+    XLA_CHECK(xla::ShapeUtil::Equal(shape, traced_shape))
+        << "Closed form shape " << shape << " differs from traced shape "
+        << traced_shape;
+  }
+  return shape;
+}
+
+bool ShapeFunctionsEnabled() { return GetShapeFunctionsEnabled().load(); }
+
+void SetShapeFunctionsEnabled(bool enabled) {
+  GetShapeFunctionsEnabled().store(enabled);
+}
+
 }  // namespace ops
 }  // namespace ir
 }  // namespace swift_xla
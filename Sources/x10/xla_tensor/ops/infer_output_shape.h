@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "absl/types/span.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
@@ -26,10 +28,26 @@ namespace ops {
 using LowerForShapeFn =
     std::function<xla::XlaOp(absl::Span<const xla::XlaOp> operands)>;
 
+using ShapeFn = std::function<xla::Shape()>;
+
 // Compute the output shape for the given input shapes and lowering.
 xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
                             const LowerForShapeFn& core_lowering_fn);
 
+// Computes the output shape with the closed form shape_fn, when all the input
+// shapes are static. Dynamic dimensions are only tracked by the XlaBuilder, so
+// the output shape is computed by tracing core_lowering_fn otherwise, or when
+// closed form shape functions are disabled.
+xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
+                            const LowerForShapeFn& core_lowering_fn,
+                            const ShapeFn& shape_fn);
+
+// Whether the closed form shape functions are used. Defaults to the
+// XLA_IR_SHAPE_FUNCTIONS environment variable, which is true when unset.
+bool ShapeFunctionsEnabled();
+
+void SetShapeFunctionsEnabled(bool enabled);
+
 }  // namespace ops
 }  // namespace ir
 }  // namespace swift_xla
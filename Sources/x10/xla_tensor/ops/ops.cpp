@@ -31,6 +31,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/log_softmax_backward.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/permute.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/softmax_backward.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/sum.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/pooling.h"
@@ -67,10 +68,15 @@ std::string ToQualString(at::aten::SymbolKind kind) {
 
 #define PTXLA_BINARY_OP(name, sym, xla_fn)                                     \
   NodePtr name(const Value& input0, const Value& input1) {                     \
-    auto shape_fn = [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp { \
+    auto lower_for_shape_fn =                                                  \
+        [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {             \
       auto promoted = XlaHelpers::Promote(operands[0], operands[1]);           \
       return xla_fn(promoted.first, promoted.second);                          \
     };                                                                         \
+    auto shape_fn = [&]() -> xla::Shape {                                      \
+      return XlaHelpers::GetPromotedBinaryOpShape(input0.shape(),              \
+                                                  input1.shape());             \
+    };                                                                         \
     auto lower_fn = [](const Node& node,                                       \
                        LoweringContext* loctx) -> XlaOpVector {                \
       xla::XlaOp xla_input0 = loctx->GetOutputOp(node.operand(0));             \
@@ -81,7 +87,8 @@ std::string ToQualString(at::aten::SymbolKind kind) {
     return GenericOp(                                                          \
         OpKind(sym), OpList{input0, input1},                                   \
         [&]() {                                                                \
-          return InferOutputShape({input0.shape(), input1.shape()}, shape_fn); \
+          return InferOutputShape({input0.shape(), input1.shape()},            \
+                                  lower_for_shape_fn, shape_fn);               \
         },                                                                     \
         std::move(lower_fn));                                                  \
   }
@@ -180,9 +187,12 @@ NodePtr ReluOp(const Value& input) {
     XLA_CHECK_EQ(operands.size(), 1) << "Unexpected number of operands";
     return BuildRelu(operands[0]);
   };
-  return GenericOp(
-      OpKind(at::aten::relu), OpList{input},
-      [&]() { return InferOutputShape({input.shape()}, lower_for_shape_fn); },
+  auto shape_fn = [&]() -> xla::Shape { return input.shape(); };
+  return GenericOp(OpKind(at::aten::relu), OpList{input},
+                   [&]() {
+                     return InferOutputShape({input.shape()},
+                                             lower_for_shape_fn, shape_fn);
+                   },
       std::move(lower_fn));
 }
 
@@ -278,10 +288,13 @@ NodePtr AddMatMulOp(const Value& input, const Value& weight,
     XLA_CHECK_EQ(operands.size(), 2) << "Unexpected number of operands";
     return xla::Dot(operands[0], operands[1]);
   };
+  auto shape_fn = [&]() -> xla::Shape {
+    return DotShape(input.shape(), weight.shape());
+  };
   return GenericOp(OpKind(at::aten::addmm), OpList{input, weight, bias},
                    [&]() {
                      return InferOutputShape({input.shape(), weight.shape()},
-                                             lower_for_shape_fn);
+                                             lower_for_shape_fn, shape_fn);
                    },
                    std::move(lower_fn));
 }
@@ -304,10 +317,13 @@ NodePtr Dot(const Value& input, const Value& weight) {
     XLA_CHECK_EQ(operands.size(), 2) << "Unexpected number of operands";
     return xla::Dot(operands[0], operands[1]);
   };
+  auto shape_fn = [&]() -> xla::Shape {
+    return DotShape(input.shape(), weight.shape());
+  };
   return GenericOp(OpKind(at::aten::mm), OpList{input, weight},
                    [&]() {
                      return InferOutputShape({input.shape(), weight.shape()},
-                                             lower_for_shape_fn);
+                                             lower_for_shape_fn, shape_fn);
                    },
                    std::move(lower_fn));
 }
@@ -322,11 +338,14 @@ NodePtr MatMul(const Value& lhs, const Value& rhs) {
       [](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return CreateMatMul(operands[0], operands[1]);
   };
-  return GenericOp(
-      OpKind(at::aten::matmul), OpList{lhs, rhs},
-      [&]() {
-        return InferOutputShape({lhs.shape(), rhs.shape()}, lower_for_shape_fn);
-      },
+  auto shape_fn = [&]() -> xla::Shape {
+    return MatMulShape(lhs.shape(), rhs.shape());
+  };
+  return GenericOp(OpKind(at::aten::matmul), OpList{lhs, rhs},
+                   [&]() {
+                     return InferOutputShape({lhs.shape(), rhs.shape()},
+                                             lower_for_shape_fn, shape_fn);
+                   },
       std::move(lower_fn));
 }
 
@@ -367,10 +386,13 @@ NodePtr ComparisonOp(c10::Symbol kind, const Value& input, const Value& other) {
       [kind](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return BuildComparisonOp(kind, operands[0], operands[1]);
   };
+  auto shape_fn = [&]() -> xla::Shape {
+    return ComparisonOpShape(input.shape(), other.shape());
+  };
   return GenericOp(OpKind(kind), {input, other},
                    [&]() {
                      return InferOutputShape({input.shape(), other.shape()},
-                                             lower_for_shape_fn);
+                                             lower_for_shape_fn, shape_fn);
                    },
                    std::move(lower_fn));
 }
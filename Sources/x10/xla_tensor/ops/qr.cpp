@@ -18,6 +18,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/data_ops.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/qr.h"
@@ -28,6 +29,9 @@ namespace ops {
 namespace {
 
 std::vector<xla::XlaOp> LowerQR(xla::XlaOp input, bool some) {
+  if (UseSmallMatrixLowering(XlaHelpers::ShapeOfXlaOp(input))) {
+    return BuildSmallQR(input, /*full_matrices=*/!some);
+  }
   xla::QRDecompositionResult qr_result =
       xla::QRDecomposition(input, /*full_matrices=*/!some,
                            /*block_size=*/128, XlaHelpers::mat_mul_precision())
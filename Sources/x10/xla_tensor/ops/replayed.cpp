@@ -0,0 +1,60 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/replayed.h"
+
+#include <vector>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+Replayed::Replayed(OpKind op, OpList operands, xla::Shape shape,
+                   size_t num_outputs, size_t hash_seed,
+                   std::shared_ptr<const xla::XlaComputation> computation,
+                   std::string description)
+    : Node(std::move(op), operands, std::move(shape), num_outputs, hash_seed),
+      hash_seed_(hash_seed),
+      computation_(std::move(computation)),
+      description_(std::move(description)) {}
+
+std::string Replayed::ToString() const { return description_; }
+
+NodePtr Replayed::Clone(OpList operands) const {
+  return MakeNode<Replayed>(op(), operands, shape(), num_outputs(), hash_seed_,
+                            computation_, description_);
+}
+
+XlaOpVector Replayed::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> inputs;
+  for (auto& operand : operands()) {
+    inputs.push_back(loctx->GetOutputOp(operand));
+  }
+  xla::XlaOp result = xla::Call(loctx->builder(), *computation_, inputs);
+  if (num_outputs() == 1) {
+    return ReturnOp(result, loctx);
+  }
+  std::vector<xla::XlaOp> results;
+  for (size_t i = 0; i < num_outputs(); ++i) {
+    results.push_back(xla::GetTupleElement(result, i));
+  }
+  return ReturnOps(results, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/xla/client/xla_computation.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// A node rebuilt from a serialized graph (see DeserializeGraph()). It lowers to
+// a call to the computation the original node lowered to, and keeps its op
+// kind, hash and description, so that dumps and caches see the same graph.
+class Replayed : public Node {
+ public:
+  Replayed(OpKind op, OpList operands, xla::Shape shape, size_t num_outputs,
+           size_t hash_seed,
+           std::shared_ptr<const xla::XlaComputation> computation,
+           std::string description);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const xla::XlaComputation& computation() const { return *computation_; }
+
+ private:
+  size_t hash_seed_;
+  std::shared_ptr<const xla::XlaComputation> computation_;
+  std::string description_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
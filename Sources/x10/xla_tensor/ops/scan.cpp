@@ -0,0 +1,292 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scan.h"
+
+#include <limits>
+#include <sstream>
+#include <unordered_set>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(OpList operands, size_t num_carried,
+                           xla::int64 length, absl::Span<const Value> results) {
+  std::vector<xla::Shape> shapes;
+  for (size_t i = 0; i < num_carried; ++i) {
+    shapes.push_back(operands[i].shape());
+  }
+  for (size_t i = num_carried; i < results.size(); ++i) {
+    const xla::Shape& result_shape = results[i].shape();
+    std::vector<xla::int64> dimensions = {length};
+    dimensions.insert(dimensions.end(), result_shape.dimensions().begin(),
+                      result_shape.dimensions().end());
+    shapes.push_back(
+        xla::ShapeUtil::MakeShape(result_shape.element_type(), dimensions));
+  }
+  XLA_CHECK(!shapes.empty()) << "A scan needs at least one output";
+  return shapes.size() == 1 ? shapes.front()
+                            : xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+size_t GetBodyHash(size_t num_carried, xla::int64 length,
+                   absl::Span<const Value> results, bool reverse) {
+  size_t hash = xla::util::MHash(num_carried, length, reverse);
+  for (auto& result : results) {
+    hash = xla::util::HashCombine(hash, result.hash());
+  }
+  return hash;
+}
+
+// Returns the values of the body which do not depend on the parameters, and
+// are used by values which do (or are results themselves).
+std::vector<Value> GetCapturedValues(absl::Span<const NodePtr> parameters,
+                                     absl::Span<const Value> results) {
+  std::vector<const Node*> roots;
+  for (auto& result : results) {
+    roots.push_back(result.node.get());
+  }
+  std::unordered_set<const Node*> dependent;
+  for (auto& parameter : parameters) {
+    dependent.insert(parameter.get());
+  }
+  std::vector<const Node*> post_order = Util::ComputePostOrder(roots);
+  for (const Node* node : post_order) {
+    for (auto& operand : node->operands()) {
+      if (dependent.count(operand.node) > 0) {
+        dependent.insert(node);
+        break;
+      }
+    }
+  }
+  OutputSet captured_set;
+  std::vector<Value> captured;
+  auto capture = [&](const Value& value) {
+    if (dependent.count(value.node.get()) == 0 &&
+        captured_set.insert(value).second) {
+      captured.push_back(value);
+    }
+  };
+  for (const Node* node : post_order) {
+    if (dependent.count(node) > 0) {
+      for (size_t i = 0; i < node->operands().size(); ++i) {
+        capture(node->operand_value(i));
+      }
+    }
+  }
+  for (auto& result : results) {
+    capture(result);
+  }
+  return captured;
+}
+
+// Returns the operands of a dynamic slice or update along the leading
+// dimension of a value of the given rank.
+std::vector<xla::XlaOp> LeadingDimensionIndices(xla::XlaOp position,
+                                                xla::int64 rank) {
+  std::vector<xla::XlaOp> indices(
+      rank, xla::Zero(position.builder(), xla::PrimitiveType::S32));
+  indices[0] = position;
+  return indices;
+}
+
+}  // namespace
+
+Scan::Scan(OpList operands, size_t num_carried, xla::int64 length,
+           std::vector<NodePtr> parameters, std::vector<Value> results,
+           std::vector<Value> captured, bool reverse)
+    : Node(xla_scan, operands,
+           NodeOutputShape(operands, num_carried, length, results),
+           /*num_outputs=*/results.size(),
+           GetBodyHash(num_carried, length, results, reverse)),
+      num_carried_(num_carried),
+      length_(length),
+      parameters_(std::move(parameters)),
+      results_(std::move(results)),
+      captured_(std::move(captured)),
+      reverse_(reverse) {}
+
+NodePtr Scan::Create(OpList init, OpList xs, xla::int64 length,
+                     std::vector<NodePtr> parameters,
+                     std::vector<Value> results, bool reverse) {
+  XLA_CHECK_EQ(parameters.size(), init.size() + xs.size());
+  XLA_CHECK_GE(results.size(), init.size());
+  // The loop counter, and the positions of the steps, are S32 values.
+  XLA_CHECK_GE(length, 0);
+  XLA_CHECK_LE(length, std::numeric_limits<xla::int32>::max())
+      << "The length of a scan must fit in 32 bits";
+  for (size_t i = 0; i < init.size(); ++i) {
+    XLA_CHECK(xla::ShapeUtil::Compatible(parameters[i]->shape(),
+                                         init[i].shape()))
+        << parameters[i]->shape() << " vs. " << init[i].shape();
+    XLA_CHECK(xla::ShapeUtil::Compatible(results[i].shape(), init[i].shape()))
+        << "The carried value " << i << " changes shape within the body: "
+        << init[i].shape() << " vs. " << results[i].shape();
+  }
+  for (size_t i = 0; i < xs.size(); ++i) {
+    const xla::Shape& sequence_shape = xs[i].shape();
+    XLA_CHECK(sequence_shape.rank() > 0 &&
+              sequence_shape.dimensions(0) == length)
+        << "The sequence " << i << " does not have " << length
+        << " steps: " << sequence_shape;
+    xla::Shape step_shape = xla::ShapeUtil::MakeShape(
+        sequence_shape.element_type(),
+        XlaHelpers::DropDimensions(sequence_shape.dimensions(), {0}));
+    XLA_CHECK(xla::ShapeUtil::Compatible(
+        parameters[init.size() + i]->shape(), step_shape))
+        << parameters[init.size() + i]->shape() << " vs. " << step_shape;
+  }
+  std::vector<Value> captured = GetCapturedValues(parameters, results);
+  std::vector<Value> operands(init.begin(), init.end());
+  operands.insert(operands.end(), xs.begin(), xs.end());
+  operands.insert(operands.end(), captured.begin(), captured.end());
+  return MakeNode<Scan>(operands, init.size(), length, std::move(parameters),
+                        std::move(results), std::move(captured), reverse);
+}
+
+std::string Scan::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", num_carried=" << num_carried_
+     << ", length=" << length_ << ", reverse=" << reverse_;
+  return ss.str();
+}
+
+NodePtr Scan::Clone(OpList operands) const {
+  return MakeNode<Scan>(operands, num_carried_, length_, parameters_,
+                        results_, captured_, reverse_);
+}
+
+// The loop state holds the step counter, the carried values, the sequences,
+// the output sequences and the captured values, in this order.
+XlaOpVector Scan::Lower(LoweringContext* loctx) const {
+  size_t num_xs = parameters_.size() - num_carried_;
+  size_t num_ys = results_.size() - num_carried_;
+  std::vector<xla::XlaOp> state = {
+      xla::Zero(loctx->builder(), xla::PrimitiveType::S32)};
+  for (size_t i = 0; i < num_carried_ + num_xs; ++i) {
+    state.push_back(loctx->GetOutputOp(operand(i)));
+  }
+  for (size_t i = 0; i < num_ys; ++i) {
+    state.push_back(xla::Zeros(loctx->builder(), shape(num_carried_ + i)));
+  }
+  for (size_t i = num_carried_ + num_xs; i < operands().size(); ++i) {
+    state.push_back(loctx->GetOutputOp(operand(i)));
+  }
+  xla::XlaOp init = xla::Tuple(loctx->builder(), state);
+  xla::Shape state_shape = XlaHelpers::ShapeOfXlaOp(init);
+  xla::XlaOp loop = xla::While(BuildCondition(state_shape),
+                               BuildBody(state_shape), init);
+  std::vector<xla::XlaOp> outputs;
+  for (size_t i = 0; i < num_carried_; ++i) {
+    outputs.push_back(xla::GetTupleElement(loop, 1 + i));
+  }
+  for (size_t i = 0; i < num_ys; ++i) {
+    outputs.push_back(
+        xla::GetTupleElement(loop, 1 + num_carried_ + num_xs + i));
+  }
+  return ReturnOps(outputs, loctx);
+}
+
+xla::XlaComputation Scan::BuildCondition(const xla::Shape& state_shape) const {
+  xla::XlaBuilder builder("ScanCondition");
+  xla::XlaOp state = xla::Parameter(&builder, 0, state_shape, "state");
+  xla::Lt(xla::GetTupleElement(state, 0),
+          xla::ConstantR0<xla::int32>(&builder, length_));
+  return ConsumeValue(builder.Build());
+}
+
+xla::XlaComputation Scan::BuildBody(const xla::Shape& state_shape) const {
+  size_t num_xs = parameters_.size() - num_carried_;
+  size_t num_ys = results_.size() - num_carried_;
+  size_t xs_base = 1 + num_carried_;
+  size_t ys_base = xs_base + num_xs;
+  size_t captured_base = ys_base + num_ys;
+  LoweringContext loctx("ScanBody");
+  xla::XlaBuilder* builder = loctx.builder();
+  xla::XlaOp state = xla::Parameter(builder, 0, state_shape, "state");
+  xla::XlaOp step = xla::GetTupleElement(state, 0);
+  xla::XlaOp position =
+      reverse_ ? xla::ConstantR0<xla::int32>(builder, length_ - 1) - step
+               : step;
+  // The parameters and the captured values are bound to the loop state, and
+  // only the nodes depending on the parameters are lowered within the body.
+  Util::EmissionMap emap;
+  for (size_t i = 0; i < num_carried_; ++i) {
+    loctx.AssignOutputOp(Output(parameters_[i].get()),
+                         xla::GetTupleElement(state, 1 + i));
+  }
+  for (size_t i = 0; i < num_xs; ++i) {
+    const xla::Shape& step_shape = parameters_[num_carried_ + i]->shape();
+    std::vector<xla::int64> slice_sizes = {1};
+    slice_sizes.insert(slice_sizes.end(), step_shape.dimensions().begin(),
+                       step_shape.dimensions().end());
+    xla::XlaOp slice = xla::DynamicSlice(
+        xla::GetTupleElement(state, xs_base + i),
+        LeadingDimensionIndices(position, slice_sizes.size()), slice_sizes);
+    loctx.AssignOutputOp(Output(parameters_[num_carried_ + i].get()),
+                         xla::Reshape(slice, step_shape.dimensions()));
+  }
+  for (auto& parameter : parameters_) {
+    emap[parameter.get()] = Util::kEmitted;
+  }
+  for (size_t i = 0; i < captured_.size(); ++i) {
+    loctx.AssignOutputOp(captured_[i],
+                         xla::GetTupleElement(state, captured_base + i));
+    emap[captured_[i].node.get()] = Util::kEmitted;
+  }
+  for (auto& result : results_) {
+    for (const Node* node : Util::ComputePostOrder(result.node.get(), &emap)) {
+      loctx.LowerNode(node);
+    }
+  }
+
+  std::vector<xla::XlaOp> next_state = {
+      step + xla::ConstantR0<xla::int32>(builder, 1)};
+  for (size_t i = 0; i < num_carried_; ++i) {
+    next_state.push_back(loctx.GetOutputOp(results_[i]));
+  }
+  for (size_t i = 0; i < num_xs; ++i) {
+    next_state.push_back(xla::GetTupleElement(state, xs_base + i));
+  }
+  for (size_t i = 0; i < num_ys; ++i) {
+    const Value& result = results_[num_carried_ + i];
+    std::vector<xla::int64> update_sizes = {1};
+    update_sizes.insert(update_sizes.end(),
+                        result.shape().dimensions().begin(),
+                        result.shape().dimensions().end());
+    next_state.push_back(xla::DynamicUpdateSlice(
+        xla::GetTupleElement(state, ys_base + i),
+        xla::Reshape(loctx.GetOutputOp(result), update_sizes),
+        LeadingDimensionIndices(position, update_sizes.size())));
+  }
+  for (size_t i = 0; i < captured_.size(); ++i) {
+    next_state.push_back(xla::GetTupleElement(state, captured_base + i));
+  }
+  return ConsumeValue(loctx.Build(xla::Tuple(builder, next_state)));
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// Runs a body graph over the leading dimension of a few sequences, as a single
+// while loop, so that the size of the graph does not depend on the number of
+// steps. The body is the graph of the results, traced on ScanParameter nodes:
+// one per carried value, followed by one per step of a sequence. Its results
+// are the new carried values, followed by values which are stacked into output
+// sequences. The outputs of the node are the final carried values, followed by
+// the output sequences. The values of the body which do not depend on the
+// parameters, like the weights of a recurrent cell, are computed outside of the
+// loop and become operands of the node.
+class Scan : public Node {
+ public:
+  Scan(OpList operands, size_t num_carried, xla::int64 length,
+       std::vector<NodePtr> parameters, std::vector<Value> results,
+       std::vector<Value> captured, bool reverse);
+
+  static NodePtr Create(OpList init, OpList xs, xla::int64 length,
+                        std::vector<NodePtr> parameters,
+                        std::vector<Value> results, bool reverse);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  size_t num_carried() const { return num_carried_; }
+
+  xla::int64 length() const { return length_; }
+
+  bool reverse() const { return reverse_; }
+
+  const std::vector<NodePtr>& parameters() const { return parameters_; }
+
+  const std::vector<Value>& results() const { return results_; }
+
+  const std::vector<Value>& captured() const { return captured_; }
+
+ private:
+  xla::XlaComputation BuildCondition(const xla::Shape& state_shape) const;
+
+  xla::XlaComputation BuildBody(const xla::Shape& state_shape) const;
+
+  size_t num_carried_;
+  xla::int64 length_;
+  std::vector<NodePtr> parameters_;
+  std::vector<Value> results_;
+  // The values of the body bound to the trailing operands of the node, which
+  // are the same ones unless the node has been cloned.
+  std::vector<Value> captured_;
+  bool reverse_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
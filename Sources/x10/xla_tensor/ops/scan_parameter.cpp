@@ -0,0 +1,55 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scan_parameter.h"
+
+#include <sstream>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+ScanParameter::ScanParameter(xla::Shape shape, xla::int64 index)
+    : Node(xla_scan_parameter, std::move(shape), /*num_outputs=*/1,
+           xla::util::MHash(index)),
+      index_(index) {}
+
+std::string ScanParameter::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", index=" << index_;
+  return ss.str();
+}
+
+NodePtr ScanParameter::Clone(OpList operands) const {
+  return MakeNode<ScanParameter>(shape(), index_);
+}
+
+XlaOpVector ScanParameter::Lower(LoweringContext* loctx) const {
+  XLA_ERROR() << "Scan parameters can only be used within the body of their "
+                 "scan: "
+              << ToString();
+}
+
+ScanParameter* ScanParameter::Cast(const Node* node) {
+  return NodeCast<ScanParameter>(node, xla_scan_parameter);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
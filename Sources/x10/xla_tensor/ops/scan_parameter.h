@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// A placeholder within the body of a Scan, standing for a carried value or for
+// the current step of a scanned sequence. It is only lowered by the Scan using
+// it, as a slice of the loop state.
+class ScanParameter : public Node {
+ public:
+  ScanParameter(xla::Shape shape, xla::int64 index);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  xla::int64 index() const { return index_; }
+
+  static ScanParameter* Cast(const Node* node);
+
+ private:
+  xla::int64 index_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,347 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/client/lib/matrix.h"
+#include "tensorflow/compiler/xla/service/shape_inference.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/data_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+bool IsReducedDimension(xla::int64 dim,
+                        absl::Span<const xla::int64> dimensions) {
+  return std::find(dimensions.begin(), dimensions.end(), dim) !=
+         dimensions.end();
+}
+
+std::vector<xla::int64> ExpandMatMulDimensions(const xla::Shape& shape,
+                                               const xla::Shape& to_shape) {
+  xla::int64 rank_delta =
+      std::max<xla::int64>(to_shape.rank() - shape.rank(), 0);
+  std::vector<xla::int64> dimensions(
+      to_shape.dimensions().begin(),
+      to_shape.dimensions().begin() + rank_delta);
+  dimensions.insert(dimensions.end(), shape.dimensions().begin(),
+                    shape.dimensions().end());
+  return dimensions;
+}
+
+// Mirrors tensorflow::GetWindowedOutputSizeVerboseV2().
+xla::int64 WindowedOutputSize(xla::int64 input_size, xla::int64 filter_size,
+                              xla::int64 dilation, xla::int64 stride,
+                              tensorflow::Padding padding,
+                              xla::int64 padding_before,
+                              xla::int64 padding_after) {
+  XLA_CHECK_GT(stride, 0) << "Stride must be positive: " << stride;
+  XLA_CHECK_GT(dilation, 0) << "Dilation must be positive: " << dilation;
+  xla::int64 effective_filter_size = (filter_size - 1) * dilation + 1;
+  xla::int64 output_size = 0;
+  switch (padding) {
+    case tensorflow::Padding::VALID:
+      output_size = (input_size - effective_filter_size + stride) / stride;
+      break;
+    case tensorflow::Padding::SAME:
+      output_size = (input_size + stride - 1) / stride;
+      break;
+    case tensorflow::Padding::EXPLICIT:
+      output_size = (input_size + padding_before + padding_after -
+                     effective_filter_size + stride) /
+                    stride;
+      break;
+  }
+  XLA_CHECK_GE(output_size, 0)
+      << "Computed output size would be negative: input size " << input_size
+      << ", effective filter size " << effective_filter_size << ", stride "
+      << stride;
+  return output_size;
+}
+
+}  // namespace
+
+xla::Shape ComparisonOpShape(const xla::Shape& shape1,
+                             const xla::Shape& shape2) {
+  return xla::ShapeUtil::MakeShape(
+      xla::PrimitiveType::PRED,
+      XlaHelpers::GetPromotedShape(shape1.dimensions(), shape2.dimensions()));
+}
+
+xla::Shape ReduceShape(const xla::Shape& shape,
+                       absl::Span<const xla::int64> dimensions,
+                       bool keep_reduced_dimensions, xla::PrimitiveType type) {
+  std::vector<xla::int64> output_dimensions;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (!IsReducedDimension(i, dimensions)) {
+      output_dimensions.push_back(shape.dimensions(i));
+    } else if (keep_reduced_dimensions) {
+      output_dimensions.push_back(1);
+    }
+  }
+  return xla::ShapeUtil::MakeShape(type, output_dimensions);
+}
+
+xla::Shape ArgReduceShape(const xla::Shape& shape, xla::int64 dim,
+                          bool keepdim) {
+  xla::PrimitiveType type =
+      GetDevicePrimitiveType(xla::PrimitiveType::S64, /*device=*/nullptr);
+  if (dim < 0) {
+    return xla::ShapeUtil::MakeShape(
+        type, keepdim ? std::vector<xla::int64>{1} : std::vector<xla::int64>());
+  }
+  XLA_CHECK_LT(dim, shape.rank());
+  return ReduceShape(shape, {dim}, keepdim, type);
+}
+
+xla::Shape DotShape(const xla::Shape& lhs, const xla::Shape& rhs) {
+  XLA_CHECK(lhs.rank() == 1 || lhs.rank() == 2) << lhs;
+  XLA_CHECK(rhs.rank() == 1 || rhs.rank() == 2) << rhs;
+  XLA_CHECK_EQ(lhs.dimensions(lhs.rank() - 1), rhs.dimensions(0))
+      << "Cannot multiply " << lhs << " and " << rhs;
+  XLA_CHECK(xla::ShapeUtil::SameElementType(lhs, rhs))
+      << lhs << " and " << rhs;
+  std::vector<xla::int64> dimensions;
+  if (lhs.rank() == 2) {
+    dimensions.push_back(lhs.dimensions(0));
+  }
+  if (rhs.rank() == 2) {
+    dimensions.push_back(rhs.dimensions(1));
+  }
+  return xla::ShapeUtil::MakeShape(lhs.element_type(), dimensions);
+}
+
+xla::Shape MatMulShape(const xla::Shape& lhs, const xla::Shape& rhs) {
+  if (lhs.rank() == 1 && rhs.rank() == 2) {
+    XLA_CHECK_EQ(lhs.dimensions(0), rhs.dimensions(0))
+        << "Cannot multiply " << lhs << " and " << rhs;
+    XLA_CHECK(xla::ShapeUtil::SameElementType(lhs, rhs))
+        << lhs << " and " << rhs;
+    return xla::ShapeUtil::MakeShape(lhs.element_type(), {rhs.dimensions(1)});
+  }
+  if (lhs.rank() <= 2 && rhs.rank() <= 2) {
+    return DotShape(lhs, rhs);
+  }
+  XLA_CHECK(lhs.rank() >= 1 && rhs.rank() >= 1)
+      << "Unsupported matmul operation: matmul(" << lhs << ", " << rhs << ")";
+  XLA_CHECK(xla::ShapeUtil::SameElementType(lhs, rhs))
+      << lhs << " and " << rhs;
+  // The lower rank operand is expanded with the leading dimensions of the other
+  // one, and the batch dimensions of both are broadcast (see CreateMatMul()).
+  std::vector<xla::int64> lhs_dimensions = ExpandMatMulDimensions(lhs, rhs);
+  std::vector<xla::int64> rhs_dimensions = ExpandMatMulDimensions(rhs, lhs);
+  size_t rank = lhs_dimensions.size();
+  XLA_CHECK_EQ(lhs_dimensions[rank - 1], rhs_dimensions[rank - 2])
+      << "Cannot multiply " << lhs << " and " << rhs;
+  std::vector<xla::int64> dimensions = XlaHelpers::GetPromotedShape(
+      absl::MakeConstSpan(lhs_dimensions).subspan(0, rank - 2),
+      absl::MakeConstSpan(rhs_dimensions).subspan(0, rank - 2));
+  dimensions.push_back(lhs_dimensions[rank - 2]);
+  dimensions.push_back(rhs_dimensions[rank - 1]);
+  return xla::ShapeUtil::MakeShape(lhs.element_type(), dimensions);
+}
+
+xla::Shape TfConvShape(const xla::Shape& input, const xla::Shape& filter,
+                       bool depthwise, absl::Span<const xla::int64> strides,
+                       tensorflow::Padding padding,
+                       absl::Span<const xla::int64> explicit_paddings,
+                       tensorflow::TensorFormat data_format,
+                       absl::Span<const xla::int64> dilations) {
+  int num_dims = input.rank();
+  int num_spatial_dims = num_dims - 2;
+  XLA_CHECK_EQ(filter.rank(), num_dims) << input << " and " << filter;
+  XLA_CHECK_EQ(strides.size(), num_dims);
+  XLA_CHECK_EQ(dilations.size(), num_dims);
+  int batch_dim = tensorflow::GetTensorBatchDimIndex(num_dims, data_format);
+  int feature_dim = tensorflow::GetTensorFeatureDimIndex(num_dims, data_format);
+  xla::int64 in_depth = filter.dimensions(num_spatial_dims);
+  xla::int64 out_depth = filter.dimensions(num_spatial_dims + 1);
+  XLA_CHECK_EQ(input.dimensions(feature_dim) % in_depth, 0)
+      << "Input depth of " << input << " is not a multiple of the filter "
+      << filter << " input depth";
+  std::vector<xla::int64> dimensions(num_dims);
+  dimensions[batch_dim] = input.dimensions(batch_dim);
+  dimensions[feature_dim] = depthwise ? in_depth * out_depth : out_depth;
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    int dim = tensorflow::GetTensorSpatialDimIndex(num_dims, data_format, i);
+    xla::int64 padding_before = 0;
+    xla::int64 padding_after = 0;
+    if (padding == tensorflow::Padding::EXPLICIT) {
+      padding_before = explicit_paddings.at(2 * dim);
+      padding_after = explicit_paddings.at(2 * dim + 1);
+    }
+    dimensions[dim] = WindowedOutputSize(
+        input.dimensions(dim), filter.dimensions(i), dilations[dim],
+        strides[dim], padding, padding_before, padding_after);
+  }
+  return xla::ShapeUtil::MakeShape(input.element_type(), dimensions);
+}
+
+xla::Shape PoolNdShape(const xla::Shape& input, xla::int64 spatial_dim_count,
+                       absl::Span<const xla::int64> kernel_size,
+                       absl::Span<const xla::int64> stride,
+                       absl::Span<const xla::int64> padding, bool ceil_mode) {
+  xla::int64 rank = input.rank();
+  XLA_CHECK(rank == spatial_dim_count + 1 || rank == spatial_dim_count + 2)
+      << "Input must be a " << spatial_dim_count + 1 << "-D or "
+      << spatial_dim_count + 2 << "-D tensor";
+  XLA_CHECK_EQ(kernel_size.size(), spatial_dim_count);
+  XLA_CHECK_EQ(padding.size(), spatial_dim_count);
+  std::vector<xla::int64> dimensions(input.dimensions().begin(),
+                                     input.dimensions().end());
+  for (xla::int64 i = 0; i < spatial_dim_count; ++i) {
+    xla::int64 dim = rank - spatial_dim_count + i;
+    xla::int64 window_stride = stride.empty() ? kernel_size[i] : stride[i];
+    xla::int64 padded_size =
+        input.dimensions(dim) + 2 * padding[i] - kernel_size[i];
+    XLA_CHECK_GE(padded_size, 0)
+        << "Pooling window " << kernel_size[i] << " is larger than the padded "
+        << "input dimension " << dim << " of " << input;
+    // In ceil mode, the high padding is extended to cover a last, partial
+    // window (see CeilModePadding() in pooling.cpp).
+    dimensions[dim] = (ceil_mode ? (padded_size + window_stride - 1) /
+                                       window_stride
+                                 : padded_size / window_stride) +
+                      1;
+  }
+  return xla::ShapeUtil::MakeShape(input.element_type(), dimensions);
+}
+
+xla::Shape GatherShape(const xla::Shape& input, const xla::Shape& index,
+                       xla::int64 dim) {
+  XLA_CHECK_EQ(input.rank(), index.rank()) << input << " and " << index;
+  XLA_CHECK_LT(dim, input.rank());
+  return xla::ShapeUtil::MakeShape(input.element_type(), index.dimensions());
+}
+
+xla::Shape IndexSelectShape(const xla::Shape& input, const xla::Shape& index,
+                            xla::int64 dim) {
+  XLA_CHECK_LT(dim, input.rank());
+  std::vector<xla::int64> dimensions(input.dimensions().begin(),
+                                     input.dimensions().begin() + dim);
+  dimensions.insert(dimensions.end(), index.dimensions().begin(),
+                    index.dimensions().end());
+  dimensions.insert(dimensions.end(), input.dimensions().begin() + dim + 1,
+                    input.dimensions().end());
+  return xla::ShapeUtil::MakeShape(input.element_type(), dimensions);
+}
+
+xla::Shape EinsumShape(const xla::Shape& lhs, const xla::Shape& rhs,
+                       const std::string& equation) {
+  auto configs = ConsumeValue(
+      xla::ParseEinsumString(equation, lhs.rank(), rhs.rank()));
+  XLA_CHECK(xla::ShapeUtil::SameElementType(lhs, rhs))
+      << lhs << " and " << rhs;
+  auto label_size = [&](xla::int64 label) -> xla::int64 {
+    xla::int64 size = -1;
+    auto update_size = [&](const std::vector<xla::int64>& config,
+                           const xla::Shape& shape) {
+      auto it = std::find(config.begin(), config.end(), label);
+      if (it != config.end()) {
+        xla::int64 label_size = shape.dimensions(it - config.begin());
+        // Labels of size 1 are broadcast to the size of the other operand.
+        XLA_CHECK(size < 0 || size == label_size || size == 1 ||
+                  label_size == 1)
+            << "Einsum " << equation << " has mismatching sizes for "
+            << lhs << " and " << rhs;
+        size = size <= 1 ? label_size : size;
+      }
+    };
+    update_size(configs[0], lhs);
+    update_size(configs[1], rhs);
+    XLA_CHECK_GE(size, 0) << "Invalid einsum equation: " << equation;
+    return size;
+  };
+  std::vector<xla::int64> dimensions;
+  for (xla::int64 label : configs[2]) {
+    dimensions.push_back(label_size(label));
+  }
+  return xla::ShapeUtil::MakeShape(lhs.element_type(), dimensions);
+}
+
+xla::Shape SliceShape(const xla::Shape& input,
+                      absl::Span<const xla::int64> start_indices,
+                      absl::Span<const xla::int64> limit_indices,
+                      absl::Span<const xla::int64> strides) {
+  return ConsumeValue(xla::ShapeInference::InferSliceShape(
+      input, start_indices, limit_indices, strides));
+}
+
+xla::Shape TransposeShape(const xla::Shape& input,
+                          absl::Span<const xla::int64> permutation) {
+  return ConsumeValue(
+      xla::ShapeInference::InferTransposeShape(input, permutation));
+}
+
+xla::Shape SqueezeShape(const xla::Shape& input, xla::int64 dim) {
+  XLA_CHECK(dim >= 0 || dim == -1) << "Invalid squeeze dimension: " << dim;
+  XLA_CHECK_LT(dim, input.rank());
+  if (dim >= 0 && input.dimensions(dim) != 1) {
+    return input;
+  }
+  return xla::ShapeUtil::MakeShape(
+      input.element_type(), BuildSqueezedDimensions(input.dimensions(), dim));
+}
+
+xla::Shape ExpandShape(const xla::Shape& input,
+                       absl::Span<const xla::int64> sizes) {
+  XLA_CHECK_LE(input.rank(), sizes.size());
+  xla::int64 rank_delta = sizes.size() - input.rank();
+  for (xla::int64 i = 0; i < input.rank(); ++i) {
+    xla::int64 size = input.dimensions(i);
+    XLA_CHECK(size == 1 || size == sizes[rank_delta + i])
+        << "Cannot expand " << input << " to (" << absl::StrJoin(sizes, ", ")
+        << ")";
+  }
+  return xla::ShapeUtil::MakeShape(input.element_type(), sizes);
+}
+
+xla::Shape ConcatShape(absl::Span<const xla::Shape> shapes, xla::int64 dim) {
+  XLA_CHECK_GT(shapes.size(), 0);
+  std::vector<const xla::Shape*> shape_ptrs;
+  shape_ptrs.reserve(shapes.size());
+  for (auto& shape : shapes) {
+    shape_ptrs.push_back(&shape);
+  }
+  return ConsumeValue(
+      xla::ShapeInference::InferConcatOpShape(shape_ptrs, dim));
+}
+
+xla::Shape StackShape(absl::Span<const xla::Shape> shapes, xla::int64 dim) {
+  XLA_CHECK_GT(shapes.size(), 0);
+  std::vector<xla::Shape> expanded_shapes;
+  expanded_shapes.reserve(shapes.size());
+  for (auto& shape : shapes) {
+    XLA_CHECK_LE(dim, shape.rank());
+    std::vector<xla::int64> dimensions(shape.dimensions().begin(),
+                                       shape.dimensions().end());
+    dimensions.insert(dimensions.begin() + dim, 1);
+    expanded_shapes.push_back(
+        xla::ShapeUtil::MakeShape(shape.element_type(), dimensions));
+  }
+  return ConcatShape(expanded_shapes, dim);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/util/padding.h"
+#include "tensorflow/core/util/tensor_format.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// Closed form output shapes of the most common operations, which match the
+// shapes of their lowerings without having to trace them with an XlaBuilder.
+// The input shapes must be static (see InferOutputShape()).
+
+// Shape of an elementwise comparison, after type and shape promotion.
+xla::Shape ComparisonOpShape(const xla::Shape& shape1,
+                             const xla::Shape& shape2);
+
+// Shape of a reduction over the given dimensions, producing values of the
+// given type. The reduced dimensions are either dropped or kept with size 1.
+xla::Shape ReduceShape(const xla::Shape& shape,
+                       absl::Span<const xla::int64> dimensions,
+                       bool keep_reduced_dimensions, xla::PrimitiveType type);
+
+// Shape of the indices returned by BuildArgMax() and BuildArgMin(). A negative
+// dim reduces the flattened input.
+xla::Shape ArgReduceShape(const xla::Shape& shape, xla::int64 dim,
+                          bool keepdim);
+
+// Shape of xla::Dot() of ranks 1 and 2 operands.
+xla::Shape DotShape(const xla::Shape& lhs, const xla::Shape& rhs);
+
+// Shape of CreateMatMul(), which broadcasts the batch dimensions.
+xla::Shape MatMulShape(const xla::Shape& lhs, const xla::Shape& rhs);
+
+// Shape of the TensorFlow forward convolution, with a filter in HWIO layout.
+xla::Shape TfConvShape(const xla::Shape& input, const xla::Shape& filter,
+                       bool depthwise, absl::Span<const xla::int64> strides,
+                       tensorflow::Padding padding,
+                       absl::Span<const xla::int64> explicit_paddings,
+                       tensorflow::TensorFormat data_format,
+                       absl::Span<const xla::int64> dilations);
+
+// Shape of BuildMaxPoolNd() and BuildAvgPoolNd(), with symmetric padding which
+// is extended on the high side in ceil mode.
+xla::Shape PoolNdShape(const xla::Shape& input, xla::int64 spatial_dim_count,
+                       absl::Span<const xla::int64> kernel_size,
+                       absl::Span<const xla::int64> stride,
+                       absl::Span<const xla::int64> padding, bool ceil_mode);
+
+// Shape of xla::TorchGather(), which has the dimensions of the index.
+xla::Shape GatherShape(const xla::Shape& input, const xla::Shape& index,
+                       xla::int64 dim);
+
+// Shape of xla::TorchIndexSelect(), where the index dimensions replace the dim
+// dimension of the input.
+xla::Shape IndexSelectShape(const xla::Shape& input, const xla::Shape& index,
+                            xla::int64 dim);
+
+// Shape of the two operands xla::Einsum().
+xla::Shape EinsumShape(const xla::Shape& lhs, const xla::Shape& rhs,
+                       const std::string& equation);
+
+xla::Shape SliceShape(const xla::Shape& input,
+                      absl::Span<const xla::int64> start_indices,
+                      absl::Span<const xla::int64> limit_indices,
+                      absl::Span<const xla::int64> strides);
+
+xla::Shape TransposeShape(const xla::Shape& input,
+                          absl::Span<const xla::int64> permutation);
+
+// Shape of the squeeze of the given size 1 dimension, or of all of them when
+// dim is -1.
+xla::Shape SqueezeShape(const xla::Shape& input, xla::int64 dim);
+
+// Shape of BuildExpand(), broadcasting the input to the given sizes.
+xla::Shape ExpandShape(const xla::Shape& input,
+                       absl::Span<const xla::int64> sizes);
+
+xla::Shape ConcatShape(absl::Span<const xla::Shape> shapes, xla::int64 dim);
+
+// Shape of BuildStack(), which concatenates the inputs along a new dimension.
+xla::Shape StackShape(absl::Span<const xla::Shape> shapes, xla::int64 dim);
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -19,6 +19,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 
 namespace swift_xla {
 namespace ir {
@@ -35,7 +36,10 @@ xla::Shape NodeOutputShape(absl::Span<const ir::Value> values, xla::int64 dim) {
   for (auto& value : values) {
     shapes.push_back(value.shape());
   }
-  return InferOutputShape(shapes, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return StackShape(shapes, dim);
+  };
+  return InferOutputShape(shapes, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
@@ -18,6 +18,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/reduction.h"
 
 namespace swift_xla {
@@ -33,7 +34,11 @@ xla::Shape NodeOutputShape(const Value& input,
     return BuildStdDeviation(operands[0], dimensions, keep_reduced_dimensions,
                              unbiased);
   };
-  return InferOutputShape({input.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return ReduceShape(input.shape(), dimensions, keep_reduced_dimensions,
+                       input.shape().element_type());
+  };
+  return InferOutputShape({input.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
@@ -18,6 +18,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/data_ops.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/svd.h"
@@ -28,10 +29,17 @@ namespace ops {
 namespace {
 
 std::vector<xla::XlaOp> LowerSVD(xla::XlaOp input, bool some, bool compute_uv) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  // The small matrix lowering only computes min(M, N) singular vectors.
+  if (UseSmallMatrixLowering(input_shape) &&
+      (some || !compute_uv ||
+       input_shape.dimensions(input_shape.rank() - 2) ==
+           input_shape.dimensions(input_shape.rank() - 1))) {
+    return BuildSmallSVD(input, some, compute_uv);
+  }
   xla::SVDResult svd_result =
       xla::SVD(input, /*max_iter=*/100, /*epsilon=*/1e-6,
                XlaHelpers::mat_mul_precision());
-  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
   xla::XlaOp u = svd_result.u;
   xla::XlaOp v = svd_result.v;
   if (!compute_uv) {
@@ -17,6 +17,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/lib/self_adjoint_eig.h"
@@ -28,11 +29,19 @@ namespace {
 
 std::vector<xla::XlaOp> LowerSymEig(xla::XlaOp input, bool eigenvectors,
                                     bool lower) {
-  xla::SelfAdjointEigResult self_adj_eig_result =
-      xla::SelfAdjointEig(input, /*lower=*/lower, /*max_iter=*/100,
-                          /*epsilon=*/1e-6);
-  xla::XlaOp v = self_adj_eig_result.v;
-  xla::XlaOp w = self_adj_eig_result.w;
+  xla::XlaOp v;
+  xla::XlaOp w;
+  if (UseSmallMatrixLowering(XlaHelpers::ShapeOfXlaOp(input))) {
+    std::vector<xla::XlaOp> eig_result = BuildSmallSymEig(input, lower);
+    w = eig_result[0];
+    v = eig_result[1];
+  } else {
+    xla::SelfAdjointEigResult self_adj_eig_result =
+        xla::SelfAdjointEig(input, /*lower=*/lower, /*max_iter=*/100,
+                            /*epsilon=*/1e-6);
+    v = self_adj_eig_result.v;
+    w = self_adj_eig_result.w;
+  }
   if (!eigenvectors) {
     v = xla::Zeros(input.builder(),
                    xla::ShapeUtil::MakeShape(
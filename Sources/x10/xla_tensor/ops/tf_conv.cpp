@@ -17,6 +17,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/tf_create_conv_attrs.h"
 #include "tensorflow/compiler/tf2xla/kernels/conv_op_helpers.h"
 
@@ -61,7 +62,12 @@ xla::Shape NodeOutputShape(const Value& input, const Value& filter,
                        /*data_format=*/data_format,
                        /*dilations=*/dilations);
   };
-  return InferOutputShape({input.shape(), filter.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return TfConvShape(input.shape(), filter.shape(), depthwise, strides,
+                       padding, explicit_paddings, data_format, dilations);
+  };
+  return InferOutputShape({input.shape(), filter.shape()}, lower_for_shape_fn,
+                          shape_fn);
 }
 
 }  // namespace
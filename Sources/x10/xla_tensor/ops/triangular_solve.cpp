@@ -17,6 +17,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/matrix.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/layout_util.h"
 
@@ -72,10 +73,16 @@ std::vector<xla::XlaOp> LowerTriangularSolve(xla::XlaOp rhs, xla::XlaOp lhs,
   xla::XlaOp lhs_broadcasted =
       XlaHelpers::ImplicitBroadcast(lhs, lhs_shape, broadcasted_shapes.second);
 
-  xla::XlaOp solution = xla::TriangularSolve(
-      lhs_broadcasted, rhs_broadcasted, left_side, lower, unit_diagonal,
-      transpose ? xla::TriangularSolveOptions::TRANSPOSE
-                : xla::TriangularSolveOptions::NO_TRANSPOSE);
+  xla::XlaOp solution =
+      UseSmallMatrixLowering(broadcasted_shapes.second)
+          ? BuildSmallTriangularSolve(lhs_broadcasted, rhs_broadcasted,
+                                      left_side, lower, transpose,
+                                      unit_diagonal)
+          : xla::TriangularSolve(
+                lhs_broadcasted, rhs_broadcasted, left_side, lower,
+                unit_diagonal,
+                transpose ? xla::TriangularSolveOptions::TRANSPOSE
+                          : xla::TriangularSolveOptions::NO_TRANSPOSE);
   return {solution, lhs_broadcasted};
 }
 
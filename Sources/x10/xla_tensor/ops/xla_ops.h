@@ -46,6 +46,8 @@ extern const OpKindWrapper xla_generic_slice;
 extern const OpKindWrapper xla_get_dimensions_size;
 extern const OpKindWrapper xla_moving_average;
 extern const OpKindWrapper xla_not_supported;
+extern const OpKindWrapper xla_scan;
+extern const OpKindWrapper xla_scan_parameter;
 extern const OpKindWrapper xla_select;
 extern const OpKindWrapper xla_tensor_data;
 extern const OpKindWrapper xla_token;
@@ -17,6 +17,7 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/shape_functions.h"
 
 namespace swift_xla {
 namespace ir {
@@ -33,7 +34,10 @@ xla::Shape NodeOutputShape(const Value& operand,
         << "Unexpected number of operands: " << operands.size();
     return xla::Slice(operands[0], start_indices, limit_indices, strides);
   };
-  return InferOutputShape({operand.shape()}, lower_for_shape_fn);
+  auto shape_fn = [&]() -> xla::Shape {
+    return SliceShape(operand.shape(), start_indices, limit_indices, strides);
+  };
+  return InferOutputShape({operand.shape()}, lower_for_shape_fn, shape_fn);
 }
 
 }  // namespace
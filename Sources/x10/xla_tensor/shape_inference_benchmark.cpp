@@ -0,0 +1,285 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the cost of the IR node construction on cold traces, where every
+// operation misses the shape cache, with the output shapes either traced with
+// an XlaBuilder or computed by the closed form shape functions. Every trace
+// uses a batch size which was never seen before, so that no shape can be found
+// in the cache. The warm trace, which hits the cache for all the nodes, is
+// reported as a reference. The results are reported in nanoseconds per IR
+// node, as JSON on stdout.
+//
+// Usage: shape_inference_benchmark [--repetitions=N]
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/fake_computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+namespace {
+
+// Creates the inputs of a graph for the given batch size.
+using InputsFn =
+    std::function<std::vector<XLATensor>(const Device&, int64_t, int)>;
+// Traces the graph over the inputs, and returns its roots.
+using GraphFn =
+    std::function<std::vector<XLATensor>(const std::vector<XLATensor>&, int)>;
+
+struct ModelSpec {
+  std::string name;
+  InputsFn inputs_fn;
+  GraphFn graph_fn;
+  std::vector<int> sizes;
+};
+
+struct PhaseResult {
+  std::string name;
+  double ns_per_node = std::numeric_limits<double>::max();
+};
+
+struct GraphResult {
+  std::string model;
+  int size = 0;
+  size_t num_nodes = 0;
+  std::vector<PhaseResult> phases;
+};
+
+XLATensor MakeInput(const Device& device, std::vector<int64_t> dims) {
+  size_t num_elements = at::GetLenFromShape(dims);
+  std::unique_ptr<float[]> data(new float[num_elements]());
+  return XLATensor::Create(at::Tensor(std::move(data), std::move(dims)),
+                           device);
+}
+
+XLATensor MakeIndex(const Device& device, std::vector<int64_t> dims) {
+  size_t num_elements = at::GetLenFromShape(dims);
+  std::unique_ptr<int64_t[]> data(new int64_t[num_elements]());
+  return XLATensor::Create(at::Tensor(std::move(data), std::move(dims)),
+                           device);
+}
+
+const int64_t kChannels = 16;
+const int64_t kSeqLen = 32;
+const int64_t kModelDim = 64;
+
+std::vector<XLATensor> MakeVisionInputs(const Device& device, int64_t batch,
+                                        int num_layers) {
+  std::vector<XLATensor> inputs = {
+      MakeInput(device, {batch, 16, 16, kChannels})};
+  for (int i = 0; i < num_layers; ++i) {
+    inputs.push_back(MakeInput(device, {3, 3, kChannels, kChannels}));
+  }
+  return inputs;
+}
+
+// Convolutions, pooling, reductions and comparisons.
+std::vector<XLATensor> BuildVision(const std::vector<XLATensor>& inputs,
+                                   int num_layers) {
+  XLATensor x = inputs[0];
+  for (int i = 0; i < num_layers; ++i) {
+    XLATensor conv = XLATensor::tf_Conv(
+        x, inputs[i + 1], /*depthwise=*/false, /*strides=*/{1, 1, 1, 1},
+        tensorflow::SAME, /*explicit_paddings=*/{}, tensorflow::FORMAT_NHWC,
+        /*dilations=*/{1, 1, 1, 1});
+    XLATensor nchw = XLATensor::permute(XLATensor::relu(conv), {0, 3, 1, 2});
+    XLATensor pooled = XLATensor::max_pool_nd(
+        nchw, /*spatial_dim_count=*/2, /*kernel_size=*/{3, 3},
+        /*stride=*/{1, 1}, /*padding=*/{1, 1}, /*ceil_mode=*/false);
+    XLATensor y = XLATensor::permute(pooled, {0, 2, 3, 1});
+    XLATensor mean = XLATensor::mean(y, {1, 2},
+                                     /*keep_reduced_dimensions=*/true,
+                                     /*dtype=*/absl::nullopt);
+    XLATensor mask = XLATensor::lt(y, mean);
+    x = XLATensor::add(XLATensor::sub(y, mean), x);
+    x = XLATensor::max(x, XLATensor::mul(x, mask));
+  }
+  XLATensor loss = XLATensor::sum(x, {0, 1, 2, 3},
+                                  /*keep_reduced_dimensions=*/false,
+                                  /*dtype=*/absl::nullopt);
+  return {loss};
+}
+
+std::vector<XLATensor> MakeSequenceInputs(const Device& device, int64_t batch,
+                                          int num_layers) {
+  std::vector<XLATensor> inputs = {
+      MakeInput(device, {batch, kSeqLen, kModelDim}),
+      MakeIndex(device, {batch, kSeqLen, 1}),
+      MakeIndex(device, {kSeqLen / 2})};
+  for (int i = 0; i < num_layers; ++i) {
+    inputs.push_back(MakeInput(device, {kModelDim, kModelDim}));
+  }
+  return inputs;
+}
+
+// Matrix multiplications, einsum, slicing, concatenation and gathers.
+std::vector<XLATensor> BuildSequence(const std::vector<XLATensor>& inputs,
+                                     int num_layers) {
+  XLATensor x = inputs[0];
+  const XLATensor& gather_index = inputs[1];
+  const XLATensor& select_index = inputs[2];
+  std::vector<XLATensor> roots;
+  for (int i = 0; i < num_layers; ++i) {
+    XLATensor q = XLATensor::matmul(x, inputs[i + 3]);
+    XLATensor scores = XLATensor::einsum("bid,bjd->bij", {q, x});
+    XLATensor context = XLATensor::einsum("bij,bjd->bid", {scores, x});
+    XLATensor head = XLATensor::slice(context, 1, 0, kSeqLen / 2, 1);
+    XLATensor tail = XLATensor::slice(context, 1, kSeqLen / 2, kSeqLen, 1);
+    XLATensor swapped = XLATensor::cat({tail, head}, 1);
+    XLATensor pairs = XLATensor::stack({swapped, context}, 0);
+    x = XLATensor::add(
+        XLATensor::sum(pairs, {0}, /*keep_reduced_dimensions=*/false,
+                       /*dtype=*/absl::nullopt),
+        XLATensor::expand(XLATensor::gather(x, 2, gather_index),
+                          xla::util::ToVector<xla::int64>(
+                              x.shape().get().dimensions())));
+    XLATensor selected = XLATensor::index_select(x, 1, select_index);
+    roots.push_back(XLATensor::argmax(selected, 2, /*keepdim=*/false));
+  }
+  roots.push_back(XLATensor::mean(x, {0, 1, 2},
+                                  /*keep_reduced_dimensions=*/false,
+                                  /*dtype=*/absl::nullopt));
+  return roots;
+}
+
+size_t GetGraphSize(const std::vector<XLATensor>& tensors) {
+  std::vector<ir::Value> roots;
+  std::vector<const ir::Node*> nodes;
+  for (auto& tensor : tensors) {
+    roots.push_back(tensor.GetIrValue());
+    nodes.push_back(roots.back().node.get());
+  }
+  return ir::Util::GetGraphSize(nodes);
+}
+
+// Traces the graph and folds the time per node into the phase result, keeping
+// the fastest run.
+void RunTrace(const ModelSpec& spec, int size,
+              const std::vector<XLATensor>& inputs, size_t num_nodes,
+              PhaseResult* result) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<XLATensor> tensors = spec.graph_fn(inputs, size);
+  for (auto& tensor : tensors) {
+    tensor.GetIrValue();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  result->ns_per_node = std::min(result->ns_per_node, ns / num_nodes);
+}
+
+GraphResult RunGraph(const ModelSpec& spec, int size, const Device& device,
+                     int repetitions, int64_t* next_batch) {
+  GraphResult result;
+  result.model = spec.name;
+  result.size = size;
+  PhaseResult traced{"traced"};
+  PhaseResult closed_form{"closed_form"};
+  PhaseResult cached{"cached"};
+  for (int i = 0; i < repetitions; ++i) {
+    for (PhaseResult* phase : {&traced, &closed_form}) {
+      ir::ops::SetShapeFunctionsEnabled(phase == &closed_form);
+      std::vector<XLATensor> inputs =
+          spec.inputs_fn(device, (*next_batch)++, size);
+      if (result.num_nodes == 0) {
+        result.num_nodes = GetGraphSize(spec.graph_fn(inputs, size));
+        inputs = spec.inputs_fn(device, (*next_batch)++, size);
+      }
+      RunTrace(spec, size, inputs, result.num_nodes, phase);
+      // Tracing again with the same shapes hits the shape cache for all the
+      // nodes, whichever way their shapes were computed the first time.
+      RunTrace(spec, size, inputs, result.num_nodes, &cached);
+      XLATensor::MarkStep(&device);
+    }
+  }
+  ir::ops::SetShapeFunctionsEnabled(true);
+  result.phases = {traced, closed_form, cached};
+  return result;
+}
+
+std::string ToJson(const std::vector<GraphResult>& results,
+                   const Device& device, int repetitions) {
+  std::vector<std::string> graphs;
+  for (auto& result : results) {
+    std::vector<std::string> phases;
+    for (auto& phase : result.phases) {
+      phases.push_back(absl::StrFormat("\"%s\": {\"ns_per_node\": %.2f}",
+                                       phase.name, phase.ns_per_node));
+    }
+    graphs.push_back(absl::StrFormat(
+        "    {\"model\": \"%s\", \"size\": %d, \"nodes\": %d, \"phases\": "
+        "{%s}, \"speedup\": %.2f}",
+        result.model, result.size, result.num_nodes,
+        absl::StrJoin(phases, ", "),
+        result.phases[0].ns_per_node / result.phases[1].ns_per_node));
+  }
+  return absl::StrCat(
+      "{\n  \"benchmark\": \"shape_inference\",\n  \"device\": \"",
+      device.ToString(), "\",\n  \"repetitions\": ", repetitions,
+      ",\n  \"graphs\": [\n", absl::StrJoin(graphs, ",\n"), "\n  ]\n}\n");
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  int repetitions = 5;
+  for (int i = 1; i < argc; ++i) {
+    absl::string_view arg(argv[i]);
+    if (absl::ConsumePrefix(&arg, "--repetitions=")) {
+      if (!absl::SimpleAtoi(arg, &repetitions) || repetitions < 1) {
+        absl::FPrintF(stderr, "Invalid repetitions: %s\n", argv[i]);
+        return 1;
+      }
+    } else {
+      absl::FPrintF(stderr, "Usage: %s [--repetitions=N]\n", argv[0]);
+      return 1;
+    }
+  }
+  xla::ComputationClient::Set(std::make_unique<xla::FakeComputationClient>());
+
+  using swift_xla::ModelSpec;
+  std::vector<ModelSpec> specs = {
+      {"vision", swift_xla::MakeVisionInputs, swift_xla::BuildVision,
+       {2, 8, 32}},
+      {"sequence", swift_xla::MakeSequenceInputs, swift_xla::BuildSequence,
+       {2, 8, 32}},
+  };
+  const swift_xla::Device& device = *swift_xla::GetDefaultDevice();
+  std::vector<swift_xla::GraphResult> results;
+  int64_t next_batch = 1;
+  for (auto& spec : specs) {
+    for (int size : spec.sizes) {
+      results.push_back(swift_xla::RunGraph(spec, size, device, repetitions,
+                                            &next_batch));
+    }
+  }
+  absl::PrintF("%s", swift_xla::ToJson(results, device, repetitions));
+  return 0;
+}
@@ -18,26 +18,36 @@
 #include <atomic>
 #include <cmath>
 #include <condition_variable>
+#include <cstring>
 #include <exception>
 #include <functional>
+#include <list>
 #include <mutex>
 #include <set>
 #include <stdexcept>
+#include <thread>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/checkpoint.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/cost_analysis.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/debug_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/graph_partitioner.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/host_evaluator.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_dump_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_estimator.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_scheduler.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/op_by_op_executor.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/expand.h"
@@ -64,6 +74,47 @@ struct TlsData {
 
 thread_local TlsData g_tls_data;
 
+// Free list of XLATensor sized blocks. Handles are often released from a
+// different thread than the one which allocated them, so the list is shared by
+// all threads rather than kept per thread, where it would only be trimmed at
+// thread exit.
+class TensorHandlePool {
+ public:
+  static TensorHandlePool* Get() {
+    static TensorHandlePool* pool = new TensorHandlePool();
+    return pool;
+  }
+
+  void* Allocate() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_blocks_.empty()) {
+        void* block = free_blocks_.back();
+        free_blocks_.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(sizeof(XLATensor));
+  }
+
+  void Release(void* block) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_blocks_.size() < kMaxFreeBlocks) {
+        free_blocks_.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+ private:
+  static constexpr size_t kMaxFreeBlocks = 4096;
+
+  std::mutex mutex_;
+  std::vector<void*> free_blocks_;
+};
+
 // Locking:
 // We perform two kinds of operations of tensors, synchronous and asynchronous.
 // The ApplyPendingGraph() are synchronous, as we need the device data result
@@ -229,6 +280,7 @@ xla::ComputationClient::DataPtr GetDeviceData(const at::Tensor& tensor,
   xla::ComputationClient::DataPtr device_data = cache->Get(tensor);
   if (device_data == nullptr) {
     device_data = TensorToXlaData(tensor, device);
+    xla::memory::SetTag(device_data.get(), {xla::memory::Kind::kCache});
     cache->Add(tensor.dup(), device_data);
   }
   return device_data;
@@ -267,10 +319,405 @@ bool IsSpecialScalar(at::Scalar value) {
   return false;
 }
 
+bool ParamAliasingEnabled() {
+  static const bool enable_aliasing =
+      xla::sys_util::GetEnvBool("XLA_ENABLE_PARAM_ALIASING", false);
+  return enable_aliasing;
+}
+
 bool ShouldSyncIrValue(const ir::Value& ir_value) {
   return ir_value->op() != ir::ops::xla_not_supported;
 }
 
+// Maps the device data living on the first device of a replicated sync, to the
+// copies which the other replicas use in its place. Entries are keyed by the
+// address of the first replica data, and hold a weak reference to it in order
+// to detect stale entries.
+class ReplicaDataMap {
+ public:
+  static ReplicaDataMap* Get() {
+    static ReplicaDataMap* replica_data_map = new ReplicaDataMap();
+    return replica_data_map;
+  }
+
+  void Set(const xla::ComputationClient::DataPtr& data,
+           std::vector<xla::ComputationClient::DataPtr> replicas) {
+    std::lock_guard<std::mutex> lock(lock_);
+    map_[data.get()] = {data, std::move(replicas)};
+  }
+
+  // Returns the copies of data for the devices[1:] replicas, or an empty vector
+  // if no valid copies have been registered for such devices.
+  std::vector<xla::ComputationClient::DataPtr> Lookup(
+      const xla::ComputationClient::DataPtr& data,
+      absl::Span<const std::string> devices) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = map_.find(data.get());
+    if (it == map_.end() || it->second.data.lock() != data ||
+        it->second.replicas.size() + 1 != devices.size()) {
+      return {};
+    }
+    for (size_t i = 0; i < it->second.replicas.size(); ++i) {
+      if (it->second.replicas[i]->device() != devices[i + 1]) {
+        return {};
+      }
+    }
+    return it->second.replicas;
+  }
+
+  // Releases the copies of the data which is no longer alive.
+  void Purge() {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (auto it = map_.begin(); it != map_.end();) {
+      if (it->second.data.expired()) {
+        it = map_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    std::weak_ptr<xla::ComputationClient::Data> data;
+    std::vector<xla::ComputationClient::DataPtr> replicas;
+  };
+
+  std::mutex lock_;
+  std::unordered_map<const xla::ComputationClient::Data*, Entry> map_;
+};
+
+// Copies the data living on devices[0] to all the other devices. The i-th
+// element of the result holds the devices[1:] copies of data[i].
+std::vector<std::vector<xla::ComputationClient::DataPtr>> BroadcastData(
+    absl::Span<const xla::ComputationClient::DataPtr> data,
+    absl::Span<const std::string> devices) {
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(data);
+  std::vector<xla::ComputationClient::TensorSource> source_tensors;
+  for (size_t i = 1; i < devices.size(); ++i) {
+    for (auto& literal : literals) {
+      auto populate_fn =
+          [&literal](const xla::ComputationClient::TensorSource& source_tensor,
+                     void* dest_buffer, size_t dest_buffer_size) {
+            std::memcpy(dest_buffer, literal.untyped_data(), dest_buffer_size);
+          };
+      source_tensors.emplace_back(literal.shape(), devices[i],
+                                  std::move(populate_fn));
+      source_tensors.back().data = literal.untyped_data();
+    }
+  }
+  std::vector<xla::ComputationClient::DataPtr> handles =
+      xla::ComputationClient::Get()->TransferToServer(source_tensors);
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> replicas(
+      data.size());
+  for (size_t i = 0; i < handles.size(); ++i) {
+    replicas[i % data.size()].push_back(std::move(handles[i]));
+  }
+  return replicas;
+}
+
+// Builds the per replica arguments of a replicated computation, out of the
+// parameters collected from the graph traced on devices[0].
+std::vector<std::vector<xla::ComputationClient::DataPtr>> GetReplicaArguments(
+    const std::vector<xla::ComputationClient::DataPtr>& parameters_data,
+    absl::Span<const std::string> devices) {
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments(
+      devices.size());
+  arguments[0] = parameters_data;
+  for (size_t r = 1; r < devices.size(); ++r) {
+    arguments[r].resize(parameters_data.size());
+  }
+  std::vector<size_t> missing_indices;
+  std::vector<xla::ComputationClient::DataPtr> missing_data;
+  for (size_t i = 0; i < parameters_data.size(); ++i) {
+    std::vector<xla::ComputationClient::DataPtr> replicas =
+        ReplicaDataMap::Get()->Lookup(parameters_data[i], devices);
+    if (replicas.empty()) {
+      missing_indices.push_back(i);
+      missing_data.push_back(parameters_data[i]);
+      continue;
+    }
+    for (size_t r = 1; r < devices.size(); ++r) {
+      arguments[r][i] = std::move(replicas[r - 1]);
+    }
+  }
+  if (!missing_data.empty()) {
+    // Data which does not have replica copies yet (like the initial model
+    // weights) is taken from the first replica.
+    XLA_COUNTER("ReplicaDataBroadcast", missing_data.size());
+    std::vector<std::vector<xla::ComputationClient::DataPtr>> replicas =
+        BroadcastData(missing_data, devices);
+    for (size_t i = 0; i < missing_indices.size(); ++i) {
+      for (size_t r = 1; r < devices.size(); ++r) {
+        arguments[r][missing_indices[i]] = replicas[i][r - 1];
+      }
+      ReplicaDataMap::Get()->Set(missing_data[i], std::move(replicas[i]));
+    }
+  }
+  return arguments;
+}
+
+size_t GetMaxPartitionSize() {
+  static const size_t max_partition_size =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_PARTITION_SIZE", 100000);
+  return max_partition_size;
+}
+
+using PartitionCache =
+    xla::util::Cache<size_t, xla::ComputationClient::Computation>;
+
+// The partitions are cached on their own, by their structure, so that graphs
+// which only differ in some of their partitions share the compilations of the
+// others.
+PartitionCache* GetPartitionCache() {
+  static const size_t kMaxCacheSize =
+      xla::sys_util::GetEnvInt("XLA_PARTITION_CACHE_SIZE", 1024);
+  static PartitionCache* cache = new PartitionCache(kMaxCacheSize);
+  return cache;
+}
+
+// The nodes of a graph partition, along with what flows in and out of it.
+struct PartitionInterface {
+  std::vector<const ir::Node*> nodes;
+  // The outputs of the nodes of former partitions used by this partition.
+  std::vector<ir::Output> inputs;
+  // The device data used by this partition, in order of first use.
+  std::vector<xla::ComputationClient::DataPtr> device_data;
+  // The outputs used by later partitions, or by the roots of the graph.
+  std::vector<ir::Output> results;
+};
+
+// Computes a key which captures the structure of a partition, independently
+// from the nodes before it, so the same partition within different graphs maps
+// to the same computation.
+size_t ComputePartitionKey(const PartitionInterface& partition, size_t seed) {
+  size_t key = seed;
+  ir::OutputMap<size_t> input_positions;
+  for (size_t i = 0; i < partition.inputs.size(); ++i) {
+    input_positions[partition.inputs[i]] = i;
+    key = xla::util::HashCombine(
+        key, xla::util::ShapeHash(partition.inputs[i].shape()));
+  }
+  std::unordered_map<xla::ComputationClient::Data::OpaqueHandle, size_t>
+      data_positions;
+  for (size_t i = 0; i < partition.device_data.size(); ++i) {
+    data_positions[partition.device_data[i]->GetOpaqueHandle()] = i;
+    key = xla::util::HashCombine(
+        key, xla::util::ShapeHash(partition.device_data[i]->shape()));
+  }
+  std::unordered_map<const ir::Node*, size_t> node_positions;
+  auto output_key = [&](const ir::Output& output) -> size_t {
+    const ir::ops::DeviceData* device_data =
+        ir::ops::DeviceData::Cast(output.node);
+    if (device_data != nullptr) {
+      return xla::util::MHash(
+          1, data_positions.at(device_data->data()->GetOpaqueHandle()));
+    }
+    auto it = node_positions.find(output.node);
+    if (it != node_positions.end()) {
+      return xla::util::MHash(2, it->second, output.index);
+    }
+    return xla::util::MHash(3, input_positions.at(output));
+  };
+  for (auto node : partition.nodes) {
+    if (ir::ops::DeviceData::Cast(node) != nullptr) {
+      continue;
+    }
+    for (auto& operand : node->operands()) {
+      key = xla::util::HashCombine(key, output_key(operand));
+    }
+    // The hash of a node with operands does not cover its shape.
+    key = xla::util::HashCombine(key, node->node_hash());
+    key = xla::util::HashCombine(key, xla::util::ShapeHash(node->shape()));
+    node_positions.emplace(node, node_positions.size());
+  }
+  for (auto& result : partition.results) {
+    key = xla::util::HashCombine(key, output_key(result));
+  }
+  return key;
+}
+
+xla::XlaComputation BuildPartitionComputation(
+    const PartitionInterface& partition, const Device& device) {
+  ir::LoweringContext lowering_ctx("SyncTensorsGraphPartition");
+  // The parameters are declared upfront, so that their order only depends on
+  // the structure of the partition.
+  for (auto& input : partition.inputs) {
+    xla::XlaOp param = lowering_ctx.AddParameter(
+        MakeShapeWithDeviceLayout(input.shape(), device.hw_type));
+    lowering_ctx.AssignOutputOp(input, param);
+  }
+  for (auto& data : partition.device_data) {
+    lowering_ctx.GetParameter(data);
+  }
+  for (auto node : partition.nodes) {
+    if (ir::ops::DeviceData::Cast(node) == nullptr) {
+      lowering_ctx.LowerNode(node);
+    }
+  }
+  for (auto& result : partition.results) {
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(result));
+  }
+  return ConsumeValue(lowering_ctx.Build());
+}
+
+// Computes the inputs and results of consecutive ranges of the post-order of
+// the graph of the given roots.
+std::vector<PartitionInterface> ComputePartitionInterfaces(
+    std::vector<std::vector<const ir::Node*>> ranges,
+    absl::Span<const ir::Output> root_outputs) {
+  std::unordered_map<const ir::Node*, size_t> node_to_range;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    for (auto node : ranges[i]) {
+      node_to_range[node] = i;
+    }
+  }
+  // The device data is never passed across partitions, but is rather a direct
+  // parameter of all the partitions using it.
+  ir::OutputSet exported_outputs(root_outputs.begin(), root_outputs.end());
+  for (auto& range : ranges) {
+    for (auto node : range) {
+      for (auto& operand : node->operands()) {
+        if (ir::ops::DeviceData::Cast(operand.node) == nullptr &&
+            node_to_range.at(operand.node) != node_to_range.at(node)) {
+          exported_outputs.insert(operand);
+        }
+      }
+    }
+  }
+  std::vector<PartitionInterface> partitions(ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    PartitionInterface& partition = partitions[i];
+    partition.nodes = std::move(ranges[i]);
+    ir::OutputSet inputs;
+    std::unordered_set<xla::ComputationClient::Data::OpaqueHandle> handles;
+    auto add_device_data = [&](const ir::ops::DeviceData* device_data) {
+      if (handles.insert(device_data->data()->GetOpaqueHandle()).second) {
+        partition.device_data.push_back(device_data->data());
+      }
+    };
+    for (auto node : partition.nodes) {
+      if (ir::ops::DeviceData::Cast(node) != nullptr) {
+        continue;
+      }
+      for (auto& operand : node->operands()) {
+        const ir::ops::DeviceData* device_data =
+            ir::ops::DeviceData::Cast(operand.node);
+        if (device_data != nullptr) {
+          add_device_data(device_data);
+        } else if (node_to_range.at(operand.node) != i &&
+                   inputs.insert(operand).second) {
+          partition.inputs.push_back(operand);
+        }
+      }
+      for (size_t j = 0; j < node->num_outputs(); ++j) {
+        ir::Output output(node, j);
+        if (exported_outputs.count(output) > 0) {
+          partition.results.push_back(output);
+        }
+      }
+    }
+  }
+  // Roots which are device data are passed through the last partition.
+  for (auto& root : root_outputs) {
+    const ir::ops::DeviceData* device_data =
+        ir::ops::DeviceData::Cast(root.node);
+    if (device_data != nullptr) {
+      PartitionInterface& partition = partitions.back();
+      if (std::find(partition.device_data.begin(), partition.device_data.end(),
+                    device_data->data()) == partition.device_data.end()) {
+        partition.device_data.push_back(device_data->data());
+      }
+      partition.results.push_back(root);
+    }
+  }
+  return partitions;
+}
+
+// Lowers the partitions concurrently, each with a builder of its own. The
+// current device is thread local and lowerings depend on it, so the pool
+// threads run with the one of the caller.
+std::vector<xla::XlaComputation> BuildPartitionComputations(
+    absl::Span<const PartitionInterface* const> partitions,
+    const Device& device) {
+  std::vector<xla::XlaComputation> computations(partitions.size());
+  xla::util::MultiWait mwait(partitions.size());
+  Device current_device = GetCurrentDevice();
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    auto builder_fn = [&, i]() {
+      Device previous_device = SetCurrentDevice(current_device);
+      xla::util::ExceptionCleanup restore_device(
+          [&](xla::util::ExceptionCleanup::StatusType) {
+            SetCurrentDevice(previous_device);
+          });
+      computations[i] = BuildPartitionComputation(*partitions[i], device);
+    };
+    xla::env::ScheduleClosure(mwait.Completer(std::move(builder_fn)));
+  }
+  mwait.Wait();
+  return computations;
+}
+
+// Returns the estimated cost by scope of the graph with the given roots, or
+// nullptr unless XLA_SCOPE_COSTS is set.
+std::shared_ptr<const ir::ScopeCosts> MaybeComputeScopeCosts(
+    absl::Span<const ir::Node* const> roots) {
+  static const bool scope_costs =
+      xla::sys_util::GetEnvBool("XLA_SCOPE_COSTS", false);
+  if (!scope_costs) {
+    return nullptr;
+  }
+  XLA_TIMED("ScopeCostAnalysis");
+  return std::make_shared<const ir::ScopeCosts>(
+      ir::ComputeScopeCosts(ir::Util::ComputePostOrder(roots)));
+}
+
+// Whether the current execution of a graph with scope costs must be timed, one
+// every XLA_SCOPE_COSTS_SAMPLE_RATE of them. Only executions on the local CPU
+// client are, since there the wall time of ExecuteComputation() is the time
+// spent in the computation.
+bool ShouldTimeScopeCosts(const std::string& device) {
+  static const xla::int64 sample_rate =
+      xla::sys_util::GetEnvInt("XLA_SCOPE_COSTS_SAMPLE_RATE", 10);
+  static std::atomic<xla::int64> executions(0);
+  if (sample_rate <= 0 || Device(device).hw_type != DeviceType::CPU) {
+    return false;
+  }
+  return executions.fetch_add(1) % sample_rate == 0;
+}
+
+bool MemoryAwareSchedulingEnabled() {
+  static const bool memory_aware_scheduling =
+      xla::sys_util::GetEnvBool("XLA_MEMORY_AWARE_SCHEDULING", false);
+  return memory_aware_scheduling;
+}
+
+// Whether the peak memory of every compiled graph is estimated, and recorded in
+// the EstimatedPeakMemory metric, when XLA_MEMORY_ESTIMATE is set.
+bool MemoryEstimateEnabled() {
+  static const bool memory_estimate =
+      xla::sys_util::GetEnvBool("XLA_MEMORY_ESTIMATE", false);
+  return memory_estimate;
+}
+
+size_t GetParallelLoweringSize() {
+  static const size_t parallel_lowering_size =
+      xla::sys_util::GetEnvInt("XLA_PARALLEL_LOWERING_SIZE", 20000);
+  return parallel_lowering_size;
+}
+
+// Device data with a dynamic dimension can be transferred with the upper bound
+// of its size, in which case the padding past the actual size is dropped.
+xla::Literal SliceLiteralToSizes(xla::Literal literal,
+                                 absl::Span<const xla::int64> sizes) {
+  if (literal.shape().dimensions() == sizes) {
+    return literal;
+  }
+  std::vector<xla::int64> start_indices(sizes.size(), 0);
+  return literal.Slice(start_indices, sizes);
+}
+
 }  // namespace
 
 // The DeviceContextArena holds per device live information and statistics,
@@ -420,6 +867,17 @@ void XLATensor::Async::Wait() {
   }
 }
 
+void* XLATensor::operator new(size_t size) {
+  XLA_CHECK_EQ(size, sizeof(XLATensor));
+  return TensorHandlePool::Get()->Allocate();
+}
+
+void XLATensor::operator delete(void* ptr) {
+  if (ptr != nullptr) {
+    TensorHandlePool::Get()->Release(ptr);
+  }
+}
+
 XLATensor XLATensor::Create(const at::Tensor& tensor, const Device& device) {
   // LOG(FATAL) << "TODO check device";
   XLATensor xtensor(tensor, device);
@@ -490,6 +948,26 @@ xla::int64 XLATensor::size(xla::int64 dim) const {
   return xla_shape.get().dimensions(dim_index);
 }
 
+std::vector<xla::int64> XLATensor::GetSizes() const {
+  c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  if (tensor_data) {
+    return XlaHelpers::I64List(tensor_data->shape());
+  }
+  auto xla_shape = shape();
+  xla::int64 dynamic_dim = XlaHelpers::GetDynamicDimension(xla_shape.get());
+  if (dynamic_dim < 0) {
+    return xla::util::ToVector<xla::int64>(xla_shape.get().dimensions());
+  }
+  if (data()->view == nullptr &&
+      data()->resolved_generation == data()->generation) {
+    return data()->resolved_sizes;
+  }
+  XLA_COUNTER("DynamicSizeSyncs", 1);
+  std::vector<XLATensor> tensors({get_dimensions_size(*this, {dynamic_dim})});
+  SyncTensorsGraph(&tensors, {}, /*wait=*/true, /*sync_xla_data=*/false);
+  return SetResolvedSizes(dynamic_dim, tensors.front());
+}
+
 at::ScalarType XLATensor::dtype() const {
   return data()->logical_element_type ? *data()->logical_element_type
                                       : physical_scalar_type();
@@ -623,8 +1101,13 @@ void XLATensor::AssignIrValue(ir::Value ir_value) const {
 void XLATensor::TryLimitGraphSize() {
   static const size_t kCheckFrequency =
       xla::sys_util::GetEnvInt("TRIM_GRAPH_CHECK_FREQUENCY", 5000);
+  // Graphs larger than XLA_GRAPH_PARTITION_SIZE are partitioned at sync time,
+  // at cut points which do not depend on when the graph happens to be checked.
+  // Trimming is only a last resort against graphs growing without bounds, so
+  // its threshold sits well above the default partition size: with the same
+  // value, pending graphs would be trimmed before ever being partitioned.
   static const size_t kMaxPendingGraphSize =
-      xla::sys_util::GetEnvInt("TRIM_GRAPH_SIZE", 100000);
+      xla::sys_util::GetEnvInt("TRIM_GRAPH_SIZE", 1000000);
   if (data()->ir_value && ++g_tls_data.trim_counter % kCheckFrequency == 0) {
     size_t graph_size = ir::Util::GetGraphSize({data()->ir_value.node.get()});
     if (graph_size > kMaxPendingGraphSize) {
@@ -667,6 +1150,19 @@ void XLATensor::SetTensorData(at::Tensor tensor_data) {
   data()->tensor_data = std::move(tensor_data);
 }
 
+std::vector<xla::int64> XLATensor::SetResolvedSizes(
+    xla::int64 dim, XLATensor dynamic_size) const {
+  std::vector<xla::int64> sizes =
+      xla::util::ToVector<xla::int64>(shape().get().dimensions());
+  sizes[dim] = dynamic_size.ToTensor().item().toLong();
+  // A view can be updated through its alias, without its generation changing.
+  if (data()->view == nullptr) {
+    data()->resolved_sizes = sizes;
+    data()->resolved_generation = data()->generation;
+  }
+  return sizes;
+}
+
 c10::optional<at::Tensor> XLATensor::CurrentTensorData() const {
   if (data()->view != nullptr && !data()->view->IsUpToDate()) {
     return absl::nullopt;
@@ -771,17 +1267,90 @@ XLATensor XLATensor::CreateViewTensor(ViewInfo view_info) const {
 
 at::Tensor XLATensor::ToTensor() {
   c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  if (!tensor_data) {
+    tensor_data = TryEvaluateOnHost();
+  }
   if (!tensor_data) {
     // The GetXlaData() call will trigger an ApplyPendingGraph() if an IR Node
     // is available on the tensor.
     std::vector<xla::Literal> literals =
         xla::ComputationClient::Get()->TransferFromServer({GetXlaData()});
-    tensor_data = MakeTensorFromXlaLiteral(literals.front(), dtype());
+    tensor_data = MakeTensorFromXlaLiteral(
+        SliceLiteralToSizes(std::move(literals.front()), GetSizes()),
+        dtype());
     SetTensorData(*tensor_data);
   }
   return *tensor_data;
 }
 
+c10::optional<at::Tensor> XLATensor::TryEvaluateOnHost() {
+  static const size_t kMaxGraphSize =
+      xla::sys_util::GetEnvInt("XLA_HOST_EVAL_GRAPH_SIZE", 32);
+  static const xla::int64 kMaxElements =
+      xla::sys_util::GetEnvInt("XLA_HOST_EVAL_MAX_ELEMENTS", 1024);
+  if (kMaxGraphSize == 0 || CurrentXlaData() != nullptr) {
+    return absl::nullopt;
+  }
+  ir::Value ir_value = CurrentIrValue();
+  if (!ir_value || !CanEvaluateOnHost(ir_value, kMaxGraphSize, kMaxElements)) {
+    return absl::nullopt;
+  }
+  // The IR value is kept, so the graph keeps growing from it rather than from
+  // an upload of the host result.
+  at::Tensor tensor_data =
+      MakeTensorFromXlaLiteral(EvaluateOnHost(ir_value), dtype());
+  SetTensorData(tensor_data);
+  return tensor_data;
+}
+
+xla::util::AsyncTask<at::Tensor> XLATensor::ToTensorAsync() {
+  c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+  if (tensor_data) {
+    at::Tensor tensor = *tensor_data;
+    xla::util::AsyncTask<at::Tensor> async([tensor]() { return tensor; });
+    async.Schedule();
+    return async;
+  }
+  // The size of a dynamic dimension is fetched together with the data, and
+  // computed by the same execution if the tensor is still pending.
+  std::vector<XLATensor> tensors;
+  if (CurrentXlaData() == nullptr) {
+    tensors.push_back(*this);
+  }
+  xla::int64 dynamic_dim = XlaHelpers::GetDynamicDimension(shape().get());
+  if (dynamic_dim >= 0) {
+    tensors.push_back(get_dimensions_size(*this, {dynamic_dim}));
+  }
+  if (!tensors.empty()) {
+    SyncTensorsGraph(&tensors, {}, /*wait=*/false, /*sync_xla_data=*/false);
+  }
+  std::vector<xla::ComputationClient::DataPtr> xla_data({CurrentXlaData()});
+  XLA_CHECK(xla_data.front() != nullptr);
+  if (dynamic_dim >= 0) {
+    xla_data.push_back(tensors.back().CurrentXlaData());
+  }
+  std::string device = GetDevice().ToString();
+  at::ScalarType type = dtype();
+  xla::util::AsyncTask<at::Tensor> async([xla_data, dynamic_dim, device,
+                                          type]() {
+    // The asynchronous execution filling the xla_data placeholder holds the
+    // device lock, so waiting for the device ops makes the data available.
+    WaitDeviceOps({device});
+    std::vector<xla::Literal> literals =
+        xla::ComputationClient::Get()->TransferFromServer(xla_data);
+    xla::Literal literal = std::move(literals.front());
+    if (dynamic_dim >= 0) {
+      std::vector<xla::int64> sizes =
+          xla::util::ToVector<xla::int64>(literal.shape().dimensions());
+      sizes[dynamic_dim] = *literals.back().GetIntegralAsS64({});
+      literal = SliceLiteralToSizes(std::move(literal), sizes);
+    }
+    return MakeTensorFromXlaLiteral(std::move(literal), type);
+  });
+  async.Schedule();
+  return async;
+}
+
 void XLATensor::ShallowCopyTo(XLATensor* dest) const {
   dest->SetIrValue(GetIrValue());
 }
@@ -864,33 +1433,38 @@ std::vector<at::Tensor> XLATensor::GetTensorsOpByOp(
     async_tensors_data = OpByOpExecutor::Get()->Execute(roots, coll.device, {});
   }
 
-  std::vector<xla::ComputationClient::DataPtr> tensors_data =
-      GatherTensorsXlaData(*tensors, coll.indices, async_tensors_data);
+  return FetchTensors(*tensors, coll.indices, async_tensors_data);
+}
+
+std::vector<at::Tensor> XLATensor::GetTensors(std::vector<XLATensor>* tensors) {
+  static const bool op_by_op =
+      xla::sys_util::GetEnvBool("XLA_GET_TENSORS_OPBYOP", false);
+  return op_by_op ? GetTensorsOpByOp(tensors) : GetTensorsFused(tensors);
+}
+
+std::vector<at::Tensor> XLATensor::FetchTensors(
+    const std::vector<XLATensor>& tensors, absl::Span<const size_t> indices,
+    absl::Span<const xla::ComputationClient::DataPtr> tensors_data) {
   std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(tensors_data);
+      xla::ComputationClient::Get()->TransferFromServer(
+          GatherTensorsXlaData(tensors, indices, tensors_data));
   std::vector<at::Tensor> results;
   size_t literals_index = 0;
-  results.reserve(tensors->size());
-  for (size_t i = 0; i < tensors->size(); ++i) {
-    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
+  results.reserve(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    c10::optional<at::Tensor> tensor_data = tensors[i].CurrentTensorData();
     if (tensor_data) {
       results.push_back(*tensor_data);
     } else {
       XLA_CHECK_LT(literals_index, literals.size());
-      results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                 (*tensors)[i].dtype()));
+      results.push_back(MakeTensorFromXlaLiteral(
+          std::move(literals[literals_index]), tensors[i].dtype()));
       ++literals_index;
     }
   }
   return results;
 }
 
-std::vector<at::Tensor> XLATensor::GetTensors(std::vector<XLATensor>* tensors) {
-  static const bool op_by_op =
-      xla::sys_util::GetEnvBool("XLA_GET_TENSORS_OPBYOP", false);
-  return op_by_op ? GetTensorsOpByOp(tensors) : GetTensorsFused(tensors);
-}
-
 std::vector<at::Tensor> XLATensor::GetTensorsFused(
     std::vector<XLATensor>* tensors) {
   SyncTensorsConfig config;
@@ -899,30 +1473,10 @@ std::vector<at::Tensor> XLATensor::GetTensorsFused(
   if (async != nullptr) {
     async->mwait.Wait();
   }
-  std::vector<xla::ComputationClient::DataPtr> tensors_data =
-      GatherTensorsXlaData(
-          *tensors,
-          async != nullptr ? async->indices : absl::Span<const size_t>(),
-          async != nullptr
-              ? async->tensors_data
-              : absl::Span<const xla::ComputationClient::DataPtr>());
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(tensors_data);
-  std::vector<at::Tensor> results;
-  size_t literals_index = 0;
-  results.reserve(tensors->size());
-  for (size_t i = 0; i < tensors->size(); ++i) {
-    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
-    if (tensor_data) {
-      results.push_back(*tensor_data);
-    } else {
-      XLA_CHECK_LT(literals_index, literals.size());
-      results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                 (*tensors)[i].dtype()));
-      ++literals_index;
-    }
-  }
-  return results;
+  return FetchTensors(
+      *tensors, async != nullptr ? async->indices : absl::Span<const size_t>(),
+      async != nullptr ? async->tensors_data
+                       : absl::Span<const xla::ComputationClient::DataPtr>());
 }
 
 std::vector<XLATensor> XLATensor::CreateTensors(
@@ -998,7 +1552,16 @@ void XLATensor::ApplyPendingGraph() {
   // device, so that a call to CurrentXlaData() returns a valid pointer.
   if (CurrentXlaData() == nullptr) {
     std::vector<XLATensor> tensors({*this});
+    // The size of a dynamic dimension is computed by the same execution, so
+    // that fetching the data later on does not run the graph a second time.
+    xla::int64 dynamic_dim = XlaHelpers::GetDynamicDimension(shape().get());
+    if (dynamic_dim >= 0) {
+      tensors.push_back(get_dimensions_size(*this, {dynamic_dim}));
+    }
     SyncTensorsGraph(&tensors, {}, /*wait=*/true, /*sync_xla_data=*/false);
+    if (dynamic_dim >= 0) {
+      SetResolvedSizes(dynamic_dim, tensors.back());
+    }
   }
 }
 
@@ -1017,8 +1580,12 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   std::vector<std::string> devices;
   std::vector<size_t> at_tensor_index;
   // The force_xla_data controls aliasing compilation, so effectively the same
-  // graph with on/off force_xla_data should not match, hash wise.
-  coll.hash = xla::util::MHash(config.force_xla_data);
+  // graph with on/off force_xla_data should not match, hash wise. Parameters
+  // are not aliased either while a checkpoint snapshot holds device buffers,
+  // which could otherwise be overwritten before being fetched.
+  coll.alias_parameters = ParamAliasingEnabled() && config.force_xla_data &&
+                          !HasPendingCheckpointSnapshots();
+  coll.hash = xla::util::MHash(config.force_xla_data, coll.alias_parameters);
   coll.config = config;
   coll.device = unique_device->ToString();
   coll.indices.reserve(tensors.size());
@@ -1173,6 +1740,12 @@ std::vector<xla::ComputationClient::DataPtr> XLATensor::FetchTensorData(
           MakeShapeWithDeviceLayout(tensor.shape(), tensor_device.hw_type);
       xla_data = xla::ComputationClient::Get()->CreateDataPlaceholder(
           tensor_device.ToString(), std::move(shape));
+      ir::Value ir_value = tensor.CurrentIrValue();
+      if (ir_value && xla::memory::IsTrackingEnabled()) {
+        xla::memory::SetTag(xla_data.get(), {xla::memory::Kind::kActivation,
+                                             ir_value->op().ToString(),
+                                             ir_value->metadata().scope});
+      }
       tensor.SetXlaData(xla_data, config.sync_xla_data);
     }
     tensors_data.emplace_back(std::move(xla_data));
@@ -1194,16 +1767,36 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
     try {
       TF_VLOG(3) << "Executing IR graph hash " << hash << " on device "
                  << async->device << " ...";
-      auto results = xla::ComputationClient::Get()->ExecuteComputation(
-          *async->cached_computation->computation, async->parameters_data,
-          async->device, options);
+      const ir::ScopeCosts* scope_costs =
+          async->cached_computation->scope_costs.get();
+      xla::int64 start_nanos = -1;
+      if (scope_costs != nullptr && ShouldTimeScopeCosts(async->device)) {
+        start_nanos = xla::sys_util::NowNs();
+      }
+      std::vector<xla::ComputationClient::DataPtr> results;
+      if (async->cached_computation->partitioned_computation != nullptr) {
+        results = ExecutePartitioned(
+            *async->cached_computation->partitioned_computation,
+            async->parameters_data, async->device);
+      } else {
+        results = xla::ComputationClient::Get()->ExecuteComputation(
+            *async->cached_computation->computation, async->parameters_data,
+            async->device, options);
+      }
       TF_VLOG(3) << "Executing IR graph hash " << hash << " on device "
                  << async->device << " done!";
+      if (scope_costs != nullptr) {
+        ir::RecordScopeCosts(
+            *scope_costs,
+            start_nanos >= 0 ? xla::sys_util::NowNs() - start_nanos : -1);
+      }
 
       for (size_t i = 0; i < results.size(); ++i) {
         if (async->tensors_data[i] != nullptr) {
           async->tensors_data[i]->Assign(*results[i]);
         } else {
+          xla::memory::SetTag(results[i].get(),
+                              {xla::memory::Kind::kActivation});
           async->tensors_data[i] = std::move(results[i]);
         }
       }
@@ -1268,8 +1861,118 @@ void XLATensor::SyncLiveTensorsGraph(const Device* device,
   SyncTensorsGraph(&tensors, devices, wait, /*sync_xla_data=*/true);
 }
 
+void XLATensor::SetReplicaTensors(const XLATensor& tensor,
+                                  absl::Span<const XLATensor> replicas) {
+  std::vector<xla::ComputationClient::DataPtr> replicas_data;
+  replicas_data.reserve(replicas.size());
+  for (XLATensor replica : replicas) {
+    replicas_data.push_back(replica.GetXlaData());
+  }
+  XLATensor primary = tensor;
+  ReplicaDataMap::Get()->Set(primary.GetXlaData(), std::move(replicas_data));
+}
+
+void XLATensor::SyncTensorsGraphReplicated(
+    std::vector<XLATensor>* tensors, absl::Span<const std::string> devices) {
+  XLA_CHECK(!devices.empty());
+  SyncTensorsConfig config;
+  SyncTensorCollection coll = CollectSyncTensors(*tensors, config);
+  if (coll.indices.empty()) {
+    return;
+  }
+  XLA_CHECK_EQ(coll.device, devices.front())
+      << "Replicated graphs must be traced on the first replica device";
+  // The same graph compiled for a different set of replicas is a different
+  // computation.
+  coll.hash = xla::util::HashCombine(coll.hash, xla::util::Hash(devices));
+  DebugUtil::SaveTensorsGraphInfo("SyncTensorsGraphReplicated", *tensors,
+                                  &coll.indices);
+
+  std::vector<xla::ComputationClient::DataPtr> parameters_data;
+  ComputationCache::TypePtr cached_computation = LookupCachedCompile(
+      *tensors, coll.hash, coll.indices, &parameters_data);
+  // Partitioned computations cannot be replicated, so they are recompiled as a
+  // whole here.
+  if (cached_computation == nullptr ||
+      cached_computation->computation == nullptr) {
+    CompilationResult compile_result =
+        Compile(*tensors, devices, coll, GetParallelLoweringSize());
+    XLA_VALUE_METRIC("TensorsGraphSize", compile_result.emitted_nodes);
+    TF_VLOG(5) << "TensorsGraphSize=" << compile_result.emitted_nodes;
+
+    cached_computation = std::make_shared<CachedComputation>(
+        std::move(compile_result.computation),
+        compile_result.parameters_data.size());
+    GetComputationCache()->Add(coll.hash, cached_computation);
+    parameters_data = std::move(compile_result.parameters_data);
+  }
+
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments =
+      GetReplicaArguments(parameters_data, devices);
+  TF_VLOG(3) << "Executing IR graph hash " << coll.hash << " on devices "
+             << absl::StrJoin(devices, ",") << " ...";
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results =
+      xla::ComputationClient::Get()->ExecuteReplicated(
+          *cached_computation->computation, arguments, devices,
+          xla::ComputationClient::ExecuteReplicatedOptions());
+  TF_VLOG(3) << "Executing IR graph hash " << coll.hash << " on devices "
+             << absl::StrJoin(devices, ",") << " done!";
+
+  // The first replica results become the tensors data, while the other ones
+  // are kept as their copies, to be fed to the next replicated execution.
+  std::vector<xla::ComputationClient::DataPtr> tensors_data =
+      FetchTensorData(tensors, coll.config, coll.indices);
+  for (size_t i = 0; i < tensors_data.size(); ++i) {
+    tensors_data[i]->Assign(*results[0][i]);
+    std::vector<xla::ComputationClient::DataPtr> replicas;
+    replicas.reserve(results.size() - 1);
+    for (size_t r = 1; r < results.size(); ++r) {
+      replicas.push_back(std::move(results[r][i]));
+    }
+    ReplicaDataMap::Get()->Set(tensors_data[i], std::move(replicas));
+  }
+  ReplicaDataMap::Get()->Purge();
+}
+
+void XLATensor::SyncLiveTensorsGraphReplicated(
+    absl::Span<const std::string> devices) {
+  XLA_CHECK(!devices.empty());
+  Device device(devices.front());
+  auto tensors = GetLiveTensors(&device);
+  TF_VLOG(4) << tensors.size() << " live tensors: replicated on devices=["
+             << absl::StrJoin(devices, ",") << "]";
+  SyncTensorsGraphReplicated(&tensors, devices);
+}
+
+xla::int64 XLATensor::EstimateLiveTensorsPeakMemory(const Device* device) {
+  std::vector<XLATensor> tensors = GetLiveTensors(device);
+  xla::util::Unique<Device> unique_device;
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    ir::Value ir_value = tensors[i].CurrentIrValue();
+    if (tensors[i].CurrentXlaData() == nullptr && ir_value &&
+        ShouldSyncIrValue(ir_value)) {
+      unique_device.set(tensors[i].GetDevice());
+      indices.push_back(i);
+    }
+  }
+  if (indices.empty()) {
+    return 0;
+  }
+  ir::LoweringContext lowering_ctx("EstimateLiveTensorsPeakMemory");
+  LowerGraph(tensors, indices, *unique_device, GetParallelLoweringSize(),
+             &lowering_ctx);
+  // The same aliasing as the one of a step barrier.
+  if (ParamAliasingEnabled() && !HasPendingCheckpointSnapshots()) {
+    BuildInputOutputAliases(tensors, indices, &lowering_ctx);
+  }
+  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+  return EstimateMemory(computation.proto()).peak_bytes;
+}
+
 void XLATensor::MarkStep(const Device* device) {
   XLA_COUNTER("MarkStep", 1);
+  xla::memory::MarkStep();
   DeviceContextArena::Get()->ClearProfileData(device);
   ir::ScopePusher::ResetScopes();
   g_tls_data.Reset();
@@ -1383,20 +2086,116 @@ void XLATensor::BuildInputOutputAliases(const std::vector<XLATensor>& tensors,
   XLA_VALUE_METRIC("InputOutputAliasCount", alias_map.size());
 }
 
+size_t XLATensor::LowerGraph(const std::vector<XLATensor>& tensors,
+                             absl::Span<const size_t> indices,
+                             const Device& device,
+                             size_t parallel_lowering_size,
+                             ir::LoweringContext* lowering_ctx) {
+  std::vector<ir::Value> roots = CollectRoots(tensors, indices);
+  std::vector<const ir::Node*> root_nodes;
+  for (auto& root : roots) {
+    root_nodes.push_back(root.node.get());
+  }
+  std::vector<const ir::Node*> post_order =
+      ir::Util::ComputePostOrder(root_nodes);
+  size_t num_threads = std::thread::hardware_concurrency();
+  if (parallel_lowering_size == 0 || num_threads < 2 ||
+      post_order.size() < 2 * parallel_lowering_size) {
+    if (!MemoryAwareSchedulingEnabled()) {
+      for (auto& root : roots) {
+        lowering_ctx->AddResult(lowering_ctx->GetOutputOp(root));
+      }
+      return lowering_ctx->GetEmittedNodeCount();
+    }
+    // The parameters are declared in post-order, as cached computations are
+    // fed with the FetchParameters() data, and the nodes are then lowered in
+    // the order keeping the fewest activations live.
+    for (auto node : post_order) {
+      const ir::ops::DeviceData* device_data = ir::ops::DeviceData::Cast(node);
+      if (device_data != nullptr) {
+        lowering_ctx->GetParameter(device_data->data());
+      }
+    }
+    std::vector<ir::Output> root_outputs(roots.begin(), roots.end());
+    for (auto node : ir::ScheduleForMemory(post_order, root_outputs)) {
+      lowering_ctx->LowerNode(node);
+    }
+    for (auto& root : roots) {
+      lowering_ctx->AddResult(lowering_ctx->GetOutputOp(root));
+    }
+    return post_order.size();
+  }
+
+  // The graph is split in ranges of its post-order, which are lowered into
+  // computations of their own concurrently, and then stitched together with
+  // calls, which XLA inlines back during compilation.
+  std::vector<ir::Output> root_outputs(roots.begin(), roots.end());
+  size_t max_range_size =
+      std::max(parallel_lowering_size,
+               (post_order.size() + num_threads - 1) / num_threads);
+  std::vector<PartitionInterface> partitions = ComputePartitionInterfaces(
+      ir::PartitionGraph(post_order, root_outputs, max_range_size),
+      root_outputs);
+  std::vector<const PartitionInterface*> build_partitions;
+  for (auto& partition : partitions) {
+    if (!partition.results.empty()) {
+      build_partitions.push_back(&partition);
+    }
+  }
+  std::vector<xla::XlaComputation> computations =
+      BuildPartitionComputations(build_partitions, device);
+  XLA_COUNTER("ParallelLoweredGraphs", 1);
+
+  // The parameters are declared in post-order, as a sequential lowering would
+  // do, since cached computations are fed with the FetchParameters() data.
+  for (auto node : post_order) {
+    const ir::ops::DeviceData* device_data = ir::ops::DeviceData::Cast(node);
+    if (device_data != nullptr) {
+      lowering_ctx->GetParameter(device_data->data());
+    }
+  }
+  for (size_t i = 0; i < build_partitions.size(); ++i) {
+    const PartitionInterface& partition = *build_partitions[i];
+    std::vector<xla::XlaOp> arguments;
+    for (auto& input : partition.inputs) {
+      arguments.push_back(lowering_ctx->GetOutputOp(input));
+    }
+    for (auto& data : partition.device_data) {
+      arguments.push_back(lowering_ctx->GetParameter(data));
+    }
+    xla::XlaOp call =
+        xla::Call(lowering_ctx->builder(), computations[i], arguments);
+    for (size_t j = 0; j < partition.results.size(); ++j) {
+      lowering_ctx->AssignOutputOp(partition.results[j],
+                                   xla::GetTupleElement(call, j));
+    }
+  }
+  for (auto& root : root_outputs) {
+    lowering_ctx->AddResult(lowering_ctx->GetOutputOp(root));
+  }
+  return post_order.size();
+}
+
 XLATensor::CompilationResult XLATensor::Compile(
     const std::vector<XLATensor>& tensors,
-    absl::Span<const std::string> devices, const SyncTensorCollection& coll) {
-  static const bool enable_aliasing =
-      xla::sys_util::GetEnvBool("XLA_ENABLE_PARAM_ALIASING", false);
+    absl::Span<const std::string> devices, const SyncTensorCollection& coll,
+    size_t parallel_lowering_size) {
   xla::util::Unique<Device> unique_device;
-  ir::LoweringContext lowering_ctx("SyncTensorsGraph");
+  std::vector<const ir::Node*> root_nodes;
   for (auto index : coll.indices) {
-    ir::Value ir_value = tensors[index].CurrentIrValue();
-    xla::XlaOp root = lowering_ctx.GetOutputOp(ir_value);
-    lowering_ctx.AddResult(root);
     unique_device.set(tensors[index].GetDevice());
+    root_nodes.push_back(tensors[index].CurrentIrValue().node.get());
+  }
+  ir::LoweringContext lowering_ctx("SyncTensorsGraph");
+  size_t emitted_nodes = 0;
+  {
+    XLA_TIMED("LowerGraph");
+    emitted_nodes = LowerGraph(tensors, coll.indices, *unique_device,
+                               parallel_lowering_size, &lowering_ctx);
   }
-  if (enable_aliasing && coll.config.force_xla_data) {
+  std::shared_ptr<const ir::ScopeCosts> scope_costs =
+      MaybeComputeScopeCosts(root_nodes);
+  if (coll.alias_parameters) {
     // We can only alias at the step barrier, when force_xla_data is true.
     // Consider the case:
     //   1. Tensor A(DEVICE_DATA)
@@ -1424,7 +2223,20 @@ XLATensor::CompilationResult XLATensor::Compile(
     BuildInputOutputAliases(tensors, coll.indices, &lowering_ctx);
   }
 
-  xla::XlaComputation computation = ConsumeValue(lowering_ctx.Build());
+  xla::XlaComputation computation;
+  {
+    XLA_TIMED("BuildGraph");
+    computation = ConsumeValue(lowering_ctx.Build());
+  }
+  if (MemoryEstimateEnabled()) {
+    MemoryEstimate memory_estimate = EstimateMemory(computation.proto());
+    static xla::metrics::Metric* peak_memory_metric = new xla::metrics::Metric(
+        "EstimatedPeakMemory", xla::metrics::MetricFnBytes);
+    peak_memory_metric->AddSample(memory_estimate.peak_bytes);
+    TF_VLOG(3) << "Estimated peak memory of IR graph hash " << coll.hash
+               << ": " << memory_estimate.peak_bytes << " bytes ("
+               << memory_estimate.parameter_bytes << " of parameters)";
+  }
   xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
   xla::Shape shape =
       MakeShapeWithDeviceLayout(program_shape.result(), unique_device->hw_type);
@@ -1448,9 +2260,171 @@ XLATensor::CompilationResult XLATensor::Compile(
   XLA_CHECK_EQ(program_shape.parameters_size(), parameters_data.size());
 
   return {/*device=*/*unique_device,
-          /*emitted_nodes=*/lowering_ctx.GetEmittedNodeCount(),
+          /*emitted_nodes=*/emitted_nodes,
           /*computation=*/std::move(computations.front()),
-          /*parameters_data=*/std::move(parameters_data)};
+          /*parameters_data=*/std::move(parameters_data),
+          /*partitioned_computation=*/nullptr,
+          /*scope_costs=*/std::move(scope_costs)};
+}
+
+XLATensor::CompilationResult XLATensor::CompilePartitioned(
+    const std::vector<XLATensor>& tensors,
+    absl::Span<const std::string> devices, const SyncTensorCollection& coll,
+    size_t max_partition_size) {
+  xla::util::Unique<Device> unique_device;
+  std::vector<ir::Value> roots = CollectRoots(tensors, coll.indices);
+  std::vector<ir::Output> root_outputs;
+  std::vector<const ir::Node*> root_nodes;
+  for (size_t i = 0; i < roots.size(); ++i) {
+    root_outputs.push_back(roots[i]);
+    root_nodes.push_back(roots[i].node.get());
+    unique_device.set(tensors[coll.indices[i]].GetDevice());
+  }
+  std::vector<const ir::Node*> post_order =
+      ir::Util::ComputePostOrder(root_nodes);
+  std::vector<std::vector<const ir::Node*>> ranges =
+      ir::PartitionGraph(post_order, root_outputs, max_partition_size);
+  XLA_COUNTER("PartitionedGraphs", 1);
+  XLA_VALUE_METRIC("GraphPartitions", ranges.size());
+  TF_VLOG(3) << "Partitioning IR graph hash " << coll.hash << " of "
+             << post_order.size() << " nodes in " << ranges.size()
+             << " partitions";
+
+  std::vector<PartitionInterface> partitions =
+      ComputePartitionInterfaces(std::move(ranges), root_outputs);
+
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      FetchParameters(tensors, coll.indices, /*graph_size=*/nullptr);
+  std::unordered_map<xla::ComputationClient::Data::OpaqueHandle, size_t>
+      parameter_indices;
+  for (size_t i = 0; i < parameters_data.size(); ++i) {
+    parameter_indices[parameters_data[i]->GetOpaqueHandle()] = i;
+  }
+  std::string device = unique_device->ToString();
+  std::vector<std::string> compilation_devices =
+      xla::ComputationClient::Get()->GetCompilationDevices(device, devices);
+  size_t key_seed = xla::util::MHash(device, compilation_devices);
+
+  auto partitioned_computation = std::make_shared<PartitionedComputation>();
+  ir::OutputMap<PartitionValue> result_values;
+  std::vector<size_t> compile_keys;
+  std::vector<const PartitionInterface*> compile_partitions;
+  std::unordered_map<size_t, size_t> compile_key_instances;
+  std::vector<std::pair<size_t, size_t>> pending_partitions;
+  for (auto& partition : partitions) {
+    // A partition made only of device data nodes has nothing to compute.
+    if (partition.results.empty()) {
+      continue;
+    }
+    size_t partition_index = partitioned_computation->partitions.size();
+    PartitionComputation partition_computation;
+    for (auto& input : partition.inputs) {
+      partition_computation.inputs.push_back(result_values.at(input));
+    }
+    for (auto& data : partition.device_data) {
+      partition_computation.inputs.push_back(
+          {-1, parameter_indices.at(data->GetOpaqueHandle())});
+    }
+    size_t key = ComputePartitionKey(partition, key_seed);
+    partition_computation.computation = GetPartitionCache()->Get(key);
+    if (partition_computation.computation == nullptr) {
+      XLA_COUNTER("PartitionCacheMiss", 1);
+      auto it = compile_key_instances.find(key);
+      if (it == compile_key_instances.end()) {
+        compile_partitions.push_back(&partition);
+        compile_keys.push_back(key);
+        it = compile_key_instances.emplace(key, compile_keys.size() - 1).first;
+      }
+      pending_partitions.emplace_back(partition_index, it->second);
+    }
+    for (size_t i = 0; i < partition.results.size(); ++i) {
+      result_values[partition.results[i]] = {
+          static_cast<xla::int64>(partition_index), i};
+    }
+    partitioned_computation->partitions.push_back(
+        std::move(partition_computation));
+  }
+  for (auto& root : root_outputs) {
+    partitioned_computation->outputs.push_back(result_values.at(root));
+  }
+
+  if (!compile_partitions.empty()) {
+    std::vector<xla::XlaComputation> partition_computations;
+    {
+      XLA_TIMED("LowerGraph");
+      partition_computations =
+          BuildPartitionComputations(compile_partitions, *unique_device);
+    }
+    std::list<xla::Shape> compile_shapes;
+    std::vector<xla::ComputationClient::CompileInstance> instances;
+    for (auto& computation : partition_computations) {
+      xla::ProgramShape program_shape =
+          ConsumeValue(computation.GetProgramShape());
+      compile_shapes.push_back(MakeShapeWithDeviceLayout(
+          program_shape.result(), unique_device->hw_type));
+      instances.push_back({std::move(computation), device, compilation_devices,
+                           &compile_shapes.back()});
+    }
+    TF_VLOG(3) << "Compiling " << instances.size() << " partitions of IR graph "
+               << "hash " << coll.hash << " on device " << device << " ...";
+    std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
+        computations =
+            xla::ComputationClient::Get()->Compile(std::move(instances));
+    TF_VLOG(3) << "Compiling " << computations.size()
+               << " partitions of IR graph hash " << coll.hash
+               << " on device " << device << " done!";
+    for (size_t i = 0; i < computations.size(); ++i) {
+      GetPartitionCache()->Add(compile_keys[i], computations[i]);
+    }
+    for (auto& partition_instance : pending_partitions) {
+      partitioned_computation->partitions[partition_instance.first]
+          .computation = computations[partition_instance.second];
+    }
+  }
+
+  return {/*device=*/*unique_device,
+          /*emitted_nodes=*/post_order.size(),
+          /*computation=*/nullptr,
+          /*parameters_data=*/std::move(parameters_data),
+          /*partitioned_computation=*/std::move(partitioned_computation),
+          /*scope_costs=*/MaybeComputeScopeCosts(root_nodes)};
+}
+
+std::vector<xla::ComputationClient::DataPtr> XLATensor::ExecutePartitioned(
+    const PartitionedComputation& partitioned_computation,
+    absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+    const std::string& device) {
+  using ChainedOp = xla::ComputationClient::ExecuteChainedOp;
+  const std::vector<PartitionComputation>& partitions =
+      partitioned_computation.partitions;
+  // The parameters of the graph come first within the chained ops, followed by
+  // the partitions in execution order. Partition results are tuples, so their
+  // values are picked by index, while device data is used as is. The runtime
+  // releases every intermediate result once its last user has been dispatched.
+  std::vector<ChainedOp> ops(parameters_data.size() + partitions.size());
+  for (size_t i = 0; i < parameters_data.size(); ++i) {
+    ops[i].device_data = parameters_data[i];
+  }
+  auto get_input = [&](const PartitionValue& value) {
+    return value.partition < 0
+               ? ChainedOp::Input{static_cast<size_t>(value.index),
+                                  absl::nullopt}
+               : ChainedOp::Input{parameters_data.size() + value.partition,
+                                  static_cast<size_t>(value.index)};
+  };
+  for (size_t i = 0; i < partitions.size(); ++i) {
+    ChainedOp& op = ops[parameters_data.size() + i];
+    op.computation = partitions[i].computation;
+    op.inputs.reserve(partitions[i].inputs.size());
+    for (auto& input : partitions[i].inputs) {
+      op.inputs.push_back(get_input(input));
+    }
+  }
+  for (size_t i = 0; i < partitioned_computation.outputs.size(); ++i) {
+    ChainedOp::Input value = get_input(partitioned_computation.outputs[i]);
+    ops[value.op_index].outputs.push_back({i, value.output_index});
+  }
+  return xla::ComputationClient::Get()->ExecuteChained(ops, device);
 }
 
 std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
@@ -1467,15 +2441,27 @@ std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
   if (async != nullptr) {
     return async;
   }
+  DebugUtil::SaveTensorsGraphBinary(*tensors, &coll.indices, coll.hash);
 
-  CompilationResult compile_result = Compile(*tensors, devices, coll);
+  size_t max_partition_size = GetMaxPartitionSize();
+  std::vector<const ir::Node*> root_nodes;
+  for (auto& root : CollectRoots(*tensors, coll.indices)) {
+    root_nodes.push_back(root.node.get());
+  }
+  CompilationResult compile_result =
+      max_partition_size > 0 &&
+              ir::Util::GetGraphSize(root_nodes) > max_partition_size
+          ? CompilePartitioned(*tensors, devices, coll, max_partition_size)
+          : Compile(*tensors, devices, coll, GetParallelLoweringSize());
 
   XLA_VALUE_METRIC("TensorsGraphSize", compile_result.emitted_nodes);
   TF_VLOG(5) << "TensorsGraphSize=" << compile_result.emitted_nodes;
 
   auto cached_computation = std::make_shared<CachedComputation>(
       std::move(compile_result.computation),
-      compile_result.parameters_data.size());
+      compile_result.parameters_data.size(),
+      std::move(compile_result.partitioned_computation),
+      std::move(compile_result.scope_costs));
   GetComputationCache()->Add(coll.hash, cached_computation);
 
   return ScheduleSyncTensorsGraph(
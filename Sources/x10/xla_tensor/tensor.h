@@ -26,6 +26,7 @@
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/cost_analysis.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/cross_replica_reduces.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
@@ -59,6 +60,12 @@ class XLATensor {
   // Creates an empty/null tensor.
   XLATensor() = default;
 
+  // Heap allocated XLATensor objects are the handles owned by the language
+  // bindings, which create and destroy one of them for every traced op. Their
+  // storage is recycled through a free list shared by all threads.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   bool is_null() const { return data_ptr() == nullptr; }
 
   size_t generation() const { return data()->generation; }
@@ -67,8 +74,22 @@ class XLATensor {
 
   xla::int64 size(xla::int64 dim) const;
 
+  // Returns the dimensions of the tensor, with the actual size of a dynamic
+  // dimension (see nonzero() and masked_select()) instead of its upper bound.
+  // Such a size is only known on device, so reading it executes the graph
+  // computing it, while the tensor itself stays pending. Ops applied to such a
+  // tensor are traced with the upper bound, which is what shape() returns,
+  // and their XLA shapes carry the dynamic dimension along: elementwise ops
+  // keep it, so GetSizes() of their results resolves to the same size.
+  std::vector<xla::int64> GetSizes() const;
+
   at::Tensor ToTensor();
 
+  // Like ToTensor(), but does not block waiting for pending device operations.
+  // The pending IR graph is scheduled for execution, and the returned task
+  // fetches the value to host once the device data becomes available.
+  xla::util::AsyncTask<at::Tensor> ToTensorAsync();
+
   void ShallowCopyTo(XLATensor* dest) const;
 
   // Assigns the tensor value to the XLA tensor.
@@ -119,6 +140,11 @@ class XLATensor {
   // Applies the queue of operations in preparation for using the data.
   void ApplyPendingGraph();
 
+  // Evaluates the pending IR graph on the host when it is tiny (see
+  // XLA_HOST_EVAL_GRAPH_SIZE), storing the result as tensor data. Returns
+  // absl::nullopt if the graph has to be run on device.
+  c10::optional<at::Tensor> TryEvaluateOnHost();
+
   static ir::Value GetIrValueForScalar(at::Scalar value,
                                        xla::PrimitiveType type,
                                        const Device& device);
@@ -166,6 +192,34 @@ class XLATensor {
                                    absl::Span<const std::string> devices,
                                    bool wait);
 
+  // Registers the copies of the tensor device data which the other replicas of
+  // a replicated sync use, with replicas[i] living on the (i+1)-th replica
+  // device.
+  static void SetReplicaTensors(const XLATensor& tensor,
+                                absl::Span<const XLATensor> replicas);
+
+  // Like SyncTensorsGraph(), but the graph is traced, compiled and hashed once,
+  // and then executed on all the devices via ExecuteReplicated(). The tensors
+  // must live on devices[0]. The other replicas are fed with the copies of the
+  // parameters registered by SetReplicaTensors() or produced by previous
+  // replicated syncs, or with a broadcast of the devices[0] data if no copy is
+  // available. The sync operation is run synchronously.
+  static void SyncTensorsGraphReplicated(std::vector<XLATensor>* tensors,
+                                         absl::Span<const std::string> devices);
+
+  // Replicated version of SyncLiveTensorsGraph(), for the live tensors of
+  // devices[0].
+  static void SyncLiveTensorsGraphReplicated(
+      absl::Span<const std::string> devices);
+
+  // Returns the estimated peak device memory, in bytes, needed to run the
+  // graph which SyncLiveTensorsGraph() would run for the live tensors, along
+  // with its parameters (see EstimateMemory()). Nothing is compiled nor run, so
+  // a step can be traced with a candidate batch size and checked against the
+  // device memory before its barrier. The device data not used by the graph is
+  // not accounted.
+  static xla::int64 EstimateLiveTensorsPeakMemory(const Device* device);
+
   // Marks an execution step, which allows the tensor framework to understand
   // the computation boundaries.
   static void MarkStep(const Device* device);
@@ -441,7 +495,8 @@ class XLATensor {
   static void div_(XLATensor& input, at::Scalar other);
 
   // A generalized contraction between tensors of arbitrary dimension defined by
-  // the given equation and applied to the input tensors.
+  // the given equation and applied to the input tensors. More than two tensors
+  // are contracted pairwise, in the order computed by GetEinsumPlan().
   static XLATensor einsum(const std::string& equation,
                           absl::Span<const XLATensor> tensors);
 
@@ -864,6 +919,23 @@ class XLATensor {
 
   static void copy_(XLATensor& input, XLATensor& src);
 
+  // Runs a body over the leading dimension of the xs sequences, in a single
+  // loop (see ir::ops::Scan). The parameters are the placeholders created by
+  // scan_parameter() for the carried values and then for the steps of the
+  // sequences, and the results are the tensors the body computes from them:
+  // the new carried values, followed by the steps of the output sequences.
+  // Returns the final carried values, followed by the output sequences.
+  static std::vector<XLATensor> scan(absl::Span<const XLATensor> init,
+                                     absl::Span<const XLATensor> xs,
+                                     absl::Span<const XLATensor> parameters,
+                                     absl::Span<const XLATensor> results,
+                                     xla::int64 length, bool reverse);
+
+  // Creates the placeholder for the index-th parameter of a scan body, which
+  // is like input, or like a step of input if it is a sequence.
+  static XLATensor scan_parameter(const XLATensor& input, xla::int64 index,
+                                  bool sequence);
+
   static void scatter_(XLATensor& input, xla::int64 dim, const XLATensor& index,
                        const XLATensor& src);
   static void scatter_(XLATensor& input, xla::int64 dim, const XLATensor& index,
@@ -1172,6 +1244,8 @@ class XLATensor {
   static XLATensor xla_truncated_normal(const XLATensor& input);
 
  private:
+  friend class XLATensorTestUtil;
+
   struct SyncTensorsConfig {
     // Whether we want to force XLA data on the target tensors (hence trimming
     // the IR graph above them).
@@ -1185,25 +1259,62 @@ class XLATensor {
     SyncTensorsConfig config;
     std::vector<size_t> indices;
     size_t hash = 0;
+    // Whether the compiled graph may alias its parameters with its outputs.
+    bool alias_parameters = false;
     std::vector<xla::util::ExceptionCleanup> unlocker;
     std::string device;
   };
 
+  // A value flowing into or out of a graph partition: the index-th result of
+  // an earlier partition, or the index-th parameter of the whole graph when
+  // partition is negative.
+  struct PartitionValue {
+    xla::int64 partition = -1;
+    size_t index = 0;
+  };
+
+  struct PartitionComputation {
+    std::shared_ptr<xla::ComputationClient::Computation> computation;
+    std::vector<PartitionValue> inputs;
+  };
+
+  // Oversized graphs are split in partitions (see ir::PartitionGraph()), which
+  // are compiled separately and chained on the device (see
+  // ExecutePartitioned()), instead of as a single computation.
+  struct PartitionedComputation {
+    std::vector<PartitionComputation> partitions;
+    // The value of every result of the whole graph.
+    std::vector<PartitionValue> outputs;
+  };
+
   struct CompilationResult {
     Device device;
     size_t emitted_nodes = 0;
     std::shared_ptr<xla::ComputationClient::Computation> computation;
     std::vector<xla::ComputationClient::DataPtr> parameters_data;
+    std::shared_ptr<PartitionedComputation> partitioned_computation;
+    std::shared_ptr<const ir::ScopeCosts> scope_costs;
   };
 
   struct CachedComputation {
     CachedComputation(
         std::shared_ptr<xla::ComputationClient::Computation> computation,
-        size_t num_parameters)
-        : computation(std::move(computation)), num_parameters(num_parameters) {}
+        size_t num_parameters,
+        std::shared_ptr<PartitionedComputation> partitioned_computation =
+            nullptr,
+        std::shared_ptr<const ir::ScopeCosts> scope_costs = nullptr)
+        : computation(std::move(computation)),
+          num_parameters(num_parameters),
+          partitioned_computation(std::move(partitioned_computation)),
+          scope_costs(std::move(scope_costs)) {}
 
     std::shared_ptr<xla::ComputationClient::Computation> computation;
     size_t num_parameters;
+    // Set instead of computation when the graph has been partitioned.
+    std::shared_ptr<PartitionedComputation> partitioned_computation;
+    // The estimated cost of the graph by scope, only computed when
+    // XLA_SCOPE_COSTS is set, and accounted at every execution.
+    std::shared_ptr<const ir::ScopeCosts> scope_costs;
   };
 
   using ComputationCache = xla::util::Cache<size_t, CachedComputation>;
@@ -1263,6 +1374,10 @@ class XLATensor {
     const Device device;
     const xla::int64 unique_id = 0;
     size_t generation = 1;
+    // The sizes resolved by GetSizes(), valid as long as the generation does
+    // not change.
+    std::vector<xla::int64> resolved_sizes;
+    size_t resolved_generation = 0;
   };
 
   XLATensor(const at::Tensor& tensor, const Device& device);
@@ -1290,6 +1405,12 @@ class XLATensor {
 
   void SetTensorData(at::Tensor tensor_data);
 
+  // Stores the sizes of the tensor, given its synced dynamic_size tensor (a
+  // get_dimensions_size() of the dynamic dimension dim), so that GetSizes()
+  // does not fetch them again until the tensor changes.
+  std::vector<xla::int64> SetResolvedSizes(xla::int64 dim,
+                                           XLATensor dynamic_size) const;
+
   ir::Value CreateTensorNode(xla::ComputationClient::DataPtr data) const;
 
   View::IrNode GetViewUpdate(const std::shared_ptr<View>& view) const;
@@ -1388,9 +1509,40 @@ class XLATensor {
                                       absl::Span<const size_t> indices,
                                       ir::LoweringContext* lowering_ctx);
 
+  // Lowers the graph of the given tensors into lowering_ctx, concurrently for
+  // graphs larger than parallel_lowering_size nodes (never if zero), and
+  // returns the number of lowered nodes.
+  static size_t LowerGraph(const std::vector<XLATensor>& tensors,
+                           absl::Span<const size_t> indices,
+                           const Device& device, size_t parallel_lowering_size,
+                           ir::LoweringContext* lowering_ctx);
+
   static CompilationResult Compile(const std::vector<XLATensor>& tensors,
                                    absl::Span<const std::string> devices,
-                                   const SyncTensorCollection& coll);
+                                   const SyncTensorCollection& coll,
+                                   size_t parallel_lowering_size);
+
+  // Turns the device data of the synced tensors into CPU tensors, along with
+  // the CPU data of the other tensors.
+  static std::vector<at::Tensor> FetchTensors(
+      const std::vector<XLATensor>& tensors, absl::Span<const size_t> indices,
+      absl::Span<const xla::ComputationClient::DataPtr> tensors_data);
+
+  // Like Compile(), but splits the graph in partitions of at most
+  // max_partition_size nodes.
+  static CompilationResult CompilePartitioned(
+      const std::vector<XLATensor>& tensors,
+      absl::Span<const std::string> devices, const SyncTensorCollection& coll,
+      size_t max_partition_size);
+
+  // Chains the partitions on device via ExecuteChained(), feeding the results
+  // of each partition to the following ones without any host round trip, and
+  // returns the results of the whole graph. A partition is dispatched without
+  // waiting for the previous ones to complete.
+  static std::vector<xla::ComputationClient::DataPtr> ExecutePartitioned(
+      const PartitionedComputation& partitioned_computation,
+      absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+      const std::string& device);
 
   static std::shared_ptr<Async> SyncTensorsGraphInternal(
       std::vector<XLATensor>* tensors, absl::Span<const std::string> devices,
@@ -98,6 +98,8 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/rrelu_with_noise.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/rrelu_with_noise_backward.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/scalar.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scan.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/scan_parameter.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/scatter.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/scatter_add.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/shrink_backward.h"
@@ -303,6 +305,12 @@ ViewInfo CreateAsStridedViewInfo(const xla::Shape& input_shape,
                   input_shape, as_strided_info);
 }
 
+// The type of the devices a cross replica reduction of the inputs runs on.
+DeviceType GetReduceDeviceType(const std::vector<XLATensor>& inputs) {
+  XLA_CHECK(!inputs.empty()) << "Cross replica reduction without inputs";
+  return inputs.front().GetDevice().hw_type;
+}
+
 }  // namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -312,8 +320,9 @@ std::pair<XLATensor, ir::Value> XLATensor::all_reduce(
     const XLATensor& input, const ir::Value& token, AllReduceType reduce_type,
     double scale, const std::vector<std::vector<xla::int64>>& groups) {
   std::vector<ir::Value> input_values({input.GetIrValue()});
-  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(reduce_type, input_values,
-                                                      token, scale, groups);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(
+      reduce_type, input_values, token, scale, groups,
+      input.GetDevice().hw_type);
   return {input.CreateFrom(ir::Value(node, 0)), ir::Value(node, 1)};
 }
 
@@ -326,8 +335,9 @@ std::pair<std::vector<XLATensor>, ir::Value> XLATensor::all_reduce(
   for (const XLATensor& input : inputs) {
     input_values.push_back(input.GetIrValue());
   }
-  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(reduce_type, input_values,
-                                                      token, scale, groups);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(
+      reduce_type, input_values, token, scale, groups,
+      GetReduceDeviceType(inputs));
   std::vector<XLATensor> results;
   std::vector<ir::Value> tokens;
   for (size_t i = 0; i < inputs.size(); ++i) {
@@ -340,8 +350,9 @@ ir::Value XLATensor::all_reduce_(
     XLATensor& input, const ir::Value& token, AllReduceType reduce_type,
     double scale, const std::vector<std::vector<xla::int64>>& groups) {
   std::vector<ir::Value> input_values({input.GetIrValue()});
-  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(reduce_type, input_values,
-                                                      token, scale, groups);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(
+      reduce_type, input_values, token, scale, groups,
+      input.GetDevice().hw_type);
   input.SetIrValue(ir::Value(node, 0));
   return ir::Value(node, 1);
 }
@@ -355,8 +366,9 @@ ir::Value XLATensor::all_reduce_(
   for (auto& input : *inputs) {
     input_values.push_back(input.GetIrValue());
   }
-  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(reduce_type, input_values,
-                                                      token, scale, groups);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(
+      reduce_type, input_values, token, scale, groups,
+      GetReduceDeviceType(*inputs));
   for (size_t i = 0; i < inputs->size(); ++i) {
     (*inputs)[i].SetIrValue(ir::Value(node, i));
   }
@@ -1003,7 +1015,7 @@ XLATensor XLATensor::einsum(const std::string& equation,
   for (const auto& tensor : tensors) {
     tensor_ir_values.push_back(tensor.GetIrValue());
   }
-  XLA_CHECK_EQ(tensors.size(), 2);
+  XLA_CHECK(!tensors.empty());
   return tensors[0].CreateFrom(
       ir::MakeNode<ir::ops::Einsum>(equation, tensor_ir_values));
 }
@@ -2114,6 +2126,55 @@ void XLATensor::copy_(XLATensor& input, XLATensor& src) {
   }
 }
 
+std::vector<XLATensor> XLATensor::scan(
+    absl::Span<const XLATensor> init, absl::Span<const XLATensor> xs,
+    absl::Span<const XLATensor> parameters,
+    absl::Span<const XLATensor> results, xla::int64 length, bool reverse) {
+  XLA_CHECK(!init.empty() || !xs.empty())
+      << "A scan needs carried values or sequences";
+  std::vector<ir::Value> init_values;
+  for (auto& tensor : init) {
+    init_values.push_back(tensor.GetIrValue());
+  }
+  std::vector<ir::Value> xs_values;
+  for (auto& tensor : xs) {
+    xs_values.push_back(tensor.GetIrValue());
+  }
+  std::vector<ir::NodePtr> parameter_nodes;
+  for (auto& tensor : parameters) {
+    ir::Value value = tensor.GetIrValue();
+    XLA_CHECK(ir::ops::ScanParameter::Cast(value.node.get()) != nullptr)
+        << "Not a scan parameter: " << value->ToString();
+    parameter_nodes.push_back(std::move(value.node));
+  }
+  std::vector<ir::Value> result_values;
+  for (auto& tensor : results) {
+    result_values.push_back(tensor.GetIrValue());
+  }
+  ir::NodePtr node = ir::ops::Scan::Create(
+      init_values, xs_values, length, std::move(parameter_nodes),
+      std::move(result_values), reverse);
+  const XLATensor& like = init.empty() ? xs.front() : init.front();
+  std::vector<XLATensor> outputs;
+  for (size_t i = 0; i < results.size(); ++i) {
+    outputs.push_back(like.CreateFrom(ir::Value(node, i), results[i].dtype()));
+  }
+  return outputs;
+}
+
+XLATensor XLATensor::scan_parameter(const XLATensor& input, xla::int64 index,
+                                    bool sequence) {
+  xla::Shape shape = input.shape().get();
+  if (sequence) {
+    XLA_CHECK_GT(shape.rank(), 0);
+    shape = xla::ShapeUtil::MakeShape(
+        shape.element_type(),
+        XlaHelpers::DropDimensions(shape.dimensions(), {0}));
+  }
+  return input.CreateFrom(
+      ir::MakeNode<ir::ops::ScanParameter>(std::move(shape), index));
+}
+
 void XLATensor::scatter_(XLATensor& input, xla::int64 dim,
                          const XLATensor& index, const XLATensor& src) {
   input.SetIrValue(ir::MakeNode<ir::ops::Scatter>(
@@ -21,12 +21,15 @@
 #include <thread>
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
@@ -382,6 +385,7 @@ void TensorToBufferSType(const at::Tensor& tensor, const xla::Shape& dest_shape,
 void PopulateTensorBuffer(const at::Tensor& tensor,
                           const xla::Shape& dest_shape, void* dest_buffer,
                           size_t dest_buffer_size, const Device& device) {
+  XLA_COUNTER("HostCopiedBytes", dest_buffer_size);
   switch (tensor.scalar_type()) {
     case at::ScalarType::Double:
       TensorToBufferSType<double>(tensor, dest_shape, dest_buffer,
@@ -438,9 +442,51 @@ at::Tensor XlaLiteralToTensor(const xla::Literal& literal,
   std::unique_ptr<DType[]> data(new DType[total_elements]);
   CopyTensors<SType, DType>(literal_data.data(), literal.shape(), data.get(),
                             total_elements * sizeof(DType), swift_shape);
+  XLA_COUNTER("HostCopiedBytes", total_elements * sizeof(DType));
   return at::Tensor(std::move(data), std::move(dimensions));
 }
 
+// Implementation of Scalar buffer which adopts the storage of an XLA literal,
+// so that data fetched from the device can be exposed without a host copy.
+class LiteralScalarBuffer : public at::AnyScalarBuffer {
+ public:
+  LiteralScalarBuffer(xla::Literal literal, at::ScalarType type)
+      : at::AnyScalarBuffer(type), literal_(std::move(literal)) {
+    set_base(literal_.untyped_data());
+    set_size(xla::ShapeUtil::ElementsIn(literal_.shape()));
+  }
+
+ private:
+  xla::Literal literal_;
+};
+
+// Returns true if the XLA type and the tensor type have the same host
+// representation, so that no element conversion is required between them.
+bool IsSameHostType(xla::PrimitiveType xla_type, at::ScalarType type) {
+  switch (xla_type) {
+    case xla::PrimitiveType::PRED:
+      return type == at::ScalarType::Bool;
+    case xla::PrimitiveType::BF16:
+      return type == at::ScalarType::BFloat16;
+    case xla::PrimitiveType::F32:
+      return type == at::ScalarType::Float;
+    case xla::PrimitiveType::F64:
+      return type == at::ScalarType::Double;
+    case xla::PrimitiveType::U8:
+      return type == at::ScalarType::Byte;
+    case xla::PrimitiveType::S8:
+      return type == at::ScalarType::Char;
+    case xla::PrimitiveType::S16:
+      return type == at::ScalarType::Short;
+    case xla::PrimitiveType::S32:
+      return type == at::ScalarType::Int;
+    case xla::PrimitiveType::S64:
+      return type == at::ScalarType::Long;
+    default:
+      return false;
+  }
+}
+
 template <typename SType>
 at::Tensor XlaLiteralToTensorHelper(const xla::Literal& literal,
                                     at::ScalarType dest_element_type) {
@@ -469,6 +515,35 @@ at::Tensor XlaLiteralToTensorHelper(const xla::Literal& literal,
   }
 }
 
+// Returns the tensor host buffer if it can be handed to the computation client
+// as is, or nullptr if it needs to be converted into the device shape first.
+const void* GetDirectTensorData(const at::Tensor& tensor,
+                                const xla::Shape& dest_shape,
+                                const Device& device) {
+  xla::Shape src_shape = MakeSwiftTensorLayout(
+      XlaHelpers::I64List(tensor.shape()), /*dynamic_dimensions=*/{},
+      XlaTypeFromTensorType(tensor.scalar_type(), device));
+  if (!xla::ShapeUtil::Equal(src_shape, dest_shape) ||
+      tensor.buffer().raw_size() != xla::ShapeUtil::ByteSizeOf(dest_shape)) {
+    return nullptr;
+  }
+  return tensor.buffer().raw_data();
+}
+
+// Accounts the data transferred from the host as parameters of the current
+// scope.
+void TagTransferredData(
+    absl::Span<const xla::ComputationClient::DataPtr> handles) {
+  if (!xla::memory::IsTrackingEnabled()) {
+    return;
+  }
+  std::string scope = ir::ScopePusher::CurrentScope();
+  for (auto& handle : handles) {
+    xla::memory::SetTag(handle.get(),
+                        {xla::memory::Kind::kParameter, "", scope});
+  }
+}
+
 }  // namespace
 
 std::vector<xla::int64> ComputeShapeStrides(const xla::Shape& shape) {
@@ -517,6 +592,43 @@ at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
   }
 }
 
+at::Tensor MakeTensorFromXlaLiteral(xla::Literal&& literal,
+                                    at::ScalarType dest_element_type) {
+  const xla::Shape& shape = literal.shape();
+  if (!shape.IsArray() ||
+      !IsSameHostType(shape.element_type(), dest_element_type) ||
+      !xla::ShapeUtil::Equal(
+          shape, MakeSwiftTensorLayout(shape.dimensions(),
+                                       /*dynamic_dimensions=*/{},
+                                       shape.element_type()))) {
+    return MakeTensorFromXlaLiteral(static_cast<const xla::Literal&>(literal),
+                                    dest_element_type);
+  }
+  XLA_COUNTER("AdoptedLiteralBuffers", 1);
+  std::vector<int64_t> dimensions =
+      xla::util::ToVector<int64_t>(shape.dimensions());
+  return at::Tensor(std::make_unique<LiteralScalarBuffer>(std::move(literal),
+                                                          dest_element_type),
+                    std::move(dimensions));
+}
+
+at::Tensor MakeTensorFromHostBuffer(at::ScalarType type, const void* data,
+                                    std::vector<int64_t> dims) {
+  size_t num_elements = at::GetLenFromShape(dims);
+  switch (type) {
+#define DEFINE_HOST_BUFFER_CASE(name, aten_name, DType)                    \
+  case at::ScalarType::aten_name:                                          \
+    return at::Tensor(std::make_unique<at::NonOwnedAnyScalarBuffer<DType>>( \
+                          reinterpret_cast<const DType*>(data),            \
+                          num_elements),                                   \
+                      std::move(dims));
+    LIST_SCALAR_TYPES(DEFINE_HOST_BUFFER_CASE)
+#undef DEFINE_HOST_BUFFER_CASE
+    default:
+      XLA_ERROR() << "Invalid scalar type: " << type;
+  }
+}
+
 xla::ComputationClient::TensorSource TensorToTensorSource(
     const at::Tensor& tensor, const Device& device) {
   const at::Tensor* tensor_ptr = &tensor;
@@ -529,8 +641,11 @@ xla::ComputationClient::TensorSource TensorToTensorSource(
                              dest_buffer_size, *device_ptr);
       };
 
-  return {CreateComputationShapeFromTensor(tensor, &device), device.ToString(),
-          std::move(populate_fn)};
+  xla::ComputationClient::TensorSource source_tensor(
+      CreateComputationShapeFromTensor(tensor, &device), device.ToString(),
+      std::move(populate_fn));
+  source_tensor.data = GetDirectTensorData(tensor, source_tensor.shape, device);
+  return source_tensor;
 }
 
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
@@ -545,10 +660,12 @@ xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
 
   std::vector<xla::ComputationClient::TensorSource> source_tensors;
   source_tensors.emplace_back(shape, device.ToString(), std::move(populate_fn));
+  source_tensors.back().data = GetDirectTensorData(tensor, shape, device);
 
   auto handles =
       xla::ComputationClient::Get()->TransferToServer(source_tensors);
   XLA_CHECK_EQ(handles.size(), 1);
+  TagTransferredData(handles);
   return std::move(handles.front());
 }
 
@@ -574,8 +691,13 @@ std::vector<xla::ComputationClient::DataPtr> CreateTensorsData(
         };
     source_tensors.emplace_back(std::move(shape), devices[i],
                                 std::move(populate_fn));
+    source_tensors.back().data =
+        GetDirectTensorData(tensors[i], source_tensors.back().shape, device);
   }
-  return xla::ComputationClient::Get()->TransferToServer(source_tensors);
+  std::vector<xla::ComputationClient::DataPtr> handles =
+      xla::ComputationClient::Get()->TransferToServer(source_tensors);
+  TagTransferredData(handles);
+  return handles;
 }
 
 xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
@@ -37,6 +37,17 @@ std::vector<xla::int64> ComputeArrayStrides(absl::Span<const xla::int64> sizes);
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type);
 
+// Same as above, but if the literal already has the host layout and element
+// representation of the destination type, the returned tensor adopts the
+// literal storage instead of copying it.
+at::Tensor MakeTensorFromXlaLiteral(xla::Literal&& literal,
+                                    at::ScalarType dest_element_type);
+
+// Wraps a host buffer holding elements of the given type within a tensor,
+// without copying it. The buffer must outlive the returned tensor.
+at::Tensor MakeTensorFromHostBuffer(at::ScalarType type, const void* data,
+                                    std::vector<int64_t> dims);
+
 // Uploads an ATEN tensor data to the device and fetches the corresponding
 // device data handle.
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
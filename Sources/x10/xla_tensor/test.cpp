@@ -12,10 +12,35 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <set>
+
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/cost_analysis.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_serialization.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_estimator.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/memory_scheduler.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/op_by_op_executor.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/all_reduce.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/token.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/test_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/xla_lower_util.h"
 
 // clang-format off
 // For TPU, run with:
@@ -26,9 +51,220 @@ using swift_xla::Device;
 using swift_xla::DeviceType;
 using swift_xla::GetDefaultDevice;
 using swift_xla::XLATensor;
+using swift_xla::XLATensorTestUtil;
+
+namespace ir = swift_xla::ir;
 
 namespace {
 
+// The number of checks which failed, which makes the test exit with an error.
+int g_failures = 0;
+
+// Reports the outcome of a check.
+void ExpectMatches(const std::string& name, bool matches) {
+  absl::PrintF("%s: %s\n", name, matches ? "OK" : "MISMATCH");
+  if (!matches) {
+    ++g_failures;
+  }
+}
+
+// Whether the two float tensors have the same shape, and elements which differ
+// by at most tolerance.
+bool TensorsClose(const at::Tensor& lhs, const at::Tensor& rhs,
+                  float tolerance = 1e-5) {
+  if (lhs.shape() != rhs.shape()) {
+    return false;
+  }
+  auto lhs_data = lhs.data<float>();
+  auto rhs_data = rhs.data<float>();
+  for (size_t i = 0; i < lhs_data.size(); ++i) {
+    if (!(std::abs(lhs_data[i] - rhs_data[i]) <= tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs the graph of the values as a single computation, as the sync of the
+// tensors holding them does, and fetches the results.
+std::vector<at::Tensor> RunFused(absl::Span<const ir::Value> roots,
+                                 const Device& device) {
+  std::vector<XLATensor> tensors;
+  for (auto& root : roots) {
+    tensors.push_back(XLATensor::Create(root, device));
+  }
+  XLATensor::SyncTensorsGraph(&tensors, {}, /*wait=*/true,
+                              /*sync_xla_data=*/false);
+  std::vector<at::Tensor> results;
+  for (auto& tensor : tensors) {
+    results.push_back(tensor.ToTensor());
+  }
+  return results;
+}
+
+// Runs the graph of the values with the executor, and fetches the results.
+std::vector<at::Tensor> RunOpByOp(swift_xla::OpByOpExecutor* executor,
+                                  absl::Span<const ir::Value> roots,
+                                  const Device& device) {
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(
+          executor->Execute(roots, device.ToString(), {}));
+  std::vector<at::Tensor> results;
+  for (size_t i = 0; i < literals.size(); ++i) {
+    results.push_back(swift_xla::MakeTensorFromXlaLiteral(
+        std::move(literals[i]),
+        swift_xla::TensorTypeFromXlaType(roots[i].shape().element_type())));
+  }
+  return results;
+}
+
+bool AllTensorsClose(absl::Span<const at::Tensor> lhs,
+                     absl::Span<const at::Tensor> rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (!TensorsClose(lhs[i], rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Builds runs of elementwise and reduction nodes around a matrix product, and
+// returns the tensors holding the first run, the second one and its sum.
+std::vector<XLATensor> BuildMixedGraph(const Device& device) {
+  at::Tensor a({0.5, -1, 2, 0.25, 1.5, -0.75}, {2, 3});
+  at::Tensor b({1, 2, -0.5, 0.125, 3, -2}, {3, 2});
+  XLATensor x = XLATensor::Create(a, device);
+  XLATensor y = XLATensor::Create(b, device);
+  XLATensor hidden = XLATensor::tanh(XLATensor::mul(XLATensor::exp(x), x));
+  XLATensor product = XLATensor::mm(hidden, y);
+  XLATensor output = XLATensor::sigmoid(
+      XLATensor::add(product, XLATensor::neg(product), at::Scalar(0.5)));
+  XLATensor total = XLATensor::sum(output, {0, 1},
+                                   /*keep_reduced_dimensions=*/false,
+                                   c10::nullopt);
+  return {hidden, output, total};
+}
+
+// A row-major matrix on the host, for checking decompositions.
+struct HostMatrix {
+  HostMatrix(int64_t rows, int64_t cols)
+      : rows(rows), cols(cols), data(rows * cols, 0) {}
+
+  float& at(int64_t i, int64_t j) { return data[i * cols + j]; }
+  float at(int64_t i, int64_t j) const { return data[i * cols + j]; }
+
+  int64_t rows;
+  int64_t cols;
+  std::vector<float> data;
+};
+
+HostMatrix ToHostMatrix(const at::Tensor& tensor) {
+  XLA_CHECK(tensor.rank() == 2) << "Not a matrix";
+  HostMatrix matrix(tensor.shape()[0], tensor.shape()[1]);
+  auto data = tensor.data<float>();
+  matrix.data.assign(data.begin(), data.end());
+  return matrix;
+}
+
+HostMatrix Transposed(const HostMatrix& matrix) {
+  HostMatrix result(matrix.cols, matrix.rows);
+  for (int64_t i = 0; i < matrix.rows; ++i) {
+    for (int64_t j = 0; j < matrix.cols; ++j) {
+      result.at(j, i) = matrix.at(i, j);
+    }
+  }
+  return result;
+}
+
+HostMatrix Multiply(const HostMatrix& lhs, const HostMatrix& rhs) {
+  XLA_CHECK_EQ(lhs.cols, rhs.rows);
+  HostMatrix result(lhs.rows, rhs.cols);
+  for (int64_t i = 0; i < lhs.rows; ++i) {
+    for (int64_t j = 0; j < rhs.cols; ++j) {
+      double sum = 0;
+      for (int64_t k = 0; k < lhs.cols; ++k) {
+        sum += static_cast<double>(lhs.at(i, k)) * rhs.at(k, j);
+      }
+      result.at(i, j) = sum;
+    }
+  }
+  return result;
+}
+
+// Scales the columns of the matrix by the values.
+HostMatrix ScaleColumns(const HostMatrix& matrix, const at::Tensor& values) {
+  auto data = values.data<float>();
+  XLA_CHECK_EQ(data.size(), static_cast<size_t>(matrix.cols));
+  HostMatrix result = matrix;
+  for (int64_t i = 0; i < matrix.rows; ++i) {
+    for (int64_t j = 0; j < matrix.cols; ++j) {
+      result.at(i, j) *= data[j];
+    }
+  }
+  return result;
+}
+
+HostMatrix Identity(int64_t n) {
+  HostMatrix result(n, n);
+  for (int64_t i = 0; i < n; ++i) {
+    result.at(i, i) = 1;
+  }
+  return result;
+}
+
+bool MatricesClose(const HostMatrix& lhs, const HostMatrix& rhs,
+                   float tolerance = 1e-3) {
+  if (lhs.rows != rhs.rows || lhs.cols != rhs.cols) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.data.size(); ++i) {
+    if (!(std::abs(lhs.data[i] - rhs.data[i]) <= tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether the columns of the matrix are orthonormal.
+bool HasOrthonormalColumns(const HostMatrix& matrix) {
+  return MatricesClose(Multiply(Transposed(matrix), matrix),
+                       Identity(matrix.cols));
+}
+
+// Returns a rows x cols matrix of rank min(rank, rows, cols), with entries of
+// magnitude around one.
+HostMatrix MakeMatrix(int64_t rows, int64_t cols, int64_t rank) {
+  HostMatrix lhs(rows, rank);
+  for (size_t i = 0; i < lhs.data.size(); ++i) {
+    lhs.data[i] = std::sin(1.7 * i + 0.3);
+  }
+  HostMatrix rhs(rank, cols);
+  for (size_t i = 0; i < rhs.data.size(); ++i) {
+    rhs.data[i] = std::cos(0.9 * i + 1.1);
+  }
+  return Multiply(lhs, rhs);
+}
+
+// Returns a symmetric n x n matrix, positive definite if rank is at least n.
+HostMatrix MakeSymmetricMatrix(int64_t n, int64_t rank) {
+  HostMatrix root = MakeMatrix(n, rank, rank);
+  HostMatrix result = Multiply(root, Transposed(root));
+  if (rank >= n) {
+    for (int64_t i = 0; i < n; ++i) {
+      result.at(i, i) += 1;
+    }
+  }
+  return result;
+}
+
+XLATensor CreateMatrixTensor(const HostMatrix& matrix, const Device& device) {
+  return XLATensor::Create(at::Tensor(matrix.data, {matrix.rows, matrix.cols}),
+                           device);
+}
+
 void WithAllDevices(
     DeviceType device_type,
     const std::function<void(const std::vector<Device>&,
@@ -95,9 +331,696 @@ void TestSingleReplication(const std::vector<Device>& all_devices) {
   }
 }
 
+void TestHostEvaluation(const Device& device) {
+  // The same tiny graph is evaluated on the host, and on device by forcing its
+  // execution, and the two results are cross-checked.
+  at::Tensor a({0.5, -2, 3, 0.25}, {4});
+  auto make_graph = [&]() {
+    XLATensor input = XLATensor::Create(a, device);
+    XLATensor exp = XLATensor::exp(XLATensor::mul(input, at::Scalar(0.5)));
+    return XLATensor::sum(XLATensor::sub(exp, input, at::Scalar(1.0)), {0},
+                          /*keep_reduced_dimensions=*/false, c10::nullopt);
+  };
+  XLATensor host_result = make_graph();
+  c10::optional<at::Tensor> host_tensor = host_result.TryEvaluateOnHost();
+  XLATensor device_result = make_graph();
+  device_result.ApplyPendingGraph();
+  at::Tensor device_tensor = device_result.ToTensor();
+  // The graph is well within XLA_HOST_EVAL_GRAPH_SIZE, so it must have been
+  // evaluated on the host.
+  ExpectMatches("host evaluation applies", host_tensor.has_value());
+  if (!host_tensor) {
+    return;
+  }
+  float host_value = host_tensor->data<float>()[0];
+  float device_value = device_tensor.data<float>()[0];
+  absl::PrintF("host evaluation: %g, device: %g\n", host_value, device_value);
+  ExpectMatches("host evaluation",
+                std::abs(host_value - device_value) <= 1e-5);
+}
+
+void TestNonZero(const Device& device) {
+  // The indices are padded to the number of input elements, and the count of
+  // nonzero values is only fetched when the sizes or the data are read.
+  at::Tensor a({0, 1.5, 0, -2, 3, 0}, {6});
+  XLATensor input = XLATensor::Create(a, device);
+  XLATensor indices = XLATensor::nonzero(input);
+  xla::int64 upper_bound = indices.shape().get().dimensions(0);
+  std::vector<xla::int64> sizes = indices.GetSizes();
+  at::Tensor result = indices.ToTensor();
+  std::vector<int64_t> expected = {1, 3, 4};
+  bool matches = result.shape() == std::vector<int64_t>({3, 1}) &&
+                 std::vector<int64_t>(result.data<int64_t>().begin(),
+                                      result.data<int64_t>().end()) == expected;
+  absl::PrintF("nonzero: upper bound %d, size %d\n", upper_bound, sizes[0]);
+  ExpectMatches("nonzero", matches);
+}
+
+void TestDynamicSizes(const Device& device) {
+  // masked_select keeps its result padded on device. An elementwise op applied
+  // to it traces with the upper bound, and keeps the dynamic dimension, so its
+  // sizes resolve to the count of selected values as well. Both fetch paths
+  // slice the padding off.
+  at::Tensor a({1, -2, 3, -4, 5, 6}, {6});
+  XLATensor input = XLATensor::Create(a, device);
+  XLATensor selected =
+      XLATensor::masked_select(input, XLATensor::gt(input, at::Scalar(0.0)));
+  XLATensor negated = XLATensor::neg(selected);
+  auto values_match = [](const at::Tensor& tensor,
+                         const std::vector<float>& expected) {
+    return tensor.shape() == std::vector<int64_t>({4}) &&
+           std::vector<float>(tensor.data<float>().begin(),
+                              tensor.data<float>().end()) == expected;
+  };
+  bool matches = negated.shape().get().dimensions(0) == 6 &&
+                 negated.GetSizes() == std::vector<xla::int64>({4}) &&
+                 values_match(negated.ToTensor(), {-1, -3, -5, -6});
+  ExpectMatches("masked_select downstream sizes", matches);
+  ExpectMatches("masked_select",
+                values_match(selected.ToTensor(), {1, 3, 5, 6}));
+
+  // The async fetch computes the size within the execution of the pending
+  // graph.
+  XLATensor pending =
+      XLATensor::masked_select(input, XLATensor::gt(input, at::Scalar(0.0)));
+  at::Tensor fetched = pending.ToTensorAsync().Wait().ConsumeValue();
+  ExpectMatches("masked_select async fetch",
+                values_match(fetched, {1, 3, 5, 6}));
+}
+
+void TestEinsum(const Device& device) {
+  // A chain of three matrices, where contracting the last two first is cheaper,
+  // checked against a product computed on the host.
+  at::Tensor a({1, 2, 3, 4, 5, 6}, {3, 2});
+  at::Tensor b({1, -1, 2, 0, 1, -2, 0.5, 3}, {2, 4});
+  at::Tensor c({2, 1, 0, -1}, {4, 1});
+  XLATensor result = XLATensor::einsum(
+      "ij,jk,kl->il", {XLATensor::Create(a, device),
+                       XLATensor::Create(b, device),
+                       XLATensor::Create(c, device)});
+  at::Tensor result_tensor = result.ToTensor();
+  bool matches = result_tensor.shape() == std::vector<int64_t>({3, 1});
+  for (int64_t i = 0; matches && i < 3; ++i) {
+    float expected = 0;
+    for (int64_t j = 0; j < 2; ++j) {
+      for (int64_t k = 0; k < 4; ++k) {
+        expected += a.data<float>()[i * 2 + j] * b.data<float>()[j * 4 + k] *
+                    c.data<float>()[k];
+      }
+    }
+    matches = std::abs(result_tensor.data<float>()[i] - expected) <= 1e-4;
+  }
+  ExpectMatches("einsum", matches);
+
+  // Ten operands, more than the optimal planner handles, so the contraction
+  // order is chosen greedily. The entries are scaled by the number of rows so
+  // that the magnitude of the chained products stays around one.
+  std::vector<int64_t> sizes = {3, 2, 5, 4, 1, 6, 2, 3, 4, 2, 3};
+  std::vector<std::string> terms;
+  std::vector<XLATensor> chain;
+  HostMatrix expected_chain = Identity(sizes[0]);
+  for (size_t i = 0; i + 1 < sizes.size(); ++i) {
+    HostMatrix factor(sizes[i], sizes[i + 1]);
+    for (size_t j = 0; j < factor.data.size(); ++j) {
+      factor.data[j] = std::sin(1.3 * j + 0.7 * i) / sizes[i];
+    }
+    terms.push_back(std::string{static_cast<char>('a' + i),
+                                static_cast<char>('a' + i + 1)});
+    chain.push_back(CreateMatrixTensor(factor, device));
+    expected_chain = Multiply(expected_chain, factor);
+  }
+  std::string equation = absl::StrJoin(terms, ",") + "->ak";
+  ExpectMatches("einsum (greedy)",
+                MatricesClose(ToHostMatrix(XLATensor::einsum(equation, chain)
+                                               .ToTensor()),
+                              expected_chain));
+
+  // Implicit output: the labels occurring once, in sorted order, so "ki,kj"
+  // yields an [i, j] result and "ij,ji" a scalar. Two operands take the same
+  // path as more.
+  HostMatrix x = MakeMatrix(3, 2, 2);
+  HostMatrix y = MakeMatrix(3, 4, 3);
+  HostMatrix z = MakeMatrix(4, 3, 3);
+  XLATensor x_tensor = CreateMatrixTensor(x, device);
+  XLATensor y_tensor = CreateMatrixTensor(y, device);
+  XLATensor z_tensor = CreateMatrixTensor(z, device);
+  HostMatrix xy =
+      ToHostMatrix(XLATensor::einsum("ki,kj", {x_tensor, y_tensor}).ToTensor());
+  HostMatrix xyz = ToHostMatrix(
+      XLATensor::einsum("ki,kj,jl", {x_tensor, y_tensor, z_tensor})
+          .ToTensor());
+  at::Tensor trace =
+      XLATensor::einsum("ij,ji", {y_tensor, z_tensor}).ToTensor();
+  HostMatrix yz = Multiply(y, z);
+  float expected_trace = yz.at(0, 0) + yz.at(1, 1) + yz.at(2, 2);
+  ExpectMatches("einsum (implicit)",
+                MatricesClose(xy, Multiply(Transposed(x), y)) &&
+                    MatricesClose(xyz, Multiply(Multiply(Transposed(x), y), z),
+                                  /*tolerance=*/1e-2) &&
+                    trace.rank() == 0 &&
+                    std::abs(trace.data<float>()[0] - expected_trace) <= 1e-2);
+}
+
+void TestScan(const Device& device) {
+  // A running sum of scaled values, where the scale is captured by the body,
+  // in both directions.
+  at::Tensor xs({1, 2, 3, 4}, {4});
+  XLATensor scale = XLATensor::Create(at::Tensor({2}, {}), device);
+  for (bool reverse : {false, true}) {
+    XLATensor init = XLATensor::Create(at::Tensor({0}, {}), device);
+    XLATensor sequence = XLATensor::Create(xs, device);
+    XLATensor carried = XLATensor::scan_parameter(init, /*index=*/0,
+                                                  /*sequence=*/false);
+    XLATensor step = XLATensor::scan_parameter(sequence, /*index=*/1,
+                                               /*sequence=*/true);
+    XLATensor sum =
+        XLATensor::add(carried, XLATensor::mul(step, scale), at::Scalar(1.0));
+    std::vector<XLATensor> outputs =
+        XLATensor::scan({init}, {sequence}, {carried, step}, {sum, sum},
+                        /*length=*/4, reverse);
+    at::Tensor ys = outputs[1].ToTensor();
+    std::vector<float> expected =
+        reverse ? std::vector<float>{20, 18, 14, 8}
+                : std::vector<float>{2, 6, 12, 20};
+    bool matches =
+        outputs[0].ToTensor().data<float>()[0] == 20 &&
+        std::vector<float>(ys.data<float>().begin(), ys.data<float>().end()) ==
+            expected;
+    ExpectMatches(reverse ? "scan (reverse)" : "scan", matches);
+  }
+}
+
+void TestScopeCosts(const Device& device) {
+  // A [3, 2] x [2, 4] matrix product within a scope, followed by an addition
+  // out of any scope.
+  XLATensor a =
+      XLATensor::Create(at::Tensor({1, 2, 3, 4, 5, 6}, {3, 2}), device);
+  XLATensor b =
+      XLATensor::Create(at::Tensor({1, 1, 1, 1, 1, 1, 1, 1}, {2, 4}), device);
+  XLATensor product;
+  {
+    ir::ScopePusher scope("dense");
+    product = XLATensor::mm(a, b);
+  }
+  XLATensor result = XLATensor::add(product, product);
+  const ir::Node* root = result.GetIrValue().node.get();
+  ir::ScopeCosts scope_costs =
+      ir::ComputeScopeCosts(ir::Util::ComputePostOrder({root}));
+  bool matches = scope_costs.size() == 2 &&
+                 scope_costs.count(ir::kUnscopedName) > 0;
+  for (auto& name_cost : scope_costs) {
+    double expected_flops =
+        name_cost.first == ir::kUnscopedName ? 3 * 4 : 2 * 3 * 4 * 2;
+    matches = matches && name_cost.second.num_nodes == 1 &&
+              name_cost.second.cost.flops == expected_flops;
+  }
+  ExpectMatches("scope costs", matches);
+
+  // A chain of three matrices costs the pairwise contractions of its plan,
+  // [2, 4] x [4, 1] and then [3, 2] x [2, 1], rather than the product of all
+  // its label sizes.
+  XLATensor c = XLATensor::Create(at::Tensor({1, 2, 3, 4}, {4, 1}), device);
+  XLATensor chain;
+  {
+    ir::ScopePusher scope("chain");
+    chain = XLATensor::einsum("ij,jk,kl->il", {a, b, c});
+  }
+  ir::ScopeCosts chain_costs = ir::ComputeScopeCosts(
+      ir::Util::ComputePostOrder({chain.GetIrValue().node.get()}));
+  double chain_flops = -1;
+  for (auto& name_cost : chain_costs) {
+    if (name_cost.first != ir::kUnscopedName) {
+      chain_flops = name_cost.second.cost.flops;
+    }
+  }
+  ExpectMatches("einsum chain cost", chain_flops == 2 * (2 * 4 + 3 * 2));
+
+  // A scan of 5 steps over a scalar body of a multiplication, by a captured
+  // scale, and an addition costs 5 times its body.
+  XLATensor scale = XLATensor::Create(at::Tensor({2}, {}), device);
+  XLATensor init = XLATensor::Create(at::Tensor({0}, {}), device);
+  XLATensor sequence =
+      XLATensor::Create(at::Tensor({1, 2, 3, 4, 5}, {5}), device);
+  XLATensor carried =
+      XLATensor::scan_parameter(init, /*index=*/0, /*sequence=*/false);
+  XLATensor step =
+      XLATensor::scan_parameter(sequence, /*index=*/1, /*sequence=*/true);
+  XLATensor sum = XLATensor::add(carried, XLATensor::mul(step, scale));
+  std::vector<XLATensor> outputs =
+      XLATensor::scan({init}, {sequence}, {carried, step}, {sum},
+                      /*length=*/5, /*reverse=*/false);
+  ir::NodeCost scan_cost =
+      ir::EstimateNodeCost(outputs[0].GetIrValue().node.get());
+  ExpectMatches("scan cost", scan_cost.flops == 5 * 2 &&
+                                 scan_cost.bytes_accessed ==
+                                     5 * 2 * 3 * sizeof(float));
+}
+
+void TestMemoryTracker() {
+  // Handles on a device of their own: a parameter, a placeholder and the
+  // result assigned to it, which must be accounted once, and a temporary
+  // which only raises the peak of the last step.
+  namespace memory = xla::memory;
+  if (!memory::IsTrackingEnabled()) {
+    return;
+  }
+  const std::string device = "TEST:0";
+  int parameter = 0;
+  int placeholder = 0;
+  int result = 0;
+  int temporary = 0;
+  auto usage_matches = [&](xla::int64 current_bytes, xla::int64 peak_bytes) {
+    memory::DeviceUsage usage = memory::GetDeviceUsages().at(device);
+    return usage.current_bytes == current_bytes &&
+           usage.peak_bytes == peak_bytes;
+  };
+  memory::TrackAllocation(&parameter, device, 100);
+  memory::SetTag(&parameter, {memory::Kind::kParameter, "", "layer"});
+  memory::TrackAllocation(&placeholder, device, 0);
+  memory::SetTag(&placeholder, {memory::Kind::kActivation, "xla::add"});
+  memory::TrackAllocation(&result, device, 40);
+  bool matches = usage_matches(140, 140);
+  memory::AssignAllocation(&placeholder, &result);
+  memory::UntrackAllocation(&result);
+  matches = matches && usage_matches(140, 140);
+  memory::MarkStep();
+  memory::UntrackAllocation(&parameter);
+  memory::MarkStep();
+  memory::TrackAllocation(&temporary, device, 20);
+  memory::UntrackAllocation(&temporary);
+  memory::MarkStep();
+  memory::UntrackAllocation(&placeholder);
+  matches = matches && usage_matches(0, 140);
+
+  // The last three steps of the device, without their step numbers.
+  std::vector<std::string> entries;
+  for (absl::string_view line :
+       absl::StrSplit(memory::CreateMemoryTimeline(), '\n')) {
+    size_t start = line.find(" device=" + device + " ");
+    if (start != absl::string_view::npos) {
+      entries.emplace_back(line.substr(start + 1));
+    }
+  }
+  std::vector<std::string> expected = {
+      "device=TEST:0 current=140 peak=140 Parameter=100 Activation=40 "
+      "Cache=0 Other=0",
+      "device=TEST:0 current=40 peak=140 Parameter=0 Activation=40 "
+      "Cache=0 Other=0",
+      "device=TEST:0 current=40 peak=60 Parameter=0 Activation=40 "
+      "Cache=0 Other=0"};
+  matches = matches && entries.size() >= expected.size() &&
+            std::equal(expected.begin(), expected.end(),
+                       entries.end() - expected.size());
+  ExpectMatches("memory tracker", matches);
+}
+
+void TestMemoryEstimate(const Device& device) {
+  // Two independent chains of elementwise ops on a [256] parameter, given in
+  // an interleaved post-order. The schedule must remain a post-order, and run
+  // each chain to its end before starting the other one.
+  XLATensor input =
+      XLATensor::Create(at::Tensor(std::vector<float>(256, 1), {256}), device);
+  XLATensor lhs = XLATensor::log(XLATensor::exp(input));
+  XLATensor rhs = XLATensor::exp(XLATensor::log(input));
+  std::vector<ir::Output> roots = {lhs.GetIrValue(), rhs.GetIrValue()};
+  const ir::Node* lhs_operand_node = roots[0].node->operand(0).node;
+  std::vector<const ir::Node*> post_order = {
+      lhs_operand_node->operand(0).node, lhs_operand_node,
+      roots[1].node->operand(0).node, roots[0].node, roots[1].node};
+  std::vector<const ir::Node*> schedule =
+      ir::ScheduleForMemory(post_order, roots);
+  std::set<const ir::Node*> scheduled;
+  bool matches = schedule.size() == post_order.size();
+  for (auto node : schedule) {
+    for (auto& operand : node->operands()) {
+      matches = matches && scheduled.count(operand.node) > 0;
+    }
+    scheduled.insert(node);
+  }
+  for (auto& root : roots) {
+    auto position = std::find(schedule.begin(), schedule.end(), root.node);
+    matches = matches && position != schedule.begin() &&
+              position != schedule.end() &&
+              *(position - 1) == root.node->operand(0).node;
+  }
+  ExpectMatches("memory schedule", matches);
+
+  // The computation as lowered: the parameter, the two chains and the result
+  // tuple. The peak is reached by the last op, while the parameter, both
+  // results and the operand of the last op are live, and aliasing the first
+  // result with the parameter removes its buffer.
+  const xla::int64 buffer_bytes = 256 * sizeof(float);
+  for (bool aliased : {false, true}) {
+    ir::LoweringContext lowering_ctx("TestMemoryEstimate");
+    for (auto& root : roots) {
+      lowering_ctx.AddResult(lowering_ctx.GetOutputOp(root));
+    }
+    if (aliased) {
+      lowering_ctx.builder()->SetUpAlias({0}, 0, {});
+    }
+    xla::XlaComputation computation =
+        lowering_ctx.Build().ConsumeValueOrDie();
+    swift_xla::MemoryEstimate estimate =
+        swift_xla::EstimateMemory(computation.proto());
+    xla::int64 result_buffers = aliased ? 1 : 2;
+    ExpectMatches(
+        absl::StrCat("memory estimate", aliased ? " with aliasing" : ""),
+        estimate.parameter_bytes == buffer_bytes &&
+            estimate.output_bytes == result_buffers * buffer_bytes &&
+            estimate.peak_bytes == (result_buffers + 2) * buffer_bytes);
+  }
+}
+
+void TestGraphSerialization(const Device& device) {
+  // A graph with a multi-output node and an input used twice, replayed over
+  // the device data of the original one, which must give the same results.
+  XLATensor input =
+      XLATensor::Create(at::Tensor({4, 1, 3, 2}, {2, 2}), device);
+  XLATensor product =
+      XLATensor::add(XLATensor::mm(input, input), input, at::Scalar(1.0));
+  XLATensor values = std::get<0>(XLATensor::topk(
+      input, /*k=*/1, /*dim=*/1, /*largest=*/true, /*sorted=*/true));
+  std::vector<ir::Output> roots = {product.GetIrValue(), values.GetIrValue()};
+  std::vector<xla::ComputationClient::DataPtr> placeholder_data;
+  std::set<const xla::ComputationClient::Data*> handles;
+  for (auto node :
+       ir::Util::ComputePostOrder({roots[0].node, roots[1].node})) {
+    const ir::ops::DeviceData* device_data = ir::ops::DeviceData::Cast(node);
+    if (device_data != nullptr &&
+        handles.insert(device_data->data().get()).second) {
+      placeholder_data.push_back(device_data->data());
+    }
+  }
+  size_t num_placeholders = 0;
+  std::vector<ir::Value> replayed = ir::DeserializeGraph(
+      ir::SerializeGraph(roots), [&](const xla::Shape& shape) {
+        XLA_CHECK_LT(num_placeholders, placeholder_data.size());
+        XLA_CHECK(xla::ShapeUtil::Equal(
+            shape, placeholder_data[num_placeholders]->shape()));
+        return ir::MakeNode<ir::ops::DeviceData>(
+            placeholder_data[num_placeholders++]);
+      });
+  bool matches = replayed.size() == 2 &&
+                 num_placeholders == placeholder_data.size();
+  std::vector<XLATensor> originals = {product, values};
+  for (size_t i = 0; matches && i < replayed.size(); ++i) {
+    at::Tensor expected = originals[i].ToTensor();
+    at::Tensor actual = XLATensor::Create(replayed[i], device).ToTensor();
+    matches = std::vector<float>(expected.data<float>().begin(),
+                                 expected.data<float>().end()) ==
+              std::vector<float>(actual.data<float>().begin(),
+                                 actual.data<float>().end());
+  }
+  ExpectMatches("graph serialization", matches);
+}
+
+void TestOpByOpClusters(const Device& device) {
+  // Runs of elementwise and reduction nodes around a matrix product, which is
+  // not clusterable, executed op-by-op without and with clusters, must give the
+  // results of the fused execution.
+  std::vector<XLATensor> tensors = BuildMixedGraph(device);
+  std::vector<ir::Value> roots;
+  for (auto& tensor : tensors) {
+    roots.push_back(tensor.GetIrValue());
+  }
+  std::vector<at::Tensor> expected = RunFused(roots, device);
+  for (size_t cluster_size : {1, 8}) {
+    swift_xla::OpByOpExecutor executor(/*compile_cache_size=*/64,
+                                       cluster_size,
+                                       /*shape_bucketing=*/false);
+    ExpectMatches(absl::StrCat("op-by-op clusters of ", cluster_size),
+                  AllTensorsClose(RunOpByOp(&executor, roots, device),
+                                  expected));
+  }
+}
+
+void TestOpByOpShapeBucketing(const Device& device) {
+  // Elementwise runs and full reductions over values of a few shapes, some of
+  // which share buckets and some of which need padding, executed op-by-op with
+  // shape bucketing must give the results of the unbucketed execution. The
+  // padding is non zero after the elementwise operations, so reductions which
+  // did not mask it would be off.
+  for (size_t cluster_size : {1, 8}) {
+    swift_xla::OpByOpExecutor bucketed(/*compile_cache_size=*/64,
+                                       cluster_size,
+                                       /*shape_bucketing=*/true);
+    swift_xla::OpByOpExecutor unbucketed(/*compile_cache_size=*/64,
+                                         cluster_size,
+                                         /*shape_bucketing=*/false);
+    for (auto& shape : std::vector<std::vector<int64_t>>{
+             {2, 3}, {5}, {4, 4}, {17}}) {
+      std::vector<float> values(xla::util::Multiply<int64_t>(shape));
+      std::vector<xla::int64> dimensions;
+      for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = 0.25f * i - 1;
+      }
+      for (size_t i = 0; i < shape.size(); ++i) {
+        dimensions.push_back(i);
+      }
+      XLATensor x = XLATensor::Create(at::Tensor(values, shape), device);
+      XLATensor y = XLATensor::sigmoid(XLATensor::mul(XLATensor::exp(x), x));
+      XLATensor sum = XLATensor::sum(y, dimensions,
+                                     /*keep_reduced_dimensions=*/false,
+                                     c10::nullopt);
+      XLATensor mean = XLATensor::mean(y, dimensions,
+                                       /*keep_reduced_dimensions=*/false,
+                                       c10::nullopt);
+      std::vector<ir::Value> roots = {y.GetIrValue(), sum.GetIrValue(),
+                                      mean.GetIrValue()};
+      ExpectMatches(
+          absl::StrCat("shape bucketing of ", absl::StrJoin(shape, "x"),
+                       " values with clusters of ", cluster_size),
+          AllTensorsClose(RunOpByOp(&bucketed, roots, device),
+                          RunOpByOp(&unbucketed, roots, device)));
+    }
+  }
+}
+
+void TestSmallMatrixLowerings(const Device& device) {
+  // The small matrix lowerings (see UseSmallMatrixLowering()) must reconstruct
+  // their inputs, with orthonormal vectors, for odd and even sizes, non square
+  // and rank deficient inputs.
+  for (int64_t n : {3, 4, 5}) {
+    HostMatrix a = MakeSymmetricMatrix(n, n);
+    XLATensor input = CreateMatrixTensor(a, device);
+    HostMatrix l = ToHostMatrix(
+        XLATensor::cholesky(input, /*upper=*/false).ToTensor());
+    HostMatrix u =
+        ToHostMatrix(XLATensor::cholesky(input, /*upper=*/true).ToTensor());
+    ExpectMatches(absl::StrCat("small cholesky of ", n, "x", n),
+                  MatricesClose(Multiply(l, Transposed(l)), a) &&
+                      MatricesClose(Multiply(Transposed(u), u), a));
+
+    HostMatrix b = MakeMatrix(n, 2, 2);
+    XLATensor rhs = CreateMatrixTensor(b, device);
+    XLATensor lower = CreateMatrixTensor(l, device);
+    HostMatrix x = ToHostMatrix(
+        std::get<0>(XLATensor::triangular_solve(
+                        rhs, lower, /*left_side=*/true, /*upper=*/false,
+                        /*transpose=*/false, /*unitriangular=*/false))
+            .ToTensor());
+    HostMatrix xt = ToHostMatrix(
+        std::get<0>(XLATensor::triangular_solve(
+                        rhs, lower, /*left_side=*/true, /*upper=*/false,
+                        /*transpose=*/true, /*unitriangular=*/false))
+            .ToTensor());
+    HostMatrix bt = Transposed(b);
+    HostMatrix xr = ToHostMatrix(
+        std::get<0>(XLATensor::triangular_solve(
+                        CreateMatrixTensor(bt, device), lower,
+                        /*left_side=*/false, /*upper=*/false,
+                        /*transpose=*/false, /*unitriangular=*/false))
+            .ToTensor());
+    ExpectMatches(absl::StrCat("small triangular solve of ", n, "x", n),
+                  MatricesClose(Multiply(l, x), b) &&
+                      MatricesClose(Multiply(Transposed(l), xt), b) &&
+                      MatricesClose(Multiply(xr, l), bt));
+
+    for (int64_t rank : {n, n - 2}) {
+      HostMatrix s = MakeSymmetricMatrix(n, rank);
+      auto eig = XLATensor::symeig(CreateMatrixTensor(s, device),
+                                   /*eigenvectors=*/true, /*upper=*/false);
+      HostMatrix v = ToHostMatrix(std::get<1>(eig).ToTensor());
+      HostMatrix reconstructed = Multiply(
+          ScaleColumns(v, std::get<0>(eig).ToTensor()), Transposed(v));
+      ExpectMatches(
+          absl::StrCat("small symeig of ", n, "x", n, " rank ", rank),
+          HasOrthonormalColumns(v) && MatricesClose(reconstructed, s));
+    }
+  }
+
+  struct MatrixCase {
+    int64_t rows;
+    int64_t cols;
+    int64_t rank;
+  };
+  for (auto& matrix_case : std::vector<MatrixCase>{{3, 3, 3},
+                                                   {4, 4, 4},
+                                                   {5, 3, 3},
+                                                   {3, 5, 3},
+                                                   {4, 4, 2},
+                                                   {5, 3, 1},
+                                                   {3, 5, 2}}) {
+    HostMatrix a =
+        MakeMatrix(matrix_case.rows, matrix_case.cols, matrix_case.rank);
+    XLATensor input = CreateMatrixTensor(a, device);
+    std::string name = absl::StrCat(matrix_case.rows, "x", matrix_case.cols,
+                                     " rank ", matrix_case.rank);
+
+    auto qr = XLATensor::qr(input, /*some=*/true);
+    HostMatrix q = ToHostMatrix(std::get<0>(qr).ToTensor());
+    HostMatrix r = ToHostMatrix(std::get<1>(qr).ToTensor());
+    ExpectMatches(absl::StrCat("small qr of ", name),
+                  HasOrthonormalColumns(q) && MatricesClose(Multiply(q, r), a));
+
+    auto svd = XLATensor::svd(input, /*some=*/true, /*compute_uv=*/true);
+    HostMatrix u = ToHostMatrix(std::get<0>(svd).ToTensor());
+    HostMatrix v = ToHostMatrix(std::get<2>(svd).ToTensor());
+    HostMatrix reconstructed =
+        Multiply(ScaleColumns(u, std::get<1>(svd).ToTensor()), Transposed(v));
+    ExpectMatches(absl::StrCat("small svd of ", name),
+                  HasOrthonormalColumns(u) && HasOrthonormalColumns(v) &&
+                      MatricesClose(reconstructed, a));
+  }
+}
+
+void TestTopK(const Device& device) {
+  // Rows long enough for the blockwise selection, but not a multiple of its
+  // block size, made of a few distinct values and many copies of the value
+  // the blocks are padded with. Ties must be selected in index order, and the
+  // padding never, as with a stable sort on the host.
+  const int64_t rows = 2;
+  const int64_t n = 2000;
+  for (bool largest : {true, false}) {
+    float pad = largest ? -std::numeric_limits<float>::infinity()
+                        : std::numeric_limits<float>::infinity();
+    std::vector<float> values(rows * n, pad);
+    for (int64_t i = 0; i < rows * n; i += 97) {
+      values[i] = static_cast<float>(i % 3);
+    }
+    for (int64_t k : {5, 40}) {
+      XLA_CHECK(UseBlockwiseTopK(n, k));
+      auto result = XLATensor::topk(
+          XLATensor::Create(at::Tensor(values, {rows, n}), device), k,
+          /*dim=*/1, largest, /*sorted=*/true);
+      at::Tensor result_values = std::get<0>(result).ToTensor();
+      at::Tensor result_indices = std::get<1>(result).ToTensor();
+      bool matches = result_indices.shape() == std::vector<int64_t>({rows, k});
+      for (int64_t row = 0; matches && row < rows; ++row) {
+        std::vector<int64_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](int64_t lhs, int64_t rhs) {
+                           float lhs_value = values[row * n + lhs];
+                           float rhs_value = values[row * n + rhs];
+                           return largest ? lhs_value > rhs_value
+                                          : lhs_value < rhs_value;
+                         });
+        for (int64_t i = 0; matches && i < k; ++i) {
+          matches = result_indices.data<int64_t>()[row * k + i] == order[i] &&
+                    result_values.data<float>()[row * k + i] ==
+                        values[row * n + order[i]];
+        }
+      }
+      ExpectMatches(absl::StrCat("blockwise top-", k,
+                                 largest ? " largest" : " smallest",
+                                 " with ties"),
+                    matches);
+    }
+  }
+}
+
+void TestPartitionedGraph(const Device& device) {
+  // A graph split in partitions of a few nodes, chained on the device, must
+  // give the results of the fused execution, including for intermediate values
+  // which are results of the whole graph.
+  std::vector<XLATensor> tensors = BuildMixedGraph(device);
+  std::vector<ir::Value> roots;
+  for (auto& tensor : tensors) {
+    roots.push_back(tensor.GetIrValue());
+  }
+  std::vector<at::Tensor> expected = RunFused(roots, device);
+  for (size_t partition_size : {2, 3, 5}) {
+    ExpectMatches(
+        absl::StrCat("graph partitions of ", partition_size, " nodes"),
+        AllTensorsClose(
+            XLATensorTestUtil::GetTensorsPartitioned(&tensors, partition_size),
+            expected));
+  }
+}
+
+void TestAllReduceLimbs(const Device& device) {
+  // A sum of 64 bit integers built for TPU reduces 16 bit limbs held in 32 bit
+  // integers, whichever device the test runs on. With a single replica, the
+  // sum must give back the input through the encoding of the limbs.
+  std::vector<int64_t> values = {0,
+                                 -5,
+                                 0xffff,
+                                 0x10000,
+                                 0x123456789abcdef0,
+                                 std::numeric_limits<int64_t>::max(),
+                                 std::numeric_limits<int64_t>::min()};
+  auto input_data = std::make_unique<int64_t[]>(values.size());
+  std::copy(values.begin(), values.end(), input_data.get());
+  XLATensor input = XLATensor::Create(
+      at::Tensor(std::move(input_data),
+                 {static_cast<int64_t>(values.size())}),
+      device);
+  ir::NodePtr node = ir::MakeNode<ir::ops::AllReduce>(
+      swift_xla::AllReduceType::kSum,
+      std::vector<ir::Value>{input.GetIrValue()},
+      ir::MakeNode<ir::ops::Token>(), /*scale=*/1.0,
+      std::vector<std::vector<xla::int64>>{}, DeviceType::TPU);
+
+  ir::LoweringContext lowering_ctx("TestAllReduceLimbs");
+  lowering_ctx.AddResult(lowering_ctx.GetOutputOp(ir::Output(node.get(), 0)));
+  xla::XlaComputation computation = lowering_ctx.Build().ConsumeValueOrDie();
+  bool reduces_limbs = false;
+  for (auto& hlo_computation : computation.proto().computations()) {
+    for (auto& instruction : hlo_computation.instructions()) {
+      if (instruction.opcode() != "all-reduce") {
+        continue;
+      }
+      const auto& reduced_shapes = instruction.shape().tuple_shapes();
+      reduces_limbs =
+          reduced_shapes.size() == 4 &&
+          std::all_of(reduced_shapes.begin(), reduced_shapes.end(),
+                      [](const xla::ShapeProto& shape) {
+                        return shape.element_type() == xla::PrimitiveType::S32;
+                      });
+    }
+  }
+  ExpectMatches("all-reduce of 64 bit integers reduces limbs", reduces_limbs);
+
+  at::Tensor result = input.CreateFrom(ir::Value(node, 0)).ToTensor();
+  auto data = result.data<int64_t>();
+  ExpectMatches("all-reduce of 64 bit integers through limbs",
+                std::equal(values.begin(), values.end(), data.begin(),
+                           data.end()));
+}
+
+void TestParallelLowering(const Device& device) {
+  // Graphs lowered concurrently in ranges of a few nodes, and stitched back
+  // with calls, must give the results of the sequential lowering.
+  std::vector<XLATensor> tensors = BuildMixedGraph(device);
+  std::vector<at::Tensor> expected =
+      XLATensorTestUtil::GetTensorsWithLoweringSize(
+          &tensors, /*parallel_lowering_size=*/0);
+  for (size_t lowering_size : {2, 3}) {
+    ExpectMatches(
+        absl::StrCat("parallel lowering in ranges of ", lowering_size,
+                     " nodes"),
+        AllTensorsClose(XLATensorTestUtil::GetTensorsWithLoweringSize(
+                            &tensors, lowering_size),
+                        expected));
+  }
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
+  // Before anything is allocated, for TestMemoryTracker.
+  setenv("XLA_MEMORY_TRACKING", "1", /*overwrite=*/0);
   at::Tensor a({1, 2}, {2});
   at::Tensor b({7, 19}, {2});
 
@@ -114,9 +1037,25 @@ int main(int argc, char** argv) {
   } else {
     absl::PrintF("result; ??x%d\n", static_cast<int>(data.size()));
   }
+  TestHostEvaluation(*GetDefaultDevice());
+  TestNonZero(*GetDefaultDevice());
+  TestDynamicSizes(*GetDefaultDevice());
+  TestEinsum(*GetDefaultDevice());
+  TestSmallMatrixLowerings(*GetDefaultDevice());
+  TestTopK(*GetDefaultDevice());
+  TestScan(*GetDefaultDevice());
+  TestScopeCosts(*GetDefaultDevice());
+  TestMemoryTracker();
+  TestMemoryEstimate(*GetDefaultDevice());
+  TestGraphSerialization(*GetDefaultDevice());
+  TestOpByOpClusters(*GetDefaultDevice());
+  TestOpByOpShapeBucketing(*GetDefaultDevice());
+  TestPartitionedGraph(*GetDefaultDevice());
+  TestParallelLowering(*GetDefaultDevice());
+  TestAllReduceLimbs(*GetDefaultDevice());
   WithAllDevices(DeviceType::TPU, [&](const std::vector<Device>& /*devices*/,
                                       const std::vector<Device>& all_devices) {
     TestSingleReplication(all_devices);
   });
-  return 0;
+  return g_failures > 0 ? 1 : 0;
 }
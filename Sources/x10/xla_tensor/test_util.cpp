@@ -0,0 +1,53 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/test_util.h"
+
+namespace swift_xla {
+
+std::vector<at::Tensor> XLATensorTestUtil::GetTensorsPartitioned(
+    std::vector<XLATensor>* tensors, size_t max_partition_size) {
+  XLATensor::SyncTensorsConfig config;
+  config.force_xla_data = false;
+  XLATensor::SyncTensorCollection coll =
+      XLATensor::CollectSyncTensors(*tensors, config);
+  std::vector<xla::ComputationClient::DataPtr> async_tensors_data;
+  if (!coll.indices.empty()) {
+    XLATensor::CompilationResult compile_result = XLATensor::CompilePartitioned(
+        *tensors, {}, coll, max_partition_size);
+    async_tensors_data = XLATensor::ExecutePartitioned(
+        *compile_result.partitioned_computation,
+        compile_result.parameters_data, coll.device);
+  }
+  return XLATensor::FetchTensors(*tensors, coll.indices, async_tensors_data);
+}
+
+std::vector<at::Tensor> XLATensorTestUtil::GetTensorsWithLoweringSize(
+    std::vector<XLATensor>* tensors, size_t parallel_lowering_size) {
+  XLATensor::SyncTensorsConfig config;
+  config.force_xla_data = false;
+  XLATensor::SyncTensorCollection coll =
+      XLATensor::CollectSyncTensors(*tensors, config);
+  std::vector<xla::ComputationClient::DataPtr> async_tensors_data;
+  if (!coll.indices.empty()) {
+    XLATensor::CompilationResult compile_result =
+        XLATensor::Compile(*tensors, {}, coll, parallel_lowering_size);
+    async_tensors_data = xla::ComputationClient::Get()->ExecuteComputation(
+        *compile_result.computation, compile_result.parameters_data,
+        coll.device, xla::ComputationClient::ExecuteComputationOptions());
+  }
+  return XLATensor::FetchTensors(*tensors, coll.indices, async_tensors_data);
+}
+
+}  // namespace swift_xla
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+
+// Runs the compilation paths of XLATensor with settings which are otherwise
+// fixed by the environment for the whole process, so that tests can check
+// them against each other within a single run.
+class XLATensorTestUtil {
+ public:
+  // Like XLATensor::GetTensors(), but the pending IR graph is always compiled
+  // in partitions of at most max_partition_size nodes, whatever the value of
+  // XLA_GRAPH_PARTITION_SIZE.
+  static std::vector<at::Tensor> GetTensorsPartitioned(
+      std::vector<XLATensor>* tensors, size_t max_partition_size);
+
+  // Like XLATensor::GetTensors(), but the pending IR graph is lowered with the
+  // given XLA_PARALLEL_LOWERING_SIZE, zero meaning sequentially.
+  static std::vector<at::Tensor> GetTensorsWithLoweringSize(
+      std::vector<XLATensor>* tensors, size_t parallel_lowering_size);
+};
+
+}  // namespace swift_xla
@@ -0,0 +1,116 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the execution time of the blockwise top-k selection with the one
+// sorting the whole dimension (see CreateTopK()), over a grid of k and row
+// sizes. Both computations reduce the selected values and indices to a scalar,
+// whose transfer waits for the execution to complete, and which must be the
+// same for both, since ties are selected in index order. The exit status is
+// nonzero when they differ. The selection runs on the default device, which is
+// the CPU unless configured otherwise.
+//
+// Usage: topk_benchmark [--rows=N] [--repetitions=N]
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/benchmark_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/device.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/xla_lower_util.h"
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+namespace {
+
+std::shared_ptr<xla::ComputationClient::Computation> CompileTopK(
+    xla::int64 k, bool blockwise, const xla::Shape& shape,
+    const Device& device) {
+  xla::XlaBuilder builder("TopKBenchmark");
+  xla::XlaOp x = xla::Parameter(&builder, 0, shape, "x");
+  std::vector<xla::XlaOp> selection =
+      blockwise ? CreateBlockwiseTopK(x, k, /*dim=*/1, /*largest=*/true)
+                : CreateSortTopK(x, k, /*dim=*/1, /*largest=*/true);
+  xla::XlaOp zero = xla::Zero(&builder, shape.element_type());
+  xla::XlaComputation add =
+      XlaHelpers::CreateAddComputation(shape.element_type());
+  xla::XlaOp checksum =
+      xla::ReduceAll(selection[0], zero, add) +
+      xla::ReduceAll(
+          xla::ConvertElementType(selection[1], shape.element_type()), zero,
+          add);
+  return CompileForDevice(ConsumeValue(builder.Build(checksum)), device);
+}
+
+// Returns whether the checksums of the two selections match.
+bool RunBenchmark(xla::int64 rows, xla::int64 n, const Device& device,
+                  int repetitions) {
+  std::vector<float> values(rows * n);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<float>((i * 7919) % 100003) / 100003.0f;
+  }
+  at::Tensor tensor(std::move(values), {rows, n});
+  xla::ComputationClient::DataPtr data = TensorToXlaData(tensor, device);
+  bool checksums_match = true;
+  for (xla::int64 k : {1, 10, 100}) {
+    double times[2];
+    double checksums[2];
+    for (bool blockwise : {false, true}) {
+      auto computation = CompileTopK(k, blockwise, data->shape(), device);
+      checksums[blockwise] =
+          ExecuteAndFetch(*computation, {data}, device).front().Get<float>({});
+      times[blockwise] =
+          TimeRepeated([&]() { ExecuteAndFetch(*computation, {data}, device); },
+                       repetitions)
+              .average_us;
+    }
+    absl::PrintF(
+        "rows=%d n=%-8d k=%-4d sort=%12.1fus blockwise=%12.1fus (%.2fx)%s\n",
+        rows, n, k, times[false], times[true], times[false] / times[true],
+        UseBlockwiseTopK(n, k) ? " *" : "");
+    checksums_match &=
+        ChecksumsMatch(absl::StrFormat("n=%d k=%d", n, k), checksums[false],
+                       checksums[true], /*relative_tolerance=*/1e-5);
+  }
+  return checksums_match;
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  int rows = 8;
+  int repetitions = 10;
+  if (!swift_xla::ParseBenchmarkFlags(
+          argc, argv, {{"rows", &rows}, {"repetitions", &repetitions}},
+          "[--rows=N] [--repetitions=N]")) {
+    return 1;
+  }
+  const swift_xla::Device& device = *swift_xla::GetDefaultDevice();
+  // Rows marked with a '*' are the ones where CreateTopK() selects blockwise.
+  absl::PrintF("Top-k selections on %s\n", device.ToString());
+  bool checksums_match = true;
+  for (xla::int64 n : {1000, 10000, 100000, 1000000}) {
+    checksums_match &= swift_xla::RunBenchmark(rows, n, device, repetitions);
+  }
+  return checksums_match ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the host side cost of the lazy tensor frontend, separately from any
+// device time. The FakeComputationClient is installed so that transfers,
+// compilations and executions are no-ops, and synthetic MLP, ResNet and
+// Transformer shaped graphs are traced at several sizes. For each phase, the
+// cost is reported in nanoseconds and heap allocations per IR node, as JSON on
+// stdout.
+//
+// Usage: tracing_benchmark [--repetitions=N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/fake_computation_client.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace {
+
+std::atomic<int64_t> g_allocations(0);
+
+}  // namespace
+
+// Count every heap allocation made by the process, so that the phases can
+// report allocations per node.
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace swift_xla {
+namespace {
+
+using GraphFn = std::function<std::vector<XLATensor>(const Device&, int)>;
+
+struct ModelSpec {
+  std::string name;
+  GraphFn graph_fn;
+  std::vector<int> sizes;
+};
+
+struct PhaseResult {
+  std::string name;
+  double ns_per_node = std::numeric_limits<double>::max();
+  double allocations_per_node = 0;
+};
+
+struct GraphResult {
+  std::string model;
+  int size = 0;
+  size_t num_nodes = 0;
+  std::vector<PhaseResult> phases;
+};
+
+XLATensor MakeInput(const Device& device, std::vector<int64_t> dims) {
+  size_t num_elements = at::GetLenFromShape(dims);
+  std::unique_ptr<float[]> data(new float[num_elements]());
+  return XLATensor::Create(at::Tensor(std::move(data), std::move(dims)),
+                           device);
+}
+
+std::vector<XLATensor> BuildMlp(const Device& device, int num_layers) {
+  const int64_t batch = 32;
+  const int64_t width = 256;
+  XLATensor h = MakeInput(device, {batch, width});
+  for (int i = 0; i < num_layers; ++i) {
+    XLATensor weight = MakeInput(device, {width, width});
+    XLATensor bias = MakeInput(device, {width});
+    h = XLATensor::relu(XLATensor::add(XLATensor::matmul(h, weight), bias));
+  }
+  XLATensor loss = XLATensor::mean(h, {0, 1},
+                                   /*keep_reduced_dimensions=*/false,
+                                   /*dtype=*/absl::nullopt);
+  return {loss};
+}
+
+XLATensor ConvBlock(const XLATensor& input, const Device& device,
+                    int64_t channels) {
+  XLATensor filter = MakeInput(device, {3, 3, channels, channels});
+  XLATensor scale = MakeInput(device, {channels});
+  XLATensor offset = MakeInput(device, {channels});
+  XLATensor conv = XLATensor::tf_Conv(
+      input, filter, /*depthwise=*/false, /*strides=*/{1, 1, 1, 1},
+      tensorflow::SAME, /*explicit_paddings=*/{}, tensorflow::FORMAT_NHWC,
+      /*dilations=*/{1, 1, 1, 1});
+  return XLATensor::add(XLATensor::mul(conv, scale), offset);
+}
+
+std::vector<XLATensor> BuildResNet(const Device& device, int num_blocks) {
+  const int64_t channels = 32;
+  XLATensor x = MakeInput(device, {8, 16, 16, channels});
+  for (int i = 0; i < num_blocks; ++i) {
+    XLATensor y = XLATensor::relu(ConvBlock(x, device, channels));
+    y = ConvBlock(y, device, channels);
+    x = XLATensor::relu(XLATensor::add(x, y));
+  }
+  XLATensor loss = XLATensor::mean(x, {0, 1, 2, 3},
+                                   /*keep_reduced_dimensions=*/false,
+                                   /*dtype=*/absl::nullopt);
+  return {loss};
+}
+
+XLATensor LayerNorm(const XLATensor& x) {
+  XLATensor mean = XLATensor::mean(x, {2}, /*keep_reduced_dimensions=*/true,
+                                   /*dtype=*/absl::nullopt);
+  XLATensor centered = XLATensor::sub(x, mean);
+  XLATensor variance = XLATensor::mean(XLATensor::mul(centered, centered), {2},
+                                       /*keep_reduced_dimensions=*/true,
+                                       /*dtype=*/absl::nullopt);
+  return XLATensor::mul(
+      centered, XLATensor::rsqrt(XLATensor::add(variance, at::Scalar(1e-5),
+                                                at::Scalar(1))));
+}
+
+std::vector<XLATensor> BuildTransformer(const Device& device,
+                                        int num_layers) {
+  const int64_t batch = 4;
+  const int64_t seq_len = 64;
+  const int64_t model_dim = 128;
+  const int64_t hidden_dim = 4 * model_dim;
+  XLATensor x = MakeInput(device, {batch, seq_len, model_dim});
+  for (int i = 0; i < num_layers; ++i) {
+    XLATensor wq = MakeInput(device, {model_dim, model_dim});
+    XLATensor wk = MakeInput(device, {model_dim, model_dim});
+    XLATensor wv = MakeInput(device, {model_dim, model_dim});
+    XLATensor wo = MakeInput(device, {model_dim, model_dim});
+    XLATensor q = XLATensor::matmul(x, wq);
+    XLATensor k = XLATensor::matmul(x, wk);
+    XLATensor v = XLATensor::matmul(x, wv);
+    XLATensor scores =
+        XLATensor::mul(XLATensor::matmul(q, XLATensor::transpose(k, 1, 2)),
+                       at::Scalar(1.0 / std::sqrt(model_dim)));
+    XLATensor attention = XLATensor::matmul(
+        XLATensor::softmax(scores, 2, /*dtype=*/absl::nullopt), v);
+    x = LayerNorm(XLATensor::add(x, XLATensor::matmul(attention, wo)));
+
+    XLATensor w1 = MakeInput(device, {model_dim, hidden_dim});
+    XLATensor b1 = MakeInput(device, {hidden_dim});
+    XLATensor w2 = MakeInput(device, {hidden_dim, model_dim});
+    XLATensor b2 = MakeInput(device, {model_dim});
+    XLATensor hidden =
+        XLATensor::relu(XLATensor::add(XLATensor::matmul(x, w1), b1));
+    x = LayerNorm(
+        XLATensor::add(x, XLATensor::add(XLATensor::matmul(hidden, w2), b2)));
+  }
+  XLATensor loss = XLATensor::mean(x, {0, 1, 2},
+                                   /*keep_reduced_dimensions=*/false,
+                                   /*dtype=*/absl::nullopt);
+  return {loss};
+}
+
+std::vector<const ir::Node*> GetRootNodes(const std::vector<ir::Value>& roots) {
+  std::vector<const ir::Node*> nodes;
+  nodes.reserve(roots.size());
+  for (auto& root : roots) {
+    nodes.push_back(root.node.get());
+  }
+  return nodes;
+}
+
+// Runs fn and folds its cost into the phase result, keeping the fastest run.
+template <typename F>
+void RunPhase(size_t num_nodes, PhaseResult* result, const F& fn) {
+  xla::int64 start_allocations = g_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  xla::int64 allocations = g_allocations.load() - start_allocations;
+  double ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  if (ns / num_nodes < result->ns_per_node) {
+    result->ns_per_node = ns / num_nodes;
+    result->allocations_per_node = static_cast<double>(allocations) / num_nodes;
+  }
+}
+
+GraphResult RunGraph(const ModelSpec& spec, int size, const Device& device,
+                     int repetitions) {
+  GraphResult result;
+  result.model = spec.name;
+  result.size = size;
+  PhaseResult trace{"trace"};
+  PhaseResult get_ir_value{"get_ir_value"};
+  PhaseResult post_order{"post_order"};
+  PhaseResult construct{"construct"};
+  PhaseResult lower{"lower"};
+  PhaseResult build{"build"};
+  PhaseResult sync{"sync"};
+  PhaseResult sync_cached{"sync_cached"};
+  for (int i = 0; i < repetitions; ++i) {
+    std::vector<XLATensor> tensors;
+    if (result.num_nodes == 0) {
+      tensors = spec.graph_fn(device, size);
+      std::vector<ir::Value> roots;
+      for (auto& tensor : tensors) {
+        roots.push_back(tensor.GetIrValue());
+      }
+      result.num_nodes = ir::Util::GetGraphSize(GetRootNodes(roots));
+      XLATensor::MarkStep(&device);
+    }
+    RunPhase(result.num_nodes, &trace,
+             [&]() { tensors = spec.graph_fn(device, size); });
+
+    std::vector<ir::Value> roots;
+    RunPhase(result.num_nodes, &get_ir_value, [&]() {
+      for (auto& tensor : tensors) {
+        roots.push_back(tensor.GetIrValue());
+      }
+    });
+    std::vector<const ir::Node*> root_nodes = GetRootNodes(roots);
+    std::vector<const ir::Node*> nodes;
+    RunPhase(result.num_nodes, &post_order,
+             [&]() { nodes = ir::Util::ComputePostOrder(root_nodes); });
+    // Rebuilds every node out of its operands, which constructs and hashes the
+    // nodes without the tensor bookkeeping of the trace phase.
+    std::vector<ir::Value> cloned_roots;
+    RunPhase(result.num_nodes, &construct,
+             [&]() { cloned_roots = ir::Util::Clone(roots, nodes); });
+    for (size_t j = 0; j < roots.size(); ++j) {
+      XLA_CHECK_EQ(cloned_roots[j].hash(), roots[j].hash());
+    }
+    ir::LoweringContext loctx("TracingBenchmark");
+    RunPhase(result.num_nodes, &lower, [&]() {
+      for (auto& root : roots) {
+        loctx.AddResult(loctx.GetOutputOp(root));
+      }
+    });
+    RunPhase(result.num_nodes, &build,
+             [&]() { ConsumeValue(loctx.Build()); });
+
+    // The first sync of a graph misses the compilation cache, while all the
+    // following ones (the graph is identical across repetitions) hit it.
+    PhaseResult* sync_phase = i == 0 ? &sync : &sync_cached;
+    RunPhase(result.num_nodes, sync_phase, [&]() {
+      XLATensor::SyncTensorsGraph(&tensors, /*devices=*/{}, /*wait=*/true,
+                                  /*sync_xla_data=*/false);
+    });
+    XLATensor::MarkStep(&device);
+  }
+  result.phases = {trace, get_ir_value, post_order, construct,
+                   lower, build,        sync,       sync_cached};
+  return result;
+}
+
+std::string ToJson(const std::vector<GraphResult>& results,
+                   const Device& device, int repetitions) {
+  std::vector<std::string> graphs;
+  for (auto& result : results) {
+    std::vector<std::string> phases;
+    for (auto& phase : result.phases) {
+      if (phase.ns_per_node == std::numeric_limits<double>::max()) {
+        continue;
+      }
+      phases.push_back(absl::StrFormat(
+          "\"%s\": {\"ns_per_node\": %.2f, \"allocations_per_node\": %.2f}",
+          phase.name, phase.ns_per_node, phase.allocations_per_node));
+    }
+    graphs.push_back(absl::StrFormat(
+        "    {\"model\": \"%s\", \"size\": %d, \"nodes\": %d, \"phases\": "
+        "{%s}}",
+        result.model, result.size, result.num_nodes,
+        absl::StrJoin(phases, ", ")));
+  }
+  return absl::StrCat("{\n  \"benchmark\": \"tracing\",\n  \"device\": \"",
+                      device.ToString(), "\",\n  \"repetitions\": ",
+                      repetitions, ",\n  \"graphs\": [\n",
+                      absl::StrJoin(graphs, ",\n"), "\n  ]\n}\n");
+}
+
+}  // namespace
+}  // namespace swift_xla
+
+int main(int argc, char** argv) {
+  int repetitions = 5;
+  for (int i = 1; i < argc; ++i) {
+    absl::string_view arg(argv[i]);
+    if (absl::ConsumePrefix(&arg, "--repetitions=")) {
+      if (!absl::SimpleAtoi(arg, &repetitions) || repetitions < 2) {
+        absl::FPrintF(stderr, "Invalid repetitions: %s\n", argv[i]);
+        return 1;
+      }
+    } else {
+      absl::FPrintF(stderr, "Usage: %s [--repetitions=N]\n", argv[0]);
+      return 1;
+    }
+  }
+  xla::ComputationClient::Set(std::make_unique<xla::FakeComputationClient>());
+
+  using swift_xla::ModelSpec;
+  std::vector<ModelSpec> specs = {
+      {"mlp", swift_xla::BuildMlp, {4, 16, 64}},
+      {"resnet", swift_xla::BuildResNet, {2, 8, 16}},
+      {"transformer", swift_xla::BuildTransformer, {1, 4, 12}},
+  };
+  const swift_xla::Device& device = *swift_xla::GetDefaultDevice();
+  std::vector<swift_xla::GraphResult> results;
+  for (auto& spec : specs) {
+    for (int size : spec.sizes) {
+      results.push_back(
+          swift_xla::RunGraph(spec, size, device, repetitions));
+    }
+  }
+  absl::PrintF("%s", swift_xla::ToJson(results, device, repetitions));
+  return 0;
+}
@@ -73,6 +73,43 @@ xla::XlaOp GetPromotedR1Mask(xla::XlaOp mask, const xla::Shape& input_shape) {
   return XlaHelpers::Flatten(GetPromotedMask(mask, input_shape));
 }
 
+// Top-k selections along dimensions smaller than this always sort them whole.
+constexpr xla::int64 kMinBlockwiseTopKSize = 1024;
+
+constexpr xla::int64 kMinTopKBlockSize = 128;
+
+// The blocks of the blockwise top-k selection hold XLA_TOPK_BLOCK_RATIO times
+// k values (but at least kMinTopKBlockSize), so that every round of selection
+// shrinks the candidates by that factor. A zero ratio disables it, while a
+// ratio of one would keep all the candidates of the blocks holding k values.
+xla::int64 GetTopKBlockSize(xla::int64 k) {
+  static xla::int64 block_ratio =
+      xla::sys_util::GetEnvInt("XLA_TOPK_BLOCK_RATIO", 16);
+  XLA_CHECK(block_ratio == 0 || block_ratio >= 2)
+      << "XLA_TOPK_BLOCK_RATIO must be zero or at least two: " << block_ratio;
+  return block_ratio > 0 ? std::max(k * block_ratio, kMinTopKBlockSize) : 0;
+}
+
+// Orders the (value, index) pairs of a top-k selection by value, and equal
+// values by index, so that the selection of tied values does not depend on
+// how the candidates were split into blocks.
+xla::XlaComputation CreateTopKComparator(xla::PrimitiveType type,
+                                         bool largest) {
+  xla::XlaBuilder builder("TopKComparator");
+  xla::Shape value_shape = xla::ShapeUtil::MakeShape(type, {});
+  xla::Shape index_shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {});
+  xla::XlaOp lhs_value = xla::Parameter(&builder, 0, value_shape, "lhs_value");
+  xla::XlaOp rhs_value = xla::Parameter(&builder, 1, value_shape, "rhs_value");
+  xla::XlaOp lhs_index = xla::Parameter(&builder, 2, index_shape, "lhs_index");
+  xla::XlaOp rhs_index = xla::Parameter(&builder, 3, index_shape, "rhs_index");
+  xla::XlaOp before = largest ? xla::Gt(lhs_value, rhs_value)
+                              : xla::Lt(lhs_value, rhs_value);
+  xla::Or(before, xla::And(xla::Eq(lhs_value, rhs_value),
+                           xla::Lt(lhs_index, rhs_index)));
+  return ConsumeValue(builder.Build());
+}
+
 bool ShouldUseDenseScatter(const xla::Shape& input_shape,
                            const xla::Shape& index_shape) {
   static int dense_scatter_factor =
@@ -316,27 +353,33 @@ std::vector<xla::XlaOp> CreateKthValue(xla::XlaOp input, xla::int64 k,
                                        xla::int64 dim, bool keepdim) {
   // Here 'k' is 1 based (1...).
   const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
-  XLA_CHECK_LE(k, shape.dimensions(dim));
-  xla::Shape iota_shape =
-      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
-  xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
-  xla::XlaOp sort_result = xla::Sort(
-      {input, iota},
-      xla::CreateScalarLtComputation(
-          {shape.element_type(), xla::PrimitiveType::S32}, input.builder()),
-      dim);
+  xla::int64 size = shape.dimensions(dim);
+  XLA_CHECK_LE(k, size);
+  // The k-th smallest value is either the last of the k smallest ones, or the
+  // last of the size - k + 1 largest ones, whichever selection is smaller.
+  std::vector<xla::XlaOp> selection;
+  xla::int64 position = k - 1;
+  if (UseBlockwiseTopK(size, k)) {
+    selection = CreateBlockwiseTopK(input, k, dim, /*largest=*/false);
+  } else if (UseBlockwiseTopK(size, size - k + 1)) {
+    selection =
+        CreateBlockwiseTopK(input, size - k + 1, dim, /*largest=*/true);
+    position = size - k;
+  } else {
+    selection = CreateSortTopK(input, k, dim, /*largest=*/false);
+  }
 
   std::vector<xla::int64> start_indices(shape.rank(), 0);
-  start_indices[dim] = k - 1;
+  start_indices[dim] = position;
   std::vector<xla::int64> limit_indices(shape.dimensions().begin(),
                                         shape.dimensions().end());
-  limit_indices[dim] = k;
+  limit_indices[dim] = position + 1;
   std::vector<xla::int64> strides(shape.rank(), 1);
 
-  xla::XlaOp values = xla::Slice(xla::GetTupleElement(sort_result, 0),
-                                 start_indices, limit_indices, strides);
-  xla::XlaOp indices = xla::Slice(xla::GetTupleElement(sort_result, 1),
-                                  start_indices, limit_indices, strides);
+  xla::XlaOp values =
+      xla::Slice(selection[0], start_indices, limit_indices, strides);
+  xla::XlaOp indices =
+      xla::Slice(selection[1], start_indices, limit_indices, strides);
   if (!keepdim) {
     auto reshape_sizes = XlaHelpers::DropDimensions(shape.dimensions(), {dim});
     values = XlaHelpers::DynamicReshape(values, reshape_sizes);
@@ -354,17 +397,33 @@ std::vector<xla::XlaOp> CreateTopK(xla::XlaOp input, xla::int64 k,
   // Here 'k' is 1 based (1...).
   const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
   XLA_CHECK_LE(k, shape.dimensions(dim));
+  std::vector<xla::XlaOp> selection =
+      UseBlockwiseTopK(shape.dimensions(dim), k)
+          ? CreateBlockwiseTopK(input, k, dim, largest)
+          : CreateSortTopK(input, k, dim, largest);
+  // aten::topk() wants Long tensors as indices.
+  return {selection[0],
+          xla::ConvertElementType(
+              selection[1], GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                                   /*device=*/nullptr))};
+}
+
+bool UseBlockwiseTopK(xla::int64 size, xla::int64 k) {
+  xla::int64 block_size = GetTopKBlockSize(k);
+  return block_size > 0 && size >= kMinBlockwiseTopKSize &&
+         size >= 2 * block_size;
+}
+
+std::vector<xla::XlaOp> CreateSortTopK(xla::XlaOp input, xla::int64 k,
+                                       xla::int64 dim, bool largest) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  XLA_CHECK_LE(k, shape.dimensions(dim));
   xla::Shape iota_shape =
       xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
   xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
-  xla::XlaComputation comparator =
-      largest ? xla::CreateScalarGtComputation(
-                    {shape.element_type(), xla::PrimitiveType::S32},
-                    input.builder())
-              : xla::CreateScalarLtComputation(
-                    {shape.element_type(), xla::PrimitiveType::S32},
-                    input.builder());
-  xla::XlaOp sort_result = xla::Sort({input, iota}, comparator, dim);
+  xla::XlaOp sort_result =
+      xla::Sort({input, iota},
+                CreateTopKComparator(shape.element_type(), largest), dim);
 
   std::vector<xla::int64> start_indices(shape.rank(), 0);
   std::vector<xla::int64> limit_indices(shape.dimensions().begin(),
@@ -376,10 +435,75 @@ std::vector<xla::XlaOp> CreateTopK(xla::XlaOp input, xla::int64 k,
                                  start_indices, limit_indices, strides);
   xla::XlaOp indices = xla::Slice(xla::GetTupleElement(sort_result, 1),
                                   start_indices, limit_indices, strides);
-  // aten::topk() wants Long tensors as indices.
-  return {values, xla::ConvertElementType(
-                      indices, GetDevicePrimitiveType(xla::PrimitiveType::S64,
-                                                      /*device=*/nullptr))};
+  return {values, indices};
+}
+
+std::vector<xla::XlaOp> CreateBlockwiseTopK(xla::XlaOp input, xla::int64 k,
+                                            xla::int64 dim, bool largest) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::int64 size = shape.dimensions(dim);
+  XLA_CHECK_LE(k, size);
+  // The selection runs on the minor dimension, where the blocks are split off.
+  std::vector<xla::int64> permutation;
+  for (xla::int64 i = 0; i < shape.rank(); ++i) {
+    if (i != dim) {
+      permutation.push_back(i);
+    }
+  }
+  permutation.push_back(dim);
+  xla::XlaOp values = xla::Transpose(input, permutation);
+  std::vector<xla::int64> outer_sizes;
+  for (size_t i = 0; i + 1 < permutation.size(); ++i) {
+    outer_sizes.push_back(shape.dimensions(permutation[i]));
+  }
+  std::vector<xla::int64> sizes = outer_sizes;
+  sizes.push_back(size);
+  xla::XlaOp indices = xla::Iota(
+      input.builder(),
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, sizes),
+      shape.rank() - 1);
+  xla::XlaComputation comparator =
+      CreateTopKComparator(shape.element_type(), largest);
+  // The padding ranks last among the values equal to it, since its index is
+  // out of range, so it is never selected over the real values of the row,
+  // which are at least k.
+  xla::XlaOp pad_value =
+      largest ? xla::MinValue(input.builder(), shape.element_type())
+              : xla::MaxValue(input.builder(), shape.element_type());
+  xla::XlaOp pad_index = xla::ConstantR0<xla::int32>(input.builder(), size);
+  xla::int64 block_size = GetTopKBlockSize(k);
+  while (size >= 2 * block_size) {
+    xla::int64 num_blocks = xla::CeilOfRatio(size, block_size);
+    XLA_CHECK_LT(num_blocks * k, size) << "Top-k round does not shrink";
+    sizes.back() = num_blocks * block_size;
+    values = PadToSize(values, sizes, pad_value);
+    indices = PadToSize(indices, sizes, pad_index);
+    sizes.back() = num_blocks;
+    sizes.push_back(block_size);
+    values = XlaHelpers::DynamicReshape(values, sizes);
+    indices = XlaHelpers::DynamicReshape(indices, sizes);
+    xla::XlaOp sort_result =
+        xla::Sort({values, indices}, comparator, sizes.size() - 1);
+    values = xla::SliceInMinorDims(xla::GetTupleElement(sort_result, 0), {0},
+                                   {k});
+    indices = xla::SliceInMinorDims(xla::GetTupleElement(sort_result, 1),
+                                    {0}, {k});
+    size = num_blocks * k;
+    sizes.pop_back();
+    sizes.back() = size;
+    values = XlaHelpers::DynamicReshape(values, sizes);
+    indices = XlaHelpers::DynamicReshape(indices, sizes);
+  }
+  xla::XlaOp sort_result =
+      xla::Sort({values, indices}, comparator, sizes.size() - 1);
+  values =
+      xla::SliceInMinorDims(xla::GetTupleElement(sort_result, 0), {0}, {k});
+  indices =
+      xla::SliceInMinorDims(xla::GetTupleElement(sort_result, 1), {0}, {k});
+  std::vector<xla::int64> inverse_permutation =
+      xla::InversePermutation(permutation);
+  return {xla::Transpose(values, inverse_permutation),
+          xla::Transpose(indices, inverse_permutation)};
 }
 
 xla::XlaOp CreateMatMul(xla::XlaOp lhs, xla::XlaOp rhs) {
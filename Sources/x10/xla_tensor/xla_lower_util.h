@@ -33,6 +33,22 @@ std::vector<xla::XlaOp> CreateKthValue(xla::XlaOp input, xla::int64 k,
 std::vector<xla::XlaOp> CreateTopK(xla::XlaOp input, xla::int64 k,
                                    xla::int64 dim, bool largest, bool sorted);
 
+// Whether selecting the top k out of size values goes through
+// CreateBlockwiseTopK() rather than CreateSortTopK().
+bool UseBlockwiseTopK(xla::int64 size, xla::int64 k);
+
+// Returns the k largest (or smallest) values along dim, in order, and their S32
+// indices, by sorting the whole dimension. Equal values are in index order.
+std::vector<xla::XlaOp> CreateSortTopK(xla::XlaOp input, xla::int64 k,
+                                       xla::int64 dim, bool largest);
+
+// Same as CreateSortTopK(), but the dimension is split into blocks of a few
+// times k values, and only the top k values of each block are kept for the
+// next round, until a single block remains. This takes O(n log(k)) rather than
+// O(n log(n)) comparisons, and selects the same values and indices.
+std::vector<xla::XlaOp> CreateBlockwiseTopK(xla::XlaOp input, xla::int64 k,
+                                            xla::int64 dim, bool largest);
+
 xla::XlaOp CreateMatMul(xla::XlaOp lhs, xla::XlaOp rhs);
 
 xla::XlaOp BuildBernoulli(xla::XlaOp probability, const xla::Shape& shape);
@@ -0,0 +1,73 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the host cost of tracing elementwise ops from Swift, which is dominated by the C API
+// calls and the tensor handle allocations rather than by any device work, and reports it as JSON:
+//
+//   op_tracing_benchmark [--ops=N] [--repetitions=N]
+
+#if os(macOS) || os(iOS) || os(watchOS) || os(tvOS)
+  import Darwin
+#else
+  import Glibc
+#endif
+
+import x10_device
+import x10_tensor
+
+func monotonicNanoseconds() -> Double {
+  var time = timespec()
+  clock_gettime(CLOCK_MONOTONIC, &time)
+  return Double(time.tv_sec) * 1e9 + Double(time.tv_nsec)
+}
+
+var opCount = 10_000
+var repetitions = 10
+for argument in CommandLine.arguments.dropFirst() {
+  let parts = argument.split(separator: "=", maxSplits: 1).map(String.init)
+  guard parts.count == 2 else { fatalError("Invalid argument: \(argument)") }
+  switch parts[0] {
+  case "--ops": opCount = Int(parts[1]) ?? opCount
+  case "--repetitions": repetitions = Int(parts[1]) ?? repetitions
+  default: fatalError("Unknown flag: \(parts[0])")
+  }
+}
+precondition(opCount > 0 && repetitions > 0, "Invalid counts")
+
+let x = Tensor<Float>(repeating: 1, shape: [4, 4])
+var nanosecondsPerOp = [Double]()
+// The first repetition warms up the handle pool and is not reported.
+for repetition in 0...repetitions {
+  let start = monotonicNanoseconds()
+  var y = x
+  for _ in 0..<opCount {
+    y = y * x + x
+  }
+  let elapsed = monotonicNanoseconds() - start
+  // The traced graph is dropped without being executed.
+  precondition(y.shape == x.shape)
+  // Each iteration traces two ops.
+  if repetition > 0 { nanosecondsPerOp.append(elapsed / Double(2 * opCount)) }
+}
+let sorted = nanosecondsPerOp.sorted()
+print(
+  """
+  {
+    "benchmark": "op_tracing",
+    "ops_per_repetition": \(2 * opCount),
+    "repetitions": \(repetitions),
+    "ns_per_op": {"min": \(Float(sorted.first!)), "median": \(Float(sorted[sorted.count / 2])), \
+  "max": \(Float(sorted.last!))}
+  }
+  """)
@@ -0,0 +1,295 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs training steps of small reference models on the default x10 device and reports the step
+// time distribution, the compilation cache behavior and the host/device time split as JSON, for
+// trend tracking, along with the peak host memory of the whole process. It is meant to be run
+// against the local computation client on CPU, so that no accelerator is needed:
+//
+//   training_benchmark [--steps=N] [--warmup=N] [--models=mlp,cnn,lstm,transformer]
+
+#if os(macOS) || os(iOS) || os(watchOS) || os(tvOS)
+  import Darwin
+#else
+  import Glibc
+#endif
+
+import x10_device
+import x10_tensor
+import x10_xla_tensor_wrapper
+
+struct MLP: Layer {
+  var dense1 = Dense<Float>(inputSize: 784, outputSize: 512, activation: relu)
+  var dense2 = Dense<Float>(inputSize: 512, outputSize: 512, activation: relu)
+  var dense3 = Dense<Float>(inputSize: 512, outputSize: 10)
+
+  @differentiable
+  func callAsFunction(_ input: Tensor<Float>) -> Tensor<Float> {
+    input.sequenced(through: dense1, dense2, dense3)
+  }
+}
+
+struct CNN: Layer {
+  var conv1 = Conv2D<Float>(filterShape: (3, 3, 1, 16), padding: .same, activation: relu)
+  var pool1 = MaxPool2D<Float>(poolSize: (2, 2), strides: (2, 2))
+  var conv2 = Conv2D<Float>(filterShape: (3, 3, 16, 32), padding: .same, activation: relu)
+  var pool2 = MaxPool2D<Float>(poolSize: (2, 2), strides: (2, 2))
+  var flatten = Flatten<Float>()
+  var dense = Dense<Float>(inputSize: 7 * 7 * 32, outputSize: 10)
+
+  @differentiable
+  func callAsFunction(_ input: Tensor<Float>) -> Tensor<Float> {
+    input.sequenced(through: conv1, pool1, conv2, pool2, flatten, dense)
+  }
+}
+
+struct LSTMClassifier: Layer {
+  var lstm = LSTM<Float>(LSTMCell(inputSize: 32, hiddenSize: 128))
+  var dense = Dense<Float>(inputSize: 128, outputSize: 10)
+
+  /// Classifies a `[batch, time, feature]` input from the last hidden state.
+  @differentiable
+  func callAsFunction(_ input: Tensor<Float>) -> Tensor<Float> {
+    let timeSteps = input.unstacked(alongAxis: 1)
+    return dense(lstm.lastOutput(from: timeSteps).hidden)
+  }
+}
+
+/// A single-head Transformer encoder block followed by a mean-pooled classifier.
+struct TransformerClassifier: Layer {
+  @noDerivative let modelSize: Int
+  var query: Dense<Float>
+  var key: Dense<Float>
+  var value: Dense<Float>
+  var output: Dense<Float>
+  var attentionNorm: LayerNorm<Float>
+  var feedForward1: Dense<Float>
+  var feedForward2: Dense<Float>
+  var feedForwardNorm: LayerNorm<Float>
+  var classifier: Dense<Float>
+
+  init(modelSize: Int, hiddenSize: Int, classCount: Int) {
+    self.modelSize = modelSize
+    query = Dense(inputSize: modelSize, outputSize: modelSize)
+    key = Dense(inputSize: modelSize, outputSize: modelSize)
+    value = Dense(inputSize: modelSize, outputSize: modelSize)
+    output = Dense(inputSize: modelSize, outputSize: modelSize)
+    attentionNorm = LayerNorm(featureCount: modelSize, axis: -1)
+    feedForward1 = Dense(inputSize: modelSize, outputSize: hiddenSize, activation: relu)
+    feedForward2 = Dense(inputSize: hiddenSize, outputSize: modelSize)
+    feedForwardNorm = LayerNorm(featureCount: modelSize, axis: -1)
+    classifier = Dense(inputSize: modelSize, outputSize: classCount)
+  }
+
+  /// Classifies a `[batch, time, feature]` input.
+  @differentiable
+  func callAsFunction(_ input: Tensor<Float>) -> Tensor<Float> {
+    let batchSize = input.shape[0]
+    let timeSteps = input.shape[1]
+    let sequenceShape: TensorShape = [batchSize, timeSteps, modelSize]
+    let x = input.reshaped(to: [batchSize * timeSteps, modelSize])
+    let q = query(x).reshaped(to: sequenceShape)
+    let k = key(x).reshaped(to: sequenceShape)
+    let v = value(x).reshaped(to: sequenceShape)
+    let scores =
+      matmul(q, k.transposed(permutation: [0, 2, 1])) / Float(modelSize).squareRoot()
+    let attention = matmul(softmax(scores), v).reshaped(to: [batchSize * timeSteps, modelSize])
+    let h = attentionNorm(x + output(attention))
+    let y = feedForwardNorm(h + feedForward2(feedForward1(h)))
+    return classifier(y.reshaped(to: sequenceShape).mean(squeezingAxes: 1))
+  }
+}
+
+/// The configuration of a benchmark run, parsed from the command line.
+struct BenchmarkOptions {
+  var steps = 50
+  var warmup = 5
+  var models = ["mlp", "cnn", "lstm", "transformer"]
+
+  init(arguments: [String]) {
+    for argument in arguments {
+      let parts = argument.split(separator: "=", maxSplits: 1).map(String.init)
+      guard parts.count == 2 else { fatalError("Invalid argument: \(argument)") }
+      let flag = parts[0]
+      switch flag {
+      case "--steps": steps = Int(parts[1]) ?? steps
+      case "--warmup": warmup = Int(parts[1]) ?? warmup
+      case "--models": models = parts[1].split(separator: ",").map(String.init)
+      default: fatalError("Unknown flag: \(flag)")
+      }
+    }
+    precondition(steps > 0 && warmup >= 0, "Invalid step counts")
+  }
+}
+
+/// The values of the x10 counters and metrics a benchmark step is charged with.
+struct MetricsSnapshot {
+  var uncachedCompiles: Int64
+  var cachedCompiles: Int64
+  var compileNanoseconds: Double
+  var deviceNanoseconds: Double
+
+  init() {
+    uncachedCompiles = GetCounterValue("UncachedCompile")
+    cachedCompiles = GetCounterValue("CachedCompile")
+    compileNanoseconds = GetMetricSummary("CompileTime").accumulator
+    // Time spent executing computations and moving data to and from the device. On the local
+    // CPU client all of these are synchronous, so they are fully charged to the step. Every
+    // execution is timed by the metric of the entry point it went through, once.
+    deviceNanoseconds =
+      GetMetricSummary("ExecuteTime").accumulator
+      + GetMetricSummary("ExecuteReplicatedTime").accumulator
+      + GetMetricSummary("ExecuteChainedTime").accumulator
+      + GetMetricSummary("TransferToServerTime").accumulator
+      + GetMetricSummary("TransferFromServerTime").accumulator
+  }
+}
+
+func monotonicNanoseconds() -> Double {
+  var time = timespec()
+  clock_gettime(CLOCK_MONOTONIC, &time)
+  return Double(time.tv_sec) * 1e9 + Double(time.tv_nsec)
+}
+
+/// Returns the peak resident set size of the process so far, in bytes. This is a high-water mark
+/// over everything the process has run, not the usage of a single model.
+func peakHostMemoryBytes() -> Int {
+  var usage = rusage()
+  getrusage(RUSAGE_SELF, &usage)
+  #if os(macOS) || os(iOS) || os(watchOS) || os(tvOS)
+    return Int(usage.ru_maxrss)
+  #else
+    return Int(usage.ru_maxrss) * 1024
+  #endif
+}
+
+func percentile(_ sortedValues: [Double], _ p: Double) -> Double {
+  let index = Int((p / 100 * Double(sortedValues.count - 1)).rounded())
+  return sortedValues[index]
+}
+
+func formatMilliseconds(_ nanoseconds: Double) -> String {
+  String(Float(nanoseconds / 1e6))
+}
+
+/// Trains `model` on a fixed batch for `options.warmup + options.steps` steps, and returns the
+/// JSON object describing the measured (non warmup) steps.
+func runBenchmark<Model: Layer>(
+  name: String, model: Model, input: Tensor<Float>, labels: Tensor<Int32>,
+  options: BenchmarkOptions, on device: Device
+) -> String
+where
+  Model.Input == Tensor<Float>, Model.Output == Tensor<Float>,
+  Model.TangentVector: VectorProtocol & ElementaryFunctions & KeyPathIterable,
+  Model.TangentVector.VectorSpaceScalar == Float
+{
+  var model = model
+  var optimizer = SGD(for: model, learningRate: 0.01)
+  Context.local.learningPhase = .training
+  LazyTensorBarrier(on: device, wait: true)
+
+  let warmupStart = MetricsSnapshot()
+  var measuredStart = warmupStart
+  var stepNanoseconds = [Double]()
+  var hostNanoseconds = 0.0
+  for step in 0..<(options.warmup + options.steps) {
+    if step == options.warmup { measuredStart = MetricsSnapshot() }
+    let before = MetricsSnapshot()
+    let start = monotonicNanoseconds()
+    let 𝛁model = gradient(at: model) { model -> Tensor<Float> in
+      softmaxCrossEntropy(logits: model(input), labels: labels)
+    }
+    optimizer.update(&model, along: 𝛁model)
+    LazyTensorBarrier(on: device, wait: true)
+    let elapsed = monotonicNanoseconds() - start
+    if step >= options.warmup {
+      let after = MetricsSnapshot()
+      stepNanoseconds.append(elapsed)
+      hostNanoseconds += elapsed - (after.deviceNanoseconds - before.deviceNanoseconds)
+    }
+  }
+  let end = MetricsSnapshot()
+
+  let sortedNanoseconds = stepNanoseconds.sorted()
+  let totalNanoseconds = stepNanoseconds.reduce(0, +)
+  let uncachedCompiles = end.uncachedCompiles - measuredStart.uncachedCompiles
+  let cachedCompiles = end.cachedCompiles - measuredStart.cachedCompiles
+  let lookups = uncachedCompiles + cachedCompiles
+  let hitRate = lookups > 0 ? Double(cachedCompiles) / Double(lookups) : 1
+  let stepCount = Double(options.steps)
+  return """
+        {"model": "\(name)", \
+    "step_time_ms": {"mean": \(formatMilliseconds(totalNanoseconds / stepCount)), \
+    "p50": \(formatMilliseconds(percentile(sortedNanoseconds, 50))), \
+    "p90": \(formatMilliseconds(percentile(sortedNanoseconds, 90))), \
+    "p99": \(formatMilliseconds(percentile(sortedNanoseconds, 99))), \
+    "min": \(formatMilliseconds(sortedNanoseconds.first!)), \
+    "max": \(formatMilliseconds(sortedNanoseconds.last!))}, \
+    "host_time_ms_mean": \(formatMilliseconds(hostNanoseconds / stepCount)), \
+    "device_time_ms_mean": \
+    \(formatMilliseconds((totalNanoseconds - hostNanoseconds) / stepCount)), \
+    "warmup_uncached_compiles": \(measuredStart.uncachedCompiles - warmupStart.uncachedCompiles), \
+    "warmup_compile_time_ms": \
+    \(formatMilliseconds(measuredStart.compileNanoseconds - warmupStart.compileNanoseconds)), \
+    "uncached_compiles": \(uncachedCompiles), \
+    "cached_compiles": \(cachedCompiles), \
+    "compile_cache_hit_rate": \(Float(hitRate)), \
+    "compile_time_ms": \
+    \(formatMilliseconds(end.compileNanoseconds - measuredStart.compileNanoseconds))}
+    """
+}
+
+let options = BenchmarkOptions(arguments: Array(CommandLine.arguments.dropFirst()))
+let device = Device.default
+var results = [String]()
+for name in options.models {
+  switch name {
+  case "mlp":
+    results.append(
+      runBenchmark(
+        name: name, model: MLP(), input: Tensor(randomNormal: [64, 784]),
+        labels: Tensor(zeros: [64]), options: options, on: device))
+  case "cnn":
+    results.append(
+      runBenchmark(
+        name: name, model: CNN(), input: Tensor(randomNormal: [32, 28, 28, 1]),
+        labels: Tensor(zeros: [32]), options: options, on: device))
+  case "lstm":
+    results.append(
+      runBenchmark(
+        name: name, model: LSTMClassifier(), input: Tensor(randomNormal: [16, 20, 32]),
+        labels: Tensor(zeros: [16]), options: options, on: device))
+  case "transformer":
+    results.append(
+      runBenchmark(
+        name: name, model: TransformerClassifier(modelSize: 128, hiddenSize: 512, classCount: 10),
+        input: Tensor(randomNormal: [8, 32, 128]),
+        labels: Tensor(zeros: [8]), options: options, on: device))
+  default:
+    fatalError("Unknown model: \(name)")
+  }
+}
+print(
+  """
+  {
+    "benchmark": "training_step",
+    "device": "\(device)",
+    "steps": \(options.steps),
+    "warmup": \(options.warmup),
+    "process_peak_host_memory_bytes": \(peakHostMemoryBytes()),
+    "results": [
+  \(results.joined(separator: ",\n"))
+    ]
+  }
+  """)
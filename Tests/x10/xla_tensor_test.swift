@@ -1,3 +1,4 @@
+import Foundation
 import XCTest
 import x10_device
 import x10_tensor
@@ -10,11 +11,137 @@ final class XLATensorTests: XCTestCase {
     LazyTensorBarrier()
     XCTAssertEqual(x.scalarized(), 20 * 30)
   }
+
+  func testFetchWhenReady() throws {
+    let x = Tensor<Int32>([2, 3]) * Tensor<Int32>([5, 7])
+    let future = x.fetchWhenReady()
+    XCTAssertEqual(future.value.scalars, [10, 21])
+    XCTAssertTrue(future.isReady)
+  }
+
+  func testInputPipeline() throws {
+    let pipeline = InputPipeline<Float, Int32>(
+      features: (0..<10).map { UInt8($0) }, featureShape: [1], labels: (0..<10).map { Int32($0) },
+      featureScale: 0.5, batchSize: 4, shuffleBufferSize: 10, workerCount: 2, seed: 7)
+    XCTAssertEqual(pipeline.batchesPerEpoch, 2)
+    for _ in 0..<3 {
+      var labels = [Int32]()
+      for (x, y) in pipeline {
+        XCTAssertEqual(x.shape, [4, 1])
+        XCTAssertEqual(y.shape, [4])
+        XCTAssertEqual(x.reshaped(to: [4]).scalars, y.scalars.map { Float($0) * 0.5 })
+        labels += y.scalars
+      }
+      XCTAssertEqual(labels.count, 8)
+      XCTAssertEqual(Set(labels).count, 8)
+    }
+  }
+
+  func testCheckpointRoundTrip() throws {
+    let directory = try makeTemporaryDirectory()
+    defer { try? FileManager.default.removeItem(at: directory) }
+    let path = directory.appendingPathComponent("round_trip.ckpt").path
+    let weight = Tensor<Float>([[1, 2], [3, 4]]) * 2
+    let bias = Tensor<Float>([0.5, -0.5])
+    X10Checkpoint.save(["weight": weight, "bias": bias], to: path)
+    let tensors: [String: Tensor<Float>] = X10Checkpoint.load(from: path)
+    XCTAssertEqual(tensors.count, 2)
+    XCTAssertEqual(tensors["weight"]!.shape, [2, 2])
+    XCTAssertEqual(tensors["weight"]!.scalars, [2, 4, 6, 8])
+    XCTAssertEqual(tensors["bias"]!.scalars, [0.5, -0.5])
+  }
+
+  func testAsyncCheckpointSave() throws {
+    let directory = try makeTemporaryDirectory()
+    defer { try? FileManager.default.removeItem(at: directory) }
+    let path = directory.appendingPathComponent("async_save.ckpt").path
+    var weight = Tensor<Float>([1, 2, 3]) * 2
+    let save = X10Checkpoint.saveAsync(["weight": weight], to: path)
+    // Updates made after the snapshot must not leak into the checkpoint.
+    weight += 1
+    LazyTensorBarrier()
+    save.wait()
+    XCTAssertTrue(save.isCompleted)
+    let tensors: [String: Tensor<Float>] = X10Checkpoint.load(from: path)
+    XCTAssertEqual(tensors["weight"]!.scalars, [2, 4, 6])
+    XCTAssertEqual(weight.scalars, [3, 5, 7])
+  }
+
+  /// The recurrent cells run as a scan, which must have the same outputs and gradients as
+  /// applying them once per time step.
+  func testRecurrentScanGradients() throws {
+    let inputs = (0..<5).map { step in
+      Tensor<Float>(shape: [3, 4], scalars: (0..<12).map { Float(sin(Double(12 * step + $0))) })
+    }
+    assertScanMatchesUnrolled(
+      SimpleRNNCell<Float>(inputSize: 4, hiddenSize: 4, seed: (0xFeed, 0xBeef)), inputs
+    ) { ($0.value * $0.value).sum() }
+    assertScanMatchesUnrolled(LSTMCell<Float>(inputSize: 4, hiddenSize: 4), inputs) {
+      ($0.hidden * $0.hidden).sum() + $0.cell.sum()
+    }
+    assertScanMatchesUnrolled(GRUCell<Float>(inputSize: 4, hiddenSize: 4), inputs) {
+      ($0.hidden * $0.hidden).sum()
+    }
+  }
+
+  /// Creates a directory of its own under the temporary directory, which the caller removes.
+  private func makeTemporaryDirectory() throws -> URL {
+    let directory = FileManager.default.temporaryDirectory.appendingPathComponent(
+      "x10_test_\(UUID().uuidString)", isDirectory: true)
+    try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: false)
+    return directory
+  }
+
+  private func assertScanMatchesUnrolled<Cell: RNNCell>(
+    _ cell: Cell, _ inputs: [Tensor<Float>],
+    _ loss: @escaping @differentiable (Cell.TimeStepOutput) -> Tensor<Float>,
+    file: StaticString = #file, line: UInt = #line
+  ) where Cell.TimeStepInput == Tensor<Float> {
+    let initialState = cell.zeroState(for: inputs[0])
+    let scanned = valueWithGradient(at: cell, inputs) { cell, inputs -> Tensor<Float> in
+      let outputs = cell.applied(over: inputs, initialState: initialState)
+      var total = Tensor<Float>(0)
+      for i in 0..<withoutDerivative(at: outputs.count) {
+        total = total + loss(outputs[i])
+      }
+      return total
+    }
+    let unrolled = valueWithGradient(at: cell, inputs) { cell, inputs -> Tensor<Float> in
+      var state = initialState
+      var total = Tensor<Float>(0)
+      for i in 0..<withoutDerivative(at: inputs.count) {
+        let output = cell(input: inputs[i], state: state)
+        state = output.state
+        total = total + loss(output.output)
+      }
+      return total
+    }
+    XCTAssert(
+      scanned.value.isAlmostEqual(to: unrolled.value, tolerance: 1e-4), file: file, line: line)
+    let (scanned𝛁cell, scanned𝛁inputs) = scanned.gradient
+    let (unrolled𝛁cell, unrolled𝛁inputs) = unrolled.gradient
+    for keyPath in unrolled𝛁cell.recursivelyAllKeyPaths(to: Tensor<Float>.self) {
+      XCTAssert(
+        scanned𝛁cell[keyPath: keyPath].isAlmostEqual(
+          to: unrolled𝛁cell[keyPath: keyPath], tolerance: 1e-4),
+        "Gradient of \(keyPath)", file: file, line: line)
+    }
+    XCTAssertEqual(scanned𝛁inputs.base.count, inputs.count, file: file, line: line)
+    for (scanned𝛁input, unrolled𝛁input) in zip(scanned𝛁inputs.base, unrolled𝛁inputs.base) {
+      XCTAssert(
+        scanned𝛁input.isAlmostEqual(to: unrolled𝛁input, tolerance: 1e-4), file: file, line: line)
+    }
+  }
 }
 
 extension XLATensorTests {
   static var allTests = [
     ("testLazyTensorBarrier", testLazyTensorBarrier),
+    ("testFetchWhenReady", testFetchWhenReady),
+    ("testInputPipeline", testInputPipeline),
+    ("testCheckpointRoundTrip", testCheckpointRoundTrip),
+    ("testAsyncCheckpointSave", testAsyncCheckpointSave),
+    ("testRecurrentScanGradients", testRecurrentScanGradients),
   ]
 }
 
@@ -74,6 +201,44 @@ final class MultiDeviceAPITests: XCTestCase {
       }
     }
   }
+
+  func testReplicatedTensorBarrier() throws {
+    let cpuDevices = Device.allDevices.filter { $0.kind == .CPU }
+    guard cpuDevices.count >= 2 else {
+      throw XCTSkip("Replication needs at least 2 CPU devices, found \(cpuDevices.count)")
+    }
+    let devices = Array(cpuDevices.prefix(2))
+    let x = Tensor<Float>([1, 2], on: devices[0])
+    x.setReplicas([Tensor<Float>([3, 4], on: devices[1])])
+    var y = x * 2
+    y.crossReplicaSum(1)
+    ReplicatedTensorBarrier(devices: devices)
+    XCTAssertEqual(y.scalars, [8, 12])
+    // The replicas keep their own copy of y, which feed the following steps.
+    var z = y + 1
+    z.crossReplicaSum(1)
+    ReplicatedTensorBarrier(devices: devices)
+    XCTAssertEqual(z.scalars, [18, 26])
+  }
+
+  func testIntegerCrossReplicaSum() throws {
+    let cpuDevices = Device.allDevices.filter { $0.kind == .CPU }
+    guard cpuDevices.count >= 2 else {
+      throw XCTSkip("Replication needs at least 2 CPU devices, found \(cpuDevices.count)")
+    }
+    let devices = Array(cpuDevices.prefix(2))
+    // Values which do not round trip through Float.
+    let x = Tensor<Int64>([1 << 40 + 1, -3], on: devices[0])
+    x.setReplicas([Tensor<Int64>([1 << 41 + 1, 5], on: devices[1])])
+    var y = x
+    y.crossReplicaSum(1)
+    let z = Tensor<Int8>(x .> 0)
+    var w = z
+    w.crossReplicaSum(1)
+    ReplicatedTensorBarrier(devices: devices)
+    XCTAssertEqual(y.scalars, [3 << 40 + 2, 2])
+    XCTAssertEqual(w.scalars, [2, 1])
+  }
 }
 
 extension MultiDeviceAPITests {
@@ -83,6 +248,8 @@ extension MultiDeviceAPITests {
     ("testSetGetReplication", testSetGetReplication),
     ("testSyncLiveTensors", testSyncLiveTensors),
     ("testCrossReplicaSum", testCrossReplicaSum),
+    ("testReplicatedTensorBarrier", testReplicatedTensorBarrier),
+    ("testIntegerCrossReplicaSum", testIntegerCrossReplicaSum),
   ]
 }
 